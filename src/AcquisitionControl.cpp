@@ -8,11 +8,15 @@
 #include "SPCFileWriter.hpp"
 #include "UniqueFileName.h"
 
+#include <algorithm>
 #include <bitset>
 #include <chrono>
 #include <cmath>
+#include <cstddef>
+#include <cstdint>
 #include <fstream>
 #include <future>
+#include <new>
 #include <string>
 #include <vector>
 
@@ -38,6 +42,26 @@ struct AcqState {
     std::future<void> logStopFinish;
 };
 
+// Memory reused by successive acquisitions, so that buffers are not
+// reallocated (and page-faulted in) when acquisition is restarted. All
+// buffers are page-aligned and faulted in when allocated during setup.
+struct AcqPools {
+    MemoryPool histograms;
+
+    // 48k events = ~5 ms at 10M events/s; 64 buffers = ~12 MiB, ~0.3 s
+    std::shared_ptr<EventBufferPool<BHSPCEvent>> eventBuffers =
+        std::make_shared<EventBufferPool<BHSPCEvent>>(48 * 1024, 64,
+                                                      SetupPolicy());
+
+    static AllocationPolicy SetupPolicy(bool largePages = false) {
+        AllocationPolicy policy;
+        policy.alignment = PageSize;
+        policy.hugePages = largePages ? HugePages::Explicit : HugePages::None;
+        policy.prefault = true;
+        return policy;
+    }
+};
+
 // All stopping of acquisition must be through this function
 static void RequestAcquisitionStop(AcqState *acqState) {
     try {
@@ -71,15 +95,17 @@ extern "C" int InitializeDeviceForAcquisition(OScDev_Device *device) {
 
 // To be called before shutting down device
 extern "C" void ShutdownAcquisitionState(OScDev_Device *device) {
-    if (GetData(device)->acqState == nullptr) {
-        return;
-    }
+    if (GetData(device)->acqState != nullptr) {
+        RequestAcquisitionStop(GetData(device)->acqState);
+        GetData(device)->acqState->finish.get();
 
-    RequestAcquisitionStop(GetData(device)->acqState);
-    GetData(device)->acqState->finish.get();
+        delete GetData(device)->acqState;
+        GetData(device)->acqState = nullptr;
+    }
 
-    delete GetData(device)->acqState;
-    GetData(device)->acqState = nullptr;
+    // The acquisition has finished, so no pooled buffers are in use
+    delete GetData(device)->pools;
+    GetData(device)->pools = nullptr;
 }
 
 static int32_t PixelsToMacroTime(double pixels, double pixelRateHz,
@@ -132,6 +158,21 @@ static int CheckMarkers(OScDev_Device *device) {
     return 0;
 }
 
+// Read a label map of one byte per raster pixel; false if the file cannot
+// be read or is not exactly that size
+static bool ReadROILabels(std::string const &path, std::size_t size,
+                          std::vector<uint8_t> &labels) {
+    std::ifstream file(path, std::ios::binary);
+    if (!file) {
+        return false;
+    }
+    labels.resize(size);
+    file.read(reinterpret_cast<char *>(labels.data()),
+              static_cast<std::streamsize>(size));
+    return file.gcount() == static_cast<std::streamsize>(size) &&
+           file.peek() == std::ifstream::traits_type::eof();
+}
+
 static void WaitForCompletionAndLog(OScDev_Device *device, AcqState *acqState,
                                     std::string const &proc) {
     auto messages = acqState->finish.get();
@@ -182,6 +223,51 @@ extern "C" int StartAcquisition(OScDev_Device *device,
     }
 
     bool accumulateIntensity = GetData(device)->accumulateIntensity;
+    bool intensityFromHistograms = GetData(device)->intensityFromHistograms;
+    uint32_t liveWindowFrames = GetData(device)->liveWindowFrames;
+    unsigned histogramThreads = GetData(device)->histogramThreadCount;
+    std::string fileNamePrefix(
+        GetData(device)->saveFiles ? GetData(device)->fileNamePrefix : "");
+    uint16_t senderPort = GetData(device)->senderPort;
+
+    // The histogram binning and ADC window are only checked if histograms
+    // (or images at the histogram ROI) are saved or sent; otherwise they are
+    // replaced with values that are always valid.
+    bool const histogramsUsed = !fileNamePrefix.empty() || senderPort != 0;
+
+    // Histogram ROI is clamped to the raster; zero size extends to the edge
+    uint32_t const *histoROI = GetData(device)->histogramROI;
+    uint32_t histoROIX = (std::min)(histoROI[0], width - 1);
+    uint32_t histoROIY = (std::min)(histoROI[1], height - 1);
+    uint32_t histoROIWidth = width - histoROIX;
+    if (histoROI[2] > 0 && histoROI[2] < histoROIWidth)
+        histoROIWidth = histoROI[2];
+    uint32_t histoROIHeight = height - histoROIY;
+    if (histoROI[3] > 0 && histoROI[3] < histoROIHeight)
+        histoROIHeight = histoROI[3];
+    uint32_t histoBinning =
+        histogramsUsed ? GetData(device)->histogramBinning : 1;
+    uint32_t histoWidth = histoROIWidth / histoBinning;
+    uint32_t histoHeight = histoROIHeight / histoBinning;
+    if (histoWidth < 1 || histoHeight < 1) {
+        OScDev_Log_Error(device,
+                         "Histogram ROI is smaller than the binning factor");
+        return 1;
+    }
+    uint32_t histoWindowStart = 0;
+    uint32_t histoWindowEnd = 4096;
+    uint32_t histoTimeBins = GetData(device)->histogramTimeBins;
+    if (histogramsUsed) {
+        histoWindowStart = GetData(device)->histogramADCWindow[0];
+        histoWindowEnd = GetData(device)->histogramADCWindow[1];
+        if (histoWindowStart >= histoWindowEnd ||
+            histoTimeBins > histoWindowEnd - histoWindowStart) {
+            OScDev_Log_Error(device,
+                             "Histogram ADC window must be nonempty and no "
+                             "smaller than the number of time bins");
+            return 1;
+        }
+    }
 
     bool lineMarkersAtLineEnds;
     switch (GetData(device)->pixelMappingMode) {
@@ -195,12 +281,159 @@ extern "C" int StartAcquisition(OScDev_Device *device,
         return 1; // Unimplemented mode
     }
     double lineDelayPixels = GetData(device)->lineDelayPx;
-    std::string fileNamePrefix(
-        GetData(device)->saveFiles ? GetData(device)->fileNamePrefix : "");
     bool compressHistograms = GetData(device)->compressHistograms;
-    uint16_t senderPort = GetData(device)->senderPort;
+    uint16_t previewPort = GetData(device)->previewPort;
+    uint16_t decayCurvePort = GetData(device)->decayCurvePort;
     bool checkSync = GetData(device)->checkSyncBeforeAcq;
 
+    ProcessingConfig procConfig;
+    procConfig.width = width;
+    procConfig.height = height;
+    procConfig.maxFrames = nFrames;
+    procConfig.channelMask = channelMask;
+    procConfig.accumulateIntensity = accumulateIntensity;
+    procConfig.intensityFromHistograms = intensityFromHistograms;
+    procConfig.meanArrivalTimeImage = GetData(device)->meanArrivalTimeImage;
+    for (uint32_t i = 0; i < GetData(device)->numTimeGates; ++i) {
+        procConfig.timeGates.push_back({GetData(device)->timeGates[i][0],
+                                        GetData(device)->timeGates[i][1]});
+    }
+    procConfig.histogramThreads = histogramThreads;
+    procConfig.histoROIX = histoROIX;
+    procConfig.histoROIY = histoROIY;
+    procConfig.histoROIWidth = histoROIWidth;
+    procConfig.histoROIHeight = histoROIHeight;
+    procConfig.histoBinning = histoBinning;
+    procConfig.histoTimeBins = histoTimeBins;
+    procConfig.histoWindowStart = histoWindowStart;
+    procConfig.histoWindowEnd = histoWindowEnd;
+    procConfig.histoTileCacheMB = GetData(device)->histogramTileCacheMB;
+    procConfig.liveWindowFrames = liveWindowFrames;
+    procConfig.phasorHarmonic = GetData(device)->phasorHarmonic;
+    procConfig.macrotimeSliceMs = GetData(device)->macrotimeSliceMs;
+    switch (GetData(device)->lifetimeMode) {
+    case LifetimeModeRapidLifetimeDetermination:
+        procConfig.sendLifetimes = true;
+        procConfig.lifetimeMethod = LifetimeMethod::RapidLifetimeDetermination;
+        break;
+    case LifetimeModeFirstMoment:
+        procConfig.sendLifetimes = true;
+        procConfig.lifetimeMethod = LifetimeMethod::FirstMoment;
+        break;
+    default:
+        procConfig.sendLifetimes = false;
+        break;
+    }
+    procConfig.previewBinning = GetData(device)->previewBinning;
+    procConfig.previewRateHz = GetData(device)->previewRateHz;
+    procConfig.fcsBinWidthNs = GetData(device)->fcsBinWidthNs;
+    procConfig.fcsTraceBinMs = GetData(device)->fcsTraceBinMs;
+    procConfig.photonBudget.totalPhotons =
+        static_cast<uint64_t>(GetData(device)->stopAtTotalPhotons);
+    procConfig.photonBudget.pixelPhotons = GetData(device)->stopAtPixelPhotons;
+    procConfig.photonBudget.pixelFraction =
+        GetData(device)->stopAtPixelPercent / 100.0;
+    procConfig.photonBudget.roiX = histoROIX;
+    procConfig.photonBudget.roiY = histoROIY;
+    procConfig.photonBudget.roiWidth = histoROIWidth;
+    procConfig.photonBudget.roiHeight = histoROIHeight;
+    procConfig.dropFramesForSlowConsumers =
+        GetData(device)->dropFramesForSlowConsumers;
+    procConfig.lineMarkerBit = lineMarkerBit;
+
+    // The label map is only read if ROI statistics are sent.
+    std::string roiLabelFile = GetData(device)->roiLabelFile;
+    if (!roiLabelFile.empty() &&
+        SendsROIStatistics(procConfig, !fileNamePrefix.empty(),
+                           senderPort != 0)) {
+        auto &roiLabels = procConfig.roiLabels;
+        if (!ReadROILabels(roiLabelFile, std::size_t(width) * height,
+                           roiLabels)) {
+            OScDev_Log_Error(device, ("Cannot read ROI label map of " +
+                                      std::to_string(width) + "x" +
+                                      std::to_string(height) +
+                                      " bytes from " + roiLabelFile)
+                                         .c_str());
+            return 1;
+        }
+        if (*std::max_element(roiLabels.begin(), roiLabels.end()) == 0) {
+            OScDev_Log_Error(device, "ROI label map contains no ROI");
+            return 1;
+        }
+    }
+
+    if (!fileNamePrefix.empty()) {
+        if (!SDTFileSupportsTimeBins(histoTimeBins)) {
+            OScDev_Log_Error(device, "Number of histogram time bins must be "
+                                     "a power of 2 for SDT files");
+            return 1;
+        }
+        SDTFileData sdtSize{};
+        sdtSize.numTimeBins = histoTimeBins;
+        sdtSize.width = histoWidth;
+        sdtSize.height = histoHeight;
+        sdtSize.numChannels = static_cast<unsigned>(channelMask.count());
+        if (!SDTFileCanHoldHistograms(&sdtSize)) {
+            OScDev_Log_Error(device, "Histograms are too large for SDT file "
+                                     "(reduce time bins, ROI, or channels, "
+                                     "or increase binning)");
+            return 1;
+        }
+    }
+
+    if (GetData(device)->pools == nullptr) {
+        GetData(device)->pools = new AcqPools();
+    }
+    auto pools = GetData(device)->pools;
+
+    // Admission control: refuse to start (before creating any files) if the
+    // histograms and images would not fit in the memory budget. Reserving
+    // the blocks up front also means that a repeated acquisition with the
+    // same settings reuses the memory of the previous one.
+    bool useLargePages = GetData(device)->useLargePages;
+    if (useLargePages && !EnableExplicitHugePages()) {
+        OScDev_Log_Warning(device, "Large pages are not available (the "
+                                   "\"Lock pages in memory\" privilege may "
+                                   "not be granted); using regular pages");
+    }
+    pools->histograms.SetPolicy(AcqPools::SetupPolicy(useLargePages));
+    std::size_t const hugePageFallbacks = GetHugePageFallbackCount();
+    uint32_t budgetMB = GetData(device)->memoryBudgetMB;
+    std::size_t const budget = budgetMB > 0 && budgetMB <= (SIZE_MAX >> 20)
+                                   ? std::size_t(budgetMB) << 20
+                                   : SIZE_MAX;
+    auto estimate = GetProcessingMemoryEstimate(
+        procConfig, !fileNamePrefix.empty(), senderPort != 0);
+    // Buffers allocated outside the pool take their share of the budget.
+    bool admitted = estimate.unpooledBytes <= budget;
+    if (admitted) {
+        pools->histograms.SetBudget(budget == SIZE_MAX
+                                        ? SIZE_MAX
+                                        : budget - estimate.unpooledBytes);
+        try {
+            admitted = pools->histograms.Reserve(estimate.poolBlockSizes);
+        } catch (std::bad_alloc const &) {
+            admitted = false;
+        }
+    }
+    if (!admitted) {
+        std::size_t required = estimate.unpooledBytes;
+        for (auto size : estimate.poolBlockSizes) {
+            required += size;
+        }
+        OScDev_Log_Error(
+            device, ("Cannot allocate " + std::to_string(required >> 20) +
+                     " MiB for histograms and images (memory budget " +
+                     std::to_string(budgetMB) + " MiB)")
+                        .c_str());
+        return 1;
+    }
+    if (useLargePages && GetHugePageFallbackCount() != hugePageFallbacks) {
+        OScDev_Log_Warning(device, "Some histogram buffers could not be "
+                                   "allocated in large pages; using regular "
+                                   "pages for them");
+    }
+
     char fileHeader[4];
     short fifoType;
     int macroTimeUnitsTenthNs;
@@ -219,6 +452,20 @@ extern "C" int StartAcquisition(OScDev_Device *device,
     if (lineMarkersAtLineEnds) {
         lineDelay -= lineTime;
     }
+    procConfig.lineDelay = lineDelay;
+    procConfig.lineTime = lineTime;
+    procConfig.macrotimeUnitsTenthNs = macroTimeUnitsTenthNs;
+
+    // Phasor phases are relative to the laser period, if known.
+    procConfig.phasorPeriodBins = 0.0;
+    double const laserRepRateMHz = GetData(device)->laserRepRateMHz;
+    if (procConfig.phasorHarmonic > 0 && laserRepRateMHz > 0.0) {
+        double adcChannelNs;
+        err = GetADCChannelWidthNs(GetData(device)->moduleNr, &adcChannelNs);
+        if (err != 0)
+            return err;
+        procConfig.phasorPeriodBins = 1000.0 / laserRepRateMHz / adcChannelNs;
+    }
 
     auto completion = std::make_shared<AcquisitionCompletion>(
         [acqState]() mutable { RequestAcquisitionStop(acqState); },
@@ -234,6 +481,9 @@ extern "C" int StartAcquisition(OScDev_Device *device,
     std::shared_ptr<SPCFileWriter> spcWriter;
     std::shared_ptr<SDTWriter> sdtWriter;
     std::shared_ptr<DataSender> dataSender;
+    std::shared_ptr<DataSender> previewSender;
+    std::shared_ptr<DataSender> decayCurveSender;
+    std::shared_ptr<MetadataJsonWriter> jsonWriter;
 
     if (!fileNamePrefix.empty()) {
         const char *const extensions[] = {".spc", ".sdt", ".json"};
@@ -249,40 +499,54 @@ extern "C" int StartAcquisition(OScDev_Device *device,
                 uniquePrefix + ".sdt",
                 static_cast<unsigned>(channelMask.count()), completion);
             sdtWriter->SetPreacquisitionData(
-                GetData(device)->moduleNr, 8, width, height,
-                compressHistograms, pixelRateHz, false,
+                GetData(device)->moduleNr, histoTimeBins, histoWindowStart,
+                histoWindowEnd, histoWidth, histoHeight, compressHistograms,
+                pixelRateHz, false,
                 GetData(device)->pixelMarkerBit < NUM_MARKER_BITS,
                 GetData(device)->lineMarkerBit < NUM_MARKER_BITS,
                 GetData(device)->frameMarkerBit < NUM_MARKER_BITS);
 
-            MetadataJsonWriter jsonWriter(uniquePrefix + ".json");
-            jsonWriter.SetChannelMask(channelMask);
-            jsonWriter.SetImageSize(width, height);
-            jsonWriter.SetPixelRateHz(pixelRateHz);
-            jsonWriter.SetMacrotimeUnitsTenthNs(macroTimeUnitsTenthNs);
-            jsonWriter.SetLineDelayAndTime(lineDelay, lineTime);
-            jsonWriter.SetMarkerSettings(false, NUM_MARKER_BITS,
+            procConfig.histoTileFile = uniquePrefix + ".tiles";
+
+            jsonWriter =
+                std::make_shared<MetadataJsonWriter>(uniquePrefix + ".json");
+            jsonWriter->SetChannelMask(channelMask);
+            jsonWriter->SetImageSize(width, height);
+            jsonWriter->SetHistogramROIAndBinning(histoROIX, histoROIY,
+                                                 histoROIWidth, histoROIHeight,
+                                                 histoBinning);
+            jsonWriter->SetHistogramTimeBinning(histoWindowStart,
+                                               histoWindowEnd, histoTimeBins);
+            jsonWriter->SetPixelRateHz(pixelRateHz);
+            jsonWriter->SetMacrotimeUnitsTenthNs(macroTimeUnitsTenthNs);
+            jsonWriter->SetLineDelayAndTime(lineDelay, lineTime);
+            jsonWriter->SetMarkerSettings(false, NUM_MARKER_BITS,
                                          GetData(device)->pixelMarkerBit,
                                          GetData(device)->lineMarkerBit,
                                          GetData(device)->frameMarkerBit);
-            jsonWriter.Save();
+            jsonWriter->Save();
         }
     }
 
     if (senderPort) {
-        dataSender = std::make_shared<DataSender>(
-            static_cast<unsigned>(channelMask.count()), senderPort,
-            completion);
+        dataSender = std::make_shared<DataSender>(senderPort, completion);
+    }
+    if (previewPort) {
+        previewSender = std::make_shared<DataSender>(previewPort, completion);
+    }
+    if (decayCurvePort) {
+        decayCurveSender =
+            std::make_shared<DataSender>(decayCurvePort, completion);
     }
 
     std::shared_ptr<EventStream<BHSPCEvent>> stream;
     try {
         completion->AddProcess("ProcessingSetup");
         auto stream_and_done = SetUpProcessing(
-            width, height, nFrames, channelMask, accumulateIntensity,
-            lineDelay, lineTime, lineMarkerBit, acq,
+            procConfig, pools->histograms, acq,
             [acqState]() mutable { RequestAcquisitionStop(acqState); },
-            spcWriter, sdtWriter, dataSender, completion);
+            spcWriter, sdtWriter, dataSender, previewSender, decayCurveSender,
+            jsonWriter, completion);
         stream = std::get<0>(stream_and_done);
         acqState->eventPumpingFinish = std::move(std::get<1>(stream_and_done));
         completion->HandleFinish("ProcessingSetup");
@@ -303,11 +567,9 @@ extern "C" int StartAcquisition(OScDev_Device *device,
         return 1;
     }
 
-    // 48k events = ~5 ms at 10M events/s
-    auto pool = std::make_shared<EventBufferPool<BHSPCEvent>>(48 * 1024);
-
     auto err_and_finish = StartAcquisitionStandardFIFO(
-        GetData(device)->moduleNr, pool, stream, stopRequested, completion);
+        GetData(device)->moduleNr, pools->eventBuffers, stream, stopRequested,
+        completion);
     err = std::get<0>(err_and_finish);
     acqState->acquisitionFinish = std::move(std::get<1>(err_and_finish));
     if (err != 0) {
@@ -32,7 +32,16 @@ static void PopulateDefaultParameters(struct BH_PrivateData *data) {
     data->lineDelayPx = 0.0;
     strcpy(data->fileNamePrefix, "OpenScan-BHSPC");
     data->senderPort = 0;
+    data->previewBinning = 4;
+    data->previewRateHz = 30.0;
+    data->fcsTraceBinMs = 10;
+    data->histogramThreadCount = 1;
+    data->histogramBinning = 1;
+    data->histogramADCWindow[0] = 0;
+    data->histogramADCWindow[1] = 4096;
+    data->histogramTimeBins = 256;
     data->checkSyncBeforeAcq = true;
+    data->stopAtPixelPercent = 100.0;
 }
 
 static OScDev_Error EnsureFLIMBoardInitialized(void) {
@@ -181,7 +190,10 @@ static OScDev_Error BH_GetPixelRates(OScDev_Device *device,
 
 static OScDev_Error BH_GetNumberOfChannels(OScDev_Device *device,
                                            uint32_t *nChannels) {
-    *nChannels = 1;
+    // Channel 0 is intensity, followed by the mean arrival time (if enabled)
+    // and the time-gated intensities
+    *nChannels = (GetData(device)->meanArrivalTimeImage ? 2 : 1) +
+                 GetData(device)->numTimeGates;
     return OScDev_OK;
 }
 
@@ -5,6 +5,7 @@
 #define WIN32_LEAN_AND_MEAN
 #include <Windows.h>
 
+struct AcqPools;   // Defined in C++
 struct AcqState;   // Defined in C++
 struct RateCounts; // Defined in C++
 
@@ -15,6 +16,45 @@ struct RateCounts; // Defined in C++
 // All BH SPC models supporting FIFO mode have 4 routing bits in FIFO mode.
 #define MAX_NUM_CHANNELS 16
 
+// Arbitrary limit for the HistogrammingThreads setting
+#define MAX_HISTOGRAM_THREADS 64
+
+// Arbitrary limit for the HistogramBinning setting
+#define MAX_HISTOGRAM_BINNING 16
+
+// Arbitrary limit for the LiveWindowFrames setting
+#define MAX_LIVE_WINDOW_FRAMES 1024
+
+// Limit on the number of gates in the TimeGates setting
+#define MAX_TIME_GATES 8
+
+// Arbitrary limit for the SendPhasorHarmonic setting
+#define MAX_PHASOR_HARMONIC 8
+
+// Arbitrary limit for the LaserRepetitionRateMHz setting
+#define MAX_LASER_REP_RATE_MHZ 1000.0
+
+// Arbitrary limit for the SendMacrotimeSlicesMs setting
+#define MAX_MACROTIME_SLICE_MS 10000
+
+// Arbitrary limits for the PreviewBinning and PreviewRateHz settings
+#define MAX_PREVIEW_BINNING 64
+#define MAX_PREVIEW_RATE_HZ 1000.0
+
+// Arbitrary limit for the StopAtTotalPhotons setting (exactly representable
+// as a double and a uint64_t)
+#define MAX_STOP_AT_TOTAL_PHOTONS 1e15
+
+// Arbitrary limits for the FCSBinWidthNs and FCSTraceBinMs settings
+#define MAX_FCS_BIN_WIDTH_NS 1000000
+#define MAX_FCS_TRACE_BIN_MS 10000
+
+// Arbitrary limit (1 TiB) for the MemoryBudgetMB setting
+#define MAX_MEMORY_BUDGET_MB (1 << 20)
+
+// Arbitrary limit (1 TiB) for the HistogramTileCacheMB setting
+#define MAX_HISTOGRAM_TILE_CACHE_MB (1 << 20)
+
 enum MarkerPolarity {
     MarkerPolarityDisabled,
     MarkerPolarityRisingEdge,
@@ -29,6 +69,14 @@ enum ScanMarkerType {
     ScanMarkerTypeFrameMarker,
 };
 
+enum LifetimeMode {
+    LifetimeModeOff,
+    LifetimeModeRapidLifetimeDetermination,
+    LifetimeModeFirstMoment,
+
+    LifetimeModeNumValues,
+};
+
 enum PixelMappingMode {
     PixelMappingModeLineStartMarkers,
     PixelMappingModeLineEndMarkers,
@@ -43,6 +91,28 @@ struct BH_PrivateData {
 
     bool accumulateIntensity;
 
+    // If nonzero, intensity images and sent histograms are the sum of the
+    // most recent liveWindowFrames frames (overriding accumulateIntensity)
+    uint32_t liveWindowFrames;
+
+    // Intensity images and sent histograms are delivered on separate
+    // threads. If the display or receiver falls behind, skip to the latest
+    // frame instead of holding up processing until it catches up.
+    bool dropFramesForSlowConsumers;
+
+    // Deliver a mean arrival time ("fast FLIM") image as a second channel,
+    // accumulated in the same way as the intensity image
+    bool meanArrivalTimeImage;
+
+    // ADC windows [start, end) of time-gated intensity images, delivered as
+    // additional channels (after intensity and mean arrival time)
+    uint32_t numTimeGates;
+    uint16_t timeGates[MAX_TIME_GATES][2];
+
+    // When histograms are being produced, compute intensity images from them
+    // instead of counting each photon a second time
+    bool intensityFromHistograms;
+
     // External marker configuration
     enum MarkerPolarity markerActiveEdges[NUM_MARKER_BITS];
     uint32_t pixelMarkerBit; // no pixel marker iff >= NUM_MARKER_BITS
@@ -58,11 +128,87 @@ struct BH_PrivateData {
 
     bool compressHistograms;
 
+    // Number of worker threads filling each FLIM histogram (1 = histogram on
+    // the event processing thread)
+    uint32_t histogramThreadCount;
+
+    // Spatial reduction of FLIM histograms (does not apply to intensity
+    // images): crop to ROI (x, y, width, height; 0 width or height extends
+    // to the edge of the raster), then bin by histogramBinning in x and y
+    uint32_t histogramROI[4];
+    uint32_t histogramBinning;
+
+    // FLIM histograms cover ADC values (microtimes; 12 bits) in
+    // [histogramADCWindow[0], histogramADCWindow[1]), divided into
+    // histogramTimeBins time bins (not greater than the window size)
+    uint32_t histogramADCWindow[2];
+    uint32_t histogramTimeBins;
+
+    // If nonzero, the saved histogram is accumulated in tiles, with this
+    // much memory for cached tiles and the rest spilled to a temporary file,
+    // allowing histograms larger than memory
+    uint32_t histogramTileCacheMB;
+
+    // Limit on histogram and intensity image memory per acquisition, in MiB
+    // (0 = unlimited); acquisition is refused if the estimate exceeds it
+    uint32_t memoryBudgetMB;
+
+    // Allocate large histograms in large pages, if permitted (requires the
+    // "Lock pages in memory" privilege; otherwise regular pages are used)
+    bool useLargePages;
+
     // Port number on local host to which UDP messages are sent
     uint16_t senderPort;
 
+    // If nonzero, send per-pixel phasors at this harmonic (of the laser
+    // period) instead of histograms
+    uint32_t phasorHarmonic;
+
+    // Laser repetition rate, for phasors (0 = take the TAC range as the
+    // laser period)
+    double laserRepRateMHz;
+
+    // If nonzero (and not sending phasors), send per-channel intensity
+    // images of consecutive macrotime slices of this duration instead of
+    // histograms
+    uint32_t macrotimeSliceMs;
+
+    // Unless Off (or sending phasors or slices), send per-pixel lifetime
+    // estimates instead of histograms
+    enum LifetimeMode lifetimeMode;
+
+    // If nonzero, port on local host to which the microtime histogram of all
+    // photons (per channel, at full ADC resolution) is sent periodically,
+    // regardless of other outputs
+    uint16_t decayCurvePort;
+
+    // If not empty, a file of one uint8 label per raster pixel (row-major;
+    // 0 = none, n = ROI n - 1); per-ROI photon counts and decay curves are
+    // sent instead of histograms (unless sending phasors, slices, or
+    // lifetimes)
+    char roiLabelFile[OScDev_MAX_STR_SIZE];
+
+    // If nonzero (and saving files), correlate the photons of each channel
+    // and pair of channels with this shortest lag, and record intensity
+    // traces binned by fcsTraceBinMs, in the metadata file
+    uint32_t fcsBinWidthNs;
+    uint32_t fcsTraceBinMs;
+
+    // If nonzero, port on local host to which a low-resolution intensity
+    // preview (binned by previewBinning in x and y) is sent previewRateHz
+    // times per second of macrotime and once at the end of the acquisition
+    uint16_t previewPort;
+    uint32_t previewBinning;
+    double previewRateHz;
+
     bool checkSyncBeforeAcq;
 
+    // Stop the acquisition early once photon count targets within the
+    // histogram ROI are reached (0 = no target)
+    double stopAtTotalPhotons;
+    uint32_t stopAtPixelPhotons;
+    double stopAtPixelPercent; // Of ROI pixels that must have the count
+
     // C++ data for rate counter monitoring. Manually initialized on device
     // open; deleted on device close.
     struct RateCounts *rates;
@@ -73,6 +219,10 @@ struct BH_PrivateData {
     // acquisition, the old AcqState must only be deallocated in the context
     // of a call from OpenScanLib.
     struct AcqState *acqState;
+
+    // C++ memory pools kept across acquisitions. Created by the first
+    // acquisition; deleted together with acqState.
+    struct AcqPools *pools;
 };
 
 static inline struct BH_PrivateData *GetData(OScDev_Device *device) {
@@ -3,6 +3,7 @@
 #include "RateCounters.h"
 
 #include <stdio.h>
+#include <stdlib.h>
 
 // For most settings, we set the setting's implData to the device.
 // This function can then be used to retrieve the device implData.
@@ -83,6 +84,159 @@ static OScDev_SettingImpl SettingImpl_IntensityImagesCumulative = {
     .SetBool = SetIntensityImagesCumulative,
 };
 
+static OScDev_Error GetLiveWindowFramesRange(OScDev_Setting *setting,
+                                             int32_t *min, int32_t *max) {
+    *min = 0;
+    *max = MAX_LIVE_WINDOW_FRAMES;
+    return OScDev_OK;
+}
+
+static OScDev_Error GetLiveWindowFrames(OScDev_Setting *setting,
+                                        int32_t *value) {
+    *value = GetSettingDeviceData(setting)->liveWindowFrames;
+    return OScDev_OK;
+}
+
+static OScDev_Error SetLiveWindowFrames(OScDev_Setting *setting,
+                                        int32_t value) {
+    if (value < 0)
+        value = 0;
+    if (value > MAX_LIVE_WINDOW_FRAMES)
+        value = MAX_LIVE_WINDOW_FRAMES;
+    GetSettingDeviceData(setting)->liveWindowFrames = value;
+    return OScDev_OK;
+}
+
+static OScDev_SettingImpl SettingImpl_LiveWindowFrames = {
+    .GetNumericConstraintType = GetNumericConstraintTypeImpl_Range,
+    .GetInt32Range = GetLiveWindowFramesRange,
+    .GetInt32 = GetLiveWindowFrames,
+    .SetInt32 = SetLiveWindowFrames,
+};
+
+static OScDev_Error GetDropFramesForSlowConsumers(OScDev_Setting *setting,
+                                                  bool *value) {
+    *value = GetSettingDeviceData(setting)->dropFramesForSlowConsumers;
+    return OScDev_OK;
+}
+
+static OScDev_Error SetDropFramesForSlowConsumers(OScDev_Setting *setting,
+                                                  bool value) {
+    GetSettingDeviceData(setting)->dropFramesForSlowConsumers = value;
+    return OScDev_OK;
+}
+
+static OScDev_SettingImpl SettingImpl_DropFramesForSlowConsumers = {
+    .GetBool = GetDropFramesForSlowConsumers,
+    .SetBool = SetDropFramesForSlowConsumers,
+};
+
+static OScDev_Error GetMeanArrivalTimeImage(OScDev_Setting *setting,
+                                            bool *value) {
+    *value = GetSettingDeviceData(setting)->meanArrivalTimeImage;
+    return OScDev_OK;
+}
+
+static OScDev_Error SetMeanArrivalTimeImage(OScDev_Setting *setting,
+                                            bool value) {
+    GetSettingDeviceData(setting)->meanArrivalTimeImage = value;
+    return OScDev_OK;
+}
+
+static OScDev_SettingImpl SettingImpl_MeanArrivalTimeImage = {
+    .GetBool = GetMeanArrivalTimeImage,
+    .SetBool = SetMeanArrivalTimeImage,
+};
+
+// Parse "start-end,start-end,..." (ADC values; empty for no gates). Returns
+// false if malformed, out of range, too many, or overlapping.
+static bool ParseTimeGates(const char *spec, uint16_t gates[][2],
+                           uint32_t *numGates) {
+    uint32_t n = 0;
+    const char *p = spec;
+    while (*p == ' ')
+        ++p;
+    while (*p != '\0') {
+        if (n == MAX_TIME_GATES)
+            return false;
+        char *end;
+        unsigned long start = strtoul(p, &end, 10);
+        if (end == p || *end != '-')
+            return false;
+        p = end + 1;
+        unsigned long stop = strtoul(p, &end, 10);
+        if (end == p || start >= stop || stop > 4096)
+            return false;
+        for (uint32_t i = 0; i < n; ++i) {
+            if (start < gates[i][1] && gates[i][0] < stop)
+                return false;
+        }
+        gates[n][0] = (uint16_t)start;
+        gates[n][1] = (uint16_t)stop;
+        ++n;
+
+        p = end;
+        while (*p == ' ')
+            ++p;
+        if (*p == ',') {
+            ++p;
+            while (*p == ' ')
+                ++p;
+            if (*p == '\0')
+                return false;
+        } else if (*p != '\0') {
+            return false;
+        }
+    }
+    *numGates = n;
+    return true;
+}
+
+static OScDev_Error GetTimeGates(OScDev_Setting *setting, char *value) {
+    struct BH_PrivateData *data = GetSettingDeviceData(setting);
+    size_t len = 0;
+    value[0] = '\0';
+    for (uint32_t i = 0; i < data->numTimeGates; ++i) {
+        len += snprintf(value + len, OScDev_MAX_STR_SIZE - len, "%s%u-%u",
+                        i > 0 ? "," : "", (unsigned)data->timeGates[i][0],
+                        (unsigned)data->timeGates[i][1]);
+    }
+    return OScDev_OK;
+}
+
+static OScDev_Error SetTimeGates(OScDev_Setting *setting, const char *value) {
+    uint16_t gates[MAX_TIME_GATES][2];
+    uint32_t numGates;
+    if (!ParseTimeGates(value, gates, &numGates))
+        return OScDev_Error_Illegal_Argument;
+    struct BH_PrivateData *data = GetSettingDeviceData(setting);
+    memcpy(data->timeGates, gates, sizeof(gates));
+    data->numTimeGates = numGates;
+    return OScDev_OK;
+}
+
+static OScDev_SettingImpl SettingImpl_TimeGates = {
+    .GetString = GetTimeGates,
+    .SetString = SetTimeGates,
+};
+
+static OScDev_Error GetIntensityFromHistograms(OScDev_Setting *setting,
+                                               bool *value) {
+    *value = GetSettingDeviceData(setting)->intensityFromHistograms;
+    return OScDev_OK;
+}
+
+static OScDev_Error SetIntensityFromHistograms(OScDev_Setting *setting,
+                                               bool value) {
+    GetSettingDeviceData(setting)->intensityFromHistograms = value;
+    return OScDev_OK;
+}
+
+static OScDev_SettingImpl SettingImpl_IntensityFromHistograms = {
+    .GetBool = GetIntensityFromHistograms,
+    .SetBool = SetIntensityFromHistograms,
+};
+
 struct MarkerActiveEdgeSettingData {
     OScDev_Device *device;
     uint32_t markerBit;
@@ -398,6 +552,413 @@ static OScDev_SettingImpl SettingImpl_SenderPort = {
     .SetInt32 = SetSenderPort,
 };
 
+static OScDev_Error GetPhasorHarmonicRange(OScDev_Setting *setting,
+                                           int32_t *min, int32_t *max) {
+    *min = 0;
+    *max = MAX_PHASOR_HARMONIC;
+    return OScDev_OK;
+}
+
+static OScDev_Error GetPhasorHarmonic(OScDev_Setting *setting,
+                                      int32_t *value) {
+    *value = GetSettingDeviceData(setting)->phasorHarmonic;
+    return OScDev_OK;
+}
+
+static OScDev_Error SetPhasorHarmonic(OScDev_Setting *setting,
+                                      int32_t value) {
+    if (value < 0)
+        value = 0;
+    if (value > MAX_PHASOR_HARMONIC)
+        value = MAX_PHASOR_HARMONIC;
+    GetSettingDeviceData(setting)->phasorHarmonic = value;
+    return OScDev_OK;
+}
+
+static OScDev_SettingImpl SettingImpl_PhasorHarmonic = {
+    .GetNumericConstraintType = GetNumericConstraintTypeImpl_Range,
+    .GetInt32Range = GetPhasorHarmonicRange,
+    .GetInt32 = GetPhasorHarmonic,
+    .SetInt32 = SetPhasorHarmonic,
+};
+
+static OScDev_Error GetLaserRepRateMHzRange(OScDev_Setting *setting,
+                                            double *min, double *max) {
+    *min = 0.0;
+    *max = MAX_LASER_REP_RATE_MHZ;
+    return OScDev_OK;
+}
+
+static OScDev_Error GetLaserRepRateMHz(OScDev_Setting *setting,
+                                       double *value) {
+    *value = GetSettingDeviceData(setting)->laserRepRateMHz;
+    return OScDev_OK;
+}
+
+static OScDev_Error SetLaserRepRateMHz(OScDev_Setting *setting,
+                                       double value) {
+    if (!(value >= 0.0))
+        value = 0.0;
+    if (value > MAX_LASER_REP_RATE_MHZ)
+        value = MAX_LASER_REP_RATE_MHZ;
+    GetSettingDeviceData(setting)->laserRepRateMHz = value;
+    return OScDev_OK;
+}
+
+static OScDev_SettingImpl SettingImpl_LaserRepRateMHz = {
+    .GetNumericConstraintType = GetNumericConstraintTypeImpl_Range,
+    .GetFloat64Range = GetLaserRepRateMHzRange,
+    .GetFloat64 = GetLaserRepRateMHz,
+    .SetFloat64 = SetLaserRepRateMHz,
+};
+
+static OScDev_Error GetMacrotimeSliceMsRange(OScDev_Setting *setting,
+                                             int32_t *min, int32_t *max) {
+    *min = 0;
+    *max = MAX_MACROTIME_SLICE_MS;
+    return OScDev_OK;
+}
+
+static OScDev_Error GetMacrotimeSliceMs(OScDev_Setting *setting,
+                                        int32_t *value) {
+    *value = GetSettingDeviceData(setting)->macrotimeSliceMs;
+    return OScDev_OK;
+}
+
+static OScDev_Error SetMacrotimeSliceMs(OScDev_Setting *setting,
+                                        int32_t value) {
+    if (value < 0)
+        value = 0;
+    if (value > MAX_MACROTIME_SLICE_MS)
+        value = MAX_MACROTIME_SLICE_MS;
+    GetSettingDeviceData(setting)->macrotimeSliceMs = value;
+    return OScDev_OK;
+}
+
+static OScDev_SettingImpl SettingImpl_MacrotimeSliceMs = {
+    .GetNumericConstraintType = GetNumericConstraintTypeImpl_Range,
+    .GetInt32Range = GetMacrotimeSliceMsRange,
+    .GetInt32 = GetMacrotimeSliceMs,
+    .SetInt32 = SetMacrotimeSliceMs,
+};
+
+static OScDev_Error GetLifetimeModeNumValues(OScDev_Setting *setting,
+                                             uint32_t *count) {
+    *count = LifetimeModeNumValues;
+    return OScDev_OK;
+}
+
+static OScDev_Error GetLifetimeModeNameForValue(OScDev_Setting *setting,
+                                                uint32_t value, char *name) {
+    switch (value) {
+    case LifetimeModeOff:
+        strcpy(name, "Off");
+        break;
+    case LifetimeModeRapidLifetimeDetermination:
+        strcpy(name, "RapidLifetimeDetermination");
+        break;
+    case LifetimeModeFirstMoment:
+        strcpy(name, "FirstMoment");
+        break;
+    default:
+        return OScDev_Error_Illegal_Argument;
+    }
+    return OScDev_OK;
+}
+
+static OScDev_Error GetLifetimeModeValueForName(OScDev_Setting *setting,
+                                                uint32_t *value,
+                                                const char *name) {
+    if (strcmp(name, "Off") == 0) {
+        *value = LifetimeModeOff;
+    } else if (strcmp(name, "RapidLifetimeDetermination") == 0) {
+        *value = LifetimeModeRapidLifetimeDetermination;
+    } else if (strcmp(name, "FirstMoment") == 0) {
+        *value = LifetimeModeFirstMoment;
+    } else {
+        return OScDev_Error_Illegal_Argument;
+    }
+    return OScDev_OK;
+}
+
+static OScDev_Error GetLifetimeMode(OScDev_Setting *setting,
+                                    uint32_t *value) {
+    *value = GetSettingDeviceData(setting)->lifetimeMode;
+    return OScDev_OK;
+}
+
+static OScDev_Error SetLifetimeMode(OScDev_Setting *setting, uint32_t value) {
+    GetSettingDeviceData(setting)->lifetimeMode = value;
+    return OScDev_OK;
+}
+
+static OScDev_SettingImpl SettingImpl_LifetimeMode = {
+    .GetEnumNumValues = GetLifetimeModeNumValues,
+    .GetEnumNameForValue = GetLifetimeModeNameForValue,
+    .GetEnumValueForName = GetLifetimeModeValueForName,
+    .GetEnum = GetLifetimeMode,
+    .SetEnum = SetLifetimeMode,
+};
+
+static OScDev_Error GetDecayCurvePort(OScDev_Setting *setting,
+                                      int32_t *value) {
+    *value = GetSettingDeviceData(setting)->decayCurvePort;
+    return OScDev_OK;
+}
+
+static OScDev_Error SetDecayCurvePort(OScDev_Setting *setting,
+                                      int32_t value) {
+    if (value < 0 || value > 65535)
+        value = 0;
+    GetSettingDeviceData(setting)->decayCurvePort = value;
+    return OScDev_OK;
+}
+
+static OScDev_SettingImpl SettingImpl_DecayCurvePort = {
+    .GetInt32 = GetDecayCurvePort,
+    .SetInt32 = SetDecayCurvePort,
+};
+
+static OScDev_Error GetFCSBinWidthNsRange(OScDev_Setting *setting,
+                                          int32_t *min, int32_t *max) {
+    *min = 0;
+    *max = MAX_FCS_BIN_WIDTH_NS;
+    return OScDev_OK;
+}
+
+static OScDev_Error GetFCSBinWidthNs(OScDev_Setting *setting,
+                                     int32_t *value) {
+    *value = GetSettingDeviceData(setting)->fcsBinWidthNs;
+    return OScDev_OK;
+}
+
+static OScDev_Error SetFCSBinWidthNs(OScDev_Setting *setting,
+                                     int32_t value) {
+    if (value < 0)
+        value = 0;
+    if (value > MAX_FCS_BIN_WIDTH_NS)
+        value = MAX_FCS_BIN_WIDTH_NS;
+    GetSettingDeviceData(setting)->fcsBinWidthNs = value;
+    return OScDev_OK;
+}
+
+static OScDev_SettingImpl SettingImpl_FCSBinWidthNs = {
+    .GetNumericConstraintType = GetNumericConstraintTypeImpl_Range,
+    .GetInt32Range = GetFCSBinWidthNsRange,
+    .GetInt32 = GetFCSBinWidthNs,
+    .SetInt32 = SetFCSBinWidthNs,
+};
+
+static OScDev_Error GetFCSTraceBinMsRange(OScDev_Setting *setting,
+                                          int32_t *min, int32_t *max) {
+    *min = 1;
+    *max = MAX_FCS_TRACE_BIN_MS;
+    return OScDev_OK;
+}
+
+static OScDev_Error GetFCSTraceBinMs(OScDev_Setting *setting,
+                                     int32_t *value) {
+    *value = GetSettingDeviceData(setting)->fcsTraceBinMs;
+    return OScDev_OK;
+}
+
+static OScDev_Error SetFCSTraceBinMs(OScDev_Setting *setting,
+                                     int32_t value) {
+    if (value < 1)
+        value = 1;
+    if (value > MAX_FCS_TRACE_BIN_MS)
+        value = MAX_FCS_TRACE_BIN_MS;
+    GetSettingDeviceData(setting)->fcsTraceBinMs = value;
+    return OScDev_OK;
+}
+
+static OScDev_SettingImpl SettingImpl_FCSTraceBinMs = {
+    .GetNumericConstraintType = GetNumericConstraintTypeImpl_Range,
+    .GetInt32Range = GetFCSTraceBinMsRange,
+    .GetInt32 = GetFCSTraceBinMs,
+    .SetInt32 = SetFCSTraceBinMs,
+};
+
+static OScDev_Error GetROILabelFile(OScDev_Setting *setting, char *value) {
+    strcpy(value, GetSettingDeviceData(setting)->roiLabelFile);
+    return OScDev_OK;
+}
+
+static OScDev_Error SetROILabelFile(OScDev_Setting *setting,
+                                    const char *value) {
+    strcpy(GetSettingDeviceData(setting)->roiLabelFile, value);
+    return OScDev_OK;
+}
+
+static OScDev_SettingImpl SettingImpl_ROILabelFile = {
+    .GetString = GetROILabelFile,
+    .SetString = SetROILabelFile,
+};
+
+static OScDev_Error GetPreviewPort(OScDev_Setting *setting, int32_t *value) {
+    *value = GetSettingDeviceData(setting)->previewPort;
+    return OScDev_OK;
+}
+
+static OScDev_Error SetPreviewPort(OScDev_Setting *setting, int32_t value) {
+    if (value < 0 || value > 65535)
+        value = 0;
+    GetSettingDeviceData(setting)->previewPort = value;
+    return OScDev_OK;
+}
+
+static OScDev_SettingImpl SettingImpl_PreviewPort = {
+    .GetInt32 = GetPreviewPort,
+    .SetInt32 = SetPreviewPort,
+};
+
+static OScDev_Error GetPreviewBinningRange(OScDev_Setting *setting,
+                                           int32_t *min, int32_t *max) {
+    *min = 1;
+    *max = MAX_PREVIEW_BINNING;
+    return OScDev_OK;
+}
+
+static OScDev_Error GetPreviewBinning(OScDev_Setting *setting,
+                                      int32_t *value) {
+    *value = GetSettingDeviceData(setting)->previewBinning;
+    return OScDev_OK;
+}
+
+static OScDev_Error SetPreviewBinning(OScDev_Setting *setting,
+                                      int32_t value) {
+    if (value < 1)
+        value = 1;
+    if (value > MAX_PREVIEW_BINNING)
+        value = MAX_PREVIEW_BINNING;
+    GetSettingDeviceData(setting)->previewBinning = value;
+    return OScDev_OK;
+}
+
+static OScDev_SettingImpl SettingImpl_PreviewBinning = {
+    .GetNumericConstraintType = GetNumericConstraintTypeImpl_Range,
+    .GetInt32Range = GetPreviewBinningRange,
+    .GetInt32 = GetPreviewBinning,
+    .SetInt32 = SetPreviewBinning,
+};
+
+static OScDev_Error GetPreviewRateHzRange(OScDev_Setting *setting,
+                                          double *min, double *max) {
+    *min = 1.0;
+    *max = MAX_PREVIEW_RATE_HZ;
+    return OScDev_OK;
+}
+
+static OScDev_Error GetPreviewRateHz(OScDev_Setting *setting,
+                                     double *value) {
+    *value = GetSettingDeviceData(setting)->previewRateHz;
+    return OScDev_OK;
+}
+
+static OScDev_Error SetPreviewRateHz(OScDev_Setting *setting, double value) {
+    if (!(value >= 1.0))
+        value = 1.0;
+    if (value > MAX_PREVIEW_RATE_HZ)
+        value = MAX_PREVIEW_RATE_HZ;
+    GetSettingDeviceData(setting)->previewRateHz = value;
+    return OScDev_OK;
+}
+
+static OScDev_SettingImpl SettingImpl_PreviewRateHz = {
+    .GetNumericConstraintType = GetNumericConstraintTypeImpl_Range,
+    .GetFloat64Range = GetPreviewRateHzRange,
+    .GetFloat64 = GetPreviewRateHz,
+    .SetFloat64 = SetPreviewRateHz,
+};
+
+static OScDev_Error GetStopAtTotalPhotonsRange(OScDev_Setting *setting,
+                                               double *min, double *max) {
+    *min = 0.0;
+    *max = MAX_STOP_AT_TOTAL_PHOTONS;
+    return OScDev_OK;
+}
+
+static OScDev_Error GetStopAtTotalPhotons(OScDev_Setting *setting,
+                                          double *value) {
+    *value = GetSettingDeviceData(setting)->stopAtTotalPhotons;
+    return OScDev_OK;
+}
+
+static OScDev_Error SetStopAtTotalPhotons(OScDev_Setting *setting,
+                                          double value) {
+    if (!(value >= 0.0))
+        value = 0.0;
+    if (value > MAX_STOP_AT_TOTAL_PHOTONS)
+        value = MAX_STOP_AT_TOTAL_PHOTONS;
+    GetSettingDeviceData(setting)->stopAtTotalPhotons = value;
+    return OScDev_OK;
+}
+
+static OScDev_SettingImpl SettingImpl_StopAtTotalPhotons = {
+    .GetNumericConstraintType = GetNumericConstraintTypeImpl_Range,
+    .GetFloat64Range = GetStopAtTotalPhotonsRange,
+    .GetFloat64 = GetStopAtTotalPhotons,
+    .SetFloat64 = SetStopAtTotalPhotons,
+};
+
+static OScDev_Error GetStopAtPixelPhotonsRange(OScDev_Setting *setting,
+                                               int32_t *min, int32_t *max) {
+    *min = 0;
+    *max = INT32_MAX;
+    return OScDev_OK;
+}
+
+static OScDev_Error GetStopAtPixelPhotons(OScDev_Setting *setting,
+                                          int32_t *value) {
+    *value = GetSettingDeviceData(setting)->stopAtPixelPhotons;
+    return OScDev_OK;
+}
+
+static OScDev_Error SetStopAtPixelPhotons(OScDev_Setting *setting,
+                                          int32_t value) {
+    if (value < 0)
+        value = 0;
+    GetSettingDeviceData(setting)->stopAtPixelPhotons = value;
+    return OScDev_OK;
+}
+
+static OScDev_SettingImpl SettingImpl_StopAtPixelPhotons = {
+    .GetNumericConstraintType = GetNumericConstraintTypeImpl_Range,
+    .GetInt32Range = GetStopAtPixelPhotonsRange,
+    .GetInt32 = GetStopAtPixelPhotons,
+    .SetInt32 = SetStopAtPixelPhotons,
+};
+
+static OScDev_Error GetStopAtPixelPercentRange(OScDev_Setting *setting,
+                                               double *min, double *max) {
+    *min = 0.0;
+    *max = 100.0;
+    return OScDev_OK;
+}
+
+static OScDev_Error GetStopAtPixelPercent(OScDev_Setting *setting,
+                                          double *value) {
+    *value = GetSettingDeviceData(setting)->stopAtPixelPercent;
+    return OScDev_OK;
+}
+
+static OScDev_Error SetStopAtPixelPercent(OScDev_Setting *setting,
+                                          double value) {
+    if (!(value >= 0.0))
+        value = 0.0;
+    if (value > 100.0)
+        value = 100.0;
+    GetSettingDeviceData(setting)->stopAtPixelPercent = value;
+    return OScDev_OK;
+}
+
+static OScDev_SettingImpl SettingImpl_StopAtPixelPercent = {
+    .GetNumericConstraintType = GetNumericConstraintTypeImpl_Range,
+    .GetFloat64Range = GetStopAtPixelPercentRange,
+    .GetFloat64 = GetStopAtPixelPercent,
+    .SetFloat64 = SetStopAtPixelPercent,
+};
+
 static OScDev_Error GetSDTCompression(OScDev_Setting *setting, bool *value) {
     *value = GetSettingDeviceData(setting)->compressHistograms;
     return OScDev_OK;
@@ -413,6 +974,255 @@ static OScDev_SettingImpl SettingImpl_SDTCompression = {
     .SetBool = SetSDTCompression,
 };
 
+static OScDev_Error GetHistogrammingThreadsRange(OScDev_Setting *setting,
+                                                 int32_t *min, int32_t *max) {
+    *min = 1;
+    *max = MAX_HISTOGRAM_THREADS;
+    return OScDev_OK;
+}
+
+static OScDev_Error GetHistogrammingThreads(OScDev_Setting *setting,
+                                            int32_t *value) {
+    *value = GetSettingDeviceData(setting)->histogramThreadCount;
+    return OScDev_OK;
+}
+
+static OScDev_Error SetHistogrammingThreads(OScDev_Setting *setting,
+                                            int32_t value) {
+    if (value < 1)
+        value = 1;
+    if (value > MAX_HISTOGRAM_THREADS)
+        value = MAX_HISTOGRAM_THREADS;
+    GetSettingDeviceData(setting)->histogramThreadCount = value;
+    return OScDev_OK;
+}
+
+static OScDev_SettingImpl SettingImpl_HistogrammingThreads = {
+    .GetNumericConstraintType = GetNumericConstraintTypeImpl_Range,
+    .GetInt32Range = GetHistogrammingThreadsRange,
+    .GetInt32 = GetHistogrammingThreads,
+    .SetInt32 = SetHistogrammingThreads,
+};
+
+static OScDev_Error GetHistogramTimeBinsRange(OScDev_Setting *setting,
+                                              int32_t *min, int32_t *max) {
+    *min = 1;
+    *max = 4096;
+    return OScDev_OK;
+}
+
+static OScDev_Error GetHistogramTimeBins(OScDev_Setting *setting,
+                                         int32_t *value) {
+    *value = GetSettingDeviceData(setting)->histogramTimeBins;
+    return OScDev_OK;
+}
+
+static OScDev_Error SetHistogramTimeBins(OScDev_Setting *setting,
+                                         int32_t value) {
+    if (value < 1)
+        value = 1;
+    if (value > 4096)
+        value = 4096;
+    GetSettingDeviceData(setting)->histogramTimeBins = value;
+    return OScDev_OK;
+}
+
+static OScDev_SettingImpl SettingImpl_HistogramTimeBins = {
+    .GetNumericConstraintType = GetNumericConstraintTypeImpl_Range,
+    .GetInt32Range = GetHistogramTimeBinsRange,
+    .GetInt32 = GetHistogramTimeBins,
+    .SetInt32 = SetHistogramTimeBins,
+};
+
+static OScDev_Error GetHistogramADCWindowRange(OScDev_Setting *setting,
+                                               int32_t *min, int32_t *max) {
+    *min = 0;
+    *max = 4096;
+    return OScDev_OK;
+}
+
+static OScDev_Error GetHistogramADCWindowStart(OScDev_Setting *setting,
+                                               int32_t *value) {
+    *value = GetSettingDeviceData(setting)->histogramADCWindow[0];
+    return OScDev_OK;
+}
+
+static OScDev_Error SetHistogramADCWindowStart(OScDev_Setting *setting,
+                                               int32_t value) {
+    if (value < 0)
+        value = 0;
+    if (value > 4095)
+        value = 4095;
+    GetSettingDeviceData(setting)->histogramADCWindow[0] = value;
+    return OScDev_OK;
+}
+
+static OScDev_SettingImpl SettingImpl_HistogramADCWindowStart = {
+    .GetNumericConstraintType = GetNumericConstraintTypeImpl_Range,
+    .GetInt32Range = GetHistogramADCWindowRange,
+    .GetInt32 = GetHistogramADCWindowStart,
+    .SetInt32 = SetHistogramADCWindowStart,
+};
+
+static OScDev_Error GetHistogramADCWindowEnd(OScDev_Setting *setting,
+                                             int32_t *value) {
+    *value = GetSettingDeviceData(setting)->histogramADCWindow[1];
+    return OScDev_OK;
+}
+
+static OScDev_Error SetHistogramADCWindowEnd(OScDev_Setting *setting,
+                                             int32_t value) {
+    if (value < 1)
+        value = 1;
+    if (value > 4096)
+        value = 4096;
+    GetSettingDeviceData(setting)->histogramADCWindow[1] = value;
+    return OScDev_OK;
+}
+
+static OScDev_SettingImpl SettingImpl_HistogramADCWindowEnd = {
+    .GetNumericConstraintType = GetNumericConstraintTypeImpl_Range,
+    .GetInt32Range = GetHistogramADCWindowRange,
+    .GetInt32 = GetHistogramADCWindowEnd,
+    .SetInt32 = SetHistogramADCWindowEnd,
+};
+
+static OScDev_Error GetHistogramTileCacheMBRange(OScDev_Setting *setting,
+                                                 int32_t *min, int32_t *max) {
+    *min = 0;
+    *max = MAX_HISTOGRAM_TILE_CACHE_MB;
+    return OScDev_OK;
+}
+
+static OScDev_Error GetHistogramTileCacheMB(OScDev_Setting *setting,
+                                            int32_t *value) {
+    *value = GetSettingDeviceData(setting)->histogramTileCacheMB;
+    return OScDev_OK;
+}
+
+static OScDev_Error SetHistogramTileCacheMB(OScDev_Setting *setting,
+                                            int32_t value) {
+    if (value < 0)
+        value = 0;
+    if (value > MAX_HISTOGRAM_TILE_CACHE_MB)
+        value = MAX_HISTOGRAM_TILE_CACHE_MB;
+    GetSettingDeviceData(setting)->histogramTileCacheMB = value;
+    return OScDev_OK;
+}
+
+static OScDev_SettingImpl SettingImpl_HistogramTileCacheMB = {
+    .GetNumericConstraintType = GetNumericConstraintTypeImpl_Range,
+    .GetInt32Range = GetHistogramTileCacheMBRange,
+    .GetInt32 = GetHistogramTileCacheMB,
+    .SetInt32 = SetHistogramTileCacheMB,
+};
+
+static OScDev_Error GetMemoryBudgetMBRange(OScDev_Setting *setting,
+                                           int32_t *min, int32_t *max) {
+    *min = 0;
+    *max = MAX_MEMORY_BUDGET_MB;
+    return OScDev_OK;
+}
+
+static OScDev_Error GetMemoryBudgetMB(OScDev_Setting *setting,
+                                     int32_t *value) {
+    *value = GetSettingDeviceData(setting)->memoryBudgetMB;
+    return OScDev_OK;
+}
+
+static OScDev_Error SetMemoryBudgetMB(OScDev_Setting *setting,
+                                     int32_t value) {
+    if (value < 0)
+        value = 0;
+    if (value > MAX_MEMORY_BUDGET_MB)
+        value = MAX_MEMORY_BUDGET_MB;
+    GetSettingDeviceData(setting)->memoryBudgetMB = value;
+    return OScDev_OK;
+}
+
+static OScDev_SettingImpl SettingImpl_MemoryBudgetMB = {
+    .GetNumericConstraintType = GetNumericConstraintTypeImpl_Range,
+    .GetInt32Range = GetMemoryBudgetMBRange,
+    .GetInt32 = GetMemoryBudgetMB,
+    .SetInt32 = SetMemoryBudgetMB,
+};
+
+static OScDev_Error GetUseLargePages(OScDev_Setting *setting, bool *value) {
+    *value = GetSettingDeviceData(setting)->useLargePages;
+    return OScDev_OK;
+}
+
+static OScDev_Error SetUseLargePages(OScDev_Setting *setting, bool value) {
+    GetSettingDeviceData(setting)->useLargePages = value;
+    return OScDev_OK;
+}
+
+static OScDev_SettingImpl SettingImpl_UseLargePages = {
+    .GetBool = GetUseLargePages,
+    .SetBool = SetUseLargePages,
+};
+
+static OScDev_Error GetHistogramBinningRange(OScDev_Setting *setting,
+                                             int32_t *min, int32_t *max) {
+    *min = 1;
+    *max = MAX_HISTOGRAM_BINNING;
+    return OScDev_OK;
+}
+
+static OScDev_Error GetHistogramBinning(OScDev_Setting *setting,
+                                        int32_t *value) {
+    *value = GetSettingDeviceData(setting)->histogramBinning;
+    return OScDev_OK;
+}
+
+static OScDev_Error SetHistogramBinning(OScDev_Setting *setting,
+                                        int32_t value) {
+    if (value < 1)
+        value = 1;
+    if (value > MAX_HISTOGRAM_BINNING)
+        value = MAX_HISTOGRAM_BINNING;
+    GetSettingDeviceData(setting)->histogramBinning = value;
+    return OScDev_OK;
+}
+
+static OScDev_SettingImpl SettingImpl_HistogramBinning = {
+    .GetNumericConstraintType = GetNumericConstraintTypeImpl_Range,
+    .GetInt32Range = GetHistogramBinningRange,
+    .GetInt32 = GetHistogramBinning,
+    .SetInt32 = SetHistogramBinning,
+};
+
+struct HistogramROISettingData {
+    OScDev_Device *device;
+    int index; // x, y, width, height
+};
+
+static void ReleaseHistogramROI(OScDev_Setting *setting) {
+    free(OScDev_Setting_GetImplData(setting));
+}
+
+static OScDev_Error GetHistogramROI(OScDev_Setting *setting, int32_t *value) {
+    struct HistogramROISettingData *data =
+        OScDev_Setting_GetImplData(setting);
+    *value = GetData(data->device)->histogramROI[data->index];
+    return OScDev_OK;
+}
+
+static OScDev_Error SetHistogramROI(OScDev_Setting *setting, int32_t value) {
+    struct HistogramROISettingData *data =
+        OScDev_Setting_GetImplData(setting);
+    if (value < 0)
+        value = 0;
+    GetData(data->device)->histogramROI[data->index] = value;
+    return OScDev_OK;
+}
+
+static OScDev_SettingImpl SettingImpl_HistogramROI = {
+    .Release = ReleaseHistogramROI,
+    .GetInt32 = GetHistogramROI,
+    .SetInt32 = SetHistogramROI,
+};
+
 struct RateCounterData {
     OScDev_Device *device;
     int index;
@@ -465,6 +1275,47 @@ OScDev_Error BH_MakeSettings(OScDev_Device *device,
         goto error;
     OScDev_PtrArray_Append(*settings, accumulateIntensity);
 
+    OScDev_Setting *liveWindowFrames;
+    if (OScDev_CHECK(err, OScDev_Setting_Create(
+                              &liveWindowFrames, "LiveWindowFrames",
+                              OScDev_ValueType_Int32,
+                              &SettingImpl_LiveWindowFrames, device)))
+        goto error;
+    OScDev_PtrArray_Append(*settings, liveWindowFrames);
+
+    OScDev_Setting *dropFramesForSlowConsumers;
+    if (OScDev_CHECK(err, OScDev_Setting_Create(
+                              &dropFramesForSlowConsumers,
+                              "DropFramesForSlowConsumers",
+                              OScDev_ValueType_Bool,
+                              &SettingImpl_DropFramesForSlowConsumers,
+                              device)))
+        goto error;
+    OScDev_PtrArray_Append(*settings, dropFramesForSlowConsumers);
+
+    OScDev_Setting *meanArrivalTimeImage;
+    if (OScDev_CHECK(err, OScDev_Setting_Create(
+                              &meanArrivalTimeImage, "MeanArrivalTimeImage",
+                              OScDev_ValueType_Bool,
+                              &SettingImpl_MeanArrivalTimeImage, device)))
+        goto error;
+    OScDev_PtrArray_Append(*settings, meanArrivalTimeImage);
+
+    OScDev_Setting *timeGates;
+    if (OScDev_CHECK(err, OScDev_Setting_Create(
+                              &timeGates, "TimeGates", OScDev_ValueType_String,
+                              &SettingImpl_TimeGates, device)))
+        goto error;
+    OScDev_PtrArray_Append(*settings, timeGates);
+
+    OScDev_Setting *intensityFromHistograms;
+    if (OScDev_CHECK(err, OScDev_Setting_Create(
+                              &intensityFromHistograms,
+                              "IntensityFromHistograms", OScDev_ValueType_Bool,
+                              &SettingImpl_IntensityFromHistograms, device)))
+        goto error;
+    OScDev_PtrArray_Append(*settings, intensityFromHistograms);
+
     for (int i = 0; i < NUM_MARKER_BITS; ++i) {
         struct MarkerActiveEdgeSettingData *data =
             calloc(1, sizeof(struct MarkerActiveEdgeSettingData));
@@ -551,6 +1402,118 @@ OScDev_Error BH_MakeSettings(OScDev_Device *device,
         goto error;
     OScDev_PtrArray_Append(*settings, senderPort);
 
+    OScDev_Setting *phasorHarmonic;
+    if (OScDev_CHECK(err, OScDev_Setting_Create(
+                              &phasorHarmonic, "SendPhasorHarmonic",
+                              OScDev_ValueType_Int32,
+                              &SettingImpl_PhasorHarmonic, device)))
+        goto error;
+    OScDev_PtrArray_Append(*settings, phasorHarmonic);
+
+    OScDev_Setting *laserRepRate;
+    if (OScDev_CHECK(err, OScDev_Setting_Create(
+                              &laserRepRate, "LaserRepetitionRateMHz",
+                              OScDev_ValueType_Float64,
+                              &SettingImpl_LaserRepRateMHz, device)))
+        goto error;
+    OScDev_PtrArray_Append(*settings, laserRepRate);
+
+    OScDev_Setting *macrotimeSliceMs;
+    if (OScDev_CHECK(err, OScDev_Setting_Create(
+                              &macrotimeSliceMs, "SendMacrotimeSlicesMs",
+                              OScDev_ValueType_Int32,
+                              &SettingImpl_MacrotimeSliceMs, device)))
+        goto error;
+    OScDev_PtrArray_Append(*settings, macrotimeSliceMs);
+
+    OScDev_Setting *lifetimeMode;
+    if (OScDev_CHECK(
+            err, OScDev_Setting_Create(&lifetimeMode, "SendLifetimes",
+                                       OScDev_ValueType_Enum,
+                                       &SettingImpl_LifetimeMode, device)))
+        goto error;
+    OScDev_PtrArray_Append(*settings, lifetimeMode);
+
+    OScDev_Setting *decayCurvePort;
+    if (OScDev_CHECK(err, OScDev_Setting_Create(
+                              &decayCurvePort, "SendDecayCurvesToUDPPort",
+                              OScDev_ValueType_Int32,
+                              &SettingImpl_DecayCurvePort, device)))
+        goto error;
+    OScDev_PtrArray_Append(*settings, decayCurvePort);
+
+    OScDev_Setting *fcsBinWidth;
+    if (OScDev_CHECK(err, OScDev_Setting_Create(
+                              &fcsBinWidth, "FCSBinWidthNs",
+                              OScDev_ValueType_Int32,
+                              &SettingImpl_FCSBinWidthNs, device)))
+        goto error;
+    OScDev_PtrArray_Append(*settings, fcsBinWidth);
+
+    OScDev_Setting *fcsTraceBin;
+    if (OScDev_CHECK(err, OScDev_Setting_Create(
+                              &fcsTraceBin, "FCSTraceBinMs",
+                              OScDev_ValueType_Int32,
+                              &SettingImpl_FCSTraceBinMs, device)))
+        goto error;
+    OScDev_PtrArray_Append(*settings, fcsTraceBin);
+
+    OScDev_Setting *roiLabelFile;
+    if (OScDev_CHECK(
+            err, OScDev_Setting_Create(&roiLabelFile, "ROILabelFile",
+                                       OScDev_ValueType_String,
+                                       &SettingImpl_ROILabelFile, device)))
+        goto error;
+    OScDev_PtrArray_Append(*settings, roiLabelFile);
+
+    OScDev_Setting *previewPort;
+    if (OScDev_CHECK(err, OScDev_Setting_Create(
+                              &previewPort, "SendPreviewToUDPPort",
+                              OScDev_ValueType_Int32,
+                              &SettingImpl_PreviewPort, device)))
+        goto error;
+    OScDev_PtrArray_Append(*settings, previewPort);
+
+    OScDev_Setting *previewBinning;
+    if (OScDev_CHECK(err, OScDev_Setting_Create(
+                              &previewBinning, "PreviewBinning",
+                              OScDev_ValueType_Int32,
+                              &SettingImpl_PreviewBinning, device)))
+        goto error;
+    OScDev_PtrArray_Append(*settings, previewBinning);
+
+    OScDev_Setting *previewRateHz;
+    if (OScDev_CHECK(err, OScDev_Setting_Create(
+                              &previewRateHz, "PreviewRateHz",
+                              OScDev_ValueType_Float64,
+                              &SettingImpl_PreviewRateHz, device)))
+        goto error;
+    OScDev_PtrArray_Append(*settings, previewRateHz);
+
+    OScDev_Setting *stopAtTotalPhotons;
+    if (OScDev_CHECK(err, OScDev_Setting_Create(
+                              &stopAtTotalPhotons, "StopAtTotalPhotons",
+                              OScDev_ValueType_Float64,
+                              &SettingImpl_StopAtTotalPhotons, device)))
+        goto error;
+    OScDev_PtrArray_Append(*settings, stopAtTotalPhotons);
+
+    OScDev_Setting *stopAtPixelPhotons;
+    if (OScDev_CHECK(err, OScDev_Setting_Create(
+                              &stopAtPixelPhotons, "StopAtPixelPhotons",
+                              OScDev_ValueType_Int32,
+                              &SettingImpl_StopAtPixelPhotons, device)))
+        goto error;
+    OScDev_PtrArray_Append(*settings, stopAtPixelPhotons);
+
+    OScDev_Setting *stopAtPixelPercent;
+    if (OScDev_CHECK(err, OScDev_Setting_Create(
+                              &stopAtPixelPercent, "StopAtPixelPercent",
+                              OScDev_ValueType_Float64,
+                              &SettingImpl_StopAtPixelPercent, device)))
+        goto error;
+    OScDev_PtrArray_Append(*settings, stopAtPixelPercent);
+
     OScDev_Setting *sdtCompression;
     if (OScDev_CHECK(
             err, OScDev_Setting_Create(&sdtCompression, "SDTCompression",
@@ -559,6 +1522,89 @@ OScDev_Error BH_MakeSettings(OScDev_Device *device,
         goto error;
     OScDev_PtrArray_Append(*settings, sdtCompression);
 
+    OScDev_Setting *histogrammingThreads;
+    if (OScDev_CHECK(err, OScDev_Setting_Create(
+                              &histogrammingThreads, "HistogrammingThreads",
+                              OScDev_ValueType_Int32,
+                              &SettingImpl_HistogrammingThreads, device)))
+        goto error;
+    OScDev_PtrArray_Append(*settings, histogrammingThreads);
+
+    OScDev_Setting *histogramBinning;
+    if (OScDev_CHECK(err, OScDev_Setting_Create(
+                              &histogramBinning, "HistogramBinning",
+                              OScDev_ValueType_Int32,
+                              &SettingImpl_HistogramBinning, device)))
+        goto error;
+    OScDev_PtrArray_Append(*settings, histogramBinning);
+
+    OScDev_Setting *histogramTimeBins;
+    if (OScDev_CHECK(err, OScDev_Setting_Create(
+                              &histogramTimeBins, "HistogramTimeBins",
+                              OScDev_ValueType_Int32,
+                              &SettingImpl_HistogramTimeBins, device)))
+        goto error;
+    OScDev_PtrArray_Append(*settings, histogramTimeBins);
+
+    OScDev_Setting *histogramADCWindowStart;
+    if (OScDev_CHECK(err, OScDev_Setting_Create(
+                              &histogramADCWindowStart,
+                              "HistogramADCWindowStart",
+                              OScDev_ValueType_Int32,
+                              &SettingImpl_HistogramADCWindowStart, device)))
+        goto error;
+    OScDev_PtrArray_Append(*settings, histogramADCWindowStart);
+
+    OScDev_Setting *histogramADCWindowEnd;
+    if (OScDev_CHECK(err, OScDev_Setting_Create(
+                              &histogramADCWindowEnd, "HistogramADCWindowEnd",
+                              OScDev_ValueType_Int32,
+                              &SettingImpl_HistogramADCWindowEnd, device)))
+        goto error;
+    OScDev_PtrArray_Append(*settings, histogramADCWindowEnd);
+
+    OScDev_Setting *histogramTileCache;
+    if (OScDev_CHECK(err, OScDev_Setting_Create(
+                              &histogramTileCache, "HistogramTileCacheMB",
+                              OScDev_ValueType_Int32,
+                              &SettingImpl_HistogramTileCacheMB, device)))
+        goto error;
+    OScDev_PtrArray_Append(*settings, histogramTileCache);
+
+    OScDev_Setting *memoryBudget;
+    if (OScDev_CHECK(err, OScDev_Setting_Create(
+                              &memoryBudget, "MemoryBudgetMB",
+                              OScDev_ValueType_Int32,
+                              &SettingImpl_MemoryBudgetMB, device)))
+        goto error;
+    OScDev_PtrArray_Append(*settings, memoryBudget);
+
+    OScDev_Setting *useLargePages;
+    if (OScDev_CHECK(err, OScDev_Setting_Create(
+                              &useLargePages, "UseLargePages",
+                              OScDev_ValueType_Bool,
+                              &SettingImpl_UseLargePages, device)))
+        goto error;
+    OScDev_PtrArray_Append(*settings, useLargePages);
+
+    const char *roiParams[] = {"X", "Y", "Width", "Height"};
+    for (int i = 0; i < 4; ++i) {
+        struct HistogramROISettingData *data =
+            calloc(1, sizeof(struct HistogramROISettingData));
+        data->device = device;
+        data->index = i;
+        char name[64];
+        snprintf(name, sizeof(name), "HistogramROI-%s", roiParams[i]);
+        OScDev_Setting *roiSetting;
+        if (OScDev_CHECK(err, OScDev_Setting_Create(
+                                  &roiSetting, name, OScDev_ValueType_Int32,
+                                  &SettingImpl_HistogramROI, data))) {
+            free(data);
+            goto error;
+        }
+        OScDev_PtrArray_Append(*settings, roiSetting);
+    }
+
     const char *rateCounters[] = {"Sync", "CFD", "TAC", "ADC"};
     for (int i = 0; i < 4; ++i) {
         struct RateCounterData *data =
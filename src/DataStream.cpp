@@ -1,26 +1,136 @@
 #include "DataStream.hpp"
 
+#include <FLIMEvents/AsyncFrameDelivery.hpp>
 #include <FLIMEvents/BHDeviceEvent.hpp>
+#include <FLIMEvents/DecayCurveProcessor.hpp>
+#include <FLIMEvents/GatedIntensityCounter.hpp>
 #include <FLIMEvents/Histogram.hpp>
+#include <FLIMEvents/HistogramIntensity.hpp>
+#include <FLIMEvents/HistogramSnapshot.hpp>
+#include <FLIMEvents/HistogramStatistics.hpp>
+#include <FLIMEvents/IntensityCounter.hpp>
+#include <FLIMEvents/LifetimeEstimator.hpp>
 #include <FLIMEvents/LineClockPixellator.hpp>
-#include <FLIMEvents/PixelPhotonRouter.hpp>
+#include <FLIMEvents/MacrotimeSliceHistogrammer.hpp>
+#include <FLIMEvents/MeanArrivalTimeCounter.hpp>
+#include <FLIMEvents/MicrotimeBinning.hpp>
+#include <FLIMEvents/MultiTauCorrelator.hpp>
+#include <FLIMEvents/MultiChannelHistogrammer.hpp>
+#include <FLIMEvents/ParallelHistogrammer.hpp>
+#include <FLIMEvents/PhasorProcessor.hpp>
+#include <FLIMEvents/PixelBinner.hpp>
+#include <FLIMEvents/PreviewImager.hpp>
+#include <FLIMEvents/PromotingHistogram.hpp>
+#include <FLIMEvents/ROIStatisticsCollector.hpp>
+#include <FLIMEvents/SlidingWindowAccumulator.hpp>
 #include <FLIMEvents/StreamBuffer.hpp>
+#include <FLIMEvents/TiledHistogram.hpp>
 
+#include <algorithm>
+#include <cstdint>
+#include <deque>
 #include <memory>
+#include <vector>
 
 using SampleType = uint16_t;
+using IntensityType = uint32_t;
 
 namespace {
-class IntensityImageSink : public HistogramProcessor<SampleType> {
+// The images sent to OpenScan for one frame. They are delivered together,
+// so that all channels of a displayed frame come from the same frame.
+struct DisplayFrame {
+    // Intensity: a cumulative snapshot, or else a frame or window sum
+    HistogramSnapshot<IntensityType> intensitySnapshot;
+    Histogram<IntensityType> intensity;
+    // Invalid unless enabled
+    Histogram<IntensityType> meanArrivalTime;
+    Histogram<IntensityType> gatedIntensity;
+};
+
+// The images of a frame as received, before they are copied for delivery.
+// Histograms are referenced (they are valid until the next frame begins).
+struct DisplayFrameSources {
+    HistogramSnapshot<IntensityType> intensitySnapshot;
+    Histogram<IntensityType> const *intensity = nullptr;
+    Histogram<IntensityType> const *meanArrivalTime = nullptr;
+    Histogram<IntensityType> const *gatedIntensity = nullptr;
+};
+
+void CopyFrame(DisplayFrameSources const &src, DisplayFrame &dst) {
+    dst.intensitySnapshot = src.intensitySnapshot;
+    if (src.intensity) {
+        CopyFrame(*src.intensity, dst.intensity);
+    }
+    if (src.meanArrivalTime) {
+        CopyFrame(*src.meanArrivalTime, dst.meanArrivalTime);
+    }
+    if (src.gatedIntensity) {
+        CopyFrame(*src.gatedIntensity, dst.gatedIntensity);
+    }
+}
+
+void CopyFrame(DisplayFrame const &src, DisplayFrame &dst) {
+    DisplayFrameSources sources;
+    sources.intensitySnapshot = src.intensitySnapshot;
+    auto const validOrNull = [](Histogram<IntensityType> const &image) {
+        return image.IsValid() ? &image : nullptr;
+    };
+    sources.intensity = validOrNull(src.intensity);
+    sources.meanArrivalTime = validOrNull(src.meanArrivalTime);
+    sources.gatedIntensity = validOrNull(src.gatedIntensity);
+    CopyFrame(sources, dst);
+}
+
+void ReleaseFrame(DisplayFrame &frame) noexcept {
+    ReleaseFrame(frame.intensitySnapshot);
+}
+
+// Receiver of display frames
+class DisplayFrameProcessor {
+  public:
+    virtual ~DisplayFrameProcessor() = default;
+
+    virtual void HandleError(std::string const &message) = 0;
+    virtual void HandleFrame(DisplayFrame const &frame) = 0;
+    virtual void HandleFinish(DisplayFrame &&frame, bool isCompleteFrame) = 0;
+};
+
+// Converts display frames to the 16-bit frames sent to OpenScan: channel 0
+// is the intensity (saturating), followed by the mean arrival time (full
+// scale = ADC range, with saturated pixels set to 65535) and the gated
+// intensities (saturating), if enabled.
+class DisplayFrameSink : public DisplayFrameProcessor {
     OScDev_Acquisition *acquisition;
     std::function<void(void)> stopFunc;
+    float meanArrivalTimeScale;
+    std::vector<uint16_t> frame;
     std::shared_ptr<AcquisitionCompletion> downstream;
 
+    void SendIntensity(DisplayFrame const &images) {
+        if (images.intensitySnapshot.IsValid()) {
+            auto const &snapshot = images.intensitySnapshot;
+            frame.resize(snapshot.GetNumberOfElements());
+            auto const tileElements = snapshot.GetTileElements();
+            for (std::size_t i = 0; i < snapshot.GetNumberOfTiles(); ++i) {
+                SaturatingNarrowArray(frame.data() + i * tileElements,
+                                      snapshot.GetTile(i),
+                                      snapshot.GetTileSize(i));
+            }
+        } else {
+            auto const &image = images.intensity;
+            frame.resize(image.GetNumberOfElements());
+            SaturatingNarrowArray(frame.data(), image.Get(), frame.size());
+        }
+        OScDev_Acquisition_CallFrameCallback(acquisition, 0, frame.data());
+    }
+
   public:
-    IntensityImageSink(OScDev_Acquisition *acquisition,
-                       std::function<void(void)> stopFunction,
-                       std::shared_ptr<AcquisitionCompletion> downstream)
+    DisplayFrameSink(OScDev_Acquisition *acquisition,
+                     std::function<void(void)> stopFunction,
+                     uint32_t inputTimeBits,
+                     std::shared_ptr<AcquisitionCompletion> downstream)
         : acquisition(acquisition), stopFunc(stopFunction),
+          meanArrivalTimeScale(65536.0f / float(1u << inputTimeBits)),
           downstream(downstream) {
         if (downstream) {
             downstream->AddProcess("IntensityImage");
@@ -36,16 +146,30 @@ class IntensityImageSink : public HistogramProcessor<SampleType> {
         }
     }
 
-    void HandleFrame(Histogram<SampleType> const &histogram) override {
-        // TODO OScDev_Acquisition_CallFrameCallback() parameter should be
-        // const
-        OScDev_Acquisition_CallFrameCallback(
-            acquisition, 0,
-            const_cast<void *>(
-                reinterpret_cast<void const *>(histogram.Get())));
+    void HandleFrame(DisplayFrame const &images) override {
+        SendIntensity(images);
+        uint32_t channel = 1;
+        if (images.meanArrivalTime.IsValid()) {
+            auto const &image = images.meanArrivalTime;
+            frame.resize(image.GetNumberOfElementsPerChannel());
+            ComputeMeanArrivalTimes(image, meanArrivalTimeScale,
+                                    frame.data());
+            OScDev_Acquisition_CallFrameCallback(acquisition, channel++,
+                                                 frame.data());
+        }
+        if (images.gatedIntensity.IsValid()) {
+            auto const &gated = images.gatedIntensity;
+            frame.resize(gated.GetNumberOfElementsPerChannel());
+            for (std::size_t g = 0; g < gated.GetNumberOfChannels(); ++g) {
+                SaturatingNarrowArray(frame.data(), gated.GetChannel(g),
+                                      frame.size());
+                OScDev_Acquisition_CallFrameCallback(acquisition, channel++,
+                                                     frame.data());
+            }
+        }
     }
 
-    void HandleFinish(Histogram<SampleType> &&, bool) override {
+    void HandleFinish(DisplayFrame &&, bool) override {
         if (stopFunc) {
             stopFunc();
         }
@@ -56,15 +180,147 @@ class IntensityImageSink : public HistogramProcessor<SampleType> {
     }
 };
 
+// Collects the images of each frame from the intensity, mean arrival time
+// and gated intensity outputs (each through its own input) and passes them
+// downstream as one display frame once every enabled input has provided
+// its image. All inputs must receive the same frames, on the same thread,
+// as they do when fed (through accumulators) from the same pixel photons.
+class DisplayFrameAssembler
+    : public std::enable_shared_from_this<DisplayFrameAssembler> {
+  public:
+    enum class Input { Intensity, MeanArrivalTime, GatedIntensity };
+
+    using Delivery = AsyncFrameDelivery<DisplayFrame, DisplayFrameProcessor>;
+
+  private:
+    static std::size_t const NumInputs = 3;
+
+    std::bitset<NumInputs> const enabled;
+    std::bitset<NumInputs> received;
+    std::bitset<NumInputs> finished;
+    DisplayFrameSources sources;
+    DisplayFrame finalFrame;
+    bool finalFrameComplete = true;
+
+    std::shared_ptr<Delivery> downstream;
+
+    class Port : public HistogramProcessor<IntensityType>,
+                 public HistogramSnapshotProcessor<IntensityType> {
+        std::shared_ptr<DisplayFrameAssembler> assembler;
+        Input const input;
+
+      public:
+        Port(std::shared_ptr<DisplayFrameAssembler> assembler, Input input)
+            : assembler(assembler), input(input) {}
+
+        void HandleError(std::string const &message) override {
+            assembler->HandleError(message);
+        }
+
+        void HandleFrame(Histogram<IntensityType> const &image) override {
+            assembler->HandleFrame(input, &image, {});
+        }
+
+        void HandleFrame(
+            HistogramSnapshot<IntensityType> const &snapshot) override {
+            assembler->HandleFrame(input, nullptr, snapshot);
+        }
+
+        void HandleFinish(Histogram<IntensityType> &&image,
+                          bool isCompleteFrame) override {
+            assembler->HandleFinish(input, std::move(image), {},
+                                    isCompleteFrame);
+        }
+
+        void HandleFinish(HistogramSnapshot<IntensityType> &&snapshot,
+                          bool isCompleteFrame) override {
+            assembler->HandleFinish(input, {}, std::move(snapshot),
+                                    isCompleteFrame);
+        }
+    };
+
+    void HandleError(std::string const &message) {
+        sources = {};
+        if (downstream) {
+            downstream->HandleError(message);
+            downstream.reset();
+        }
+    }
+
+    void HandleFrame(Input input, Histogram<IntensityType> const *image,
+                     HistogramSnapshot<IntensityType> const &snapshot) {
+        switch (input) {
+        case Input::Intensity:
+            sources.intensity = image;
+            sources.intensitySnapshot = snapshot;
+            break;
+        case Input::MeanArrivalTime:
+            sources.meanArrivalTime = image;
+            break;
+        case Input::GatedIntensity:
+            sources.gatedIntensity = image;
+            break;
+        }
+        received.set(std::size_t(input));
+        if (received == enabled) {
+            if (downstream) {
+                downstream->HandleFrameFrom(sources);
+            }
+            received.reset();
+            sources = {};
+        }
+    }
+
+    void HandleFinish(Input input, Histogram<IntensityType> &&image,
+                      HistogramSnapshot<IntensityType> &&snapshot,
+                      bool isCompleteFrame) {
+        switch (input) {
+        case Input::Intensity:
+            finalFrame.intensity = std::move(image);
+            finalFrame.intensitySnapshot = std::move(snapshot);
+            break;
+        case Input::MeanArrivalTime:
+            finalFrame.meanArrivalTime = std::move(image);
+            break;
+        case Input::GatedIntensity:
+            finalFrame.gatedIntensity = std::move(image);
+            break;
+        }
+        finalFrameComplete = finalFrameComplete && isCompleteFrame;
+        finished.set(std::size_t(input));
+        if (finished == enabled) {
+            sources = {};
+            if (downstream) {
+                downstream->HandleFinish(std::move(finalFrame),
+                                         finalFrameComplete);
+                downstream.reset();
+            }
+        }
+    }
+
+  public:
+    DisplayFrameAssembler(std::shared_ptr<Delivery> downstream,
+                          bool meanArrivalTime, bool gatedIntensity)
+        : enabled(1u | (meanArrivalTime ? 2u : 0u) |
+                  (gatedIntensity ? 4u : 0u)),
+          downstream(downstream) {}
+
+    // The processor through which the given input's images are received
+    // (the intensity input also accepts snapshots)
+    std::shared_ptr<Port> GetInput(Input input) {
+        return std::make_shared<Port>(shared_from_this(), input);
+    }
+};
+
+// Receives the multi-channel histogram of all enabled channels.
 class HistogramSink : public HistogramProcessor<SampleType> {
-    unsigned channel;
     std::shared_ptr<SDTWriter> sdtWriter;
     std::shared_ptr<DataSender> dataSender;
 
   public:
-    HistogramSink(unsigned channel, std::shared_ptr<SDTWriter> sdtWriter,
+    HistogramSink(std::shared_ptr<SDTWriter> sdtWriter,
                   std::shared_ptr<DataSender> dataSender)
-        : channel(channel), sdtWriter(sdtWriter), dataSender(dataSender) {}
+        : sdtWriter(sdtWriter), dataSender(dataSender) {}
 
     void HandleError(std::string const &message) override {
         if (sdtWriter) {
@@ -81,7 +337,7 @@ class HistogramSink : public HistogramProcessor<SampleType> {
         // Only the final cumulative histogram is written to SDT.
 
         if (dataSender) {
-            dataSender->SetHistogram(channel, histogram);
+            dataSender->SetHistograms(histogram);
         }
     }
 
@@ -89,7 +345,354 @@ class HistogramSink : public HistogramProcessor<SampleType> {
                       bool isCompleteFrame) override {
         // isCompleteFrame is always true because our upstream guarantees it
         if (sdtWriter) {
-            sdtWriter->SetHistogram(channel, std::move(histogram));
+            sdtWriter->SetHistograms(std::move(histogram));
+            sdtWriter.reset();
+        }
+        if (dataSender) {
+            dataSender->Finish();
+            dataSender.reset();
+        }
+    }
+};
+
+// Receives the cumulative histogram of all enabled channels, which may have
+// been promoted to 32 bits, or snapshots of it.
+class PromotedHistogramSink : public PromotingHistogramProcessor,
+                              public PromotingHistogramSnapshotProcessor {
+    std::shared_ptr<SDTWriter> sdtWriter;
+    std::shared_ptr<DataSender> dataSender;
+
+  public:
+    PromotedHistogramSink(std::shared_ptr<SDTWriter> sdtWriter,
+                          std::shared_ptr<DataSender> dataSender)
+        : sdtWriter(sdtWriter), dataSender(dataSender) {}
+
+    void HandleError(std::string const &message) override {
+        if (sdtWriter) {
+            sdtWriter->HandleError(message);
+            sdtWriter.reset();
+        }
+        if (dataSender) {
+            dataSender->HandleError(message);
+            dataSender.reset();
+        }
+    }
+
+    void HandleFrame(PromotingHistogram const &histogram) override {
+        if (dataSender) {
+            dataSender->SetHistograms(histogram);
+        }
+    }
+
+    void HandleFinish(PromotingHistogram &&histogram,
+                      bool isCompleteFrame) override {
+        if (sdtWriter) {
+            sdtWriter->SetHistograms(std::move(histogram));
+        }
+        Finish();
+    }
+
+    void HandleFrame(PromotingHistogramSnapshot const &snapshot) override {
+        if (dataSender) {
+            dataSender->SetHistograms(snapshot);
+        }
+    }
+
+    void HandleFinish(PromotingHistogramSnapshot &&snapshot,
+                      bool isCompleteFrame) override {
+        if (sdtWriter) {
+            sdtWriter->SetHistograms(std::move(snapshot));
+        }
+        Finish();
+    }
+
+  private:
+    void Finish() {
+        sdtWriter.reset();
+        if (dataSender) {
+            dataSender->Finish();
+            dataSender.reset();
+        }
+    }
+};
+
+// Sends phasor images to the data sender.
+class PhasorSink : public PhasorImageProcessor {
+    std::shared_ptr<DataSender> dataSender;
+
+  public:
+    explicit PhasorSink(std::shared_ptr<DataSender> dataSender)
+        : dataSender(dataSender) {}
+
+    void HandleError(std::string const &message) override {
+        if (dataSender) {
+            dataSender->HandleError(message);
+            dataSender.reset();
+        }
+    }
+
+    void HandleFrame(PhasorImage const &image) override {
+        if (dataSender) {
+            dataSender->SetPhasors(image);
+        }
+    }
+
+    void HandleFinish(PhasorImage &&, bool) override {
+        if (dataSender) {
+            dataSender->Finish();
+            dataSender.reset();
+        }
+    }
+};
+
+// Sends ROI statistics to the data sender.
+class ROIStatisticsSink : public ROIStatisticsProcessor {
+    std::shared_ptr<DataSender> dataSender;
+
+  public:
+    explicit ROIStatisticsSink(std::shared_ptr<DataSender> dataSender)
+        : dataSender(dataSender) {}
+
+    void HandleError(std::string const &message) override {
+        if (dataSender) {
+            dataSender->HandleError(message);
+            dataSender.reset();
+        }
+    }
+
+    void HandleFrame(ROIStatistics const &stats) override {
+        if (dataSender) {
+            dataSender->SetROIStatistics(stats);
+        }
+    }
+
+    void HandleFinish(ROIStatistics &&, bool) override {
+        if (dataSender) {
+            dataSender->Finish();
+            dataSender.reset();
+        }
+    }
+};
+
+// Sends decay curves to the decay curve sender.
+class DecayCurveSink : public GlobalDecayProcessor {
+    std::shared_ptr<DataSender> dataSender;
+
+  public:
+    explicit DecayCurveSink(std::shared_ptr<DataSender> dataSender)
+        : dataSender(dataSender) {}
+
+    void HandleError(std::string const &message) override {
+        if (dataSender) {
+            dataSender->HandleError(message);
+            dataSender.reset();
+        }
+    }
+
+    void HandleFrame(GlobalDecay const &decay) override {
+        if (dataSender) {
+            dataSender->SetDecayCurves(decay);
+        }
+    }
+
+    void HandleFinish(GlobalDecay &&decay, bool) override {
+        if (dataSender) {
+            dataSender->SetDecayCurves(decay);
+            dataSender->Finish();
+            dataSender.reset();
+        }
+    }
+};
+
+// Collects histogram statistics and adds them to the metadata file at the
+// end of the acquisition. Only the most recent per-frame records are kept, so
+// that long acquisitions do not grow memory (or the file) without bound.
+class HistogramStatisticsJsonSink : public HistogramStatisticsProcessor {
+    static constexpr std::size_t MaxFrameRecords = 1024;
+
+    std::shared_ptr<MetadataJsonWriter> writer;
+    std::deque<HistogramStatistics> frames;
+    uint64_t firstFrame = 0;
+
+  public:
+    explicit HistogramStatisticsJsonSink(
+        std::shared_ptr<MetadataJsonWriter> writer)
+        : writer(writer) {}
+
+    void HandleError(std::string const &) override { writer.reset(); }
+
+    void HandleFrame(HistogramStatistics const &frame,
+                     HistogramStatistics const &) override {
+        if (frames.size() == MaxFrameRecords) {
+            frames.pop_front();
+            ++firstFrame;
+        }
+        frames.push_back(frame);
+    }
+
+    void HandleFinish(HistogramStatistics const &cumulative) override {
+        if (writer) {
+            writer->SetHistogramStatistics(frames, firstFrame, cumulative);
+            writer->Save();
+            writer.reset();
+        }
+    }
+};
+
+// Adds the correlation results to the metadata file at the end of the
+// acquisition.
+class FCSJsonSink : public FCSDataProcessor {
+    std::shared_ptr<MetadataJsonWriter> writer;
+    uint64_t traceBinWidth;
+
+  public:
+    explicit FCSJsonSink(std::shared_ptr<MetadataJsonWriter> writer,
+                         uint64_t traceBinWidth)
+        : writer(writer), traceBinWidth(traceBinWidth) {}
+
+    void HandleError(std::string const &) override { writer.reset(); }
+
+    void HandleUpdate(FCSData const &) override {}
+
+    void HandleFinish(FCSData &&data) override {
+        if (writer) {
+            writer->SetFCSData(data, traceBinWidth);
+            writer->Save();
+            writer.reset();
+        }
+    }
+};
+
+// Sends preview images to the preview sender.
+class PreviewSink : public HistogramProcessor<IntensityType> {
+    std::shared_ptr<DataSender> dataSender;
+
+  public:
+    explicit PreviewSink(std::shared_ptr<DataSender> dataSender)
+        : dataSender(dataSender) {}
+
+    void HandleError(std::string const &message) override {
+        if (dataSender) {
+            dataSender->HandleError(message);
+            dataSender.reset();
+        }
+    }
+
+    void HandleFrame(Histogram<IntensityType> const &image) override {
+        if (dataSender) {
+            dataSender->SetHistograms(image);
+        }
+    }
+
+    void HandleFinish(Histogram<IntensityType> &&image, bool) override {
+        if (dataSender) {
+            dataSender->SetHistograms(image);
+            dataSender->Finish();
+            dataSender.reset();
+        }
+    }
+};
+
+// Receives snapshots of the cumulative histogram, passing them after each
+// frame to a lifetime estimator, and at the end to the SDT writer.
+class PromotedHistogramLifetimeSink
+    : public PromotingHistogramSnapshotProcessor {
+    std::shared_ptr<SDTWriter> sdtWriter;
+    std::shared_ptr<PromotingHistogramSnapshotProcessor> estimator;
+
+  public:
+    PromotedHistogramLifetimeSink(
+        std::shared_ptr<SDTWriter> sdtWriter,
+        std::shared_ptr<PromotingHistogramSnapshotProcessor> estimator)
+        : sdtWriter(sdtWriter), estimator(estimator) {}
+
+    void HandleError(std::string const &message) override {
+        if (sdtWriter) {
+            sdtWriter->HandleError(message);
+            sdtWriter.reset();
+        }
+        if (estimator) {
+            estimator->HandleError(message);
+            estimator.reset();
+        }
+    }
+
+    void HandleFrame(PromotingHistogramSnapshot const &snapshot) override {
+        if (estimator) {
+            estimator->HandleFrame(snapshot);
+        }
+    }
+
+    void HandleFinish(PromotingHistogramSnapshot &&snapshot,
+                      bool isCompleteFrame) override {
+        // The estimator finishes with its last image, not the histogram.
+        if (estimator) {
+            estimator->HandleFinish(PromotingHistogramSnapshot(),
+                                    isCompleteFrame);
+            estimator.reset();
+        }
+        if (sdtWriter) {
+            sdtWriter->SetHistograms(std::move(snapshot));
+            sdtWriter.reset();
+        }
+    }
+};
+
+// Sends lifetime images to the data sender.
+class LifetimeSink : public LifetimeImageProcessor {
+    std::shared_ptr<DataSender> dataSender;
+
+  public:
+    explicit LifetimeSink(std::shared_ptr<DataSender> dataSender)
+        : dataSender(dataSender) {}
+
+    void HandleError(std::string const &message) override {
+        if (dataSender) {
+            dataSender->HandleError(message);
+            dataSender.reset();
+        }
+    }
+
+    void HandleFrame(LifetimeImage const &image) override {
+        if (dataSender) {
+            dataSender->SetLifetimes(image);
+        }
+    }
+
+    void HandleFinish(LifetimeImage &&, bool) override {
+        if (dataSender) {
+            dataSender->Finish();
+            dataSender.reset();
+        }
+    }
+};
+
+// Receives the cumulative tiled histogram at the end of acquisition. Tiled
+// histograms are too large to send, so the data sender receives nothing.
+class TiledHistogramSink : public TiledHistogramProcessor<SampleType> {
+    std::shared_ptr<SDTWriter> sdtWriter;
+    std::shared_ptr<DataSender> dataSender;
+
+  public:
+    TiledHistogramSink(std::shared_ptr<SDTWriter> sdtWriter,
+                       std::shared_ptr<DataSender> dataSender)
+        : sdtWriter(sdtWriter), dataSender(dataSender) {}
+
+    void HandleError(std::string const &message) override {
+        if (sdtWriter) {
+            sdtWriter->HandleError(message);
+            sdtWriter.reset();
+        }
+        if (dataSender) {
+            dataSender->HandleError(message);
+            dataSender.reset();
+        }
+    }
+
+    void HandleFinish(std::shared_ptr<TiledHistogram<SampleType>> histogram,
+                      bool isCompleteFrame) override {
+        if (sdtWriter) {
+            sdtWriter->SetTiledHistograms(histogram);
             sdtWriter.reset();
         }
         if (dataSender) {
@@ -129,96 +732,838 @@ static void PumpDeviceEvents(
     }
 }
 
-template <typename T>
-static std::shared_ptr<PixelPhotonProcessor> MakeNoncumulativeHistogrammer(
-    uint32_t histoBits, uint32_t inputBits, uint32_t width, uint32_t height,
-    std::shared_ptr<HistogramProcessor<T>> downstream) {
-    Histogram<T> frameHisto(histoBits, inputBits, true, width, height);
-    return std::make_shared<Histogrammer<T>>(std::move(frameHisto),
-                                             downstream);
+// Dimensions of the FLIM histograms and intensity images
+namespace {
+struct ImageShapes {
+    // Tiles of tiled histograms are about this size
+    static std::size_t const TargetTileBytes = 4 << 20;
+
+    static uint32_t const InputBits = 12;
+    static std::size_t const IntensityTileElements =
+        CowHistogram<IntensityType>::DefaultTileBytes / sizeof(IntensityType);
+
+    MicrotimeBinning binning;
+    uint32_t histoWidth;
+    uint32_t histoHeight;
+    std::size_t nChannels;
+    uint32_t intensityWidth;
+    uint32_t intensityHeight;
+    std::size_t linesPerTile;
+    std::size_t maxCachedTiles;
+
+    explicit ImageShapes(ProcessingConfig const &config)
+        : binning(InputBits, config.histoWindowStart, config.histoWindowEnd,
+                  config.histoTimeBins, true),
+          histoWidth(config.histoROIWidth / config.histoBinning),
+          histoHeight(config.histoROIHeight / config.histoBinning),
+          nChannels(config.channelMask.count()), intensityWidth(config.width),
+          intensityHeight(config.height) {
+        std::size_t lineBytes = TiledHistogram<SampleType>::GetTileStorageSize(
+            binning, histoWidth, 1);
+        linesPerTile = (std::min)(
+            (std::max)(TargetTileBytes / lineBytes, std::size_t(1)),
+            std::size_t(histoHeight));
+        // Saturated for 32-bit builds
+        std::size_t cacheBytes = std::size_t((std::min)(
+            uint64_t(config.histoTileCacheMB) << 20, uint64_t(SIZE_MAX)));
+        // At least one tile per channel, so that channels do not thrash
+        maxCachedTiles = (std::max)(cacheBytes / TileSize(), nChannels);
+    }
+
+    std::size_t TileSize() const {
+        return TiledHistogram<SampleType>::GetTileStorageSize(
+            binning, histoWidth, linesPerTile);
+    }
+
+    std::size_t HistogramSize() const {
+        return Histogram<SampleType>::GetStorageSize(binning, histoWidth,
+                                                     histoHeight, nChannels);
+    }
+
+    std::size_t IntensitySize() const {
+        return Histogram<IntensityType>::GetStorageSize(0, intensityWidth,
+                                                        intensityHeight);
+    }
+
+    Histogram<SampleType> MakeHistogram(MemoryPool &pool) const {
+        return Histogram<SampleType>(binning, histoWidth, histoHeight,
+                                     nChannels, pool);
+    }
+
+    std::size_t CumulativeHistogramTileCount() const {
+        return nChannels *
+               CowHistogram<SampleType>::GetNumberOfTiles(
+                   std::size_t(binning.GetNumberOfBins()) * histoWidth *
+                       histoHeight,
+                   CowPromotingHistogram::GetTileElements(
+                       binning.GetNumberOfBins()));
+    }
+
+    std::size_t CumulativeHistogramTileSize() const {
+        return CowPromotingHistogram::GetTileElements(
+                   binning.GetNumberOfBins()) *
+               sizeof(SampleType);
+    }
+
+    // Zeroed
+    CowPromotingHistogram MakeCumulativeHistogram(MemoryPool &pool) const {
+        return CowPromotingHistogram(binning, histoWidth, histoHeight,
+                                     nChannels, &pool);
+    }
+
+    // Per-channel intensity image at the histogram ROI and binning
+    std::size_t SliceSize() const {
+        return Histogram<SampleType>::GetStorageSize(0, histoWidth,
+                                                     histoHeight, nChannels);
+    }
+
+    Histogram<SampleType> MakeSlice(MemoryPool &pool) const {
+        return Histogram<SampleType>(0, InputBits, true, histoWidth,
+                                     histoHeight, nChannels, pool);
+    }
+
+    std::size_t PhasorSize() const {
+        return PhasorImage::GetStorageSize(histoWidth, histoHeight,
+                                           nChannels);
+    }
+
+    // Zeroed
+    PhasorImage MakePhasor(MemoryPool &pool) const {
+        PhasorImage image(histoWidth, histoHeight, nChannels, pool);
+        image.Clear();
+        return image;
+    }
+
+    Histogram<IntensityType> MakeIntensity(MemoryPool &pool) const {
+        return Histogram<IntensityType>(0, 0, false, intensityWidth,
+                                        intensityHeight, 1, pool);
+    }
+
+    // Photon counts and microtime sums
+    std::size_t MeanArrivalTimeSize() const {
+        return Histogram<IntensityType>::GetStorageSize(0, intensityWidth,
+                                                        intensityHeight, 2);
+    }
+
+    Histogram<IntensityType> MakeMeanArrivalTime(MemoryPool &pool) const {
+        return Histogram<IntensityType>(0, 0, false, intensityWidth,
+                                        intensityHeight, 2, pool);
+    }
+
+    std::size_t GatedIntensitySize(std::size_t nGates) const {
+        return Histogram<IntensityType>::GetStorageSize(0, intensityWidth,
+                                                        intensityHeight,
+                                                        nGates);
+    }
+
+    Histogram<IntensityType> MakeGatedIntensity(std::size_t nGates,
+                                                MemoryPool &pool) const {
+        return Histogram<IntensityType>(0, 0, false, intensityWidth,
+                                        intensityHeight, nGates, pool);
+    }
+
+    std::size_t CumulativeIntensityTileCount() const {
+        return CowHistogram<IntensityType>::GetNumberOfTiles(
+            std::size_t(intensityWidth) * intensityHeight,
+            IntensityTileElements);
+    }
+
+    std::size_t CumulativeIntensityTileSize() const {
+        return IntensityTileElements * sizeof(IntensityType);
+    }
+
+    // Zeroed
+    CowHistogram<IntensityType>
+    MakeCumulativeIntensity(MemoryPool &pool) const {
+        return CowHistogram<IntensityType>(MicrotimeBinning(0, 0, false),
+                                           intensityWidth, intensityHeight, 1,
+                                           IntensityTileElements, &pool);
+    }
+};
+
+// Whether the histogram is accumulated out-of-core (only for saving to file)
+bool UseTiledHistogram(ProcessingConfig const &config, bool writeHistograms) {
+    return writeHistograms && config.histoTileCacheMB > 0;
 }
 
-template <typename T>
+// Whether the histogram path should be a full-raster histogram from which the
+// intensity images are derived
+bool DeriveIntensity(ProcessingConfig const &config, bool saveHistograms) {
+    bool const binHistograms =
+        config.histoBinning > 1 || config.histoROIX > 0 ||
+        config.histoROIY > 0 || config.histoROIWidth < config.width ||
+        config.histoROIHeight < config.height;
+    // Photons outside a narrowed microtime window are not histogrammed.
+    bool const fullWindow =
+        config.histoWindowStart == 0 &&
+        config.histoWindowEnd == (1u << ImageShapes::InputBits);
+    // Intensity images can only be derived from full-raster, full-window
+    // histograms.
+    return saveHistograms && config.intensityFromHistograms &&
+           !binHistograms && fullWindow;
+}
+} // namespace
+
+// nThreads > 1 selects ParallelHistogrammer with that many worker threads
+static std::shared_ptr<PixelPhotonProcessor>
+MakeNoncumulativeHistogrammer(
+    ImageShapes const &shapes, RouteChannelTable const &routeTable,
+    unsigned nThreads, MemoryPool &pool,
+    std::shared_ptr<HistogramProcessor<SampleType>> downstream,
+    std::shared_ptr<HistogramStatisticsProcessor> statistics) {
+    if (nThreads > 1) {
+        std::vector<Histogram<SampleType>> frameHistos;
+        for (unsigned i = 0; i < nThreads; ++i) {
+            frameHistos.emplace_back(shapes.MakeHistogram(pool));
+        }
+        return std::make_shared<ParallelHistogrammer<SampleType>>(
+            std::move(frameHistos), routeTable, downstream,
+            ParallelHistogrammer<SampleType>::DefaultBatchSize, statistics);
+    }
+
+    return std::make_shared<MultiChannelHistogrammer<SampleType>>(
+        shapes.MakeHistogram(pool), routeTable, downstream, statistics);
+}
+
+// Number of frame buffers for delivering frames to the display and the data
+// sender on their own threads
+static std::size_t const DeliveryBuffers = 2;
+
+// Wrap sink so that frames are delivered on a separate thread, keeping the
+// event processing thread from waiting on the display or data sender.
+template <typename H, typename P>
+static std::shared_ptr<P> DeliverAsync(std::shared_ptr<P> sink,
+                                       SlowConsumerPolicy policy) {
+    return std::make_shared<AsyncFrameDelivery<H, P>>(sink, DeliveryBuffers,
+                                                      policy);
+}
+
+// Returns the processor that receives frame histograms. The cumulative
+// histogram goes to the SDT writer; the data sender gets the cumulative
+// histogram too, or the sum of the last windowFrames frames if nonzero.
+// Cumulative histograms are promoted to 32 bits where they would saturate.
+// If lifetimes is given, it receives the histograms destined for the data
+// sender (on the delivery thread) in place of the data sender.
+static std::shared_ptr<HistogramProcessor<SampleType>>
+MakeHistogramOutput(ImageShapes const &shapes, uint32_t windowFrames,
+                    SlowConsumerPolicy sendPolicy, MemoryPool &pool,
+                    std::shared_ptr<SDTWriter> sdtWriter,
+                    std::shared_ptr<DataSender> dataSender,
+                    std::shared_ptr<LifetimeEstimator> lifetimes) {
+    auto makeZeroed = [&] {
+        auto h = shapes.MakeHistogram(pool);
+        h.Clear();
+        return h;
+    };
+    bool const sending = dataSender || lifetimes;
+
+    if (!sending) {
+        return std::make_shared<PromotingHistogramAccumulator>(
+            makeZeroed(),
+            std::make_shared<PromotedHistogramSink>(sdtWriter, nullptr));
+    }
+
+    if (windowFrames == 0) {
+        // The delivery thread holds snapshots of the cumulative histogram,
+        // so that it is not copied for each frame.
+        std::shared_ptr<PromotingHistogramSnapshotProcessor> sink;
+        if (lifetimes) {
+            sink = std::make_shared<PromotedHistogramLifetimeSink>(sdtWriter,
+                                                                   lifetimes);
+        } else {
+            sink = std::make_shared<PromotedHistogramSink>(sdtWriter,
+                                                           dataSender);
+        }
+        return std::make_shared<SnapshotPromotingHistogramAccumulator>(
+            shapes.MakeCumulativeHistogram(pool),
+            DeliverAsync<PromotingHistogramSnapshot>(sink, sendPolicy));
+    }
+
+    std::shared_ptr<HistogramProcessor<SampleType>> windowSink;
+    if (lifetimes) {
+        windowSink = lifetimes;
+    } else {
+        windowSink = std::make_shared<HistogramSink>(nullptr, dataSender);
+    }
+    auto windowed = std::make_shared<SlidingWindowAccumulator<SampleType>>(
+        makeZeroed(), windowFrames,
+        DeliverAsync<Histogram<SampleType>>(windowSink, sendPolicy));
+    if (!sdtWriter) {
+        return windowed;
+    }
+    auto cumulative = std::make_shared<PromotingHistogramAccumulator>(
+        makeZeroed(),
+        std::make_shared<PromotedHistogramSink>(sdtWriter, nullptr));
+    return std::make_shared<BroadcastHistogramProcessor<SampleType>>(
+        windowed, cumulative);
+}
+
+// Returns the processor that computes phasor images at the given harmonic
+// of the laser period (in microtime units; 0 = the ADC range) for the data
+// sender, which receives the cumulative image after each frame.
+static std::shared_ptr<PixelPhotonProcessor>
+MakePhasorOutput(ImageShapes const &shapes, uint32_t harmonic,
+                 double periodBins, RouteChannelTable const &routeTable,
+                 SlowConsumerPolicy sendPolicy, MemoryPool &pool,
+                 std::shared_ptr<DataSender> dataSender) {
+    std::shared_ptr<PhasorImageProcessor> sink =
+        std::make_shared<PhasorSink>(dataSender);
+    auto cumulative = std::make_shared<PhasorAccumulator>(
+        shapes.MakePhasor(pool),
+        DeliverAsync<PhasorImage>(sink, sendPolicy));
+    return std::make_shared<PhasorProcessor>(
+        shapes.MakePhasor(pool),
+        PhasorLookupTable(ImageShapes::InputBits, harmonic, true,
+                          periodBins),
+        routeTable, cumulative);
+}
+
+// Returns the estimator that computes lifetime images from the histograms
+// for the data sender. Lifetimes are in units of ADC channels.
+static std::shared_ptr<LifetimeEstimator>
+MakeLifetimeOutput(ProcessingConfig const &config, ImageShapes const &shapes,
+                   std::shared_ptr<DataSender> dataSender) {
+    auto const &binning = shapes.binning;
+    float const binWidth =
+        float(binning.GetWindowEnd() - binning.GetWindowStart()) /
+        float(binning.GetNumberOfBins());
+    return std::make_shared<LifetimeEstimator>(
+        config.lifetimeMethod, binWidth, config.histogramThreads,
+        std::make_shared<LifetimeSink>(dataSender));
+}
+
+// Number of macrotime slices being filled at a time, which bounds how far
+// out of order photons may arrive
+static std::size_t const SliceRingSize = 4;
+
+// Returns the processor that collects intensity images of consecutive
+// macrotime slices for the data sender. Slices are never dropped for a slow
+// consumer, because the slice index is not sent: the nth image received must
+// be slice n.
+static std::shared_ptr<PixelPhotonProcessor>
+MakeSliceOutput(ProcessingConfig const &config, ImageShapes const &shapes,
+                RouteChannelTable const &routeTable, MemoryPool &pool,
+                std::shared_ptr<DataSender> dataSender) {
+    uint64_t const sliceDuration = uint64_t(config.macrotimeSliceMs) *
+                                   10'000'000 / config.macrotimeUnitsTenthNs;
+    std::vector<Histogram<SampleType>> ring;
+    for (std::size_t i = 0; i < SliceRingSize; ++i) {
+        ring.emplace_back(shapes.MakeSlice(pool));
+    }
+    return std::make_shared<MacrotimeSliceHistogrammer<SampleType>>(
+        std::move(ring), routeTable, (std::max)(sliceDuration, uint64_t(1)),
+        DeliverAsync<Histogram<SampleType>>(
+            std::shared_ptr<HistogramProcessor<SampleType>>(
+                std::make_shared<HistogramSink>(nullptr, dataSender)),
+            SlowConsumerPolicy::Block));
+}
+
+// Returns the processor that collects per-ROI photon counts and decay
+// curves (at the histogram time binning) for the data sender. The
+// statistics are cumulative if the intensity image is (without a live
+// window), and are small enough not to need pooling.
+static std::shared_ptr<PixelPhotonProcessor>
+MakeROIStatisticsOutput(ProcessingConfig const &config,
+                        ImageShapes const &shapes,
+                        RouteChannelTable const &routeTable,
+                        SlowConsumerPolicy sendPolicy,
+                        std::shared_ptr<DataSender> dataSender) {
+    std::shared_ptr<ROIStatisticsProcessor> sink =
+        std::make_shared<ROIStatisticsSink>(dataSender);
+    auto labels = config.roiLabels;
+    return std::make_shared<ROIStatisticsCollector>(
+        std::move(labels), config.width, config.height, shapes.binning,
+        routeTable, config.liveWindowFrames == 0 && config.accumulateIntensity,
+        DeliverAsync<ROIStatistics>(sink, sendPolicy));
+}
+
+// Decay curves are sent this many times per second of macrotime
+static double const DecayCurveRateHz = 10.0;
+
+// Returns the processor that accumulates the decay curve of each enabled
+// channel from all photons (regardless of pixel assignment) for the decay
+// curve sender, passing all events on to downstream.
+static std::shared_ptr<DecodedEventProcessor>
+MakeDecayCurveOutput(ProcessingConfig const &config,
+                     std::shared_ptr<DataSender> decayCurveSender,
+                     std::shared_ptr<DecodedEventProcessor> downstream) {
+    uint64_t const interval = uint64_t(
+        1e10 / (DecayCurveRateHz * config.macrotimeUnitsTenthNs));
+    std::shared_ptr<GlobalDecayProcessor> sink =
+        std::make_shared<DecayCurveSink>(decayCurveSender);
+    return std::make_shared<DecayCurveProcessor>(
+        config.channelMask, ImageShapes::InputBits, true,
+        (std::max)(interval, uint64_t(1)),
+        DeliverAsync<GlobalDecay>(sink, SlowConsumerPolicy::LatestWins),
+        downstream);
+}
+
+// Correlator levels and registers per level: lags up to 15 * 2^15 base bins
+static std::size_t const FCSNumLevels = 16;
+static std::size_t const FCSNumRegisters = 16;
+
+// Trace bins kept for the metadata file, per channel (the most recent)
+static std::size_t const FCSMaxTraceBins = 65536;
+
+// Returns the processor that correlates the photons of the enabled channels
+// and records their intensity traces for the metadata file, passing all
+// events on to downstream.
+static std::shared_ptr<DecodedEventProcessor>
+MakeFCSOutput(ProcessingConfig const &config,
+              std::shared_ptr<MetadataJsonWriter> metadataWriter,
+              std::shared_ptr<DecodedEventProcessor> downstream) {
+    uint64_t const binWidth = (std::max)(
+        uint64_t(config.fcsBinWidthNs) * 10 / config.macrotimeUnitsTenthNs,
+        uint64_t(1));
+    uint64_t const traceBinWidth =
+        (std::max)(uint64_t(config.fcsTraceBinMs) * 10'000'000 /
+                       config.macrotimeUnitsTenthNs,
+                   uint64_t(1));
+    return std::make_shared<FCSCorrelator>(
+        config.channelMask, binWidth, FCSNumLevels, FCSNumRegisters,
+        traceBinWidth, FCSMaxTraceBins, 0,
+        std::make_shared<FCSJsonSink>(metadataWriter, traceBinWidth),
+        downstream);
+}
+
+// Returns the processor that sends a binned intensity preview (and
+// microtime sums, if mean arrival times are enabled) at the configured rate.
+// The preview image is small and not pooled. Previews are always delivered
+// latest-wins: a stale preview is of no use.
 static std::shared_ptr<PixelPhotonProcessor>
-MakeCumulativeHistogrammer(uint32_t histoBits, uint32_t inputBits,
-                           uint32_t width, uint32_t height,
-                           std::shared_ptr<HistogramProcessor<T>> downstream) {
-    Histogram<T> cumulHisto(histoBits, inputBits, true, width, height);
-    cumulHisto.Clear();
-    return MakeNoncumulativeHistogrammer<T>(
-        histoBits, inputBits, width, height,
-        std::make_shared<HistogramAccumulator<T>>(std::move(cumulHisto),
-                                                  downstream));
+MakePreviewOutput(ProcessingConfig const &config,
+                  std::shared_ptr<DataSender> previewSender) {
+    uint32_t const binning = config.previewBinning;
+    uint32_t const width = (std::max)(config.width / binning, 1u);
+    uint32_t const height = (std::max)(config.height / binning, 1u);
+    std::size_t const nChannels = config.meanArrivalTimeImage ? 2 : 1;
+    uint64_t const interval = uint64_t(
+        1e10 / (config.previewRateHz * config.macrotimeUnitsTenthNs));
+    return std::make_shared<PreviewImager>(
+        Histogram<IntensityType>(0, 0, false, width, height, nChannels),
+        binning, config.channelMask, ImageShapes::InputBits, true, false,
+        (std::max)(interval, uint64_t(1)),
+        DeliverAsync<Histogram<IntensityType>>(
+            std::shared_ptr<HistogramProcessor<IntensityType>>(
+                std::make_shared<PreviewSink>(previewSender)),
+            SlowConsumerPolicy::LatestWins));
+}
+
+// Whether images derived alongside intensity (mean arrival time, gated) are
+// accumulated into a second image of the same size
+static bool AccumulateImages(ProcessingConfig const &config) {
+    return config.liveWindowFrames > 0 || config.accumulateIntensity;
+}
+
+// Accumulate images in the same way as the intensity image before passing
+// them to sink. makeImage(pool) must return an image of the accumulated
+// size.
+template <typename F>
+static std::shared_ptr<HistogramProcessor<IntensityType>>
+MaybeAccumulate(ProcessingConfig const &config, F makeImage, MemoryPool &pool,
+                std::shared_ptr<HistogramProcessor<IntensityType>> sink) {
+    if (!AccumulateImages(config)) {
+        return sink;
+    }
+    Histogram<IntensityType> cumulative = makeImage(pool);
+    cumulative.Clear();
+    if (config.liveWindowFrames > 0) {
+        return std::make_shared<SlidingWindowAccumulator<IntensityType>>(
+            std::move(cumulative), config.liveWindowFrames, sink);
+    }
+    return std::make_shared<HistogramAccumulator<IntensityType>>(
+        std::move(cumulative), sink);
+}
+
+// Returns the processor that computes mean arrival time images of all
+// enabled channels for the display frame.
+static std::shared_ptr<PixelPhotonProcessor> MakeMeanArrivalTimeOutput(
+    ProcessingConfig const &config, ImageShapes const &shapes,
+    MemoryPool &pool,
+    std::shared_ptr<HistogramProcessor<IntensityType>> displayInput) {
+    auto proc = MaybeAccumulate(
+        config,
+        [&](MemoryPool &p) { return shapes.MakeMeanArrivalTime(p); }, pool,
+        displayInput);
+    return std::make_shared<MeanArrivalTimeCounter>(
+        shapes.MakeMeanArrivalTime(pool), config.channelMask,
+        ImageShapes::InputBits, true, proc);
+}
+
+// Returns the processor that computes time-gated intensity images of all
+// enabled channels for the display frame.
+static std::shared_ptr<PixelPhotonProcessor> MakeGatedIntensityOutput(
+    ProcessingConfig const &config, ImageShapes const &shapes,
+    MemoryPool &pool,
+    std::shared_ptr<HistogramProcessor<IntensityType>> displayInput) {
+    auto const nGates = config.timeGates.size();
+    auto proc = MaybeAccumulate(
+        config,
+        [&](MemoryPool &p) { return shapes.MakeGatedIntensity(nGates, p); },
+        pool, displayInput);
+    return std::make_shared<GatedIntensityCounter>(
+        shapes.MakeGatedIntensity(nGates, pool), config.timeGates,
+        ImageShapes::InputBits, config.channelMask, proc);
+}
+
+// Crop and bin photons for the histogram, if configured
+static std::shared_ptr<PixelPhotonProcessor>
+MaybeBin(ProcessingConfig const &config, ImageShapes const &shapes,
+         std::shared_ptr<PixelPhotonProcessor> histoProc) {
+    if (shapes.histoWidth != config.width ||
+        shapes.histoHeight != config.height || config.histoROIX > 0 ||
+        config.histoROIY > 0) {
+        return std::make_shared<PixelBinner>(
+            config.histoROIX, config.histoROIY, config.histoROIWidth,
+            config.histoROIHeight, config.histoBinning, histoProc);
+    }
+    return histoProc;
+}
+
+// Bytes of live window state (beyond the output image) for images of the
+// given size
+template <typename T>
+static std::size_t WindowStorageSize(ProcessingConfig const &config,
+                                     std::size_t imageBytes) {
+    if (config.liveWindowFrames == 0) {
+        return 0;
+    }
+    return SlidingWindowAccumulator<T>::GetStorageSize(
+        imageBytes / sizeof(T), config.liveWindowFrames);
+}
+
+bool SendsROIStatistics(ProcessingConfig const &config, bool saveHistograms,
+                        bool sendHistograms) {
+    return sendHistograms && config.phasorHarmonic == 0 &&
+           config.macrotimeSliceMs == 0 &&
+           !(config.sendLifetimes &&
+             !UseTiledHistogram(config, saveHistograms));
+}
+
+// Pool blocks must match the allocations made by SetUpProcessing. (Tiles
+// copied on write while the display holds a snapshot, and the small ROI
+// statistics, decay curves and previews, are not included.)
+ProcessingMemoryEstimate
+GetProcessingMemoryEstimate(ProcessingConfig const &config,
+                            bool saveHistograms, bool sendHistograms) {
+    ImageShapes const shapes(config);
+    ProcessingMemoryEstimate estimate;
+    auto &sizes = estimate.poolBlockSizes;
+    auto &unpooled = estimate.unpooledBytes;
+
+    // Frame and cumulative phasor images replace sent histograms
+    if (sendHistograms && config.phasorHarmonic > 0) {
+        sizes.insert(sizes.end(), 2, shapes.PhasorSize());
+        unpooled += DeliveryBuffers * shapes.PhasorSize();
+        sendHistograms = false;
+    }
+
+    // So do macrotime slices
+    if (sendHistograms && config.macrotimeSliceMs > 0) {
+        sizes.insert(sizes.end(), SliceRingSize, shapes.SliceSize());
+        unpooled += DeliveryBuffers * shapes.SliceSize();
+        sendHistograms = false;
+    }
+
+    // So do ROI statistics (not pooled), unless lifetimes are sent
+    if (!config.roiLabels.empty() &&
+        SendsROIStatistics(config, saveHistograms, sendHistograms)) {
+        sendHistograms = false;
+    }
+
+    // Intensity image and its accumulation. The display frame copies the
+    // intensity image unless it holds a snapshot of the cumulative image.
+    std::size_t displayFrameBytes = 0;
+    sizes.push_back(shapes.IntensitySize());
+    if (config.liveWindowFrames > 0) {
+        sizes.push_back(shapes.IntensitySize());
+        unpooled += WindowStorageSize<IntensityType>(config,
+                                                     shapes.IntensitySize());
+        displayFrameBytes += shapes.IntensitySize();
+    } else if (config.accumulateIntensity) {
+        sizes.insert(sizes.end(), shapes.CumulativeIntensityTileCount(),
+                     shapes.CumulativeIntensityTileSize());
+    } else {
+        displayFrameBytes += shapes.IntensitySize();
+    }
+
+    // Mean arrival time and gated intensity images and their accumulation
+    std::size_t const derivedImages = AccumulateImages(config) ? 2 : 1;
+    std::vector<std::size_t> derivedSizes;
+    if (config.meanArrivalTimeImage) {
+        derivedSizes.push_back(shapes.MeanArrivalTimeSize());
+    }
+    if (!config.timeGates.empty()) {
+        derivedSizes.push_back(
+            shapes.GatedIntensitySize(config.timeGates.size()));
+    }
+    for (auto size : derivedSizes) {
+        sizes.insert(sizes.end(), derivedImages, size);
+        unpooled += WindowStorageSize<IntensityType>(config, size);
+        displayFrameBytes += size;
+    }
+    unpooled += DeliveryBuffers * displayFrameBytes;
+
+    if (UseTiledHistogram(config, saveHistograms)) {
+        sizes.insert(sizes.end(), shapes.maxCachedTiles, shapes.TileSize());
+    } else if (saveHistograms || sendHistograms) {
+        std::size_t frames = (std::max)(config.histogramThreads, 1u);
+        bool const windowed = config.liveWindowFrames > 0 && sendHistograms;
+        // Sent cumulative histograms are snapshots, held in tiles
+        bool const snapshots = sendHistograms && !windowed;
+        std::size_t outputs = windowed && saveHistograms ? 2 : 1;
+        if (snapshots) {
+            outputs = 0;
+            sizes.insert(sizes.end(), shapes.CumulativeHistogramTileCount(),
+                         shapes.CumulativeHistogramTileSize());
+        }
+        sizes.insert(sizes.end(), frames + outputs, shapes.HistogramSize());
+
+        // A cumulative histogram may be promoted to 32 bits, in addition
+        // to the pooled 16-bit one
+        std::size_t const promotedBytes = 2 * shapes.HistogramSize();
+        if (windowed) {
+            unpooled += WindowStorageSize<SampleType>(config,
+                                                      shapes.HistogramSize());
+            unpooled += DeliveryBuffers * shapes.HistogramSize();
+        } else if (snapshots) {
+            // Tiles copied on write while the delivery thread holds
+            // snapshots (at most every tile, once per buffer), and the
+            // copy of the final snapshot made for the SDT file
+            unpooled += DeliveryBuffers *
+                        (shapes.HistogramSize() + promotedBytes);
+            if (saveHistograms) {
+                unpooled += promotedBytes;
+            }
+        }
+        if (saveHistograms || !windowed) {
+            unpooled += promotedBytes;
+        }
+    }
+    return estimate;
 }
 
 // Returns stream to which events should be sent
 // Second retval is completion of event pumping, which needs to be stored
 // until processing finishes (or else destructor will block).
 std::tuple<std::shared_ptr<EventStream<BHSPCEvent>>, std::future<void>>
-SetUpProcessing(uint32_t width, uint32_t height, uint32_t maxFrames,
-                std::bitset<16> channelMask, bool accumulateIntensity,
-                int32_t lineDelay, uint32_t lineTime, uint32_t lineMarkerBit,
+SetUpProcessing(ProcessingConfig const &config, MemoryPool &pool,
                 OScDev_Acquisition *acquisition,
                 std::function<void(void)> stopFunc,
                 std::shared_ptr<DeviceEventProcessor> additionalProcessor,
                 std::shared_ptr<SDTWriter> histogramWriter,
                 std::shared_ptr<DataSender> histogramSender,
+                std::shared_ptr<DataSender> previewSender,
+                std::shared_ptr<DataSender> decayCurveSender,
+                std::shared_ptr<MetadataJsonWriter> metadataWriter,
                 std::shared_ptr<AcquisitionCompletion> completion) {
-    uint32_t inputBits = 12;
-    uint32_t intensityBits = 0; // Intensity image is 0-bit histogram
-    uint32_t histoBits = 8;     // TODO Configurable
+    ImageShapes const shapes(config);
 
     // Construct our processing graph starting at downstream.
 
-    auto intensitySink = std::make_shared<IntensityImageSink>(
-        acquisition, stopFunc, completion);
-    auto intensityAccumulator =
-        accumulateIntensity
-            ? MakeCumulativeHistogrammer<SampleType>(
-                  intensityBits, inputBits, width, height, intensitySink)
-            : MakeNoncumulativeHistogrammer<SampleType>(
-                  intensityBits, inputBits, width, height, intensitySink);
-
     // We construct a single-channel intensity image as the sum of all enabled
     // channels (for now, at least).
-    std::vector<std::shared_ptr<PixelPhotonProcessor>> channelAccumulators;
-    channelAccumulators.resize(channelMask.size());
-    for (unsigned i = 0; i < channelMask.size(); ++i) {
-        if (!channelMask[i])
-            continue;
-        channelAccumulators[i] = intensityAccumulator;
-    }
-    auto intensityProc =
-        std::make_shared<PixelPhotonRouter>(channelAccumulators);
-
-    std::shared_ptr<PixelPhotonProcessor> pixelPhotonProcs = intensityProc;
-
-    // If saving histograms, create histogrammers for each enabled channel.
-    if (histogramWriter || histogramSender) {
-        std::vector<std::shared_ptr<PixelPhotonProcessor>> histogrammers;
-        histogrammers.resize(channelMask.size());
-        int n = 0;
-        for (unsigned i = 0; i < channelMask.size(); ++i) {
-            if (!channelMask[i])
-                continue;
-            auto histoSink = std::make_shared<HistogramSink>(
-                n, histogramWriter, histogramSender);
-            auto histoProc = MakeCumulativeHistogrammer<SampleType>(
-                histoBits, inputBits, width, height, histoSink);
-            histogrammers[i] = histoProc;
-            ++n;
-        }
-        auto histoProc = std::make_shared<PixelPhotonRouter>(histogrammers);
+    SlowConsumerPolicy const policy = config.dropFramesForSlowConsumers
+                                          ? SlowConsumerPolicy::LatestWins
+                                          : SlowConsumerPolicy::Block;
+    // All OpenScan channels of a frame are delivered together, on one
+    // thread.
+    auto display = std::make_shared<DisplayFrameAssembler>(
+        std::make_shared<DisplayFrameAssembler::Delivery>(
+            std::make_shared<DisplayFrameSink>(acquisition, stopFunc,
+                                               ImageShapes::InputBits,
+                                               completion),
+            DeliveryBuffers, policy),
+        config.meanArrivalTimeImage, !config.timeGates.empty());
+    auto intensitySink =
+        display->GetInput(DisplayFrameAssembler::Input::Intensity);
+    std::shared_ptr<HistogramProcessor<IntensityType>> intensityProc;
+    if (config.liveWindowFrames == 0 && config.accumulateIntensity) {
+        // The display thread holds snapshots of the cumulative image, so
+        // that accumulation need not wait for it or copy the whole image.
+        intensityProc =
+            std::make_shared<SnapshotHistogramAccumulator<IntensityType>>(
+                shapes.MakeCumulativeIntensity(pool), intensitySink);
+    } else {
+        intensityProc = intensitySink;
+        if (config.liveWindowFrames > 0) {
+            auto cumulIntensity = shapes.MakeIntensity(pool);
+            cumulIntensity.Clear();
+            intensityProc =
+                std::make_shared<SlidingWindowAccumulator<IntensityType>>(
+                    std::move(cumulIntensity), config.liveWindowFrames,
+                    intensityProc);
+        }
+    }
+
+    // The budget is checked on every frame, before accumulation
+    if (config.photonBudget.IsEnabled()) {
+        intensityProc = std::make_shared<PhotonBudgetMonitor>(
+            config.width, config.height, config.photonBudget, stopFunc,
+            intensityProc);
+    }
+
+    auto const routeTable = MakeDenseRouteChannelTable(config.channelMask);
+
+    // Phasors are computed directly from photons, so the data sender needs
+    // no histograms (and can receive images even with tiled histograms).
+    std::shared_ptr<PixelPhotonProcessor> phasorProc;
+    if (histogramSender && config.phasorHarmonic > 0) {
+        phasorProc = MaybeBin(
+            config, shapes,
+            MakePhasorOutput(shapes, config.phasorHarmonic,
+                             config.phasorPeriodBins, routeTable, policy,
+                             pool, histogramSender));
+        histogramSender.reset();
+    }
+
+    // Slices are also collected directly from photons.
+    std::shared_ptr<PixelPhotonProcessor> sliceProc;
+    if (histogramSender && config.macrotimeSliceMs > 0) {
+        sliceProc = MaybeBin(config, shapes,
+                             MakeSliceOutput(config, shapes, routeTable, pool,
+                                             histogramSender));
+        histogramSender.reset();
+    }
+
+    // Lifetimes are estimated from the histograms sent. Tiled histograms are
+    // not sent, so neither are lifetimes.
+    std::shared_ptr<LifetimeEstimator> lifetimes;
+    if (histogramSender && config.sendLifetimes &&
+        !UseTiledHistogram(config, histogramWriter != nullptr)) {
+        lifetimes = MakeLifetimeOutput(config, shapes, histogramSender);
+        histogramSender.reset();
+    }
+
+    // ROI statistics are collected directly from photons over the whole
+    // raster.
+    std::shared_ptr<PixelPhotonProcessor> roiProc;
+    if (histogramSender && !config.roiLabels.empty()) {
+        roiProc = MakeROIStatisticsOutput(config, shapes, routeTable, policy,
+                                          histogramSender);
+        histogramSender.reset();
+    }
+
+    bool const saveHistograms =
+        histogramWriter || histogramSender || lifetimes;
+
+    // Statistics are gathered by the (non-tiled) histogrammer as it fills
+    // each frame histogram.
+    std::shared_ptr<HistogramStatisticsProcessor> statistics;
+    if (metadataWriter) {
+        statistics =
+            std::make_shared<HistogramStatisticsJsonSink>(metadataWriter);
+    }
+    std::shared_ptr<PixelPhotonProcessor> pixelPhotonProcs;
+
+    if (UseTiledHistogram(config, histogramWriter != nullptr)) {
+        // Accumulate all frames into a single histogram that may be larger
+        // than memory; no per-frame histograms.
+        auto intensityCounter = std::make_shared<IntensityCounter>(
+            shapes.MakeIntensity(pool), config.channelMask, intensityProc);
+
+        auto tiled = std::make_shared<TiledHistogram<SampleType>>(
+            shapes.binning, shapes.histoWidth, shapes.histoHeight,
+            shapes.nChannels, shapes.linesPerTile, shapes.maxCachedTiles,
+            config.histoTileFile, &pool);
+        std::shared_ptr<PixelPhotonProcessor> histoProc =
+            std::make_shared<TiledHistogrammer<SampleType>>(
+                tiled, routeTable,
+                std::make_shared<TiledHistogramSink>(histogramWriter,
+                                                     histogramSender));
+        histoProc = MaybeBin(config, shapes, histoProc);
 
         pixelPhotonProcs = std::make_shared<BroadcastPixelPhotonProcessor<2>>(
-            intensityProc, histoProc);
+            intensityCounter, histoProc);
+    } else if (DeriveIntensity(config, saveHistograms)) {
+        // Histogram each photon once; the intensity image of every frame is
+        // computed from the frame histogram before accumulation.
+        auto histoOutput =
+            MakeHistogramOutput(shapes, config.liveWindowFrames, policy,
+                                pool, histogramWriter, histogramSender,
+                                lifetimes);
+
+        auto reducer = std::make_shared<
+            HistogramIntensityReducer<SampleType, IntensityType>>(
+            shapes.MakeIntensity(pool), histoOutput, intensityProc);
+
+        pixelPhotonProcs = MakeNoncumulativeHistogrammer(
+            shapes, routeTable, config.histogramThreads, pool, reducer,
+            statistics);
+    } else {
+        auto intensityCounter = std::make_shared<IntensityCounter>(
+            shapes.MakeIntensity(pool), config.channelMask, intensityProc);
+
+        pixelPhotonProcs = intensityCounter;
+
+        // If saving histograms, histogram all enabled channels into a single
+        // multi-channel histogram.
+        if (saveHistograms) {
+            auto histoOutput =
+                MakeHistogramOutput(shapes, config.liveWindowFrames, policy,
+                                    pool, histogramWriter, histogramSender,
+                                    lifetimes);
+            auto histoProc = MakeNoncumulativeHistogrammer(
+                shapes, routeTable, config.histogramThreads, pool,
+                histoOutput, statistics);
+            histoProc = MaybeBin(config, shapes, histoProc);
+
+            pixelPhotonProcs =
+                std::make_shared<BroadcastPixelPhotonProcessor<2>>(
+                    intensityCounter, histoProc);
+        }
+    }
+
+    if (phasorProc) {
+        pixelPhotonProcs = std::make_shared<BroadcastPixelPhotonProcessor<2>>(
+            pixelPhotonProcs, phasorProc);
+    }
+    if (sliceProc) {
+        pixelPhotonProcs = std::make_shared<BroadcastPixelPhotonProcessor<2>>(
+            pixelPhotonProcs, sliceProc);
+    }
+    if (roiProc) {
+        pixelPhotonProcs = std::make_shared<BroadcastPixelPhotonProcessor<2>>(
+            pixelPhotonProcs, roiProc);
+    }
+    if (config.meanArrivalTimeImage) {
+        pixelPhotonProcs = std::make_shared<BroadcastPixelPhotonProcessor<2>>(
+            pixelPhotonProcs,
+            MakeMeanArrivalTimeOutput(
+                config, shapes, pool,
+                display->GetInput(
+                    DisplayFrameAssembler::Input::MeanArrivalTime)));
+    }
+    if (!config.timeGates.empty()) {
+        pixelPhotonProcs = std::make_shared<BroadcastPixelPhotonProcessor<2>>(
+            pixelPhotonProcs,
+            MakeGatedIntensityOutput(
+                config, shapes, pool,
+                display->GetInput(
+                    DisplayFrameAssembler::Input::GatedIntensity)));
+    }
+
+    if (previewSender) {
+        pixelPhotonProcs = std::make_shared<BroadcastPixelPhotonProcessor<2>>(
+            pixelPhotonProcs, MakePreviewOutput(config, previewSender));
     }
 
     auto pixellator = std::make_shared<LineClockPixellator>(
-        width, height, maxFrames, lineDelay, lineTime, lineMarkerBit,
-        pixelPhotonProcs);
+        config.width, config.height, config.maxFrames, config.lineDelay,
+        config.lineTime, config.lineMarkerBit, pixelPhotonProcs);
+
+    std::shared_ptr<DecodedEventProcessor> decodedProc = pixellator;
+    if (decayCurveSender) {
+        decodedProc =
+            MakeDecayCurveOutput(config, decayCurveSender, decodedProc);
+    }
+
+    // Correlation results are only saved to file.
+    if (metadataWriter && config.fcsBinWidthNs > 0) {
+        decodedProc = MakeFCSOutput(config, metadataWriter, decodedProc);
+    }
 
-    auto decoder = std::make_shared<BHSPCEventDecoder>(pixellator);
+    auto decoder = std::make_shared<BHSPCEventDecoder>(decodedProc);
 
     std::vector<std::shared_ptr<DeviceEventProcessor>> procs;
     procs.emplace_back(decoder);
@@ -2,27 +2,125 @@
 
 #include "AcquisitionCompletion.hpp"
 #include "DataSender.hpp"
+#include "MetadataJson.hpp"
 #include "SDTFileWriter.hpp"
 #include "SPCFileWriter.hpp"
 
 #include <FLIMEvents/BHDeviceEvent.hpp>
+#include <FLIMEvents/GatedIntensityCounter.hpp>
+#include <FLIMEvents/LifetimeEstimator.hpp>
+#include <FLIMEvents/MemoryPool.hpp>
+#include <FLIMEvents/PhotonBudgetMonitor.hpp>
 #include <FLIMEvents/StreamBuffer.hpp>
 
 #include <OpenScanDeviceLib.h>
 
 #include <bitset>
+#include <cstddef>
 #include <cstdint>
 #include <functional>
 #include <memory>
+#include <string>
 #include <tuple>
+#include <vector>
+
+// Parameters of the processing graph for one acquisition
+struct ProcessingConfig {
+    uint32_t width;
+    uint32_t height;
+    uint32_t maxFrames;
+    std::bitset<16> channelMask;
+    bool accumulateIntensity;
+    bool intensityFromHistograms;
+    // Deliver a mean arrival time image as OpenScan channel 1
+    bool meanArrivalTimeImage;
+    // Deliver a time-gated intensity image for each gate, as the OpenScan
+    // channels following intensity and mean arrival time
+    std::vector<TimeGate> timeGates;
+    unsigned histogramThreads;
+    uint32_t histoROIX;
+    uint32_t histoROIY;
+    uint32_t histoROIWidth;
+    uint32_t histoROIHeight;
+    uint32_t histoBinning;
+    // Microtimes in [histoWindowStart, histoWindowEnd) are divided into
+    // histoTimeBins time bins
+    uint32_t histoTimeBins;
+    uint32_t histoWindowStart;
+    uint32_t histoWindowEnd;
+    // Nonzero selects an out-of-core tiled histogram (when writing to file)
+    // with a tile cache of this size, spilling to histoTileFile
+    uint32_t histoTileCacheMB;
+    std::string histoTileFile;
+    uint32_t liveWindowFrames;
+    // Nonzero sends cumulative phasor images at this harmonic to the data
+    // sender, instead of histograms
+    uint32_t phasorHarmonic;
+    // Laser period in (raw, 12-bit) microtime units for phasors; 0 = the
+    // ADC range
+    double phasorPeriodBins;
+    // Unless sending phasors, nonzero sends per-channel intensity images of
+    // consecutive slices of this duration to the data sender, instead of
+    // histograms
+    uint32_t macrotimeSliceMs;
+    // Unless sending phasors or slices, send per-pixel lifetime estimates
+    // (in units of ADC channels) to the data sender, instead of histograms
+    bool sendLifetimes;
+    LifetimeMethod lifetimeMethod;
+    // Unless sending phasors, slices, or lifetimes, if not empty, send
+    // per-ROI photon counts and decay curves to the data sender, instead of
+    // histograms. One label per raster pixel: 0 = none, n = ROI n - 1.
+    std::vector<uint8_t> roiLabels;
+    // If nonzero, correlate the photons of the enabled channels (with
+    // this shortest lag) and record intensity traces binned by
+    // fcsTraceBinMs, for the metadata file
+    uint32_t fcsBinWidthNs;
+    uint32_t fcsTraceBinMs;
+    // Stop the acquisition (as if by the user) once the photon counts of the
+    // intensity images reach the budget, if it has any target
+    PhotonBudget photonBudget;
+    // Intensity preview (with mean arrival times if meanArrivalTimeImage),
+    // binned by previewBinning, sent to the preview sender previewRateHz
+    // times per second of macrotime and once at the finish
+    uint32_t previewBinning;
+    double previewRateHz;
+    // Frames are delivered to the display and data sender on separate
+    // threads; if they fall behind, either wait (false) or skip to the
+    // latest frame (true). Macrotime slices are never skipped.
+    bool dropFramesForSlowConsumers;
+    int32_t lineDelay;
+    uint32_t lineTime;
+    uint32_t macrotimeUnitsTenthNs;
+    uint32_t lineMarkerBit;
+};
+
+// Memory that SetUpProcessing and the processing will use, for admission
+// control
+struct ProcessingMemoryEstimate {
+    // Sizes of the histogram and image buffers allocated from the pool
+    std::vector<std::size_t> poolBlockSizes;
+    // Upper bound on the buffers allocated outside the pool: copies for
+    // asynchronous delivery, frames of live windows and promoted histograms
+    std::size_t unpooledBytes = 0;
+};
+
+// Whether ROI statistics would be sent to the data sender if config had ROI
+// labels (rather than phasors, slices, or histograms with lifetimes)
+bool SendsROIStatistics(ProcessingConfig const &config, bool saveHistograms,
+                        bool sendHistograms);
+
+ProcessingMemoryEstimate
+GetProcessingMemoryEstimate(ProcessingConfig const &config,
+                            bool saveHistograms, bool sendHistograms);
 
 std::tuple<std::shared_ptr<EventStream<BHSPCEvent>>, std::future<void>>
-SetUpProcessing(uint32_t width, uint32_t height, uint32_t maxFrames,
-                std::bitset<16> channelMask, bool accumulateIntensity,
-                int32_t lineDelay, uint32_t lineTime, uint32_t lineMarkerBit,
+SetUpProcessing(ProcessingConfig const &config, MemoryPool &pool,
                 OScDev_Acquisition *acquisition,
                 std::function<void(void)> stopFunc,
                 std::shared_ptr<DeviceEventProcessor> additionalProcessor,
                 std::shared_ptr<SDTWriter> histogramWriter,
                 std::shared_ptr<DataSender> histogramSender,
+                std::shared_ptr<DataSender> previewSender,
+                std::shared_ptr<DataSender> decayCurveSender,
+                std::shared_ptr<MetadataJsonWriter> metadataWriter,
                 std::shared_ptr<AcquisitionCompletion> completion);
@@ -106,6 +106,25 @@ int SetMarkerPolarities(short module, uint16_t enabledBits,
     return 0;
 }
 
+// Width of one microtime unit (ADC channel at 12-bit resolution), from the
+// current TAC range and gain
+int GetADCChannelWidthNs(short module, double *widthNs) {
+    float range, gain;
+    short err = SPC_get_parameter(module, TAC_RANGE, &range);
+    if (err < 0) {
+        return err;
+    }
+    err = SPC_get_parameter(module, TAC_GAIN, &gain);
+    if (err < 0) {
+        return err;
+    }
+    if (!(range > 0.0f) || !(gain > 0.0f)) {
+        return 1; // Invalid TAC settings
+    }
+    *widthNs = double(range) / double(gain) / 4096.0;
+    return 0;
+}
+
 // Prepare for acquisition and determine necessary parameters for data handling
 // fileHeader: set to first 4 bytes of the (4- or 6-byte) .spc file header
 // fifoType: set to FIFO_48, FIFO_32, FIFO_130, etc.
@@ -13,6 +13,7 @@
 int ConfigureDeviceForFIFOAcquisition(short module);
 int SetMarkerPolarities(short module, uint16_t enabledBits,
                         uint16_t polarityBits);
+int GetADCChannelWidthNs(short module, double *widthNs);
 int SetUpAcquisition(short module, bool checkSync, char fileHeader[4],
                      short *fifoType, int *macroTimeClockTenthNs);
 bool IsStandardFIFO(short fifoType);
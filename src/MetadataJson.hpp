@@ -1,13 +1,20 @@
 #pragma once
 
+#include <FLIMEvents/HistogramStatistics.hpp>
+#include <FLIMEvents/MultiTauCorrelator.hpp>
+
 #include <rapidjson/document.h>
 #include <rapidjson/filereadstream.h>
 #include <rapidjson/filewritestream.h>
 #include <rapidjson/prettywriter.h>
 
+#include <array>
 #include <bitset>
+#include <cstdint>
 #include <cstdio>
+#include <deque>
 #include <string>
+#include <vector>
 
 namespace rj = rapidjson;
 
@@ -50,6 +57,28 @@ class MetadataJsonWriter final {
         doc.AddMember("raster_height", height, doc.GetAllocator());
     }
 
+    void SetHistogramROIAndBinning(uint32_t x, uint32_t y, uint32_t width,
+                                   uint32_t height, uint32_t binning) {
+        rj::Value roi(rj::kArrayType);
+        auto &allocator = doc.GetAllocator();
+        roi.PushBack(x, allocator);
+        roi.PushBack(y, allocator);
+        roi.PushBack(width, allocator);
+        roi.PushBack(height, allocator);
+        doc.AddMember("histogram_roi", roi, allocator);
+        doc.AddMember("histogram_binning", binning, allocator);
+    }
+
+    void SetHistogramTimeBinning(uint32_t windowStart, uint32_t windowEnd,
+                                 uint32_t numTimeBins) {
+        rj::Value window(rj::kArrayType);
+        auto &allocator = doc.GetAllocator();
+        window.PushBack(windowStart, allocator);
+        window.PushBack(windowEnd, allocator);
+        doc.AddMember("histogram_microtime_window", window, allocator);
+        doc.AddMember("histogram_time_bins", numTimeBins, allocator);
+    }
+
     void SetPixelRateHz(double pixelRateHz) {
         doc.AddMember("pixel_rate_hz", pixelRateHz, doc.GetAllocator());
     }
@@ -80,6 +109,82 @@ class MetadataJsonWriter final {
             doc.AddMember("frame_marker_bit", frameMarkerBit,
                           doc.GetAllocator());
     }
+
+    // Per-frame and cumulative statistics of the saved histogram, added at
+    // the end of the acquisition (followed by another Save()). The per-frame
+    // records may be the last few only; firstFrame is the index of the first.
+    void SetHistogramStatistics(std::deque<HistogramStatistics> const &frames,
+                                uint64_t firstFrame,
+                                HistogramStatistics const &cumulative) {
+        auto &allocator = doc.GetAllocator();
+        auto channelsValue = [&](HistogramStatistics const &stats) {
+            rj::Value array(rj::kArrayType);
+            for (std::size_t ch = 0; ch < stats.channels.size(); ++ch) {
+                auto const &c = stats.channels[ch];
+                rj::Value obj(rj::kObjectType);
+                obj.AddMember("total_photons", c.totalPhotons, allocator);
+                obj.AddMember("max_pixel_photons", c.maxPixelPhotons,
+                              allocator);
+                obj.AddMember("saturated_bins", c.saturatedBins, allocator);
+                obj.AddMember("empty_pixel_fraction",
+                              stats.GetEmptyPixelFraction(ch), allocator);
+                array.PushBack(obj, allocator);
+            }
+            return array;
+        };
+        rj::Value frameArray(rj::kArrayType);
+        for (auto const &f : frames) {
+            frameArray.PushBack(channelsValue(f), allocator);
+        }
+        rj::Value stats(rj::kObjectType);
+        stats.AddMember("first_frame", firstFrame, allocator);
+        stats.AddMember("frames", frameArray, allocator);
+        stats.AddMember("cumulative", channelsValue(cumulative), allocator);
+        doc.RemoveMember("histogram_statistics");
+        doc.AddMember("histogram_statistics", stats, allocator);
+    }
+
+    // Correlation curves and intensity traces, added at the end of the
+    // acquisition (followed by another Save())
+    void SetFCSData(FCSData const &data, uint64_t traceBinWidth) {
+        auto &allocator = doc.GetAllocator();
+        auto curvesValue = [&](std::vector<CorrelationCurve> const &curves) {
+            rj::Value array(rj::kArrayType);
+            for (auto const &curve : curves) {
+                rj::Value lags(rj::kArrayType);
+                for (auto lag : curve.lags) {
+                    lags.PushBack(lag, allocator);
+                }
+                rj::Value values(rj::kArrayType);
+                for (auto v : curve.values) {
+                    values.PushBack(v, allocator);
+                }
+                rj::Value obj(rj::kObjectType);
+                obj.AddMember("lags_macrotime_units", lags, allocator);
+                obj.AddMember("values", values, allocator);
+                array.PushBack(obj, allocator);
+            }
+            return array;
+        };
+        rj::Value traces(rj::kArrayType);
+        for (auto const &trace : data.traces) {
+            rj::Value counts(rj::kArrayType);
+            for (auto c : trace) {
+                counts.PushBack(c, allocator);
+            }
+            traces.PushBack(counts, allocator);
+        }
+        rj::Value fcs(rj::kObjectType);
+        fcs.AddMember("autocorrelations", curvesValue(data.autocorrelations),
+                      allocator);
+        fcs.AddMember("cross_correlations",
+                      curvesValue(data.crossCorrelations), allocator);
+        fcs.AddMember("trace_bin_macrotime_units", traceBinWidth, allocator);
+        fcs.AddMember("trace_first_bin", data.firstTraceBin, allocator);
+        fcs.AddMember("traces", traces, allocator);
+        doc.RemoveMember("fcs");
+        doc.AddMember("fcs", fcs, allocator);
+    }
 };
 
 class MetadataJsonReader final {
@@ -136,6 +241,63 @@ class MetadataJsonReader final {
         return height.GetUint();
     }
 
+    // Returns x, y, width, height; the full raster if not specified
+    std::array<uint32_t, 4> GetHistogramROI() const {
+        if (!doc.HasMember("histogram_roi"))
+            return {0, 0, GetRasterWidth(), GetRasterHeight()};
+        auto &array = doc["histogram_roi"];
+        if (!array.IsArray() || array.GetArray().Size() != 4)
+            throw std::runtime_error(
+                "JSON histogram_roi must be array of length 4");
+        std::array<uint32_t, 4> ret;
+        for (rj::SizeType i = 0; i < 4; ++i) {
+            if (!array[i].IsUint())
+                throw std::runtime_error(
+                    "JSON histogram_roi array must contain integers");
+            ret[i] = array[i].GetUint();
+        }
+        return ret;
+    }
+
+    uint32_t GetHistogramBinning() const {
+        if (!doc.HasMember("histogram_binning"))
+            return 1;
+        auto &binning = doc["histogram_binning"];
+        if (!binning.IsUint())
+            throw std::runtime_error(
+                "JSON histogram_binning field must be integer");
+        return binning.GetUint();
+    }
+
+    // Returns start, end; the full 12-bit range if not specified
+    std::array<uint32_t, 2> GetHistogramMicrotimeWindow() const {
+        if (!doc.HasMember("histogram_microtime_window"))
+            return {0, 4096};
+        auto &array = doc["histogram_microtime_window"];
+        if (!array.IsArray() || array.GetArray().Size() != 2)
+            throw std::runtime_error(
+                "JSON histogram_microtime_window must be array of length 2");
+        std::array<uint32_t, 2> ret;
+        for (rj::SizeType i = 0; i < 2; ++i) {
+            if (!array[i].IsUint())
+                throw std::runtime_error("JSON histogram_microtime_window "
+                                         "array must contain integers");
+            ret[i] = array[i].GetUint();
+        }
+        return ret;
+    }
+
+    // Returns 256 (the former fixed value) if not specified
+    uint32_t GetHistogramTimeBins() const {
+        if (!doc.HasMember("histogram_time_bins"))
+            return 256;
+        auto &bins = doc["histogram_time_bins"];
+        if (!bins.IsUint())
+            throw std::runtime_error(
+                "JSON histogram_time_bins field must be integer");
+        return bins.GetUint();
+    }
+
     double GetPixelRateHz() const {
         if (!doc.HasMember("pixel_rate_hz"))
             throw std::runtime_error("JSON field missing: pixel_rate_hz");
@@ -3,7 +3,9 @@
 #include "FLIMEvents/BHDeviceEvent.hpp"
 #include "FLIMEvents/Histogram.hpp"
 #include "FLIMEvents/LineClockPixellator.hpp"
-#include "FLIMEvents/PixelPhotonRouter.hpp"
+#include "FLIMEvents/MicrotimeBinning.hpp"
+#include "FLIMEvents/MultiChannelHistogrammer.hpp"
+#include "FLIMEvents/PixelBinner.hpp"
 #include "FLIMEvents/StreamBuffer.hpp"
 #include "MetadataJson.hpp"
 
@@ -24,12 +26,11 @@ void Usage() {
 using SampleType = uint16_t;
 
 template <typename T> class HistogramSink : public HistogramProcessor<T> {
-    unsigned channel;
     std::shared_ptr<DataSender> dataSender;
 
   public:
-    HistogramSink(unsigned channel, std::shared_ptr<DataSender> dataSender)
-        : channel(channel), dataSender(dataSender) {}
+    HistogramSink(std::shared_ptr<DataSender> dataSender)
+        : dataSender(dataSender) {}
 
     void HandleError(std::string const &message) override {
         if (dataSender) {
@@ -40,7 +41,7 @@ template <typename T> class HistogramSink : public HistogramProcessor<T> {
 
     void HandleFrame(Histogram<SampleType> const &histogram) override {
         if (dataSender) {
-            dataSender->SetHistogram(channel, histogram);
+            dataSender->SetHistograms(histogram);
         }
     }
 
@@ -56,22 +57,23 @@ template <typename T> class HistogramSink : public HistogramProcessor<T> {
 
 template <typename T>
 static std::shared_ptr<PixelPhotonProcessor> MakeNoncumulativeHistogrammer(
-    uint32_t histoBits, uint32_t inputBits, uint32_t width, uint32_t height,
+    MicrotimeBinning const &timeBinning, uint32_t width, uint32_t height,
+    std::size_t nChannels, RouteChannelTable const &routeTable,
     std::shared_ptr<HistogramProcessor<T>> downstream) {
-    Histogram<T> frameHisto(histoBits, inputBits, true, width, height);
-    return std::make_shared<Histogrammer<T>>(std::move(frameHisto),
-                                             downstream);
+    Histogram<T> frameHisto(timeBinning, width, height, nChannels);
+    return std::make_shared<MultiChannelHistogrammer<T>>(
+        std::move(frameHisto), routeTable, downstream);
 }
 
 template <typename T>
-static std::shared_ptr<PixelPhotonProcessor>
-MakeCumulativeHistogrammer(uint32_t histoBits, uint32_t inputBits,
-                           uint32_t width, uint32_t height,
-                           std::shared_ptr<HistogramProcessor<T>> downstream) {
-    Histogram<T> cumulHisto(histoBits, inputBits, true, width, height);
+static std::shared_ptr<PixelPhotonProcessor> MakeCumulativeHistogrammer(
+    MicrotimeBinning const &timeBinning, uint32_t width, uint32_t height,
+    std::size_t nChannels, RouteChannelTable const &routeTable,
+    std::shared_ptr<HistogramProcessor<T>> downstream) {
+    Histogram<T> cumulHisto(timeBinning, width, height, nChannels);
     cumulHisto.Clear();
     return MakeNoncumulativeHistogrammer<T>(
-        histoBits, inputBits, width, height,
+        timeBinning, width, height, nChannels, routeTable,
         std::make_shared<HistogramAccumulator<T>>(std::move(cumulHisto),
                                                   downstream));
 }
@@ -92,8 +94,12 @@ void replay(std::string const &inFilename,
 
     std::bitset<16> channelMask = jsonReader.GetChannelMask();
 
-    int32_t inputBits = 12;
-    int32_t histoBits = 8;
+    uint32_t const inputBits = 12;
+    auto window = jsonReader.GetHistogramMicrotimeWindow();
+    uint32_t timeBins = jsonReader.GetHistogramTimeBins();
+    // Throws if the window or number of bins is out of range
+    MicrotimeBinning timeBinning(inputBits, window[0], window[1], timeBins,
+                                 true);
 
     uint32_t width = jsonReader.GetRasterWidth();
     uint32_t height = jsonReader.GetRasterHeight();
@@ -116,24 +122,21 @@ void replay(std::string const &inFilename,
             "JSON parameters don't match macrotime units (from .spc) of " +
             std::to_string(macrotimeUnitsTenthNs) + " x 0.1 ns");
 
-    auto nChannels = static_cast<unsigned>(channelMask.count());
-    auto sender = std::make_shared<DataSender>(nChannels, port, nullptr);
-
-    std::vector<std::shared_ptr<PixelPhotonProcessor>> histogrammers;
-    histogrammers.resize(nChannels);
-    int n = 0;
-    for (unsigned i = 0; i < channelMask.size(); ++i) {
-        if (!channelMask[i])
-            continue;
-        auto histoSink =
-            std::make_shared<HistogramSink<SampleType>>(n, sender);
-        auto histoProc = MakeCumulativeHistogrammer<SampleType>(
-            histoBits, inputBits, width, height, histoSink);
-        histogrammers[n] = histoProc;
-        ++n;
-    }
-
-    auto histProc = std::make_shared<PixelPhotonRouter>(histogrammers);
+    auto sender = std::make_shared<DataSender>(port, nullptr);
+
+    auto roi = jsonReader.GetHistogramROI();
+    uint32_t binning = jsonReader.GetHistogramBinning();
+    if (binning < 1 || roi[0] + roi[2] > width || roi[1] + roi[3] > height)
+        throw std::runtime_error("Histogram ROI or binning out of range");
+
+    auto histoSink = std::make_shared<HistogramSink<SampleType>>(sender);
+    // PixelBinner checks that the ROI is at least one bin in size
+    auto histProc = std::make_shared<PixelBinner>(
+        roi[0], roi[1], roi[2], roi[3], binning,
+        MakeCumulativeHistogrammer<SampleType>(
+            timeBinning, roi[2] / binning, roi[3] / binning,
+            channelMask.count(), MakeDenseRouteChannelTable(channelMask),
+            histoSink));
 
     auto pixellator = std::make_shared<LineClockPixellator>(
         width, height, UINT32_MAX, lineDelay, lineTime, lineMarkerBit,
@@ -34,6 +34,47 @@
 
 #define NEWLINE "\r\n"
 
+// Data blocks may lie beyond 2 GiB, where ftell()/fseek() fail with a 32-bit
+// long. Offsets in the file are 32-bit, limiting the file to 4 GiB.
+#ifdef _MSC_VER
+#define FTELL64 _ftelli64
+#define FSEEK64 _fseeki64
+#else
+#define FTELL64 ftello
+#define FSEEK64 fseeko
+#endif
+#define MAX_SDT_FILE_SIZE 0xffffffffULL
+
+// Block type for 32-bit samples (BH headers define this alongside
+// DATA_USHORT; defined here in case they do not)
+#ifndef DATA_ULONG
+#define DATA_ULONG 0x1000
+#endif
+
+// Samples per chunk when writing streamed histograms
+#define STREAM_CHUNK_SAMPLES (1 << 20)
+
+// The 12-bit ADC range, and the width of each of the 16 areas selectable by
+// ADC zoom
+#define ADC_RANGE 4096
+#define ADC_ZOOM_WIDTH (ADC_RANGE / 16)
+
+// Whether the microtime window is exactly one of the ADC zoom areas, so that
+// it can be recorded as such
+static bool IsADCZoomArea(const struct SDTFileData *data) {
+    return data->adcWindowEnd - data->adcWindowStart == ADC_ZOOM_WIDTH &&
+           data->adcWindowStart % ADC_ZOOM_WIDTH == 0;
+}
+
+// Bits needed to index the time bins (the "ADC resolution" in SPCM terms)
+static unsigned BitsForTimeBins(unsigned numTimeBins) {
+    unsigned bits = 0;
+    while ((1u << bits) < numTimeBins) {
+        ++bits;
+    }
+    return bits;
+}
+
 static int WriteSDTIdentification(FILE *fp, const struct SDTFileData *data) {
     int ret = 0;
     char *buf = NULL;
@@ -59,7 +100,7 @@ static int WriteSDTIdentification(FILE *fp, const struct SDTFileData *data) {
             "  Contents  : FLIM histogram(s) generated by OpenScan" NEWLINE
             "*END" NEWLINE NEWLINE,
             fcs_data_identifier, // FIFO Image mode data
-            data->histogramBits, data->date, data->time);
+            BitsForTimeBins(data->numTimeBins), data->date, data->time);
 
         size_t len = strlen(buf);
         if (len >= bufSize - 1) { // May not have fit in buf
@@ -120,12 +161,27 @@ WriteSDTMeasurementDescBlock(FILE *fp, const struct SDTFileData *data,
     b.syn_hf = p->sync_holdoff;
 
     b.tac_r /* s */ = p->tac_range /* ns */ * 1e-9f;
+    if (!IsADCZoomArea(data)) {
+        // Readers take the bin width to be tac_r / adc_re, so describe the
+        // window as if it were the full range
+        b.tac_r *= (float)(data->adcWindowEnd - data->adcWindowStart) /
+                   ADC_RANGE;
+    }
     b.tac_g = p->tac_gain;
-    b.tac_of = p->tac_offset;
+    b.tac_of /* % of TAC range */ = p->tac_offset;
+    if (!IsADCZoomArea(data) && p->tac_gain > 0) {
+        // Record where the window starts within the ADC range. Histograms
+        // are in natural time order, so the earliest time is at the end of
+        // the window of (reversed) ADC values. One ADC range spans 1/gain of
+        // the TAC range.
+        b.tac_of += 100.0f * (float)(ADC_RANGE - data->adcWindowEnd) /
+                    ADC_RANGE / p->tac_gain;
+    }
     b.tac_ll = p->tac_limit_low;
     b.tac_lh = p->tac_limit_high;
 
-    b.adc_re = 1 << data->histogramBits;
+    // A power of 2 (see SDTFileSupportsTimeBins())
+    b.adc_re = data->numTimeBins;
 
     b.eal_de = p->ext_latch_delay;
 
@@ -203,7 +259,10 @@ WriteSDTMeasurementDescBlock(FILE *fp, const struct SDTFileData *data,
 
     // Not applicable to FIFO data
     b.overflow_corr_factor = 0.0f;
-    b.adc_zoom = 0;
+    // Bit 4 enables zoom; bits 0-3 select one of 16 areas of the ADC range
+    b.adc_zoom = IsADCZoomArea(data)
+                     ? (short)(0x10 | data->adcWindowStart / ADC_ZOOM_WIDTH)
+                     : 0;
 
     b.cycles = 1;
 
@@ -330,18 +389,57 @@ WriteSDTMeasurementDescBlock(FILE *fp, const struct SDTFileData *data,
     return 0;
 }
 
+// Streams the histogram of the channel at index in chunks.
+static int WriteStreamedHistogram(FILE *fp, size_t numSamples,
+                                  SDTHistogramReader readHistogram,
+                                  void *context, unsigned index) {
+    size_t chunkSize =
+        numSamples < STREAM_CHUNK_SAMPLES ? numSamples : STREAM_CHUNK_SAMPLES;
+    uint16_t *chunk = malloc(sizeof(uint16_t) * chunkSize);
+    if (!chunk) {
+        return 1; // Out of memory
+    }
+
+    int ret = 0;
+    for (size_t offset = 0; offset < numSamples; offset += chunkSize) {
+        size_t count = numSamples - offset;
+        if (count > chunkSize) {
+            count = chunkSize;
+        }
+        ret = readHistogram(context, index, offset, chunk, count);
+        if (ret) {
+            break;
+        }
+        size_t written = fwrite(chunk, sizeof(uint16_t), count, fp);
+        if (written < count) {
+            ret = 1; // Write error
+            break;
+        }
+    }
+
+    free(chunk);
+    return ret;
+}
+
+static size_t HistogramSampleSize(const struct SDTFileData *data) {
+    return data->wideHistograms ? sizeof(uint32_t) : sizeof(uint16_t);
+}
+
+// Exactly one of histogram or readHistogram is non-null. Streamed histograms
+// are not compressed (compression requires the whole block in memory).
 static int WriteSDTHistogramDataBlock(
     FILE *fp, bool useCompression, const struct SDTFileData *data,
-    const struct SDTFileChannelData *channelData, const uint16_t *histogram,
-    unsigned *nextBlockOffsetFieldOffset) {
+    const struct SDTFileChannelData *channelData, const void *histogram,
+    SDTHistogramReader readHistogram, void *context, unsigned index,
+    long long *nextBlockOffsetFieldOffset) {
     size_t numSamples =
-        data->width * data->height * (1 << data->histogramBits);
-    size_t uncompressedSize = sizeof(uint16_t) * numSamples;
+        (size_t)data->width * data->height * data->numTimeBins;
+    size_t uncompressedSize = HistogramSampleSize(data) * numSamples;
 
     // Attempt the compression first, so that we can fall back to uncompressed
     // on failure.
     struct InMemoryZip *compressedHisto = NULL;
-    if (useCompression) {
+    if (useCompression && histogram != NULL) {
         compressedHisto = CreateInMemoryZip();
         if (compressedHisto) {
             // The default compression level (6) is too slow. Compression
@@ -355,15 +453,16 @@ static int WriteSDTHistogramDataBlock(
         }
     }
 
-    long headerOffset = ftell(fp);
+    long long headerOffset = FTELL64(fp);
     BHFileBlockHeader header;
     memset(&header, 0, sizeof(header));
 
     // block_no or data_offs_ext/next_block_offs_ext is always 0 for us
-    header.data_offs = headerOffset + sizeof(header);
+    header.data_offs = (unsigned long)(headerOffset + sizeof(header));
     *nextBlockOffsetFieldOffset =
         headerOffset + offsetof(BHFileBlockHeader, next_block_offs);
-    header.block_type = FIFO_DATA | IMG_BLOCK | DATA_USHORT;
+    header.block_type = FIFO_DATA | IMG_BLOCK |
+                        (data->wideHistograms ? DATA_ULONG : DATA_USHORT);
     if (compressedHisto != NULL) {
         header.block_type |= DATA_ZIPPED;
     }
@@ -381,7 +480,10 @@ static int WriteSDTHistogramDataBlock(
         goto exit;
     }
 
-    if (compressedHisto == NULL) {
+    if (histogram == NULL) {
+        ret = WriteStreamedHistogram(fp, numSamples, readHistogram, context,
+                                     index);
+    } else if (compressedHisto == NULL) {
         written = fwrite(histogram, 1, uncompressedSize, fp);
         if (written < uncompressedSize) {
             ret = 1; // Write error
@@ -453,11 +555,44 @@ static unsigned short HeaderChecksum(const bhfile_header *header) {
     return -sum + BH_HEADER_CHKSUM;
 }
 
+static unsigned long long
+HistogramDataBlockSize(const struct SDTFileData *data) {
+    return (unsigned long long)data->width * data->height *
+           data->numTimeBins * HistogramSampleSize(data);
+}
+
+bool SDTFileCanHoldHistograms(const struct SDTFileData *data) {
+    // Allow ample space for the headers and setup
+    unsigned long long const headerAllowance = 1 << 20;
+    return headerAllowance +
+               data->numChannels * (sizeof(BHFileBlockHeader) +
+                                    HistogramDataBlockSize(data)) <=
+           MAX_SDT_FILE_SIZE;
+}
+
+bool SDTFileSupportsTimeBins(unsigned numTimeBins) {
+    return numTimeBins >= 1 && numTimeBins <= ADC_RANGE &&
+           (numTimeBins & (numTimeBins - 1)) == 0;
+}
+
+// Histograms are taken from channelHistograms if non-null, or else streamed
+// from readHistogram.
 static int
 WriteSDTFileP(FILE *fp, const struct SDTFileData *data,
               const struct SDTFileChannelData *const channelDataArray[],
-              const uint16_t *const channelHistograms[],
+              const void *const channelHistograms[],
+              SDTHistogramReader readHistogram, void *context,
               const SPCdata *fifoModeParams) {
+    if (!SDTFileCanHoldHistograms(data)) {
+        return 1; // Too large for SDT format
+    }
+    if (!SDTFileSupportsTimeBins(data->numTimeBins)) {
+        return 1; // Cannot be described in SDT format
+    }
+    if (channelHistograms == NULL && data->wideHistograms) {
+        return 1; // Streamed histograms are 16-bit
+    }
+
     bhfile_header header;
     memset(&header, 0, sizeof(header));
 
@@ -497,31 +632,32 @@ WriteSDTFileP(FILE *fp, const struct SDTFileData *data,
     }
 
     header.no_of_data_blocks = data->numChannels;
-    header.data_block_length = data->width * data->height *
-                               (1 << data->histogramBits) * sizeof(uint16_t);
+    header.data_block_length = (long)HistogramDataBlockSize(data);
     header.reserved1 = data->numChannels;
 
     header.data_block_offs = ftell(fp);
     for (unsigned i = 0; i < data->numChannels; ++i) {
-        unsigned long nextOffsetPos = -1;
-        err = WriteSDTHistogramDataBlock(fp, data->useCompression, data,
-                                         channelDataArray[i],
-                                         channelHistograms[i], &nextOffsetPos);
+        long long nextOffsetPos = -1;
+        err = WriteSDTHistogramDataBlock(
+            fp, data->useCompression, data, channelDataArray[i],
+            channelHistograms ? channelHistograms[i] : NULL, readHistogram,
+            context, i, &nextOffsetPos);
         if (err)
             return err;
 
         // Update the next-block-offset field. This sets the next-block-offset
         // of the last data block to the end-of-file offset, which is what was
         // observed in files written by BH.
-        long pos = ftell(fp);
-        if (fseek(fp, nextOffsetPos, SEEK_SET) != 0) {
+        long long pos = FTELL64(fp);
+        unsigned long pos32 = (unsigned long)pos;
+        if (FSEEK64(fp, nextOffsetPos, SEEK_SET) != 0) {
             return 1; // I/O error
         }
-        written = fwrite(&pos, sizeof(unsigned long), 1, fp);
+        written = fwrite(&pos32, sizeof(unsigned long), 1, fp);
         if (written < 1) {
             return 1; // Write error
         }
-        if (fseek(fp, pos, SEEK_SET) != 0) {
+        if (FSEEK64(fp, pos, SEEK_SET) != 0) {
             return 1; // I/O error
         }
     }
@@ -543,7 +679,7 @@ WriteSDTFileP(FILE *fp, const struct SDTFileData *data,
 
 int WriteSDTFile(const char *filename, const struct SDTFileData *data,
                  const struct SDTFileChannelData *const channelDataArray[],
-                 const uint16_t *const channelHistograms[],
+                 const void *const channelHistograms[],
                  const SPCdata *fifoModeParams) {
     FILE *fp = fopen(filename, "wb");
     if (!fp) {
@@ -551,7 +687,25 @@ int WriteSDTFile(const char *filename, const struct SDTFileData *data,
     }
 
     int err = WriteSDTFileP(fp, data, channelDataArray, channelHistograms,
-                            fifoModeParams);
+                            NULL, NULL, fifoModeParams);
+
+    fclose(fp);
+
+    return err;
+}
+
+int WriteSDTFileStreamed(
+    const char *filename, const struct SDTFileData *data,
+    const struct SDTFileChannelData *const channelDataArray[],
+    SDTHistogramReader readHistogram, void *context,
+    const SPCdata *fifoModeParams) {
+    FILE *fp = fopen(filename, "wb");
+    if (!fp) {
+        return 1; // Cannot open file
+    }
+
+    int err = WriteSDTFileP(fp, data, channelDataArray, NULL, readHistogram,
+                            context, fifoModeParams);
 
     fclose(fp);
 
@@ -3,6 +3,7 @@
 #include <Spcm_def.h>
 
 #include <stdbool.h>
+#include <stddef.h>
 #include <stdint.h>
 
 #ifdef __cplusplus
@@ -11,13 +12,20 @@ extern "C" {
 
 // Channel-independent data needed to write an SDT file
 struct SDTFileData {
-    unsigned histogramBits; // 8 to 12
+    unsigned numTimeBins; // 1 to 4096
+    // Range of ADC values (0 to 4096) divided into the time bins
+    unsigned adcWindowStart;
+    unsigned adcWindowEnd;
     unsigned width;
     unsigned height;
     unsigned numChannels;
 
     bool useCompression;
 
+    // Histogram samples are uint32_t rather than uint16_t (not supported for
+    // streamed histograms)
+    bool wideHistograms;
+
     double pixelRateHz;
     unsigned macroTimeUnitsTenthNs;
 
@@ -67,11 +75,35 @@ struct SDTFileChannelData {
     float timeOfLastPhotonInChannelSeconds;
 };
 
+// Histograms are uint16_t, or uint32_t if data->wideHistograms.
 int WriteSDTFile(const char *filename, const struct SDTFileData *data,
                  const struct SDTFileChannelData *const channelDataArray[],
-                 const uint16_t *const channelHistograms[],
+                 const void *const channelHistograms[],
                  const SPCdata *fifoModeParams);
 
+// Supplies count samples of the histogram of the channel at index, starting
+// at sample offset. Returns nonzero on error.
+typedef int (*SDTHistogramReader)(void *context, unsigned index,
+                                  size_t offset, uint16_t *buffer,
+                                  size_t count);
+
+// Same as WriteSDTFile(), but histograms are read in chunks, so that they
+// need not be held in memory. The histograms are not compressed.
+int WriteSDTFileStreamed(
+    const char *filename, const struct SDTFileData *data,
+    const struct SDTFileChannelData *const channelDataArray[],
+    SDTHistogramReader readHistogram, void *context,
+    const SPCdata *fifoModeParams);
+
+// Whether histograms of the given size (numTimeBins, width, height,
+// numChannels, and wideHistograms) fit in an SDT file, whose offsets are
+// 32-bit
+bool SDTFileCanHoldHistograms(const struct SDTFileData *data);
+
+// Whether the number of time bins can be recorded in an SDT file (the ADC
+// resolution is recorded as a number of bits, so it must be a power of 2)
+bool SDTFileSupportsTimeBins(unsigned numTimeBins);
+
 #ifdef __cplusplus
 } // extern "C"
 #endif
@@ -4,6 +4,8 @@
 #include "SDTFile.h"
 
 #include <FLIMEvents/Histogram.hpp>
+#include <FLIMEvents/PromotingHistogram.hpp>
+#include <FLIMEvents/TiledHistogram.hpp>
 
 #include <cstring>
 #include <ctime>
@@ -22,8 +24,11 @@ class SDTWriter final : public std::enable_shared_from_this<SDTWriter> {
     std::vector<SDTFileChannelData> channelData;
     SPCdata params;
 
-    std::mutex mutex; // Protects the next 3 members that are set by upstream
-    std::vector<Histogram<uint16_t>> histograms;
+    std::mutex mutex; // Protects the next 7 members that are set by upstream
+    Histogram<uint16_t> histogram; // All channels
+    PromotingHistogram promotedHistogram;                     // Or this
+    PromotingHistogramSnapshot promotedSnapshot;              // Or this
+    std::shared_ptr<TiledHistogram<uint16_t>> tiledHistogram; // Or this
     bool finishedRecordingPostAcquisitionData;
     bool canceled;
     bool writeStarted;
@@ -31,6 +36,18 @@ class SDTWriter final : public std::enable_shared_from_this<SDTWriter> {
     std::future<void> asyncWriteCompletion;
     std::shared_ptr<AcquisitionCompletion> downstream;
 
+    static int ReadTiledHistogram(void *context, unsigned index,
+                                  size_t offset, uint16_t *buffer,
+                                  size_t count) {
+        auto histogram = static_cast<TiledHistogram<uint16_t> *>(context);
+        try {
+            histogram->Read(index, offset, buffer, count);
+        } catch (std::exception const &) {
+            return 1;
+        }
+        return 0;
+    }
+
     void SendError(std::string const &message) {
         {
             std::lock_guard<std::mutex> hold(mutex);
@@ -70,8 +87,6 @@ class SDTWriter final : public std::enable_shared_from_this<SDTWriter> {
 
         memset(&params, 0, sizeof(params));
 
-        histograms.resize(nChannels);
-
         if (downstream) {
             downstream->AddProcess("SDTWriter");
         }
@@ -79,13 +94,16 @@ class SDTWriter final : public std::enable_shared_from_this<SDTWriter> {
 
     // Should be called after setting all SPC parameters but before starting
     // measurement.
-    void SetPreacquisitionData(short module, uint32_t histogramBits,
+    void SetPreacquisitionData(short module, uint32_t numTimeBins,
+                               uint32_t adcWindowStart, uint32_t adcWindowEnd,
                                uint32_t width, uint32_t height,
                                bool useCompression, double pixelRateHz,
                                bool usePixelMarkers, bool recordPixelMarkers,
                                bool recordLineMarkers,
                                bool recordFrameMarkers) {
-        data.histogramBits = histogramBits;
+        data.numTimeBins = numTimeBins;
+        data.adcWindowStart = adcWindowStart;
+        data.adcWindowEnd = adcWindowEnd;
         data.width = width;
         data.height = height;
         data.useCompression = useCompression;
@@ -159,12 +177,47 @@ class SDTWriter final : public std::enable_shared_from_this<SDTWriter> {
         StartWritingFileIfReady();
     }
 
-    // Return value indicates write finish; caller must keep histogram valid
-    // until the future completes. Not thread safe.
-    void SetHistogram(unsigned channel, Histogram<uint16_t> &&histogram) {
+    // Set the multi-channel histogram (one channel per SDT channel). Not
+    // thread safe.
+    void SetHistograms(Histogram<uint16_t> &&histogram) {
+        {
+            std::lock_guard<std::mutex> hold(mutex);
+            this->histogram = std::move(histogram);
+        }
+
+        StartWritingFileIfReady();
+    }
+
+    // Same as SetHistograms(), for a cumulative histogram that may have
+    // overflowed 16 bits. If any channel did, all channels are written with
+    // 32-bit samples. Not thread safe.
+    void SetHistograms(PromotingHistogram &&histogram) {
+        {
+            std::lock_guard<std::mutex> hold(mutex);
+            promotedHistogram = std::move(histogram);
+        }
+
+        StartWritingFileIfReady();
+    }
+
+    // Same, for a snapshot of a cumulative histogram. The channels are
+    // copied out of their tiles for writing. Not thread safe.
+    void SetHistograms(PromotingHistogramSnapshot &&snapshot) {
+        {
+            std::lock_guard<std::mutex> hold(mutex);
+            promotedSnapshot = std::move(snapshot);
+        }
+
+        StartWritingFileIfReady();
+    }
+
+    // Same as SetHistograms(), for a histogram too large for memory. The
+    // histogram is streamed into the file. Not thread safe.
+    void SetTiledHistograms(
+        std::shared_ptr<TiledHistogram<uint16_t>> histogram) {
         {
             std::lock_guard<std::mutex> hold(mutex);
-            histograms[channel] = std::move(histogram);
+            tiledHistogram = histogram;
         }
 
         StartWritingFileIfReady();
@@ -175,6 +228,49 @@ class SDTWriter final : public std::enable_shared_from_this<SDTWriter> {
     }
 
   private:
+    // Sets data.wideHistograms to match. Channels needing conversion to
+    // 32 bits, and snapshot channels, are copied into narrowed or widened.
+    std::vector<void const *>
+    GetHistogramDataPointers(std::vector<std::vector<uint16_t>> &narrowed,
+                             std::vector<std::vector<uint32_t>> &widened) {
+        std::vector<void const *> ptrs;
+        narrowed.reserve(channelData.size());
+        widened.reserve(channelData.size());
+        if (promotedSnapshot.IsValid()) {
+            data.wideHistograms = promotedSnapshot.IsPromoted();
+            auto const n = promotedSnapshot.GetNumberOfElementsPerChannel();
+            for (size_t i = 0; i < channelData.size(); ++i) {
+                if (data.wideHistograms) {
+                    widened.emplace_back(n);
+                    promotedSnapshot.CopyChannel(i, widened.back().data());
+                    ptrs.emplace_back(widened.back().data());
+                } else {
+                    narrowed.emplace_back(n);
+                    promotedSnapshot.CopyChannel(i, narrowed.back().data());
+                    ptrs.emplace_back(narrowed.back().data());
+                }
+            }
+            return ptrs;
+        }
+        data.wideHistograms = promotedHistogram.IsValid() &&
+                              promotedHistogram.IsPromoted();
+        for (size_t i = 0; i < channelData.size(); ++i) {
+            if (histogram.IsValid()) {
+                ptrs.emplace_back(histogram.GetChannel(i));
+            } else if (!data.wideHistograms) {
+                ptrs.emplace_back(promotedHistogram.GetNarrowChannel(i));
+            } else if (promotedHistogram.IsChannelPromoted(i)) {
+                ptrs.emplace_back(promotedHistogram.GetWideChannel(i));
+            } else {
+                widened.emplace_back(
+                    promotedHistogram.GetNumberOfElementsPerChannel());
+                promotedHistogram.CopyChannel(i, widened.back().data());
+                ptrs.emplace_back(widened.back().data());
+            }
+        }
+        return ptrs;
+    }
+
     void StartWritingFileIfReady() {
         {
             std::lock_guard<std::mutex> hold(mutex);
@@ -186,9 +282,9 @@ class SDTWriter final : public std::enable_shared_from_this<SDTWriter> {
             if (!finishedRecordingPostAcquisitionData) {
                 return;
             }
-            for (auto const &histo : histograms) {
-                if (!histo.IsValid())
-                    return;
+            if (!histogram.IsValid() && !promotedHistogram.IsValid() &&
+                !promotedSnapshot.IsValid() && !tiledHistogram) {
+                return;
             }
 
             writeStarted = true;
@@ -196,19 +292,36 @@ class SDTWriter final : public std::enable_shared_from_this<SDTWriter> {
 
         asyncWriteCompletion =
             std::async(std::launch::async, [self = shared_from_this()] {
-                std::vector<uint16_t const *> histoDataPtrs;
-                for (auto const &h : self->histograms) {
-                    histoDataPtrs.emplace_back(h.Get());
-                }
-
                 std::vector<SDTFileChannelData const *> chanDataPtrs;
                 for (size_t i = 0; i < self->channelData.size(); ++i) {
                     chanDataPtrs.emplace_back(&self->channelData[i]);
                 }
 
-                int err = WriteSDTFile(self->filename.c_str(), &self->data,
+                int err;
+                if (self->tiledHistogram) {
+                    err = WriteSDTFileStreamed(
+                        self->filename.c_str(), &self->data,
+                        chanDataPtrs.data(), ReadTiledHistogram,
+                        self->tiledHistogram.get(), &self->params);
+                } else {
+                    // Copies of channels, if needed
+                    std::vector<std::vector<uint16_t>> narrowed;
+                    std::vector<std::vector<uint32_t>> widened;
+                    auto histoDataPtrs =
+                        self->GetHistogramDataPointers(narrowed, widened);
+                    err = WriteSDTFile(self->filename.c_str(), &self->data,
                                        chanDataPtrs.data(),
                                        histoDataPtrs.data(), &self->params);
+                }
+
+                // Return the (possibly pooled) memory, and delete any
+                // backing file, before reporting completion; self is kept
+                // alive by this future.
+                self->histogram = Histogram<uint16_t>();
+                self->promotedHistogram = PromotingHistogram();
+                self->promotedSnapshot = PromotingHistogramSnapshot();
+                self->tiledHistogram.reset();
+
                 if (err) {
                     self->SendError("Write error in SDT file");
                 } else if (self->downstream) {
@@ -5,21 +5,27 @@
 #include "TempDir.hpp"
 #include "UDPSender.hpp"
 
+#include <FLIMEvents/DecayCurveProcessor.hpp>
 #include <FLIMEvents/Histogram.hpp>
+#include <FLIMEvents/LifetimeEstimator.hpp>
+#include <FLIMEvents/PhasorProcessor.hpp>
+#include <FLIMEvents/PromotingHistogram.hpp>
+#include <FLIMEvents/ROIStatisticsCollector.hpp>
 
+#include <algorithm>
 #include <chrono>
 #include <future>
 #include <memory>
+#include <string>
 #include <thread>
 
 // Send frame histograms using a simple UDP + file protocol.
 class DataSender final : public std::enable_shared_from_this<DataSender> {
-    unsigned const nChannels;
-
     std::mutex mutex;
     unsigned nextSeqNo = 0;
     bool started = false;
     bool canceled = false;
+    std::string seriesType; // Element type of the started series
 
     TempDir tempDir;
     std::unique_ptr<MemMapFile> mapped;
@@ -48,58 +54,179 @@ class DataSender final : public std::enable_shared_from_this<DataSender> {
         }
     }
 
-    void Start(std::size_t nCh, std::size_t h, std::size_t w,
-               std::size_t nTimeBins) {
-        sender->SendMsg("new_series\tu16\t4\t" + std::to_string(nCh) + '\t' +
-                        std::to_string(h) + '\t' + std::to_string(w) + '\t' +
+    void Start(std::string const &type, std::size_t nCh, std::size_t h,
+               std::size_t w, std::size_t nTimeBins) {
+        sender->SendMsg("new_series\t" + type + "\t4\t" +
+                        std::to_string(nCh) + '\t' + std::to_string(h) +
+                        '\t' + std::to_string(w) + '\t' +
                         std::to_string(nTimeBins) + '\t' + tempDir.GetPath());
 
         {
             std::lock_guard<std::mutex> hold(mutex);
             started = true;
+            seriesType = type;
+        }
+    }
+
+    // Send an element of type elements, filled in by fill(T *). A change of
+    // type ends the series and starts a new one.
+    template <typename T, typename F>
+    void SendElement(std::string const &type, std::size_t nCh, std::size_t h,
+                     std::size_t w, std::size_t nTimeBins, F fill) {
+        bool series_started;
+        bool type_changed;
+        {
+            std::lock_guard<std::mutex> hold(mutex);
+            if (canceled)
+                return;
+            series_started = started;
+            type_changed = started && type != seriesType;
         }
+
+        if (type_changed) {
+            sender->SendMsg("end_series");
+            series_started = false;
+        }
+
+        std::size_t size = sizeof(T) * nCh * h * w * nTimeBins;
+        std::string name = tempDir.GetPath() + "/" + std::to_string(nextSeqNo);
+        mapped = std::make_unique<MemMapFile>(size, name);
+        fill(reinterpret_cast<T *>(mapped->Get()));
+
+        if (!series_started) {
+            Start(type, nCh, h, w, nTimeBins);
+        }
+        mapped.reset();
+        sender->SendMsg("element\t" + std::to_string(nextSeqNo));
+        ++nextSeqNo;
     }
 
   public:
-    DataSender(unsigned nChannels, uint16_t port,
+    DataSender(uint16_t port,
                std::shared_ptr<AcquisitionCompletion> downstream)
-        : nChannels(nChannels), sender(std::make_unique<UDPSender>(port)),
-          downstream(downstream) {
+        : sender(std::make_unique<UDPSender>(port)), downstream(downstream) {
         if (downstream) {
             downstream->AddProcess("DataSender");
         }
     }
 
-    // Assumes channels come in in cyclic order
-    void SetHistogram(unsigned channel, Histogram<uint16_t> const &histogram) {
-        {
-            std::lock_guard<std::mutex> hold(mutex);
-            if (canceled)
-                return;
-        }
-
-        std::size_t nElems = histogram.GetNumberOfElements();
+    // Send one element of the series; the histogram holds all channels.
+    void SetHistograms(Histogram<uint16_t> const &histogram) {
+        SendElement<uint16_t>(
+            "u16", histogram.GetNumberOfChannels(), histogram.GetHeight(),
+            histogram.GetWidth(), histogram.GetNumberOfTimeBins(),
+            [&](uint16_t *dest) {
+                memcpy(dest, histogram.Get(),
+                       sizeof(uint16_t) * histogram.GetNumberOfElements());
+            });
+    }
 
-        if (channel == 0) {
-            std::size_t size = sizeof(uint16_t) * nElems * nChannels;
-            std::string name =
-                tempDir.GetPath() + "/" + std::to_string(nextSeqNo);
-            mapped = std::make_unique<MemMapFile>(size, name);
+    // Same, for a cumulative histogram that may have overflowed 16 bits.
+    // Once any channel is promoted, elements are sent as u32 (in a new
+    // series).
+    void SetHistograms(PromotingHistogram const &histogram) {
+        if (!histogram.IsPromoted()) {
+            SetHistograms(histogram.GetNarrow());
+            return;
         }
+        SendElement<uint32_t>(
+            "u32", histogram.GetNumberOfChannels(), histogram.GetHeight(),
+            histogram.GetWidth(), histogram.GetNumberOfTimeBins(),
+            [&](uint32_t *dest) {
+                auto const n = histogram.GetNumberOfElementsPerChannel();
+                for (std::size_t ch = 0; ch < histogram.GetNumberOfChannels();
+                     ++ch) {
+                    histogram.CopyChannel(ch, dest + ch * n);
+                }
+            });
+    }
 
-        std::size_t offset = sizeof(uint16_t) * nElems * channel;
-        memcpy(mapped->Get() + offset, histogram.Get(),
-               sizeof(uint16_t) * nElems);
-
-        if (channel + 1 == nChannels) {
-            if (nextSeqNo == 0) {
-                Start(nChannels, histogram.GetHeight(), histogram.GetWidth(),
-                      histogram.GetNumberOfTimeBins());
-            }
-            mapped.reset();
-            sender->SendMsg("element\t" + std::to_string(nextSeqNo));
-            ++nextSeqNo;
+    // Same, for a snapshot of a cumulative histogram, which is copied
+    // directly from its tiles.
+    void SetHistograms(PromotingHistogramSnapshot const &snapshot) {
+        auto const n = snapshot.GetNumberOfElementsPerChannel();
+        auto const nCh = snapshot.GetNumberOfChannels();
+        if (!snapshot.IsPromoted()) {
+            SendElement<uint16_t>(
+                "u16", nCh, snapshot.GetHeight(), snapshot.GetWidth(),
+                snapshot.GetNumberOfTimeBins(), [&](uint16_t *dest) {
+                    for (std::size_t ch = 0; ch < nCh; ++ch) {
+                        snapshot.CopyChannel(ch, dest + ch * n);
+                    }
+                });
+            return;
         }
+        SendElement<uint32_t>(
+            "u32", nCh, snapshot.GetHeight(), snapshot.GetWidth(),
+            snapshot.GetNumberOfTimeBins(), [&](uint32_t *dest) {
+                for (std::size_t ch = 0; ch < nCh; ++ch) {
+                    snapshot.CopyChannel(ch, dest + ch * n);
+                }
+            });
+    }
+
+    // Send one element of a series of 32-bit images or histograms.
+    void SetHistograms(Histogram<uint32_t> const &histogram) {
+        SendElement<uint32_t>(
+            "u32", histogram.GetNumberOfChannels(), histogram.GetHeight(),
+            histogram.GetWidth(), histogram.GetNumberOfTimeBins(),
+            [&](uint32_t *dest) {
+                memcpy(dest, histogram.Get(),
+                       sizeof(uint32_t) * histogram.GetNumberOfElements());
+            });
+    }
+
+    // Send one element of a series of phasor images, as f32 with 3 "time
+    // bins" per pixel: G, S, and the photon count.
+    void SetPhasors(PhasorImage const &image) {
+        SendElement<float>(
+            "f32", image.GetNumberOfChannels(), image.GetHeight(),
+            image.GetWidth(), 3, [&](float *dest) {
+                for (std::size_t i = 0; i < image.GetNumberOfPixels(); ++i) {
+                    dest[3 * i] = float(image.GetG(i));
+                    dest[3 * i + 1] = float(image.GetS(i));
+                    dest[3 * i + 2] = float(image.GetCounts()[i]);
+                }
+            });
+    }
+
+    // Send one element of a series of lifetime images, as f32 with 1 "time
+    // bin" per pixel.
+    void SetLifetimes(LifetimeImage const &image) {
+        SendElement<float>("f32", image.numChannels, image.height,
+                           image.width, 1, [&](float *dest) {
+                               memcpy(dest, image.lifetimes.data(),
+                                      sizeof(float) * image.lifetimes.size());
+                           });
+    }
+
+    // Send one element of a series of ROI statistics, as u32 with each ROI
+    // a "pixel" of a 1-row image, holding the decay followed by the photon
+    // count (saturated to 32 bits).
+    void SetROIStatistics(ROIStatistics const &stats) {
+        std::size_t const nBins = stats.numTimeBins;
+        SendElement<uint32_t>(
+            "u32", stats.numChannels, 1, stats.numROIs, nBins + 1,
+            [&](uint32_t *dest) {
+                for (std::size_t i = 0; i < stats.photonCounts.size(); ++i) {
+                    memcpy(dest + i * (nBins + 1),
+                           stats.decays.data() + i * nBins,
+                           sizeof(uint32_t) * nBins);
+                    dest[i * (nBins + 1) + nBins] = uint32_t((std::min)(
+                        stats.photonCounts[i], uint64_t(UINT32_MAX)));
+                }
+            });
+    }
+
+    // Send one element of a series of decay curves, as u32 with each
+    // channel a 1-pixel image.
+    void SetDecayCurves(GlobalDecay const &decay) {
+        SendElement<uint32_t>("u32", decay.numChannels, 1, 1,
+                              decay.numTimeBins, [&](uint32_t *dest) {
+                                  memcpy(dest, decay.counts.data(),
+                                         sizeof(uint32_t) *
+                                             decay.counts.size());
+                              });
     }
 
     void Finish() {
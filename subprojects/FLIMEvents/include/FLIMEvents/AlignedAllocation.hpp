@@ -0,0 +1,326 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <new>
+
+#ifdef _WIN32
+#include <malloc.h>
+#else
+#include <sys/mman.h>
+#endif
+
+#ifdef _WIN32
+// The few Win32 functions used here, declared exactly as in the Windows SDK
+// (so that they are compatible with <Windows.h>, which this header does not
+// include, to keep its macros out of includers).
+struct _LUID;
+struct _TOKEN_PRIVILEGES;
+
+namespace internal {
+namespace win32 {
+#ifdef _WIN64
+using SizeT = unsigned long long; // SIZE_T
+#else
+using SizeT = unsigned long; // SIZE_T
+#endif
+
+extern "C" {
+__declspec(dllimport) void *__stdcall GetCurrentProcess(void);
+__declspec(dllimport) int __stdcall OpenProcessToken(void *processHandle,
+                                                     unsigned long access,
+                                                     void **tokenHandle);
+__declspec(dllimport) int __stdcall LookupPrivilegeValueW(
+    wchar_t const *systemName, wchar_t const *name, ::_LUID *luid);
+__declspec(dllimport) int __stdcall AdjustTokenPrivileges(
+    void *tokenHandle, int disableAll, ::_TOKEN_PRIVILEGES *newState,
+    unsigned long bufferLength, ::_TOKEN_PRIVILEGES *previousState,
+    unsigned long *returnLength);
+__declspec(dllimport) unsigned long __stdcall GetLastError(void);
+__declspec(dllimport) int __stdcall CloseHandle(void *handle);
+__declspec(dllimport) SizeT __stdcall GetLargePageMinimum(void);
+__declspec(dllimport) void *__stdcall VirtualAlloc(void *address, SizeT size,
+                                                   unsigned long type,
+                                                   unsigned long protect);
+__declspec(dllimport) int __stdcall VirtualFree(void *address, SizeT size,
+                                                unsigned long type);
+}
+
+// Values of the SDK macros MEM_COMMIT, etc.
+constexpr unsigned long MemCommit = 0x1000;
+constexpr unsigned long MemReserve = 0x2000;
+constexpr unsigned long MemRelease = 0x8000;
+constexpr unsigned long MemLargePages = 0x20000000;
+constexpr unsigned long PageReadWrite = 0x04;
+constexpr unsigned long TokenAdjustPrivileges = 0x0020;
+constexpr unsigned long TokenQuery = 0x0008;
+constexpr unsigned long SePrivilegeEnabled = 0x00000002;
+constexpr unsigned long ErrorSuccess = 0;
+
+// Layout of TOKEN_PRIVILEGES holding a single privilege
+struct SinglePrivilege {
+    unsigned long privilegeCount;
+    unsigned long luidLowPart;
+    long luidHighPart;
+    unsigned long attributes;
+};
+} // namespace win32
+} // namespace internal
+#endif
+
+// Allocation of large buffers (histograms, event buffers) with control over
+// alignment, huge pages, and when pages are faulted in.
+
+constexpr std::size_t CacheLineSize = 64;
+constexpr std::size_t PageSize = 4096;
+constexpr std::size_t HugePageSize = std::size_t(2) << 20;
+
+enum class HugePages {
+    // Regular pages
+    None,
+    // Linux: 2 MiB-aligned memory advised for transparent huge pages
+    // (MADV_HUGEPAGE). Windows: page-aligned memory from VirtualAlloc.
+    Transparent,
+    // Linux: hugetlbfs pages (MAP_HUGETLB), which must have been reserved
+    // by the administrator. Windows: large pages (MEM_LARGE_PAGES), which
+    // require the "Lock pages in memory" privilege to have been granted
+    // (it is enabled on first use). Falls back to Transparent if not
+    // available.
+    Explicit,
+};
+
+struct AllocationPolicy {
+    // Power of 2, at most PageSize
+    std::size_t alignment = CacheLineSize;
+
+    // Only applies to allocations of at least HugePageSize
+    HugePages hugePages = HugePages::None;
+
+    // Touch every page upon allocation, so that page faults occur during
+    // setup rather than while processing the first frames
+    bool prefault = false;
+
+    bool operator==(AllocationPolicy const &rhs) const noexcept {
+        return alignment == rhs.alignment && hugePages == rhs.hugePages &&
+               prefault == rhs.prefault;
+    }
+
+    bool operator!=(AllocationPolicy const &rhs) const noexcept {
+        return !(*this == rhs);
+    }
+};
+
+namespace internal {
+inline std::size_t RoundUp(std::size_t size, std::size_t unit) noexcept {
+    return (size + unit - 1) / unit * unit;
+}
+
+inline HugePages EffectiveHugePages(std::size_t size,
+                                    AllocationPolicy const &policy) noexcept {
+    return size < HugePageSize ? HugePages::None : policy.hugePages;
+}
+
+// Number of Explicit allocations that fell back to other pages
+inline std::atomic<std::size_t> &HugePageFallbacks() noexcept {
+    static std::atomic<std::size_t> count{0};
+    return count;
+}
+
+#ifdef _WIN32
+// Enable the "Lock pages in memory" privilege (SeLockMemoryPrivilege) of
+// the process token, which MEM_LARGE_PAGES requires. The privilege must have
+// been granted to the user; this only enables it. Returns false if it could
+// not be enabled.
+inline bool EnableLockMemoryPrivilege() noexcept {
+    void *token;
+    if (!win32::OpenProcessToken(
+            win32::GetCurrentProcess(),
+            win32::TokenAdjustPrivileges | win32::TokenQuery, &token)) {
+        return false;
+    }
+    win32::SinglePrivilege privileges{};
+    privileges.privilegeCount = 1;
+    privileges.attributes = win32::SePrivilegeEnabled;
+    bool ok =
+        win32::LookupPrivilegeValueW(
+            nullptr, L"SeLockMemoryPrivilege",
+            reinterpret_cast<::_LUID *>(&privileges.luidLowPart)) &&
+        win32::AdjustTokenPrivileges(
+            token, 0, reinterpret_cast<::_TOKEN_PRIVILEGES *>(&privileges),
+            0, nullptr, nullptr);
+    // AdjustTokenPrivileges() succeeds even if the privilege is not held.
+    ok = ok && win32::GetLastError() == win32::ErrorSuccess;
+    win32::CloseHandle(token);
+    return ok;
+}
+
+// Large page size, or 0 if large pages cannot be used. The privilege is
+// enabled on the first call.
+inline std::size_t LargePageSize() noexcept {
+    static std::size_t const size =
+        EnableLockMemoryPrivilege() ? win32::GetLargePageMinimum() : 0;
+    return size;
+}
+
+// Committed read-write pages (large pages if requested); nullptr on failure
+inline void *VirtualAllocate(std::size_t size, bool largePages) noexcept {
+    unsigned long type = win32::MemReserve | win32::MemCommit;
+    if (largePages) {
+        type |= win32::MemLargePages;
+    }
+    return win32::VirtualAlloc(nullptr, size, type, win32::PageReadWrite);
+}
+
+inline void VirtualRelease(void *ptr) noexcept {
+    win32::VirtualFree(ptr, 0, win32::MemRelease);
+}
+#endif
+
+inline void Prefault(void *ptr, std::size_t size) noexcept {
+    auto *bytes = static_cast<unsigned char volatile *>(ptr);
+    for (std::size_t offset = 0; offset < size; offset += PageSize) {
+        bytes[offset] = 0;
+    }
+}
+} // namespace internal
+
+// Allocate uninitialized memory according to policy. Returns nullptr if size
+// is zero; throws std::bad_alloc on failure. Must be freed by FreeAligned()
+// with the same size and policy.
+inline void *AllocateAligned(std::size_t size,
+                             AllocationPolicy const &policy) {
+    if (size == 0) {
+        return nullptr;
+    }
+
+    void *ptr = nullptr;
+    switch (internal::EffectiveHugePages(size, policy)) {
+    case HugePages::None:
+#ifdef _WIN32
+        ptr = _aligned_malloc(size, policy.alignment);
+#else
+        if (posix_memalign(&ptr, policy.alignment, size) != 0) {
+            ptr = nullptr;
+        }
+#endif
+        break;
+
+#ifdef _WIN32
+    case HugePages::Transparent:
+        ptr = internal::VirtualAllocate(size, false);
+        break;
+
+    case HugePages::Explicit: {
+        // Both the large page allocation and the fallback are released in
+        // the same way in FreeAligned().
+        std::size_t const largePageSize = internal::LargePageSize();
+        if (largePageSize) {
+            ptr = internal::VirtualAllocate(
+                internal::RoundUp(size, largePageSize), true);
+        }
+        if (!ptr) { // No privilege, or no contiguous physical memory
+            ++internal::HugePageFallbacks();
+            ptr = internal::VirtualAllocate(size, false);
+        }
+        break;
+    }
+#else
+    case HugePages::Transparent:
+        if (posix_memalign(&ptr, HugePageSize, size) != 0) {
+            ptr = nullptr;
+        }
+#ifdef MADV_HUGEPAGE
+        if (ptr) {
+            madvise(ptr, size, MADV_HUGEPAGE); // Advisory; ignore failure
+        }
+#endif
+        break;
+
+    case HugePages::Explicit: {
+        // Both the hugetlb mapping and the fallback are unmapped with the
+        // same (rounded) length in FreeAligned().
+        std::size_t const length = internal::RoundUp(size, HugePageSize);
+        ptr = MAP_FAILED;
+#ifdef MAP_HUGETLB
+        ptr = mmap(nullptr, length, PROT_READ | PROT_WRITE,
+                   MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+#endif
+        if (ptr == MAP_FAILED) { // No huge pages reserved
+            ++internal::HugePageFallbacks();
+            ptr = mmap(nullptr, length, PROT_READ | PROT_WRITE,
+                       MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+#ifdef MADV_HUGEPAGE
+            if (ptr != MAP_FAILED) {
+                madvise(ptr, length, MADV_HUGEPAGE);
+            }
+#endif
+        }
+        if (ptr == MAP_FAILED) {
+            ptr = nullptr;
+        }
+        break;
+    }
+#endif
+    }
+
+    if (!ptr) {
+        throw std::bad_alloc();
+    }
+    if (policy.prefault) {
+        internal::Prefault(ptr, size);
+    }
+    return ptr;
+}
+
+// Returns true if HugePages::Explicit allocations can use large pages; on
+// Windows, enables the privilege that they require. Allocations may still
+// fall back to other pages (see GetHugePageFallbackCount()).
+inline bool EnableExplicitHugePages() noexcept {
+#ifdef _WIN32
+    return internal::LargePageSize() != 0;
+#elif defined(MAP_HUGETLB)
+    return true;
+#else
+    return false;
+#endif
+}
+
+// Number of HugePages::Explicit allocations so far that could not obtain
+// large (hugetlb) pages and fell back to other pages
+inline std::size_t GetHugePageFallbackCount() noexcept {
+    return internal::HugePageFallbacks().load();
+}
+
+inline void FreeAligned(void *ptr, std::size_t size,
+                        AllocationPolicy const &policy) noexcept {
+    if (!ptr) {
+        return;
+    }
+
+    switch (internal::EffectiveHugePages(size, policy)) {
+    case HugePages::None:
+#ifdef _WIN32
+        _aligned_free(ptr);
+#else
+        std::free(ptr);
+#endif
+        break;
+
+#ifdef _WIN32
+    case HugePages::Transparent:
+    case HugePages::Explicit:
+        internal::VirtualRelease(ptr);
+        break;
+#else
+    case HugePages::Transparent:
+        std::free(ptr);
+        break;
+
+    case HugePages::Explicit:
+        munmap(ptr, internal::RoundUp(size, HugePageSize));
+        break;
+#endif
+    }
+}
@@ -0,0 +1,267 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <type_traits>
+
+// SSE2 is part of x86-64 and is enabled by /arch:SSE2 (default) on x86.
+#if defined(__SSE2__) || defined(_M_X64) ||                                   \
+    (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define FLIMEVENTS_USE_SSE2 1
+#include <emmintrin.h>
+#endif
+
+// TODO This can be constexpr in VS2019 but not in VS2015.
+template <typename T, typename U,
+          typename = std::enable_if_t<sizeof(T) >= sizeof(U)>>
+inline T SaturatingAdd(T a, U b) {
+    T c = a + b;
+    if (c < a)
+        c = -1;
+    return c;
+}
+
+// Element-wise dst[i] = SaturatingAdd(dst[i], src[i]) for i in [0, n).
+template <typename T>
+inline void SaturatingAddArray(T *dst, T const *src, std::size_t n) noexcept {
+    for (std::size_t i = 0; i < n; ++i) {
+        dst[i] = SaturatingAdd(dst[i], src[i]);
+    }
+}
+
+// Element-wise dst[i] += src[i] for i in [0, n), modulo 2^bits. Returns true
+// if any element wrapped around.
+template <typename T>
+inline bool CarryingAddArray(T *dst, T const *src, std::size_t n) noexcept {
+    bool carried = false;
+    for (std::size_t i = 0; i < n; ++i) {
+        dst[i] = T(dst[i] + src[i]);
+        carried |= dst[i] < src[i];
+    }
+    return carried;
+}
+
+// dst[i] = sum[i] + 65536 if sum[i] wrapped around when src[i] was added to
+// it, else sum[i], for i in [0, n). This recovers the true sums after
+// CarryingAddArray().
+inline void UnwrapCarriedArray(uint32_t *dst, uint16_t const *sum,
+                               uint16_t const *src, std::size_t n) noexcept {
+    for (std::size_t i = 0; i < n; ++i) {
+        dst[i] = uint32_t(sum[i]) + (sum[i] < src[i] ? 65536u : 0u);
+    }
+}
+
+// Element-wise dst[i] += src[i] for i in [0, n), modulo 2^32.
+inline void WideningAddArray(uint32_t *dst, uint16_t const *src,
+                             std::size_t n) noexcept {
+    std::size_t i = 0;
+#ifdef FLIMEVENTS_USE_SSE2
+    auto const zero = _mm_setzero_si128();
+    for (; i + 8 <= n; i += 8) {
+        auto b = _mm_loadu_si128(reinterpret_cast<__m128i const *>(src + i));
+        auto *d = reinterpret_cast<__m128i *>(dst + i);
+        _mm_storeu_si128(d, _mm_add_epi32(_mm_loadu_si128(d),
+                                          _mm_unpacklo_epi16(b, zero)));
+        _mm_storeu_si128(d + 1, _mm_add_epi32(_mm_loadu_si128(d + 1),
+                                              _mm_unpackhi_epi16(b, zero)));
+    }
+#endif
+    for (; i < n; ++i) {
+        dst[i] += src[i];
+    }
+}
+
+// Sum of src[i] for i in [0, n).
+template <typename T>
+inline uint64_t SumArray(T const *src, std::size_t n) noexcept {
+    uint64_t sum = 0;
+    for (std::size_t i = 0; i < n; ++i) {
+        sum += src[i];
+    }
+    return sum;
+}
+
+// True if src[i] == 0 for all i in [0, n). Returns early on nonzero data.
+template <typename T>
+inline bool IsZeroArray(T const *src, std::size_t n) noexcept {
+    static_assert(std::is_integral<T>::value, "T must be integral");
+    auto const *bytes = reinterpret_cast<unsigned char const *>(src);
+    std::size_t const size = n * sizeof(T);
+    std::size_t i = 0;
+#ifdef FLIMEVENTS_USE_SSE2
+    auto const zero = _mm_setzero_si128();
+    for (; i + 64 <= size; i += 64) {
+        auto const *p = reinterpret_cast<__m128i const *>(bytes + i);
+        auto any = _mm_or_si128(
+            _mm_or_si128(_mm_loadu_si128(p), _mm_loadu_si128(p + 1)),
+            _mm_or_si128(_mm_loadu_si128(p + 2), _mm_loadu_si128(p + 3)));
+        if (_mm_movemask_epi8(_mm_cmpeq_epi8(any, zero)) != 0xffff) {
+            return false;
+        }
+    }
+#endif
+    for (; i < size; ++i) {
+        if (bytes[i]) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// dst[i] = min(src[i], 65535) for i in [0, n).
+inline void SaturatingNarrowArray(uint16_t *dst, uint32_t const *src,
+                                  std::size_t n) noexcept {
+    std::size_t i = 0;
+#ifdef FLIMEVENTS_USE_SSE2
+    // SSE2 only has a signed 32-to-16-bit pack (PACKSSDW), so clamp first,
+    // then shift the range down by 32768 for the pack and back up after.
+    auto const signBit = _mm_set1_epi32(INT32_MIN);
+    auto const maxBiased = _mm_set1_epi32(INT32_MIN + 65535);
+    auto const lowMask = _mm_set1_epi32(0xffff);
+    auto const bias32 = _mm_set1_epi32(32768);
+    auto const bias16 = _mm_set1_epi16(INT16_MIN);
+    for (; i + 8 <= n; i += 8) {
+        __m128i halves[2];
+        for (int h = 0; h < 2; ++h) {
+            auto a = _mm_loadu_si128(
+                reinterpret_cast<__m128i const *>(src + i + 4 * h));
+            auto over =
+                _mm_cmpgt_epi32(_mm_xor_si128(a, signBit), maxBiased);
+            auto clamped = _mm_and_si128(_mm_or_si128(a, over), lowMask);
+            halves[h] = _mm_sub_epi32(clamped, bias32);
+        }
+        auto packed = _mm_packs_epi32(halves[0], halves[1]);
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(dst + i),
+                         _mm_add_epi16(packed, bias16));
+    }
+#endif
+    for (; i < n; ++i) {
+        dst[i] = src[i] > 65535 ? uint16_t(65535) : uint16_t(src[i]);
+    }
+}
+
+#ifdef FLIMEVENTS_USE_SSE2
+
+template <>
+inline void SaturatingAddArray<uint8_t>(uint8_t *dst, uint8_t const *src,
+                                        std::size_t n) noexcept {
+    std::size_t i = 0;
+    for (; i + 16 <= n; i += 16) {
+        auto a = _mm_loadu_si128(reinterpret_cast<__m128i const *>(dst + i));
+        auto b = _mm_loadu_si128(reinterpret_cast<__m128i const *>(src + i));
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(dst + i),
+                         _mm_adds_epu8(a, b));
+    }
+    for (; i < n; ++i) {
+        dst[i] = SaturatingAdd(dst[i], src[i]);
+    }
+}
+
+template <>
+inline void SaturatingAddArray<uint16_t>(uint16_t *dst, uint16_t const *src,
+                                         std::size_t n) noexcept {
+    std::size_t i = 0;
+    for (; i + 8 <= n; i += 8) {
+        auto a = _mm_loadu_si128(reinterpret_cast<__m128i const *>(dst + i));
+        auto b = _mm_loadu_si128(reinterpret_cast<__m128i const *>(src + i));
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(dst + i),
+                         _mm_adds_epu16(a, b));
+    }
+    for (; i < n; ++i) {
+        dst[i] = SaturatingAdd(dst[i], src[i]);
+    }
+}
+
+template <>
+inline void SaturatingAddArray<uint32_t>(uint32_t *dst, uint32_t const *src,
+                                         std::size_t n) noexcept {
+    // SSE2 has no unsigned 32-bit saturating add or unsigned compare; flip
+    // the sign bits so that a signed compare detects wrap-around.
+    auto const signBit = _mm_set1_epi32(INT32_MIN);
+    std::size_t i = 0;
+    for (; i + 4 <= n; i += 4) {
+        auto a = _mm_loadu_si128(reinterpret_cast<__m128i const *>(dst + i));
+        auto b = _mm_loadu_si128(reinterpret_cast<__m128i const *>(src + i));
+        auto sum = _mm_add_epi32(a, b);
+        auto wrapped = _mm_cmpgt_epi32(_mm_xor_si128(a, signBit),
+                                       _mm_xor_si128(sum, signBit));
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(dst + i),
+                         _mm_or_si128(sum, wrapped));
+    }
+    for (; i < n; ++i) {
+        dst[i] = SaturatingAdd(dst[i], src[i]);
+    }
+}
+
+template <>
+inline bool CarryingAddArray<uint16_t>(uint16_t *dst, uint16_t const *src,
+                                       std::size_t n) noexcept {
+    // A lane carried iff the wrapping and saturating sums differ; collect
+    // the differences in a sticky accumulator and test once at the end.
+    auto sticky = _mm_setzero_si128();
+    std::size_t i = 0;
+    for (; i + 8 <= n; i += 8) {
+        auto a = _mm_loadu_si128(reinterpret_cast<__m128i const *>(dst + i));
+        auto b = _mm_loadu_si128(reinterpret_cast<__m128i const *>(src + i));
+        auto sum = _mm_add_epi16(a, b);
+        auto saturated = _mm_adds_epu16(a, b);
+        sticky = _mm_or_si128(sticky, _mm_xor_si128(sum, saturated));
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(dst + i), sum);
+    }
+    bool carried = _mm_movemask_epi8(_mm_cmpeq_epi16(
+                       sticky, _mm_setzero_si128())) != 0xffff;
+    for (; i < n; ++i) {
+        dst[i] = uint16_t(dst[i] + src[i]);
+        carried |= dst[i] < src[i];
+    }
+    return carried;
+}
+
+template <>
+inline uint64_t SumArray<uint8_t>(uint8_t const *src, std::size_t n) noexcept {
+    // PSADBW against zero yields two 64-bit partial sums
+    auto const zero = _mm_setzero_si128();
+    auto acc = zero;
+    std::size_t i = 0;
+    for (; i + 16 <= n; i += 16) {
+        auto a = _mm_loadu_si128(reinterpret_cast<__m128i const *>(src + i));
+        acc = _mm_add_epi64(acc, _mm_sad_epu8(a, zero));
+    }
+    uint64_t lanes[2];
+    _mm_storeu_si128(reinterpret_cast<__m128i *>(lanes), acc);
+    uint64_t sum = lanes[0] + lanes[1];
+    for (; i < n; ++i) {
+        sum += src[i];
+    }
+    return sum;
+}
+
+template <>
+inline uint64_t SumArray<uint16_t>(uint16_t const *src,
+                                   std::size_t n) noexcept {
+    // Widen to 32-bit lanes; flush to 64 bits before the lanes can overflow.
+    auto const zero = _mm_setzero_si128();
+    std::size_t const maxChunk = 8 * 32768;
+    uint64_t sum = 0;
+    std::size_t i = 0;
+    while (i + 8 <= n) {
+        std::size_t const chunkEnd =
+            i + (n - i < maxChunk ? (n - i) / 8 * 8 : maxChunk);
+        auto acc = zero;
+        for (; i < chunkEnd; i += 8) {
+            auto a =
+                _mm_loadu_si128(reinterpret_cast<__m128i const *>(src + i));
+            acc = _mm_add_epi32(acc, _mm_unpacklo_epi16(a, zero));
+            acc = _mm_add_epi32(acc, _mm_unpackhi_epi16(a, zero));
+        }
+        uint32_t lanes[4];
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(lanes), acc);
+        sum += uint64_t(lanes[0]) + lanes[1] + lanes[2] + lanes[3];
+    }
+    for (; i < n; ++i) {
+        sum += src[i];
+    }
+    return sum;
+}
+
+#endif // FLIMEVENTS_USE_SSE2
@@ -0,0 +1,200 @@
+#pragma once
+
+#include "Histogram.hpp"
+
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+// What to do with a new frame when all frame buffers are awaiting delivery
+enum class SlowConsumerPolicy {
+    // Wait for a buffer to be freed (every frame is delivered)
+    Block,
+    // Discard the oldest undelivered frame, or the new frame if the only
+    // buffer is being delivered (the producer never waits)
+    LatestWins,
+};
+
+// Called on a frame buffer once its frame has been delivered or discarded.
+// Overload for frame types whose idle buffers should not hold on to
+// resources (such as shared snapshot tiles).
+template <typename H> inline void ReleaseFrame(H &) noexcept {}
+
+// Decouple a slow frame consumer (display, network) from the processing
+// thread: each frame is copied into one of a fixed number of buffers, and
+// the buffers are handed to downstream on a dedicated delivery thread.
+// H is the frame type and P the processor interface (HandleError,
+// HandleFrame(H const &), HandleFinish(H &&, bool)); CopyFrame(H const &,
+// H &) must be defined for H, and ReleaseFrame(H &) may be. Buffers are
+// allocated on first use.
+// Frames are delivered in order; finish is delivered after all pending
+// frames. An error discards pending frames.
+template <typename H, typename P> class AsyncFrameDelivery : public P {
+    SlowConsumerPolicy const policy;
+
+    std::mutex mutex;
+    std::condition_variable bufferFreed;
+    std::condition_variable frameQueued;
+    std::vector<H> freeBuffers;
+    std::deque<H> pending; // Oldest first
+    std::size_t droppedFrames = 0;
+    bool finished = false;
+    bool errored = false;
+    std::string errorMessage;
+    H finalFrame;
+    bool finalFrameComplete = false;
+
+    std::shared_ptr<P> downstream; // Used only on the delivery thread
+    std::thread deliveryThread;
+
+    void Deliver() {
+        std::unique_lock<std::mutex> lock(mutex);
+        for (;;) {
+            frameQueued.wait(lock, [&] {
+                return !pending.empty() || finished || errored;
+            });
+            if (errored) {
+                pending.clear();
+                break;
+            }
+            if (pending.empty()) {
+                break; // Finished
+            }
+
+            H frame = std::move(pending.front());
+            pending.pop_front();
+            lock.unlock();
+            downstream->HandleFrame(frame);
+            ReleaseFrame(frame);
+            lock.lock();
+            freeBuffers.emplace_back(std::move(frame));
+            bufferFreed.notify_one();
+        }
+
+        bool const isError = errored;
+        std::string const message = errorMessage;
+        H last = std::move(finalFrame);
+        bool const lastComplete = finalFrameComplete;
+        lock.unlock();
+
+        if (isError) {
+            downstream->HandleError(message);
+        } else {
+            downstream->HandleFinish(std::move(last), lastComplete);
+        }
+        downstream.reset();
+    }
+
+  public:
+    explicit AsyncFrameDelivery(std::shared_ptr<P> downstream,
+                                std::size_t numBuffers = 2,
+                                SlowConsumerPolicy policy =
+                                    SlowConsumerPolicy::Block)
+        : policy(policy), freeBuffers(numBuffers), downstream(downstream) {
+        if (numBuffers < 1) {
+            throw std::invalid_argument(
+                "At least 1 frame buffer is required");
+        }
+        if (this->downstream) {
+            deliveryThread = std::thread([this] { Deliver(); });
+        }
+    }
+
+    ~AsyncFrameDelivery() {
+        if (deliveryThread.joinable()) {
+            {
+                std::lock_guard<std::mutex> hold(mutex);
+                if (!finished && !errored) {
+                    errored = true;
+                    errorMessage = "Frame delivery abandoned";
+                }
+            }
+            frameQueued.notify_one();
+            deliveryThread.join();
+        }
+    }
+
+    AsyncFrameDelivery(AsyncFrameDelivery const &) = delete;
+    AsyncFrameDelivery &operator=(AsyncFrameDelivery const &) = delete;
+
+    // Number of frames discarded under SlowConsumerPolicy::LatestWins
+    std::size_t GetDroppedFrameCount() {
+        std::lock_guard<std::mutex> hold(mutex);
+        return droppedFrames;
+    }
+
+    void HandleError(std::string const &message) override {
+        {
+            std::lock_guard<std::mutex> hold(mutex);
+            if (finished || errored) {
+                return;
+            }
+            errored = true;
+            errorMessage = message;
+        }
+        frameQueued.notify_one();
+    }
+
+    void HandleFrame(H const &frame) override { HandleFrameFrom(frame); }
+
+    // Same as HandleFrame(), for any source type S for which
+    // CopyFrame(S const &, H &) is defined, such as a set of references to
+    // parts of a frame.
+    template <typename S> void HandleFrameFrom(S const &source) {
+        H buffer;
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            if (!deliveryThread.joinable() || finished || errored) {
+                return;
+            }
+            if (freeBuffers.empty()) {
+                if (policy == SlowConsumerPolicy::Block) {
+                    bufferFreed.wait(lock,
+                                     [&] { return !freeBuffers.empty(); });
+                } else if (!pending.empty()) {
+                    ReleaseFrame(pending.front());
+                    freeBuffers.emplace_back(std::move(pending.front()));
+                    pending.pop_front();
+                    ++droppedFrames;
+                } else { // The only buffer is being delivered
+                    ++droppedFrames;
+                    return;
+                }
+            }
+            buffer = std::move(freeBuffers.back());
+            freeBuffers.pop_back();
+        }
+
+        CopyFrame(source, buffer);
+
+        {
+            std::lock_guard<std::mutex> hold(mutex);
+            pending.emplace_back(std::move(buffer));
+        }
+        frameQueued.notify_one();
+    }
+
+    void HandleFinish(H &&frame, bool isCompleteFrame) override {
+        {
+            std::lock_guard<std::mutex> hold(mutex);
+            if (finished || errored) {
+                return;
+            }
+            finished = true;
+            finalFrame = std::move(frame);
+            finalFrameComplete = isCompleteFrame;
+        }
+        frameQueued.notify_one();
+    }
+};
+
+template <typename T>
+using AsyncHistogramProcessor =
+    AsyncFrameDelivery<Histogram<T>, HistogramProcessor<T>>;
@@ -0,0 +1,164 @@
+#pragma once
+
+#include "ArrayArithmetic.hpp"
+#include "DecodedEvent.hpp"
+#include "MultiChannelHistogrammer.hpp"
+
+#include <bitset>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
+
+// Microtime histograms of all photons, one per channel, at full ADC
+// resolution. Layout is [channel][t].
+struct GlobalDecay {
+    std::size_t numChannels = 0;
+    std::size_t numTimeBins = 0;
+    std::vector<uint32_t> counts;
+};
+
+inline void CopyFrame(GlobalDecay const &src, GlobalDecay &dst) {
+    dst = src;
+}
+
+// Receiver of periodically updated decay curves; each "frame" is the
+// cumulative curve so far.
+class GlobalDecayProcessor {
+  public:
+    virtual ~GlobalDecayProcessor() = default;
+
+    virtual void HandleError(std::string const &message) = 0;
+    virtual void HandleFrame(GlobalDecay const &decay) = 0;
+    virtual void HandleFinish(GlobalDecay &&decay, bool isCompleteFrame) = 0;
+};
+
+// Accumulate the microtime histogram of each enabled route (channels are
+// assigned in route order) over the whole acquisition, independent of pixel
+// assignment, and pass it to output every updateInterval (macrotime units)
+// and on finish. All events are passed on unchanged to downstream (if any),
+// so that this can be inserted after the decoder at the cost of one table
+// increment per photon; the table (2^inputTimeBits bins per channel) is
+// small enough to stay in L1 cache. Lost data does not invalidate the
+// curve and is only passed on.
+class DecayCurveProcessor : public DecodedEventProcessor {
+    RouteChannelTable const routeTable;
+    uint16_t const maxMicrotime;
+    bool const reverseTime;
+    uint64_t const updateInterval;
+
+    GlobalDecay decay;
+    bool started = false;
+    uint64_t nextUpdateTime = 0;
+
+    std::shared_ptr<GlobalDecayProcessor> output;
+    std::shared_ptr<DecodedEventProcessor> downstream;
+
+    void AdvanceTo(uint64_t macrotime) {
+        if (!started) {
+            started = true;
+            nextUpdateTime = macrotime + updateInterval;
+        } else if (macrotime >= nextUpdateTime) {
+            nextUpdateTime = macrotime + updateInterval;
+            if (output) {
+                output->HandleFrame(decay);
+            }
+        }
+    }
+
+  public:
+    // Microtimes have inputTimeBits bits; if reverseTime, they are taken as
+    // counting down, so that time bin 0 is the earliest.
+    DecayCurveProcessor(std::bitset<16> const &routeMask,
+                        uint32_t inputTimeBits, bool reverseTime,
+                        uint64_t updateInterval,
+                        std::shared_ptr<GlobalDecayProcessor> output,
+                        std::shared_ptr<DecodedEventProcessor> downstream)
+        : routeTable(MakeDenseRouteChannelTable(routeMask)),
+          maxMicrotime(uint16_t((1u << inputTimeBits) - 1)),
+          reverseTime(reverseTime), updateInterval(updateInterval),
+          output(output), downstream(downstream) {
+        if (routeMask.none()) {
+            throw std::invalid_argument("No channels for decay curves");
+        }
+        if (inputTimeBits < 1 || inputTimeBits > 16) {
+            throw std::invalid_argument("Invalid microtime bits");
+        }
+        if (updateInterval < 1) {
+            throw std::invalid_argument(
+                "Decay curve update interval must be positive");
+        }
+        decay.numChannels = routeMask.count();
+        decay.numTimeBins = std::size_t(1) << inputTimeBits;
+        decay.counts.resize(decay.numChannels * decay.numTimeBins);
+    }
+
+    void HandleTimestamp(DecodedEvent const &event) override {
+        AdvanceTo(event.macrotime);
+        if (downstream) {
+            downstream->HandleTimestamp(event);
+        }
+    }
+
+    void HandleValidPhoton(ValidPhotonEvent const &event) override {
+        AdvanceTo(event.macrotime);
+        auto const channel = event.route < 16 ? routeTable[event.route]
+                                              : RouteNotHistogrammed;
+        if (channel != RouteNotHistogrammed) {
+            uint16_t t = event.microtime & maxMicrotime;
+            if (reverseTime) {
+                t = uint16_t(maxMicrotime - t);
+            }
+            uint32_t &count = decay.counts[channel * decay.numTimeBins + t];
+            count = SaturatingAdd(count, 1u);
+        }
+        if (downstream) {
+            downstream->HandleValidPhoton(event);
+        }
+    }
+
+    void HandleInvalidPhoton(InvalidPhotonEvent const &event) override {
+        AdvanceTo(event.macrotime);
+        if (downstream) {
+            downstream->HandleInvalidPhoton(event);
+        }
+    }
+
+    void HandleMarker(MarkerEvent const &event) override {
+        AdvanceTo(event.macrotime);
+        if (downstream) {
+            downstream->HandleMarker(event);
+        }
+    }
+
+    void HandleDataLost(DataLostEvent const &event) override {
+        if (downstream) {
+            downstream->HandleDataLost(event);
+        }
+    }
+
+    void HandleError(std::string const &message) override {
+        if (output) {
+            output->HandleError(message);
+            output.reset();
+        }
+        if (downstream) {
+            downstream->HandleError(message);
+            downstream.reset();
+        }
+    }
+
+    void HandleFinish() override {
+        if (output) {
+            output->HandleFinish(std::move(decay), true);
+            output.reset();
+        }
+        if (downstream) {
+            downstream->HandleFinish();
+            downstream.reset();
+        }
+    }
+};
@@ -0,0 +1,111 @@
+#pragma once
+
+#include "Histogram.hpp"
+#include "PixelPhotonEvent.hpp"
+
+#include <bitset>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
+
+// Microtime (ADC value) window [start, end)
+struct TimeGate {
+    uint32_t start;
+    uint32_t end;
+};
+
+// Count pixel-assigned photons of the selected routes into one intensity
+// image per time gate, in a single pass. The images are a 0-bit histogram
+// with one channel per gate (layout [gate][y][x]), so they can be
+// accumulated by HistogramAccumulator and SlidingWindowAccumulator. Each
+// photon costs a table lookup and a single increment.
+class GatedIntensityCounter : public PixelPhotonProcessor {
+    static uint8_t const NotGated = 0xff;
+
+    Histogram<uint32_t> image;
+    std::vector<uint8_t> gateOfMicrotime;
+    std::size_t const width;
+    std::size_t const pixels;
+    uint16_t const routeMask; // Bit i set iff route i is counted
+    bool frameInProgress;
+
+    std::shared_ptr<HistogramProcessor<uint32_t>> downstream;
+
+  public:
+    // The image must have 1 time bin and as many channels as there are
+    // gates. Gates must not overlap and must lie within the inputTimeBits-bit
+    // microtime range.
+    GatedIntensityCounter(
+        Histogram<uint32_t> &&image, std::vector<TimeGate> const &gates,
+        uint32_t inputTimeBits, std::bitset<16> const &routeMask,
+        std::shared_ptr<HistogramProcessor<uint32_t>> downstream)
+        : image(std::move(image)),
+          gateOfMicrotime(std::size_t(1) << inputTimeBits, NotGated),
+          width(this->image.GetWidth()),
+          pixels(this->image.GetNumberOfElementsPerChannel()),
+          routeMask(static_cast<uint16_t>(routeMask.to_ulong())),
+          frameInProgress(false), downstream(downstream) {
+        if (this->image.GetNumberOfTimeBins() != 1 ||
+            this->image.GetNumberOfChannels() != gates.size()) {
+            throw std::invalid_argument(
+                "Gated intensity image must have 1 time bin and 1 channel "
+                "per gate");
+        }
+        if (gates.empty() || gates.size() >= NotGated) {
+            throw std::invalid_argument("Invalid number of time gates");
+        }
+        for (std::size_t g = 0; g < gates.size(); ++g) {
+            if (gates[g].start >= gates[g].end ||
+                gates[g].end > gateOfMicrotime.size()) {
+                throw std::invalid_argument("Invalid time gate");
+            }
+            for (uint32_t t = gates[g].start; t < gates[g].end; ++t) {
+                if (gateOfMicrotime[t] != NotGated) {
+                    throw std::invalid_argument("Time gates overlap");
+                }
+                gateOfMicrotime[t] = uint8_t(g);
+            }
+        }
+    }
+
+    void HandleBeginFrame() override {
+        image.Clear();
+        frameInProgress = true;
+    }
+
+    void HandleEndFrame() override {
+        frameInProgress = false;
+        if (downstream) {
+            downstream->HandleFrame(image);
+        }
+    }
+
+    void HandlePixelPhoton(PixelPhotonEvent const &event) override {
+        if (event.route >= 16 || !((routeMask >> event.route) & 1) ||
+            event.microtime >= gateOfMicrotime.size()) {
+            return;
+        }
+        auto gate = gateOfMicrotime[event.microtime];
+        if (gate != NotGated) {
+            ++image.Get()[gate * pixels + event.y * width + event.x];
+        }
+    }
+
+    void HandleError(std::string const &message) override {
+        if (downstream) {
+            downstream->HandleError(message);
+            downstream.reset();
+        }
+    }
+
+    void HandleFinish() override {
+        if (downstream) {
+            downstream->HandleFinish(std::move(image), !frameInProgress);
+            downstream.reset();
+        }
+    }
+};
@@ -1,33 +1,38 @@
 #pragma once
 
+#include "AlignedAllocation.hpp"
+#include "ArrayArithmetic.hpp"
+#include "MemoryPool.hpp"
+#include "MicrotimeBinning.hpp"
 #include "PixelPhotonEvent.hpp"
 
 #include <cstring>
 #include <deque>
 #include <memory>
+#include <stdexcept>
 #include <string>
 #include <type_traits>
 #include <vector>
 
-// TODO This can be constexpr in VS2019 but not in VS2015.
-template <typename T, typename U,
-          typename = std::enable_if_t<sizeof(T) >= sizeof(U)>>
-inline T SaturatingAdd(T a, U b) {
-    T c = a + b;
-    if (c < a)
-        c = -1;
-    return c;
-}
-
 template <typename T, typename = std::enable_if_t<std::is_unsigned<T>::value>>
 class Histogram {
-    uint32_t timeBits;
-    uint32_t inputTimeBits;
-    bool reverseTime;
-    std::size_t width;
-    std::size_t height;
-
-    std::unique_ptr<T[]> hist;
+    MicrotimeBinning binning;
+    std::size_t numTimeBins = 0;
+    std::size_t width = 0;
+    std::size_t height = 0;
+    std::size_t numChannels = 0;
+
+    // Layout is [channel][y][x][t]
+    // Shared only so that pooled storage can carry its deleter; the storage
+    // is never shared between Histogram objects.
+    std::shared_ptr<T> hist;
+
+    static std::shared_ptr<T> AllocateStorage(std::size_t size) {
+        AllocationPolicy const policy;
+        return std::shared_ptr<T>(
+            static_cast<T *>(AllocateAligned(size, policy)),
+            [size, policy](T *p) { FreeAligned(p, size, policy); });
+    }
 
   public:
     ~Histogram() = default;
@@ -40,15 +45,47 @@ class Histogram {
     Histogram() = default;
 
     // Warning: Newly constructed histogram is not zeroed (for efficiency)
+    Histogram(MicrotimeBinning const &binning, std::size_t width,
+              std::size_t height, std::size_t numChannels = 1)
+        : binning(binning), numTimeBins(binning.GetNumberOfBins()),
+          width(width), height(height), numChannels(numChannels),
+          hist(AllocateStorage(GetNumberOfElements() * sizeof(T))) {}
+
+    // Same as above, but with storage obtained from the given pool.
+    Histogram(MicrotimeBinning const &binning, std::size_t width,
+              std::size_t height, std::size_t numChannels, MemoryPool &pool)
+        : binning(binning), numTimeBins(binning.GetNumberOfBins()),
+          width(width), height(height), numChannels(numChannels),
+          hist(std::static_pointer_cast<T>(
+              pool.Allocate(GetNumberOfElements() * sizeof(T)))) {}
+
+    // Histogram of the full range of inputTimeBits-bit microtimes in
+    // 2^timeBits bins
     Histogram(uint32_t timeBits, uint32_t inputTimeBits, bool reverseTime,
-              std::size_t width, std::size_t height)
-        : timeBits(timeBits), inputTimeBits(inputTimeBits),
-          reverseTime(reverseTime), width(width), height(height),
-          hist(std::make_unique<T[]>(GetNumberOfElements())) {
-        if (timeBits > inputTimeBits) {
-            throw std::invalid_argument(
-                "Histogram time bits must not be greater than input bits");
-        }
+              std::size_t width, std::size_t height,
+              std::size_t numChannels = 1)
+        : Histogram(MicrotimeBinning(timeBits, inputTimeBits, reverseTime),
+                    width, height, numChannels) {}
+
+    Histogram(uint32_t timeBits, uint32_t inputTimeBits, bool reverseTime,
+              std::size_t width, std::size_t height, std::size_t numChannels,
+              MemoryPool &pool)
+        : Histogram(MicrotimeBinning(timeBits, inputTimeBits, reverseTime),
+                    width, height, numChannels, pool) {}
+
+    // Size of the storage needed for a histogram of the given dimensions
+    static std::size_t GetStorageSize(MicrotimeBinning const &binning,
+                                      std::size_t width, std::size_t height,
+                                      std::size_t numChannels = 1) noexcept {
+        return std::size_t(binning.GetNumberOfBins()) * width * height *
+               numChannels * sizeof(T);
+    }
+
+    static std::size_t GetStorageSize(uint32_t timeBits, std::size_t width,
+                                      std::size_t height,
+                                      std::size_t numChannels = 1) noexcept {
+        return (std::size_t(1) << timeBits) * width * height * numChannels *
+               sizeof(T);
     }
 
     bool IsValid() const noexcept { return hist.get(); }
@@ -57,43 +94,77 @@ class Histogram {
         memset(hist.get(), 0, GetNumberOfElements() * sizeof(T));
     }
 
-    uint32_t GetTimeBits() const noexcept { return timeBits; }
+    MicrotimeBinning const &GetMicrotimeBinning() const noexcept {
+        return binning;
+    }
 
-    uint32_t GetNumberOfTimeBins() const noexcept { return 1 << timeBits; }
+    uint32_t GetNumberOfTimeBins() const noexcept {
+        return uint32_t(numTimeBins);
+    }
 
     std::size_t GetWidth() const noexcept { return width; }
 
     std::size_t GetHeight() const noexcept { return height; }
 
-    std::size_t GetNumberOfElements() const noexcept {
+    std::size_t GetNumberOfChannels() const noexcept { return numChannels; }
+
+    std::size_t GetNumberOfElementsPerChannel() const noexcept {
         return GetNumberOfTimeBins() * width * height;
     }
 
-    void Increment(std::size_t t, std::size_t x, std::size_t y) noexcept {
-        auto tReduced = uint16_t(t >> (inputTimeBits - timeBits));
-        auto tReversed =
-            reverseTime ? (1 << timeBits) - 1 - tReduced : tReduced;
-        auto index = (y * width + x) * GetNumberOfTimeBins() + tReversed;
-        hist[index] = SaturatingAdd(hist[index], T(1));
+    std::size_t GetNumberOfElements() const noexcept {
+        return GetNumberOfElementsPerChannel() * numChannels;
+    }
+
+    // Returns false if t is outside the microtime window.
+    bool Increment(std::size_t t, std::size_t x, std::size_t y,
+                   std::size_t channel = 0) noexcept {
+        auto bin = binning.GetBin(uint32_t(t));
+        if (bin == MicrotimeBinning::NotBinned) {
+            return false;
+        }
+        auto pixel = (channel * height + y) * width + x;
+        auto index = pixel * numTimeBins + bin;
+        T *h = hist.get();
+        h[index] = SaturatingAdd(h[index], T(1));
+        return true;
     }
 
     T const *Get() const noexcept { return hist.get(); }
 
+    T *Get() noexcept { return hist.get(); }
+
+    // View of a single channel's [y][x][t] data
+    T const *GetChannel(std::size_t channel) const noexcept {
+        return hist.get() + channel * GetNumberOfElementsPerChannel();
+    }
+
     Histogram &operator+=(Histogram<T> const &rhs) {
-        if (rhs.timeBits != timeBits || rhs.width != width ||
-            rhs.height != height) {
+        if (rhs.numTimeBins != numTimeBins || rhs.width != width ||
+            rhs.height != height || rhs.numChannels != numChannels) {
             abort(); // Programming error
         }
 
-        std::size_t n = GetNumberOfElements();
-        for (std::size_t i = 0; i < n; ++i) {
-            hist[i] = SaturatingAdd(hist[i], rhs.hist[i]);
-        }
+        SaturatingAddArray(hist.get(), rhs.hist.get(), GetNumberOfElements());
 
         return *this;
     }
 };
 
+// Copy src into dst, (re)allocating dst if it does not match src.
+template <typename T>
+inline void CopyFrame(Histogram<T> const &src, Histogram<T> &dst) {
+    if (!dst.IsValid() ||
+        dst.GetNumberOfTimeBins() != src.GetNumberOfTimeBins() ||
+        dst.GetWidth() != src.GetWidth() ||
+        dst.GetHeight() != src.GetHeight() ||
+        dst.GetNumberOfChannels() != src.GetNumberOfChannels()) {
+        dst = Histogram<T>(src.GetMicrotimeBinning(), src.GetWidth(),
+                           src.GetHeight(), src.GetNumberOfChannels());
+    }
+    std::memcpy(dst.Get(), src.Get(), src.GetNumberOfElements() * sizeof(T));
+}
+
 // Receiver of frame-by-frame histogram events
 template <typename T> class HistogramProcessor {
   public:
@@ -108,6 +179,53 @@ template <typename T> class HistogramProcessor {
                               bool isCompleteFrame) = 0;
 };
 
+// Send each histogram to two downstream processors.
+// Upon finishing, the histogram is moved into the second downstream; the first
+// receives a moved-out histogram, so it must not need the finished histogram
+// (as is the case for accumulators).
+template <typename T>
+class BroadcastHistogramProcessor : public HistogramProcessor<T> {
+    std::shared_ptr<HistogramProcessor<T>> first;
+    std::shared_ptr<HistogramProcessor<T>> second;
+
+  public:
+    BroadcastHistogramProcessor(std::shared_ptr<HistogramProcessor<T>> first,
+                                std::shared_ptr<HistogramProcessor<T>> second)
+        : first(first), second(second) {}
+
+    void HandleError(std::string const &message) override {
+        if (first) {
+            first->HandleError(message);
+            first.reset();
+        }
+        if (second) {
+            second->HandleError(message);
+            second.reset();
+        }
+    }
+
+    void HandleFrame(Histogram<T> const &histogram) override {
+        if (first) {
+            first->HandleFrame(histogram);
+        }
+        if (second) {
+            second->HandleFrame(histogram);
+        }
+    }
+
+    void HandleFinish(Histogram<T> &&histogram,
+                      bool isCompleteFrame) override {
+        if (first) {
+            first->HandleFinish({}, isCompleteFrame);
+            first.reset();
+        }
+        if (second) {
+            second->HandleFinish(std::move(histogram), isCompleteFrame);
+            second.reset();
+        }
+    }
+};
+
 // Collect pixel-assiend photon events into a series of histograms
 template <typename T> class Histogrammer : public PixelPhotonProcessor {
     Histogram<T> histogram;
@@ -0,0 +1,103 @@
+#pragma once
+
+#include "ArrayArithmetic.hpp"
+#include "Histogram.hpp"
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdlib>
+#include <limits>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <utility>
+
+// Compute the intensity image of a (multi-channel) histogram: each pixel is
+// the sum over all time bins of all channels, clipped to the range of U.
+template <typename T, typename U>
+void ReduceHistogramToIntensity(Histogram<T> const &histogram,
+                                Histogram<U> &intensity) {
+    if (intensity.GetNumberOfTimeBins() != 1 ||
+        intensity.GetNumberOfChannels() != 1 ||
+        intensity.GetWidth() != histogram.GetWidth() ||
+        intensity.GetHeight() != histogram.GetHeight()) {
+        abort(); // Programming error
+    }
+
+    std::size_t const nBins = histogram.GetNumberOfTimeBins();
+    std::size_t const nPixels = histogram.GetWidth() * histogram.GetHeight();
+    uint64_t const maxValue = std::numeric_limits<U>::max();
+    U *out = intensity.Get();
+    for (std::size_t p = 0; p < nPixels; ++p) {
+        uint64_t sum = 0;
+        for (std::size_t c = 0; c < histogram.GetNumberOfChannels(); ++c) {
+            sum += SumArray(histogram.GetChannel(c) + p * nBins, nBins);
+        }
+        out[p] = static_cast<U>((std::min)(sum, maxValue));
+    }
+}
+
+// Pass histograms through unchanged, additionally sending the corresponding
+// intensity image to a second downstream. This replaces a separate 0-bit
+// histogrammer when both histograms and intensity images are needed, so that
+// each photon is only histogrammed once.
+template <typename T, typename U>
+class HistogramIntensityReducer : public HistogramProcessor<T> {
+    Histogram<U> intensity;
+
+    std::shared_ptr<HistogramProcessor<T>> downstream;
+    std::shared_ptr<HistogramProcessor<U>> intensityDownstream;
+
+  public:
+    // The intensity histogram must have 1 time bin, 1 channel, and the same
+    // size as the incoming histograms.
+    HistogramIntensityReducer(
+        Histogram<U> &&intensity,
+        std::shared_ptr<HistogramProcessor<T>> downstream,
+        std::shared_ptr<HistogramProcessor<U>> intensityDownstream)
+        : intensity(std::move(intensity)), downstream(downstream),
+          intensityDownstream(intensityDownstream) {
+        if (this->intensity.GetNumberOfTimeBins() != 1 ||
+            this->intensity.GetNumberOfChannels() != 1) {
+            throw std::invalid_argument(
+                "Intensity histogram must have 1 time bin and 1 channel");
+        }
+    }
+
+    void HandleError(std::string const &message) override {
+        if (intensityDownstream) {
+            intensityDownstream->HandleError(message);
+            intensityDownstream.reset();
+        }
+        if (downstream) {
+            downstream->HandleError(message);
+            downstream.reset();
+        }
+    }
+
+    void HandleFrame(Histogram<T> const &histogram) override {
+        if (intensityDownstream) {
+            ReduceHistogramToIntensity(histogram, intensity);
+            intensityDownstream->HandleFrame(intensity);
+        }
+        if (downstream) {
+            downstream->HandleFrame(histogram);
+        }
+    }
+
+    void HandleFinish(Histogram<T> &&histogram,
+                      bool isCompleteFrame) override {
+        if (intensityDownstream) {
+            if (histogram.IsValid()) {
+                ReduceHistogramToIntensity(histogram, intensity);
+            }
+            intensityDownstream->HandleFinish(std::move(intensity),
+                                              isCompleteFrame);
+            intensityDownstream.reset();
+        }
+        if (downstream) {
+            downstream->HandleFinish(std::move(histogram), isCompleteFrame);
+            downstream.reset();
+        }
+    }
+};
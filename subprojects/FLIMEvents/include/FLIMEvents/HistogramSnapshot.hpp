@@ -0,0 +1,307 @@
+#pragma once
+
+#include "AlignedAllocation.hpp"
+#include "ArrayArithmetic.hpp"
+#include "Histogram.hpp"
+#include "MemoryPool.hpp"
+#include "MicrotimeBinning.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+template <typename T> class CowHistogram;
+
+// Immutable, reference-counted view of a CowHistogram at one point in time.
+// Copying a snapshot is cheap (the tiles are shared), and a snapshot may be
+// kept and read on any thread while the histogram continues to accumulate.
+// Layout is the same as Histogram<T>, divided into tiles of
+// GetTileElements() elements (the last tile may be shorter).
+template <typename T> class HistogramSnapshot {
+    friend class CowHistogram<T>;
+
+    MicrotimeBinning binning;
+    std::size_t numTimeBins = 0;
+    std::size_t width = 0;
+    std::size_t height = 0;
+    std::size_t numChannels = 0;
+    std::size_t tileElements = 0;
+    std::vector<std::shared_ptr<T const>> tiles;
+
+  public:
+    // Creates an empty (invalid) snapshot.
+    HistogramSnapshot() = default;
+
+    bool IsValid() const noexcept { return !tiles.empty(); }
+
+    MicrotimeBinning const &GetMicrotimeBinning() const noexcept {
+        return binning;
+    }
+
+    uint32_t GetNumberOfTimeBins() const noexcept {
+        return uint32_t(numTimeBins);
+    }
+
+    std::size_t GetWidth() const noexcept { return width; }
+
+    std::size_t GetHeight() const noexcept { return height; }
+
+    std::size_t GetNumberOfChannels() const noexcept { return numChannels; }
+
+    std::size_t GetNumberOfElementsPerChannel() const noexcept {
+        return numTimeBins * width * height;
+    }
+
+    std::size_t GetNumberOfElements() const noexcept {
+        return GetNumberOfElementsPerChannel() * numChannels;
+    }
+
+    std::size_t GetTileElements() const noexcept { return tileElements; }
+
+    std::size_t GetNumberOfTiles() const noexcept { return tiles.size(); }
+
+    T const *GetTile(std::size_t tile) const noexcept {
+        return tiles[tile].get();
+    }
+
+    // Number of elements in the given tile
+    std::size_t GetTileSize(std::size_t tile) const noexcept {
+        return (std::min)(tileElements,
+                          GetNumberOfElements() - tile * tileElements);
+    }
+
+    T Get(std::size_t index) const noexcept {
+        return tiles[index / tileElements].get()[index % tileElements];
+    }
+
+    // Copy all elements to dest (GetNumberOfElements() elements)
+    void CopyTo(T *dest) const noexcept {
+        for (std::size_t i = 0; i < tiles.size(); ++i) {
+            std::memcpy(dest + i * tileElements, tiles[i].get(),
+                        GetTileSize(i) * sizeof(T));
+        }
+    }
+};
+
+// Snapshots share their tiles, so a copy only takes new references.
+template <typename T>
+inline void CopyFrame(HistogramSnapshot<T> const &src,
+                      HistogramSnapshot<T> &dst) {
+    dst = src;
+}
+
+// A delivered snapshot must not keep its tiles: the accumulating histogram
+// would have to copy every tile it next modifies.
+template <typename T>
+inline void ReleaseFrame(HistogramSnapshot<T> &snapshot) noexcept {
+    snapshot = HistogramSnapshot<T>();
+}
+
+// A cumulative histogram whose storage is divided into tiles that are shared
+// with snapshots (copy-on-write). Adding a frame writes only the tiles in
+// which the frame is nonzero, and a tile is duplicated only if a snapshot
+// still holds it. Consumers thus keep frames without copying them, and
+// only modified tiles are ever copied.
+// Not thread safe (but snapshots are).
+template <typename T> class CowHistogram {
+    static_assert(std::is_unsigned<T>::value, "T must be unsigned");
+
+    MicrotimeBinning binning;
+    std::size_t numTimeBins;
+    std::size_t width;
+    std::size_t height;
+    std::size_t numChannels;
+    std::size_t tileElements;
+
+    MemoryPool *pool;
+    std::vector<std::shared_ptr<T>> tiles;
+    std::size_t tileCopyCount = 0;
+
+    std::shared_ptr<T> AllocateTile() const {
+        std::size_t const size = tileElements * sizeof(T);
+        if (pool) {
+            return std::static_pointer_cast<T>(pool->Allocate(size));
+        }
+        AllocationPolicy const policy;
+        return std::shared_ptr<T>(
+            static_cast<T *>(AllocateAligned(size, policy)),
+            [size, policy](T *p) { FreeAligned(p, size, policy); });
+    }
+
+    // Apply add(tile, src + offset, n) to each tile in which src (of
+    // GetNumberOfElements() elements) is nonzero
+    template <typename U, typename F> void AddToTiles(U const *src, F add) {
+        std::size_t const total = GetNumberOfElements();
+        for (std::size_t i = 0; i < tiles.size(); ++i) {
+            std::size_t const offset = i * tileElements;
+            std::size_t const n = (std::min)(tileElements, total - offset);
+            if (!IsZeroArray(src + offset, n)) {
+                add(MutableTile(i), src + offset, n);
+            }
+        }
+    }
+
+  public:
+    // Default tile size; small enough that sparse frames leave most tiles
+    // untouched
+    static std::size_t const DefaultTileBytes = 64 * 1024;
+
+    // Make the tile exclusively ours and return it for writing
+    T *MutableTile(std::size_t tile) {
+        // A count of 1 cannot be raced: only this (single) thread creates
+        // snapshots. A stale count > 1 merely causes an extra copy.
+        if (tiles[tile].use_count() > 1) {
+            auto copy = AllocateTile();
+            std::memcpy(copy.get(), tiles[tile].get(),
+                        tileElements * sizeof(T));
+            tiles[tile] = std::move(copy);
+            ++tileCopyCount;
+        } else {
+            // Order our writes after the last reader's release of the tile
+            std::atomic_thread_fence(std::memory_order_acquire);
+        }
+        return tiles[tile].get();
+    }
+
+    // Creates an empty (invalid) histogram.
+    CowHistogram()
+        : numTimeBins(0), width(0), height(0), numChannels(0),
+          tileElements(0), pool(nullptr) {}
+
+    // The histogram is initially zeroed. Tile memory is obtained from pool,
+    // if given.
+    CowHistogram(MicrotimeBinning const &binning, std::size_t width,
+                 std::size_t height, std::size_t numChannels = 1,
+                 std::size_t tileElements = DefaultTileBytes / sizeof(T),
+                 MemoryPool *pool = nullptr)
+        : binning(binning), numTimeBins(binning.GetNumberOfBins()),
+          width(width), height(height), numChannels(numChannels),
+          tileElements(tileElements), pool(pool) {
+        if (tileElements < 1) {
+            throw std::invalid_argument("Tiles must have at least 1 element");
+        }
+        tiles.resize(GetNumberOfTiles(GetNumberOfElements(), tileElements));
+        for (auto &tile : tiles) {
+            tile = AllocateTile();
+            std::memset(tile.get(), 0, tileElements * sizeof(T));
+        }
+    }
+
+    CowHistogram(CowHistogram const &) = delete;
+    CowHistogram &operator=(CowHistogram const &) = delete;
+    CowHistogram(CowHistogram &&) = default;
+    CowHistogram &operator=(CowHistogram &&) = default;
+
+    static std::size_t GetNumberOfTiles(std::size_t numElements,
+                                        std::size_t tileElements) noexcept {
+        return (numElements + tileElements - 1) / tileElements;
+    }
+
+    std::size_t GetNumberOfElements() const noexcept {
+        return numTimeBins * width * height * numChannels;
+    }
+
+    std::size_t GetTileElements() const noexcept { return tileElements; }
+
+    // Number of tiles duplicated because a snapshot held them
+    std::size_t GetTileCopyCount() const noexcept { return tileCopyCount; }
+
+    HistogramSnapshot<T> Snapshot() const {
+        HistogramSnapshot<T> snap;
+        snap.binning = binning;
+        snap.numTimeBins = numTimeBins;
+        snap.width = width;
+        snap.height = height;
+        snap.numChannels = numChannels;
+        snap.tileElements = tileElements;
+        snap.tiles.assign(tiles.begin(), tiles.end());
+        return snap;
+    }
+
+    // Saturating add of a histogram of the same dimensions
+    CowHistogram &operator+=(Histogram<T> const &rhs) {
+        if (rhs.GetNumberOfTimeBins() != numTimeBins ||
+            rhs.GetWidth() != width || rhs.GetHeight() != height ||
+            rhs.GetNumberOfChannels() != numChannels) {
+            abort(); // Programming error
+        }
+
+        AddToTiles(rhs.Get(), SaturatingAddArray<T>);
+        return *this;
+    }
+
+    // Add src (GetNumberOfElements() elements) modulo the range of T, as
+    // CarryingAddArray() does. Returns true if any sum wrapped around.
+    bool CarryingAdd(T const *src) {
+        bool carried = false;
+        AddToTiles(src, [&](T *tile, T const *s, std::size_t n) {
+            carried = CarryingAddArray(tile, s, n) || carried;
+        });
+        return carried;
+    }
+
+    // Add 16-bit src (GetNumberOfElements() elements) modulo 2^32
+    void WideningAdd(uint16_t const *src) {
+        static_assert(std::is_same<T, uint32_t>::value,
+                      "Widening add requires 32-bit histogram");
+        AddToTiles(src, WideningAddArray);
+    }
+};
+
+// Receiver of cumulative histogram snapshots
+template <typename T> class HistogramSnapshotProcessor {
+  public:
+    virtual ~HistogramSnapshotProcessor() = default;
+
+    virtual void HandleError(std::string const &message) = 0;
+    virtual void HandleFrame(HistogramSnapshot<T> const &snapshot) = 0;
+    virtual void HandleFinish(HistogramSnapshot<T> &&snapshot,
+                              bool isCompleteFrame) = 0;
+};
+
+// Accumulate a series of histograms, as HistogramAccumulator does, but send
+// downstream a snapshot that it may keep.
+// Guarantees complete frame upon finish (all zeros if there was no frame).
+template <typename T>
+class SnapshotHistogramAccumulator : public HistogramProcessor<T> {
+    CowHistogram<T> cumulative;
+
+    std::shared_ptr<HistogramSnapshotProcessor<T>> downstream;
+
+  public:
+    SnapshotHistogramAccumulator(
+        CowHistogram<T> &&histogram,
+        std::shared_ptr<HistogramSnapshotProcessor<T>> downstream)
+        : cumulative(std::move(histogram)), downstream(downstream) {}
+
+    void HandleError(std::string const &message) override {
+        if (downstream) {
+            downstream->HandleError(message);
+            downstream.reset();
+        }
+    }
+
+    void HandleFrame(Histogram<T> const &histogram) override {
+        cumulative += histogram;
+        if (downstream) {
+            downstream->HandleFrame(cumulative.Snapshot());
+        }
+    }
+
+    void HandleFinish(Histogram<T> &&histogram,
+                      bool isCompleteFrame) override {
+        // We discard any incomplete frame from upstream
+        if (downstream) {
+            downstream->HandleFinish(cumulative.Snapshot(), true);
+            downstream.reset();
+        }
+    }
+};
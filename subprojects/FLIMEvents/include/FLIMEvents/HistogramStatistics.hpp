@@ -0,0 +1,129 @@
+#pragma once
+
+#include "ArrayArithmetic.hpp"
+#include "Histogram.hpp"
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <string>
+#include <vector>
+
+struct ChannelStatistics {
+    uint64_t totalPhotons = 0;    // Within the microtime window
+    uint32_t maxPixelPhotons = 0; // Sum over time bins, saturated to 32 bits
+    uint64_t saturatedBins = 0;
+    std::size_t emptyPixels = 0;
+};
+
+// Statistics of a multi-channel histogram (or of a series of them)
+struct HistogramStatistics {
+    std::size_t numPixels = 0; // Per channel
+    std::vector<ChannelStatistics> channels;
+
+    double GetEmptyPixelFraction(std::size_t channel) const noexcept {
+        return numPixels > 0 ? double(channels[channel].emptyPixels) /
+                                   double(numPixels)
+                             : 0.0;
+    }
+};
+
+// Receiver of histogram statistics, alongside the HistogramProcessor that
+// receives the histograms themselves
+class HistogramStatisticsProcessor {
+  public:
+    virtual ~HistogramStatisticsProcessor() = default;
+
+    virtual void HandleError(std::string const &message) = 0;
+    // Called at the end of each frame, before the frame histogram is passed
+    // downstream. The cumulative statistics are those of the sum of all
+    // complete frames so far; their saturatedBins is the total over frames.
+    virtual void HandleFrame(HistogramStatistics const &frame,
+                             HistogramStatistics const &cumulative) = 0;
+    virtual void HandleFinish(HistogramStatistics const &cumulative) = 0;
+};
+
+// Maintains histogram statistics while a histogrammer fills a histogram, so
+// that they need not be computed by scanning the histogram: each binned
+// photon adds one to a per-pixel count, and the end of each frame costs a
+// pass over those counts (1/numTimeBins of the histogram size). Saturated
+// bins are looked for only in pixels with enough photons to have one.
+template <typename T> class HistogramStatisticsTracker {
+    std::size_t const numPixels;
+    std::vector<uint32_t> framePixelCounts; // [channel][pixel]
+    std::vector<uint32_t> cumulativePixelCounts;
+    HistogramStatistics frame;
+    HistogramStatistics cumulative;
+
+  public:
+    HistogramStatisticsTracker(std::size_t numPixels, std::size_t numChannels)
+        : numPixels(numPixels), framePixelCounts(numPixels * numChannels),
+          cumulativePixelCounts(numPixels * numChannels) {
+        frame.numPixels = numPixels;
+        frame.channels.resize(numChannels);
+        cumulative.numPixels = numPixels;
+        cumulative.channels.resize(numChannels);
+        for (auto &c : cumulative.channels) {
+            c.emptyPixels = numPixels;
+        }
+    }
+
+    void BeginFrame() noexcept {
+        std::fill(framePixelCounts.begin(), framePixelCounts.end(), 0);
+    }
+
+    // Record a photon that was added to the histogram (not outside the
+    // microtime window)
+    void AddPhoton(std::size_t channel, std::size_t pixel) noexcept {
+        ++framePixelCounts[channel * numPixels + pixel];
+    }
+
+    // Record photons counted elsewhere; counts is indexed [channel][pixel]
+    void AddPixelCounts(uint32_t const *counts) noexcept {
+        SaturatingAddArray(framePixelCounts.data(), counts,
+                           framePixelCounts.size());
+    }
+
+    // Compute the statistics of the frame, whose histogram is given, and add
+    // it to the cumulative statistics
+    void EndFrame(Histogram<T> const &histogram) noexcept {
+        T const maxCount = std::numeric_limits<T>::max();
+        std::size_t const nBins = histogram.GetNumberOfTimeBins();
+        for (std::size_t ch = 0; ch < frame.channels.size(); ++ch) {
+            ChannelStatistics f;
+            ChannelStatistics &c = cumulative.channels[ch];
+            c.maxPixelPhotons = 0;
+            c.emptyPixels = 0;
+            std::size_t const offset = ch * numPixels;
+            uint32_t const *counts = framePixelCounts.data() + offset;
+            uint32_t *cumCounts = cumulativePixelCounts.data() + offset;
+            for (std::size_t p = 0; p < numPixels; ++p) {
+                uint32_t const n = counts[p];
+                f.totalPhotons += n;
+                f.maxPixelPhotons = (std::max)(f.maxPixelPhotons, n);
+                f.emptyPixels += n == 0;
+                if (n >= maxCount) {
+                    T const *bins = histogram.GetChannel(ch) + p * nBins;
+                    f.saturatedBins += std::size_t(
+                        std::count(bins, bins + nBins, maxCount));
+                }
+                uint32_t const cum = SaturatingAdd(cumCounts[p], n);
+                cumCounts[p] = cum;
+                c.maxPixelPhotons = (std::max)(c.maxPixelPhotons, cum);
+                c.emptyPixels += cum == 0;
+            }
+            c.totalPhotons += f.totalPhotons;
+            c.saturatedBins += f.saturatedBins;
+            frame.channels[ch] = f;
+        }
+    }
+
+    HistogramStatistics const &GetFrameStatistics() const noexcept {
+        return frame;
+    }
+
+    HistogramStatistics const &GetCumulativeStatistics() const noexcept {
+        return cumulative;
+    }
+};
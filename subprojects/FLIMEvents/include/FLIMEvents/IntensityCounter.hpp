@@ -0,0 +1,71 @@
+#pragma once
+
+#include "Histogram.hpp"
+#include "PixelPhotonEvent.hpp"
+
+#include <bitset>
+#include <cstdint>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <utility>
+
+// Count pixel-assigned photons of the selected routes into a series of
+// intensity images. The images are 0-bit, single-channel histograms, so
+// they can be accumulated by HistogramAccumulator, but each photon only costs
+// a single increment (no time bin or channel computation).
+class IntensityCounter : public PixelPhotonProcessor {
+    Histogram<uint32_t> image;
+    std::size_t const width;
+    uint16_t const routeMask; // Bit i set iff route i is counted
+    bool frameInProgress;
+
+    std::shared_ptr<HistogramProcessor<uint32_t>> downstream;
+
+  public:
+    // The image must have 1 time bin and 1 channel.
+    IntensityCounter(Histogram<uint32_t> &&image,
+                     std::bitset<16> const &routeMask,
+                     std::shared_ptr<HistogramProcessor<uint32_t>> downstream)
+        : image(std::move(image)), width(this->image.GetWidth()),
+          routeMask(static_cast<uint16_t>(routeMask.to_ulong())),
+          frameInProgress(false), downstream(downstream) {
+        if (this->image.GetNumberOfTimeBins() != 1 ||
+            this->image.GetNumberOfChannels() != 1) {
+            throw std::invalid_argument(
+                "Intensity image must have 1 time bin and 1 channel");
+        }
+    }
+
+    void HandleBeginFrame() override {
+        image.Clear();
+        frameInProgress = true;
+    }
+
+    void HandleEndFrame() override {
+        frameInProgress = false;
+        if (downstream) {
+            downstream->HandleFrame(image);
+        }
+    }
+
+    void HandlePixelPhoton(PixelPhotonEvent const &event) override {
+        if (event.route < 16 && ((routeMask >> event.route) & 1)) {
+            ++image.Get()[event.y * width + event.x];
+        }
+    }
+
+    void HandleError(std::string const &message) override {
+        if (downstream) {
+            downstream->HandleError(message);
+            downstream.reset();
+        }
+    }
+
+    void HandleFinish() override {
+        if (downstream) {
+            downstream->HandleFinish(std::move(image), !frameInProgress);
+            downstream.reset();
+        }
+    }
+};
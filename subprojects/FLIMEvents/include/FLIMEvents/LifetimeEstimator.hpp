@@ -0,0 +1,333 @@
+#pragma once
+
+#include "ArrayArithmetic.hpp"
+#include "Histogram.hpp"
+#include "HistogramSnapshot.hpp"
+#include "PromotingHistogram.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+enum class LifetimeMethod {
+    // Rapid lifetime determination: the decay is split into two equal
+    // contiguous gates with counts D0 and D1, and tau = gate width /
+    // ln(D0 / D1). Assumes a single exponential starting at time bin 0.
+    RapidLifetimeDetermination,
+    // Mean arrival time relative to the start of time bin 0. Equals tau for
+    // a single exponential starting at bin 0 if the window is long enough.
+    FirstMoment,
+};
+
+// Estimate the lifetime of each of nPixels decays (nBins time bins each,
+// consecutive) into lifetimes, in units of binWidth per time bin. Pixels
+// for which there is no estimate are 0.
+template <typename T>
+inline void EstimateLifetimes(T const *decays, std::size_t nPixels,
+                              std::size_t nBins, LifetimeMethod method,
+                              float binWidth, float *lifetimes) noexcept {
+    std::size_t const half = nBins / 2;
+    for (std::size_t p = 0; p < nPixels; ++p) {
+        T const *decay = decays + p * nBins;
+        float tau = 0.0f;
+        if (method == LifetimeMethod::RapidLifetimeDetermination) {
+            uint64_t const d0 = SumArray(decay, half);
+            uint64_t const d1 = SumArray(decay + half, half);
+            if (d1 > 0 && d0 > d1) {
+                tau = float(half) * binWidth /
+                      float(std::log(double(d0) / double(d1)));
+            }
+        } else {
+            uint64_t const total = SumArray(decay, nBins);
+            uint64_t weighted = 0;
+            for (std::size_t t = 1; t < nBins; ++t) {
+                weighted += uint64_t(t) * decay[t];
+            }
+            if (total > 0) {
+                tau = binWidth *
+                      float((double(weighted) + 0.5 * double(total)) /
+                            double(total));
+            }
+        }
+        lifetimes[p] = tau;
+    }
+}
+
+// Per-pixel lifetime estimates of a multi-channel image.
+// Layout is [channel][y][x].
+struct LifetimeImage {
+    std::size_t width = 0;
+    std::size_t height = 0;
+    std::size_t numChannels = 0;
+    std::vector<float> lifetimes;
+};
+
+inline void CopyFrame(LifetimeImage const &src, LifetimeImage &dst) {
+    dst = src;
+}
+
+// Receiver of frame-by-frame lifetime images
+class LifetimeImageProcessor {
+  public:
+    virtual ~LifetimeImageProcessor() = default;
+
+    virtual void HandleError(std::string const &message) = 0;
+    virtual void HandleFrame(LifetimeImage const &image) = 0;
+    virtual void HandleFinish(LifetimeImage &&image,
+                              bool isCompleteFrame) = 0;
+};
+
+// Compute a lifetime image from each histogram received, spreading the
+// pixels over worker threads. Accepts frame (or windowed) histograms as
+// well as cumulative promoting histograms and their snapshots. The
+// histograms must be in time order (bin 0 earliest).
+class LifetimeEstimator : public HistogramProcessor<uint16_t>,
+                          public PromotingHistogramProcessor,
+                          public PromotingHistogramSnapshotProcessor {
+    using Job = std::function<void()>;
+
+    LifetimeMethod const method;
+    float const binWidth;
+    std::size_t const numThreads;
+    LifetimeImage image;
+
+    std::vector<std::thread> workers;
+
+    // Protects jobs, unfinishedJobCount, and shuttingDown
+    std::mutex mutex;
+    std::condition_variable jobAvailableCondition;
+    std::condition_variable allJobsDoneCondition;
+    std::deque<Job> jobs;
+    std::size_t unfinishedJobCount = 0;
+    bool shuttingDown = false;
+
+    std::shared_ptr<LifetimeImageProcessor> downstream;
+
+    void RunWorker() {
+        for (;;) {
+            Job job;
+            {
+                std::unique_lock<std::mutex> lock(mutex);
+                jobAvailableCondition.wait(
+                    lock, [&] { return !jobs.empty() || shuttingDown; });
+                if (jobs.empty()) {
+                    return;
+                }
+                job = std::move(jobs.front());
+                jobs.pop_front();
+            }
+
+            job();
+
+            bool allDone;
+            {
+                std::lock_guard<std::mutex> hold(mutex);
+                allDone = --unfinishedJobCount == 0;
+            }
+            if (allDone) {
+                allJobsDoneCondition.notify_all();
+            }
+        }
+    }
+
+    void Post(Job &&job) {
+        if (workers.empty()) {
+            job();
+            return;
+        }
+        {
+            std::lock_guard<std::mutex> hold(mutex);
+            jobs.emplace_back(std::move(job));
+            ++unfinishedJobCount;
+        }
+        jobAvailableCondition.notify_one();
+    }
+
+    void WaitForAllJobs() {
+        std::unique_lock<std::mutex> lock(mutex);
+        allJobsDoneCondition.wait(lock,
+                                  [&] { return unfinishedJobCount == 0; });
+    }
+
+    void StopWorkers() {
+        {
+            std::lock_guard<std::mutex> hold(mutex);
+            shuttingDown = true;
+        }
+        jobAvailableCondition.notify_all();
+        for (auto &w : workers) {
+            if (w.joinable()) {
+                w.join();
+            }
+        }
+    }
+
+    template <typename H> void PrepareImage(H const &histogram) {
+        image.width = histogram.GetWidth();
+        image.height = histogram.GetHeight();
+        image.numChannels = histogram.GetNumberOfChannels();
+        image.lifetimes.resize(image.width * image.height *
+                               image.numChannels);
+    }
+
+    // Post jobs estimating one channel in numThreads chunks of pixels
+    template <typename T>
+    void PostChannel(std::size_t channel, T const *decays,
+                     std::size_t nBins) {
+        std::size_t const nPixels = image.width * image.height;
+        std::size_t const chunk = (nPixels + numThreads - 1) / numThreads;
+        float *out = image.lifetimes.data() + channel * nPixels;
+        for (std::size_t start = 0; start < nPixels; start += chunk) {
+            std::size_t const n = (std::min)(chunk, nPixels - start);
+            Post([this, decays, out, nBins, start, n] {
+                EstimateLifetimes(decays + start * nBins, n, nBins, method,
+                                  binWidth, out + start);
+            });
+        }
+    }
+
+    // Same, for a snapshot channel, in numThreads chunks of tiles (which hold
+    // whole pixels)
+    template <typename T>
+    void PostChannel(std::size_t channel, HistogramSnapshot<T> const &decays) {
+        std::size_t const nBins = decays.GetNumberOfTimeBins();
+        std::size_t const tileElements = decays.GetTileElements();
+        if (tileElements % nBins != 0) {
+            abort(); // Programming error
+        }
+        std::size_t const tilePixels = tileElements / nBins;
+        std::size_t const nTiles = decays.GetNumberOfTiles();
+        std::size_t const chunk = (nTiles + numThreads - 1) / numThreads;
+        float *out = image.lifetimes.data() + channel * image.width *
+                                                  image.height;
+        for (std::size_t start = 0; start < nTiles; start += chunk) {
+            std::size_t const end = (std::min)(start + chunk, nTiles);
+            Post([this, &decays, out, nBins, tilePixels, start, end] {
+                for (std::size_t i = start; i < end; ++i) {
+                    EstimateLifetimes(decays.GetTile(i),
+                                      decays.GetTileSize(i) / nBins, nBins,
+                                      method, binWidth,
+                                      out + i * tilePixels);
+                }
+            });
+        }
+    }
+
+    void Estimate(Histogram<uint16_t> const &histogram) {
+        PrepareImage(histogram);
+        for (std::size_t ch = 0; ch < image.numChannels; ++ch) {
+            PostChannel(ch, histogram.GetChannel(ch),
+                        histogram.GetNumberOfTimeBins());
+        }
+        WaitForAllJobs();
+    }
+
+    void Estimate(PromotingHistogram const &histogram) {
+        PrepareImage(histogram);
+        for (std::size_t ch = 0; ch < image.numChannels; ++ch) {
+            if (histogram.IsChannelPromoted(ch)) {
+                PostChannel(ch, histogram.GetWideChannel(ch),
+                            histogram.GetNumberOfTimeBins());
+            } else {
+                PostChannel(ch, histogram.GetNarrowChannel(ch),
+                            histogram.GetNumberOfTimeBins());
+            }
+        }
+        WaitForAllJobs();
+    }
+
+    void Estimate(PromotingHistogramSnapshot const &snapshot) {
+        PrepareImage(snapshot);
+        for (std::size_t ch = 0; ch < image.numChannels; ++ch) {
+            if (snapshot.IsChannelPromoted(ch)) {
+                PostChannel(ch, snapshot.GetWideChannel(ch));
+            } else {
+                PostChannel(ch, snapshot.GetNarrowChannel(ch));
+            }
+        }
+        WaitForAllJobs();
+    }
+
+    void Finish(bool isCompleteFrame) {
+        if (downstream) {
+            downstream->HandleFinish(std::move(image), isCompleteFrame);
+            downstream.reset();
+        }
+    }
+
+  public:
+    // numThreads worker threads are started if numThreads > 1; otherwise
+    // estimation runs on the calling thread. Lifetimes are in units of
+    // binWidth per histogram time bin.
+    LifetimeEstimator(LifetimeMethod method, float binWidth,
+                      std::size_t numThreads,
+                      std::shared_ptr<LifetimeImageProcessor> downstream)
+        : method(method), binWidth(binWidth),
+          numThreads((std::max)(numThreads, std::size_t(1))),
+          downstream(downstream) {
+        if (this->numThreads > 1) {
+            workers.reserve(this->numThreads);
+            for (std::size_t i = 0; i < this->numThreads; ++i) {
+                workers.emplace_back([this] { RunWorker(); });
+            }
+        }
+    }
+
+    ~LifetimeEstimator() override { StopWorkers(); }
+
+    LifetimeEstimator(LifetimeEstimator const &) = delete;
+    LifetimeEstimator &operator=(LifetimeEstimator const &) = delete;
+
+    void HandleError(std::string const &message) override {
+        if (downstream) {
+            downstream->HandleError(message);
+            downstream.reset();
+        }
+    }
+
+    void HandleFrame(Histogram<uint16_t> const &histogram) override {
+        if (downstream) {
+            Estimate(histogram);
+            downstream->HandleFrame(image);
+        }
+    }
+
+    void HandleFrame(PromotingHistogram const &histogram) override {
+        if (downstream) {
+            Estimate(histogram);
+            downstream->HandleFrame(image);
+        }
+    }
+
+    void HandleFrame(PromotingHistogramSnapshot const &snapshot) override {
+        if (downstream) {
+            Estimate(snapshot);
+            downstream->HandleFrame(image);
+        }
+    }
+
+    // The image of the last complete frame is passed on finish.
+    void HandleFinish(Histogram<uint16_t> &&, bool isCompleteFrame) override {
+        Finish(isCompleteFrame);
+    }
+
+    void HandleFinish(PromotingHistogram &&, bool isCompleteFrame) override {
+        Finish(isCompleteFrame);
+    }
+
+    void HandleFinish(PromotingHistogramSnapshot &&,
+                      bool isCompleteFrame) override {
+        Finish(isCompleteFrame);
+    }
+};
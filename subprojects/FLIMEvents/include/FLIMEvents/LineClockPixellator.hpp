@@ -101,6 +101,11 @@ class LineClockPixellator : public DecodedEventProcessor {
     }
 
     void FinishLine() {
+        // All photons of the line have been emitted, and earlier ones are
+        // discarded
+        if (downstream) {
+            downstream->HandleTimeReached(lineStartTime + lineTime);
+        }
         ++currentLine;
 
         bool endFrame = currentLine % linesPerFrame == 0;
@@ -129,6 +134,7 @@ class LineClockPixellator : public DecodedEventProcessor {
             static_cast<uint32_t>(pixelsPerLine * timeInLine / lineTime);
         newEvent.route = event.route;
         newEvent.microtime = event.microtime;
+        newEvent.macrotime = event.macrotime;
         if (downstream) {
             downstream->HandlePixelPhoton(newEvent);
         }
@@ -0,0 +1,152 @@
+#pragma once
+
+#include "Histogram.hpp"
+#include "MultiChannelHistogrammer.hpp"
+#include "PixelPhotonEvent.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
+
+// Collect pixel-assigned photons into a series of histograms (or, with 0
+// time bits, intensity images), one per fixed macrotime slice, independent
+// of frame boundaries. Slice 0 starts at the first photon (or time reached).
+// Slices are kept in a ring of histograms, so that photons may arrive
+// slightly out of order (up to the ring size in slices); a slice is passed
+// downstream as a frame once the time reached passes its end, or when a
+// photon arrives that does not fit in the ring without it. Photons of
+// already emitted slices are dropped. Slices without photons are emitted as
+// empty frames, so that frame n is always slice n.
+// The last (incomplete) slice is passed on finish.
+template <typename T>
+class MacrotimeSliceHistogrammer : public PixelPhotonProcessor {
+    std::vector<Histogram<T>> ring; // Slice s in ring[s % ring.size()]
+    RouteChannelTable const routeTable;
+    uint64_t const sliceDuration; // In macrotime units
+
+    bool started = false;
+    uint64_t origin = 0;
+    uint64_t firstOpenSlice = 0; // Oldest slice not yet emitted
+    uint64_t endOpenSlice = 0;   // One past the newest slice
+    uint64_t droppedPhotons = 0;
+
+    std::shared_ptr<HistogramProcessor<T>> downstream;
+
+    Histogram<T> &Slot(uint64_t slice) noexcept {
+        return ring[std::size_t(slice % ring.size())];
+    }
+
+    // Open slices up to and including slice, emitting the oldest ones to
+    // make room
+    void OpenThrough(uint64_t slice) {
+        for (; endOpenSlice <= slice; ++endOpenSlice) {
+            if (endOpenSlice - firstOpenSlice == ring.size()) {
+                if (downstream) {
+                    downstream->HandleFrame(Slot(firstOpenSlice));
+                }
+                ++firstOpenSlice;
+            }
+            Slot(endOpenSlice).Clear();
+        }
+    }
+
+    // Emit all slices before slice, opening any that are not yet open
+    void EmitBefore(uint64_t slice) {
+        for (; firstOpenSlice < slice; ++firstOpenSlice) {
+            if (firstOpenSlice == endOpenSlice) {
+                Slot(endOpenSlice++).Clear();
+            }
+            if (downstream) {
+                downstream->HandleFrame(Slot(firstOpenSlice));
+            }
+        }
+    }
+
+    void Start(uint64_t macrotime) noexcept {
+        if (!started) {
+            started = true;
+            origin = macrotime;
+        }
+    }
+
+  public:
+    // All histograms in the ring must have the same dimensions, with as
+    // many channels as routeTable uses.
+    MacrotimeSliceHistogrammer(
+        std::vector<Histogram<T>> &&ring, RouteChannelTable const &routeTable,
+        uint64_t sliceDuration,
+        std::shared_ptr<HistogramProcessor<T>> downstream)
+        : ring(std::move(ring)), routeTable(routeTable),
+          sliceDuration(sliceDuration), downstream(downstream) {
+        if (this->ring.empty()) {
+            throw std::invalid_argument(
+                "At least 1 slice histogram is required");
+        }
+        if (sliceDuration < 1) {
+            throw std::invalid_argument("Slice duration must be positive");
+        }
+        CheckRouteChannelTable(routeTable,
+                               this->ring.front().GetNumberOfChannels());
+    }
+
+    // Photons arriving after their slice was emitted
+    uint64_t GetNumberOfDroppedPhotons() const noexcept {
+        return droppedPhotons;
+    }
+
+    void HandleBeginFrame() override {}
+
+    void HandleEndFrame() override {}
+
+    void HandlePixelPhoton(PixelPhotonEvent const &event) override {
+        if (event.route >= 16 ||
+            routeTable[event.route] == RouteNotHistogrammed) {
+            return;
+        }
+        Start(event.macrotime);
+        if (event.macrotime < origin) {
+            ++droppedPhotons;
+            return;
+        }
+        uint64_t const slice = (event.macrotime - origin) / sliceDuration;
+        if (slice < firstOpenSlice) {
+            ++droppedPhotons;
+            return;
+        }
+        OpenThrough(slice);
+        Slot(slice).Increment(event.microtime, event.x, event.y,
+                              routeTable[event.route]);
+    }
+
+    void HandleTimeReached(uint64_t macrotime) override {
+        Start(macrotime);
+        if (macrotime > origin) {
+            EmitBefore((macrotime - origin) / sliceDuration);
+        }
+    }
+
+    void HandleError(std::string const &message) override {
+        if (downstream) {
+            downstream->HandleError(message);
+            downstream.reset();
+        }
+    }
+
+    void HandleFinish() override {
+        if (!downstream) {
+            return;
+        }
+        if (endOpenSlice == firstOpenSlice) { // Nothing after last emitted
+            OpenThrough(firstOpenSlice);
+        }
+        for (; firstOpenSlice + 1 < endOpenSlice; ++firstOpenSlice) {
+            downstream->HandleFrame(Slot(firstOpenSlice));
+        }
+        downstream->HandleFinish(std::move(Slot(firstOpenSlice)), false);
+        downstream.reset();
+    }
+};
@@ -0,0 +1,129 @@
+#pragma once
+
+#include "ArrayArithmetic.hpp"
+#include "Histogram.hpp"
+#include "PixelPhotonEvent.hpp"
+
+#include <bitset>
+#include <cstdint>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <utility>
+
+// Add a photon with microtime t to a pixel's count and microtime sum. The
+// two saturate together (both become UINT32_MAX), so that a saturated pixel
+// is recognizable rather than having a mean that drifts toward zero.
+inline void AddArrivalTime(uint32_t &count, uint32_t &sum,
+                           uint16_t t) noexcept {
+    if (count == UINT32_MAX || sum > UINT32_MAX - t) {
+        count = UINT32_MAX;
+        sum = UINT32_MAX;
+    } else {
+        ++count;
+        sum += t;
+    }
+}
+
+// Accumulate, for each pixel, the photon count and the sum of microtimes of
+// the selected routes into a series of images from which the mean arrival
+// time ("fast FLIM") can be computed. The images are 0-bit, 2-channel
+// histograms (channel 0 holds counts, channel 1 microtime sums), so they can
+// be accumulated by HistogramAccumulator and SlidingWindowAccumulator.
+// Counts and sums saturate; accumulation keeps a saturated value saturated,
+// and ComputeMeanArrivalTimes() flags pixels in which either has saturated.
+class MeanArrivalTimeCounter : public PixelPhotonProcessor {
+    Histogram<uint32_t> image;
+    std::size_t const width;
+    std::size_t const pixels;
+    uint16_t const routeMask; // Bit i set iff route i is counted
+    uint16_t const maxMicrotime;
+    bool const reverseTime;
+    bool frameInProgress;
+
+    std::shared_ptr<HistogramProcessor<uint32_t>> downstream;
+
+  public:
+    // The image must have 1 time bin and 2 channels. Microtimes have
+    // inputTimeBits bits; if reverseTime, they are taken as counting down.
+    MeanArrivalTimeCounter(
+        Histogram<uint32_t> &&image, std::bitset<16> const &routeMask,
+        uint32_t inputTimeBits, bool reverseTime,
+        std::shared_ptr<HistogramProcessor<uint32_t>> downstream)
+        : image(std::move(image)), width(this->image.GetWidth()),
+          pixels(this->image.GetNumberOfElementsPerChannel()),
+          routeMask(static_cast<uint16_t>(routeMask.to_ulong())),
+          maxMicrotime(uint16_t((1u << inputTimeBits) - 1)),
+          reverseTime(reverseTime), frameInProgress(false),
+          downstream(downstream) {
+        if (this->image.GetNumberOfTimeBins() != 1 ||
+            this->image.GetNumberOfChannels() != 2) {
+            throw std::invalid_argument(
+                "Mean arrival time image must have 1 time bin and 2 "
+                "channels");
+        }
+        if (inputTimeBits < 1 || inputTimeBits > 16) {
+            throw std::invalid_argument("Invalid microtime bits");
+        }
+    }
+
+    void HandleBeginFrame() override {
+        image.Clear();
+        frameInProgress = true;
+    }
+
+    void HandleEndFrame() override {
+        frameInProgress = false;
+        if (downstream) {
+            downstream->HandleFrame(image);
+        }
+    }
+
+    void HandlePixelPhoton(PixelPhotonEvent const &event) override {
+        if (event.route < 16 && ((routeMask >> event.route) & 1)) {
+            uint16_t t = event.microtime & maxMicrotime;
+            if (reverseTime) {
+                t = uint16_t(maxMicrotime - t);
+            }
+            auto const pixel = event.y * width + event.x;
+            uint32_t *data = image.Get();
+            AddArrivalTime(data[pixel], data[pixels + pixel], t);
+        }
+    }
+
+    void HandleError(std::string const &message) override {
+        if (downstream) {
+            downstream->HandleError(message);
+            downstream.reset();
+        }
+    }
+
+    void HandleFinish() override {
+        if (downstream) {
+            downstream->HandleFinish(std::move(image), !frameInProgress);
+            downstream.reset();
+        }
+    }
+};
+
+// Value of mean arrival times of pixels whose count or sum has saturated
+constexpr uint16_t MeanArrivalTimeSaturated = 65535;
+
+// Compute dest[i] = scale * (mean microtime of pixel i), clipped to 65534,
+// from an image produced by MeanArrivalTimeCounter. Pixels without photons
+// are 0; saturated pixels are MeanArrivalTimeSaturated.
+inline void ComputeMeanArrivalTimes(Histogram<uint32_t> const &image,
+                                    float scale, uint16_t *dest) noexcept {
+    auto const n = image.GetNumberOfElementsPerChannel();
+    uint32_t const *counts = image.GetChannel(0);
+    uint32_t const *sums = image.GetChannel(1);
+    for (std::size_t i = 0; i < n; ++i) {
+        if (counts[i] == UINT32_MAX || sums[i] == UINT32_MAX) {
+            dest[i] = MeanArrivalTimeSaturated;
+            continue;
+        }
+        float const mean =
+            counts[i] ? scale * float(sums[i]) / float(counts[i]) : 0.0f;
+        dest[i] = mean >= 65534.0f ? uint16_t(65534) : uint16_t(mean + 0.5f);
+    }
+}
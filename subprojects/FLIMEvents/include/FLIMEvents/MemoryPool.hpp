@@ -0,0 +1,170 @@
+#pragma once
+
+#include "AlignedAllocation.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <new>
+#include <vector>
+
+// Blocks of raw memory, recycled by size, with a memory budget. Blocks are
+// allocated according to an AllocationPolicy (alignment, huge pages, and
+// prefaulting).
+// Intended to be kept for the lifetime of a device, so that repeated
+// acquisitions with the same settings reuse the same (already faulted-in)
+// memory for their histograms.
+// Thread safe. Blocks may outlive the pool; they are freed when released
+// after the pool has been destroyed.
+class MemoryPool {
+    struct State {
+        std::mutex mutex;
+        std::multimap<std::size_t, void *> freeBlocks; // Key = size
+        std::size_t freeBytes = 0;
+        std::size_t inUseBytes = 0;
+        AllocationPolicy policy; // Of the free blocks
+
+        ~State() { FreeAll(); }
+
+        void FreeAll() noexcept {
+            for (auto const &block : freeBlocks) {
+                FreeAligned(block.second, block.first, policy);
+            }
+            freeBlocks.clear();
+            freeBytes = 0;
+        }
+
+        void Release(void *ptr, std::size_t size,
+                     AllocationPolicy const &blockPolicy) noexcept {
+            std::lock_guard<std::mutex> hold(mutex);
+            inUseBytes -= size;
+            if (blockPolicy != policy) { // Policy changed since allocation
+                FreeAligned(ptr, size, blockPolicy);
+                return;
+            }
+            try {
+                freeBlocks.emplace(size, ptr);
+                freeBytes += size;
+            } catch (std::bad_alloc const &) {
+                FreeAligned(ptr, size, blockPolicy);
+            }
+        }
+    };
+
+    std::shared_ptr<State> state;
+    std::size_t budget;
+
+  public:
+    explicit MemoryPool(std::size_t budgetBytes = SIZE_MAX,
+                        AllocationPolicy const &policy = {})
+        : state(std::make_shared<State>()), budget(budgetBytes) {
+        state->policy = policy;
+    }
+
+    MemoryPool(MemoryPool const &) = delete;
+    MemoryPool &operator=(MemoryPool const &) = delete;
+
+    void SetBudget(std::size_t budgetBytes) noexcept { budget = budgetBytes; }
+
+    std::size_t GetBudget() const noexcept { return budget; }
+
+    // Free blocks allocated under a different policy are freed
+    void SetPolicy(AllocationPolicy const &policy) {
+        std::lock_guard<std::mutex> hold(state->mutex);
+        if (policy != state->policy) {
+            state->FreeAll();
+            state->policy = policy;
+        }
+    }
+
+    AllocationPolicy GetPolicy() const {
+        std::lock_guard<std::mutex> hold(state->mutex);
+        return state->policy;
+    }
+
+    // Total size of blocks available for reuse
+    std::size_t GetFreeBytes() const {
+        std::lock_guard<std::mutex> hold(state->mutex);
+        return state->freeBytes;
+    }
+
+    // Total size of blocks currently allocated to users
+    std::size_t GetInUseBytes() const {
+        std::lock_guard<std::mutex> hold(state->mutex);
+        return state->inUseBytes;
+    }
+
+    // Make the free blocks exactly match the given sizes, keeping existing
+    // blocks where possible and freeing the rest. Returns false, without
+    // allocating anything, if the blocks together with those in use would
+    // exceed the budget. Throws std::bad_alloc if allocation fails.
+    bool Reserve(std::vector<std::size_t> const &blockSizes) {
+        std::size_t required = 0;
+        for (auto size : blockSizes) {
+            required += size;
+        }
+
+        std::lock_guard<std::mutex> hold(state->mutex);
+        if (required > budget || state->inUseBytes > budget - required) {
+            return false;
+        }
+
+        std::multimap<std::size_t, void *> kept;
+        std::size_t keptBytes = 0;
+        std::vector<std::size_t> missing;
+        for (auto size : blockSizes) {
+            auto it = state->freeBlocks.find(size);
+            if (it != state->freeBlocks.end()) {
+                kept.emplace(*it);
+                keptBytes += size;
+                state->freeBlocks.erase(it);
+            } else {
+                missing.push_back(size);
+            }
+        }
+        state->FreeAll();
+        state->freeBlocks = std::move(kept);
+        state->freeBytes = keptBytes;
+
+        for (auto size : missing) {
+            void *ptr = AllocateAligned(size, state->policy);
+            state->freeBlocks.emplace(size, ptr);
+            state->freeBytes += size;
+        }
+        return true;
+    }
+
+    // Obtain a block of the given size, reusing a free block if possible.
+    // The block returns to the pool when the last reference is released.
+    std::shared_ptr<void> Allocate(std::size_t size) {
+        void *ptr = nullptr;
+        AllocationPolicy policy;
+        {
+            std::lock_guard<std::mutex> hold(state->mutex);
+            policy = state->policy;
+            auto it = state->freeBlocks.find(size);
+            if (it != state->freeBlocks.end()) {
+                ptr = it->second;
+                state->freeBlocks.erase(it);
+                state->freeBytes -= size;
+            }
+            state->inUseBytes += size;
+        }
+        if (!ptr) {
+            try {
+                ptr = AllocateAligned(size, policy);
+            } catch (std::bad_alloc const &) {
+                std::lock_guard<std::mutex> hold(state->mutex);
+                state->inUseBytes -= size;
+                throw;
+            }
+        }
+
+        // If this throws, the deleter is called and returns ptr to the pool
+        return std::shared_ptr<void>(ptr, [s = state, size, policy](void *p) {
+            s->Release(p, size, policy);
+        });
+    }
+};
@@ -0,0 +1,97 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <stdexcept>
+#include <vector>
+
+// Mapping from microtime (ADC value) to histogram time bin. The window
+// [windowStart, windowEnd) of inputBits-bit microtimes is divided into
+// numBins bins of (nearly) equal width; microtimes outside the window are
+// not histogrammed. The mapping is a lookup table, so that any bin count
+// costs the same per photon as a power of 2.
+// Copies share the (immutable) table.
+class MicrotimeBinning {
+    uint32_t inputBits;
+    uint32_t windowStart;
+    uint32_t windowEnd;
+    uint32_t numBins;
+    bool reverse;
+    std::shared_ptr<std::vector<uint16_t> const> table; // Indexed by microtime
+
+  public:
+    static uint16_t const NotBinned = 0xffff;
+
+    // Creates an unusable object (no bins).
+    MicrotimeBinning()
+        : inputBits(0), windowStart(0), windowEnd(0), numBins(0),
+          reverse(false) {}
+
+    // If reverse, bin 0 holds the microtimes at the end of the window.
+    MicrotimeBinning(uint32_t inputBits, uint32_t windowStart,
+                     uint32_t windowEnd, uint32_t numBins, bool reverse)
+        : inputBits(inputBits), windowStart(windowStart),
+          windowEnd(windowEnd), numBins(numBins), reverse(reverse) {
+        if (inputBits > 16) {
+            throw std::invalid_argument("Microtime must be at most 16 bits");
+        }
+        if (windowStart >= windowEnd || windowEnd > (1u << inputBits)) {
+            throw std::invalid_argument("Invalid microtime window");
+        }
+        if (numBins < 1 || numBins > windowEnd - windowStart) {
+            throw std::invalid_argument(
+                "Number of time bins must be between 1 and the window size");
+        }
+
+        auto t = std::make_shared<std::vector<uint16_t>>(
+            std::size_t(1) << inputBits, uint16_t(NotBinned));
+        uint32_t const windowSize = windowEnd - windowStart;
+        for (uint32_t m = windowStart; m < windowEnd; ++m) {
+            auto bin = uint16_t(uint64_t(m - windowStart) * numBins /
+                                windowSize);
+            (*t)[m] = reverse ? uint16_t(numBins - 1 - bin) : bin;
+        }
+        table = std::move(t);
+    }
+
+    // Full range of inputBits-bit microtimes in 2^timeBits bins
+    MicrotimeBinning(uint32_t timeBits, uint32_t inputBits, bool reverse)
+        : MicrotimeBinning(inputBits, 0, 1u << inputBits,
+                           CheckedPowerOf2(timeBits, inputBits), reverse) {}
+
+    uint32_t GetInputBits() const noexcept { return inputBits; }
+
+    uint32_t GetWindowStart() const noexcept { return windowStart; }
+
+    uint32_t GetWindowEnd() const noexcept { return windowEnd; }
+
+    uint32_t GetNumberOfBins() const noexcept { return numBins; }
+
+    bool IsReversed() const noexcept { return reverse; }
+
+    // Returns NotBinned if microtime is outside the window.
+    uint16_t GetBin(uint32_t microtime) const noexcept {
+        return microtime < table->size() ? (*table)[microtime] : NotBinned;
+    }
+
+    bool operator==(MicrotimeBinning const &rhs) const noexcept {
+        return inputBits == rhs.inputBits &&
+               windowStart == rhs.windowStart &&
+               windowEnd == rhs.windowEnd && numBins == rhs.numBins &&
+               reverse == rhs.reverse;
+    }
+
+    bool operator!=(MicrotimeBinning const &rhs) const noexcept {
+        return !(*this == rhs);
+    }
+
+  private:
+    static uint32_t CheckedPowerOf2(uint32_t timeBits, uint32_t inputBits) {
+        if (timeBits > inputBits) {
+            throw std::invalid_argument(
+                "Histogram time bits must not be greater than input bits");
+        }
+        return 1u << timeBits;
+    }
+};
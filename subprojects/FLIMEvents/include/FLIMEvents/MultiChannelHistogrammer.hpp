@@ -0,0 +1,144 @@
+#pragma once
+
+#include "Histogram.hpp"
+#include "HistogramStatistics.hpp"
+#include "PixelPhotonEvent.hpp"
+
+#include <array>
+#include <bitset>
+#include <cstdint>
+#include <memory>
+#include <stdexcept>
+#include <string>
+
+// Maps each of the 16 possible photon routes (BH routing signals) to a
+// channel of a multi-channel histogram, or to RouteNotHistogrammed.
+using RouteChannelTable = std::array<uint8_t, 16>;
+
+uint8_t const RouteNotHistogrammed = 0xff;
+
+// Channel n of the histogram receives the n-th enabled route.
+inline RouteChannelTable
+MakeDenseRouteChannelTable(std::bitset<16> const &routeMask) {
+    RouteChannelTable table;
+    uint8_t n = 0;
+    for (std::size_t i = 0; i < table.size(); ++i) {
+        table[i] = routeMask[i] ? n++ : RouteNotHistogrammed;
+    }
+    return table;
+}
+
+// All enabled routes are summed into channel 0.
+inline RouteChannelTable
+MakeMergedRouteChannelTable(std::bitset<16> const &routeMask) {
+    RouteChannelTable table;
+    for (std::size_t i = 0; i < table.size(); ++i) {
+        table[i] = routeMask[i] ? 0 : RouteNotHistogrammed;
+    }
+    return table;
+}
+
+inline void CheckRouteChannelTable(RouteChannelTable const &table,
+                                   std::size_t numChannels) {
+    for (auto channel : table) {
+        if (channel != RouteNotHistogrammed && channel >= numChannels) {
+            throw std::invalid_argument(
+                "Route mapped to channel not present in histogram");
+        }
+    }
+}
+
+// Collect pixel-assigned photon events of all routes into a series of
+// multi-channel histograms, in a single pass (no per-channel processors).
+template <typename T>
+class MultiChannelHistogrammer : public PixelPhotonProcessor {
+    Histogram<T> histogram;
+    RouteChannelTable const routeTable;
+    bool frameInProgress;
+
+    std::shared_ptr<HistogramProcessor<T>> downstream;
+
+    // Only if statistics are requested
+    std::unique_ptr<HistogramStatisticsTracker<T>> tracker;
+    std::shared_ptr<HistogramStatisticsProcessor> statsDownstream;
+
+  public:
+    // If statsDownstream is given, it receives per-frame and cumulative
+    // statistics, maintained while filling.
+    MultiChannelHistogrammer(
+        Histogram<T> &&histogram, RouteChannelTable const &routeTable,
+        std::shared_ptr<HistogramProcessor<T>> downstream,
+        std::shared_ptr<HistogramStatisticsProcessor> statsDownstream = {})
+        : histogram(std::move(histogram)), routeTable(routeTable),
+          frameInProgress(false), downstream(downstream),
+          statsDownstream(statsDownstream) {
+        CheckRouteChannelTable(routeTable,
+                               this->histogram.GetNumberOfChannels());
+        if (statsDownstream) {
+            tracker = std::make_unique<HistogramStatisticsTracker<T>>(
+                this->histogram.GetWidth() * this->histogram.GetHeight(),
+                this->histogram.GetNumberOfChannels());
+        }
+    }
+
+    void HandleBeginFrame() override {
+        histogram.Clear();
+        if (tracker) {
+            tracker->BeginFrame();
+        }
+        frameInProgress = true;
+    }
+
+    void HandleEndFrame() override {
+        frameInProgress = false;
+        if (tracker) {
+            tracker->EndFrame(histogram);
+            if (statsDownstream) {
+                statsDownstream->HandleFrame(
+                    tracker->GetFrameStatistics(),
+                    tracker->GetCumulativeStatistics());
+            }
+        }
+        if (downstream) {
+            downstream->HandleFrame(histogram);
+        }
+    }
+
+    void HandlePixelPhoton(PixelPhotonEvent const &event) override {
+        if (event.route >= routeTable.size()) {
+            return;
+        }
+        auto channel = routeTable[event.route];
+        if (channel == RouteNotHistogrammed) {
+            return;
+        }
+        if (histogram.Increment(event.microtime, event.x, event.y,
+                                channel) &&
+            tracker) {
+            tracker->AddPhoton(channel, event.y * histogram.GetWidth() +
+                                            event.x);
+        }
+    }
+
+    void HandleError(std::string const &message) override {
+        if (statsDownstream) {
+            statsDownstream->HandleError(message);
+            statsDownstream.reset();
+        }
+        if (downstream) {
+            downstream->HandleError(message);
+            downstream.reset();
+        }
+    }
+
+    void HandleFinish() override {
+        if (statsDownstream) {
+            statsDownstream->HandleFinish(tracker->GetCumulativeStatistics());
+            statsDownstream.reset();
+        }
+        if (downstream) {
+            downstream->HandleFinish(std::move(histogram), !frameInProgress);
+            downstream.reset();
+        }
+    }
+};
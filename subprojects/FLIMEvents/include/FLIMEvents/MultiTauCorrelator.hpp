@@ -0,0 +1,419 @@
+#pragma once
+
+#include "DecodedEvent.hpp"
+#include "MultiChannelHistogrammer.hpp"
+
+#include <algorithm>
+#include <bitset>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
+
+// Streaming multi-tau correlator of two binned signals a and b (equal for
+// autocorrelation), using cascaded shift registers: level k holds the last
+// P values of the signals binned by 2^k, and its lags are j * 2^k base bins
+// for j in [1, P) at level 0 and [P/2, P) above. Each base bin costs O(P)
+// at level 0 if b is nonzero, plus the same at each higher level, which is
+// reached half as often; zero bins (b = 0) cost only the register shifts,
+// and a run of bins where both signals are zero costs O(P) per level
+// regardless of its length.
+class MultiTauCorrelator {
+    struct Level {
+        std::vector<uint64_t> delayedA; // Ring buffer of past values of a
+        std::vector<double> products;   // Sum of a(t - lag) * b(t) per lag
+        std::size_t head = 0;           // Index of the latest value of a
+        uint64_t numPushed = 0;
+        double sumA = 0.0;
+        double sumB = 0.0;
+        // The first of each pair of values, not yet passed to the next level
+        uint64_t pendingA = 0;
+        uint64_t pendingB = 0;
+        bool hasPending = false;
+    };
+
+    std::size_t const numRegisters; // P
+    std::vector<Level> levels;
+
+    std::size_t FirstRegister(std::size_t level) const noexcept {
+        return level == 0 ? 1 : numRegisters / 2;
+    }
+
+    void Push(std::size_t level, uint64_t a, uint64_t b) noexcept {
+        for (;;) {
+            Level &l = levels[level];
+            l.head = (l.head == 0 ? numRegisters : l.head) - 1;
+            l.delayedA[l.head] = a;
+            ++l.numPushed;
+            l.sumA += double(a);
+            l.sumB += double(b);
+
+            if (b != 0) {
+                for (std::size_t j = FirstRegister(level); j < numRegisters;
+                     ++j) {
+                    std::size_t i = l.head + j;
+                    if (i >= numRegisters) {
+                        i -= numRegisters;
+                    }
+                    l.products[j] += double(l.delayedA[i]) * double(b);
+                }
+            }
+
+            if (level + 1 == levels.size()) {
+                return;
+            }
+            if (!l.hasPending) {
+                l.pendingA = a;
+                l.pendingB = b;
+                l.hasPending = true;
+                return;
+            }
+            l.hasPending = false;
+            a += l.pendingA;
+            b += l.pendingB;
+            ++level;
+        }
+    }
+
+    // Push count zero bins (a = b = 0) at the given level
+    void PushZeros(std::size_t level, uint64_t count) noexcept {
+        for (; count > 0; ++level) {
+            Level &l = levels[level];
+            l.numPushed += count;
+            // Once the register is all zeros, its rotation does not matter.
+            std::size_t const shifts =
+                std::size_t((std::min)(count, uint64_t(numRegisters)));
+            for (std::size_t i = 0; i < shifts; ++i) {
+                l.head = (l.head == 0 ? numRegisters : l.head) - 1;
+                l.delayedA[l.head] = 0;
+            }
+
+            if (level + 1 == levels.size()) {
+                return;
+            }
+            if (l.hasPending) { // Completed by the first zero
+                l.hasPending = false;
+                --count;
+                Push(level + 1, l.pendingA, l.pendingB);
+            }
+            if (count % 2 != 0) {
+                l.pendingA = 0;
+                l.pendingB = 0;
+                l.hasPending = true;
+            }
+            count /= 2;
+        }
+    }
+
+  public:
+    // numRegisters (P) must be even and at least 2.
+    MultiTauCorrelator(std::size_t numLevels, std::size_t numRegisters)
+        : numRegisters(numRegisters), levels(numLevels) {
+        if (numLevels < 1) {
+            throw std::invalid_argument("Correlator must have a level");
+        }
+        if (numRegisters < 2 || numRegisters % 2 != 0) {
+            throw std::invalid_argument(
+                "Correlator registers per level must be even and >= 2");
+        }
+        for (auto &l : levels) {
+            l.delayedA.resize(numRegisters);
+            l.products.resize(numRegisters);
+        }
+    }
+
+    // Add the next base bin of each signal
+    void Push(uint64_t a, uint64_t b) noexcept { Push(0, a, b); }
+
+    // Same as calling Push(0, 0) count times
+    void PushZeros(uint64_t count) noexcept { PushZeros(0, count); }
+
+    // Lags, in base bins, in increasing order
+    std::vector<uint64_t> GetLags() const {
+        std::vector<uint64_t> lags;
+        for (std::size_t k = 0; k < levels.size(); ++k) {
+            for (std::size_t j = FirstRegister(k); j < numRegisters; ++j) {
+                lags.push_back(uint64_t(j) << k);
+            }
+        }
+        return lags;
+    }
+
+    // Normalized correlation G(lag) = <a(t) b(t + lag)> / (<a> <b>) for each
+    // lag of GetLags(); 0 where there is not yet any data.
+    std::vector<double> GetCorrelation() const {
+        std::vector<double> g;
+        for (std::size_t k = 0; k < levels.size(); ++k) {
+            Level const &l = levels[k];
+            double const n = double(l.numPushed);
+            double const meanProduct = l.sumA * l.sumB / (n * n);
+            for (std::size_t j = FirstRegister(k); j < numRegisters; ++j) {
+                if (l.numPushed <= j || meanProduct <= 0.0) {
+                    g.push_back(0.0);
+                } else {
+                    g.push_back(l.products[j] / double(l.numPushed - j) /
+                                meanProduct);
+                }
+            }
+        }
+        return g;
+    }
+};
+
+struct CorrelationCurve {
+    std::vector<uint64_t> lags; // In macrotime units
+    std::vector<double> values;
+};
+
+struct FCSData {
+    // One per channel
+    std::vector<CorrelationCurve> autocorrelations;
+    // One per pair of channels (i, j), i < j, in the order (0, 1), (0, 2),
+    // ..., (1, 2), ...: G_ij(lag) = <I_i(t) I_j(t + lag)> / (<I_i> <I_j>)
+    std::vector<CorrelationCurve> crossCorrelations;
+    // Photon counts per trace bin, one trace per channel, for the bins
+    // completed since the previous update (only the most recent, if there
+    // are more than the correlator keeps)
+    std::vector<std::vector<uint32_t>> traces;
+    // Index of the first bin of traces, counting from the first event
+    uint64_t firstTraceBin = 0;
+};
+
+// Receiver of correlation results
+class FCSDataProcessor {
+  public:
+    virtual ~FCSDataProcessor() = default;
+
+    virtual void HandleError(std::string const &message) = 0;
+    virtual void HandleUpdate(FCSData const &data) = 0;
+    virtual void HandleFinish(FCSData &&data) = 0;
+};
+
+// Correlate the photon streams of the enabled routes (channels are assigned
+// in route order) for fluorescence correlation spectroscopy, and record a
+// binned intensity trace of each channel. All events are passed on to
+// downstream (if any), so that the correlator can be attached to the same
+// stream as imaging.
+class FCSCorrelator : public DecodedEventProcessor {
+    RouteChannelTable const routeTable;
+    std::size_t const numChannels;
+    uint64_t const binWidth;      // Correlator base bin, in macrotime units
+    uint64_t const traceBinWidth; // In macrotime units
+    std::size_t const maxTraceBins;
+    uint64_t const updateInterval;
+
+    // Autocorrelations, then cross-correlations (as in FCSData)
+    std::vector<MultiTauCorrelator> correlators;
+
+    bool started = false;
+    uint64_t firstTraceBin = 0;
+    uint64_t currentBin = 0;
+    uint64_t currentTraceBin = 0;
+    uint64_t nextUpdateTime = 0;
+    std::vector<uint64_t> binCounts;
+    std::vector<uint32_t> traceCounts;
+    // Trace bins not yet sent, starting at traceStart; at most maxTraceBins
+    std::vector<std::deque<uint32_t>> traces;
+    uint64_t traceStart = 0;
+
+    std::shared_ptr<FCSDataProcessor> output;
+    std::shared_ptr<DecodedEventProcessor> downstream;
+
+    void PushBin() noexcept {
+        std::size_t c = 0;
+        for (std::size_t i = 0; i < numChannels; ++i) {
+            correlators[c++].Push(binCounts[i], binCounts[i]);
+        }
+        for (std::size_t i = 0; i < numChannels; ++i) {
+            for (std::size_t j = i + 1; j < numChannels; ++j) {
+                correlators[c++].Push(binCounts[i], binCounts[j]);
+            }
+        }
+        std::fill(binCounts.begin(), binCounts.end(), 0);
+    }
+
+    // Complete the current trace bin, followed by count - 1 empty ones
+    void PushTraceBins(uint64_t count) {
+        uint64_t const zeros = count - 1;
+        std::size_t const stored =
+            std::size_t((std::min)(zeros, uint64_t(maxTraceBins)));
+        for (std::size_t i = 0; i < numChannels; ++i) {
+            traces[i].push_back(traceCounts[i]);
+            traces[i].insert(traces[i].end(), stored, 0);
+            traceCounts[i] = 0;
+        }
+        // Drop the oldest bins beyond the limit; empty bins that would have
+        // been dropped are not stored in the first place.
+        std::size_t const excess =
+            traces[0].size() - (std::min)(traces[0].size(), maxTraceBins);
+        for (auto &trace : traces) {
+            trace.erase(trace.begin(), trace.begin() + excess);
+        }
+        traceStart += excess + (zeros - stored);
+    }
+
+    // Complete all bins ending at or before macrotime. Runs of empty bins
+    // are skipped in bulk.
+    void AdvanceTo(uint64_t macrotime) {
+        uint64_t const bin = macrotime / binWidth;
+        uint64_t const traceBin = macrotime / traceBinWidth;
+        if (!started) {
+            started = true;
+            currentBin = bin;
+            currentTraceBin = traceBin;
+            firstTraceBin = traceBin;
+            traceStart = traceBin;
+            nextUpdateTime = macrotime + updateInterval;
+            return;
+        }
+        if (currentBin < bin) {
+            PushBin();
+            for (auto &corr : correlators) {
+                corr.PushZeros(bin - currentBin - 1);
+            }
+            currentBin = bin;
+        }
+        if (currentTraceBin < traceBin) {
+            PushTraceBins(traceBin - currentTraceBin);
+            currentTraceBin = traceBin;
+        }
+        if (updateInterval > 0 && macrotime >= nextUpdateTime) {
+            nextUpdateTime = macrotime + updateInterval;
+            if (output) {
+                output->HandleUpdate(TakeData());
+            }
+        }
+    }
+
+    CorrelationCurve GetCurve(MultiTauCorrelator const &correlator) const {
+        CorrelationCurve curve;
+        curve.lags = correlator.GetLags();
+        for (auto &lag : curve.lags) {
+            lag *= binWidth;
+        }
+        curve.values = correlator.GetCorrelation();
+        return curve;
+    }
+
+    // The current correlations, and the trace bins since the last call
+    FCSData TakeData() {
+        FCSData data;
+        for (std::size_t c = 0; c < correlators.size(); ++c) {
+            auto &curves = c < numChannels ? data.autocorrelations
+                                           : data.crossCorrelations;
+            curves.emplace_back(GetCurve(correlators[c]));
+        }
+        for (auto &trace : traces) {
+            data.traces.emplace_back(trace.begin(), trace.end());
+            trace.clear();
+        }
+        data.firstTraceBin = traceStart - firstTraceBin;
+        traceStart = currentTraceBin;
+        return data;
+    }
+
+  public:
+    // binWidth is the shortest lag (macrotime units); lags extend to
+    // binWidth * (numRegisters - 1) * 2^(numLevels - 1). At most
+    // maxTraceBins trace bins are kept between updates. Intermediate results
+    // are sent every updateInterval (macrotime units) unless 0.
+    FCSCorrelator(std::bitset<16> const &routeMask, uint64_t binWidth,
+                  std::size_t numLevels, std::size_t numRegisters,
+                  uint64_t traceBinWidth, std::size_t maxTraceBins,
+                  uint64_t updateInterval,
+                  std::shared_ptr<FCSDataProcessor> output,
+                  std::shared_ptr<DecodedEventProcessor> downstream)
+        : routeTable(MakeDenseRouteChannelTable(routeMask)),
+          numChannels(routeMask.count()), binWidth(binWidth),
+          traceBinWidth(traceBinWidth), maxTraceBins(maxTraceBins),
+          updateInterval(updateInterval), binCounts(numChannels),
+          traceCounts(numChannels), traces(numChannels), output(output),
+          downstream(downstream) {
+        if (numChannels < 1) {
+            throw std::invalid_argument("No channels to correlate");
+        }
+        if (binWidth < 1 || traceBinWidth < 1) {
+            throw std::invalid_argument("Bin widths must be positive");
+        }
+        if (maxTraceBins < 1) {
+            throw std::invalid_argument("Trace must have at least 1 bin");
+        }
+        std::size_t const numPairs = numChannels * (numChannels - 1) / 2;
+        for (std::size_t c = 0; c < numChannels + numPairs; ++c) {
+            correlators.emplace_back(numLevels, numRegisters);
+        }
+    }
+
+    void HandleTimestamp(DecodedEvent const &event) override {
+        AdvanceTo(event.macrotime);
+        if (downstream) {
+            downstream->HandleTimestamp(event);
+        }
+    }
+
+    void HandleValidPhoton(ValidPhotonEvent const &event) override {
+        AdvanceTo(event.macrotime);
+        auto const channel = event.route < 16 ? routeTable[event.route]
+                                              : RouteNotHistogrammed;
+        if (channel != RouteNotHistogrammed) {
+            ++binCounts[channel];
+            ++traceCounts[channel];
+        }
+        if (downstream) {
+            downstream->HandleValidPhoton(event);
+        }
+    }
+
+    void HandleInvalidPhoton(InvalidPhotonEvent const &event) override {
+        AdvanceTo(event.macrotime);
+        if (downstream) {
+            downstream->HandleInvalidPhoton(event);
+        }
+    }
+
+    void HandleMarker(MarkerEvent const &event) override {
+        AdvanceTo(event.macrotime);
+        if (downstream) {
+            downstream->HandleMarker(event);
+        }
+    }
+
+    void HandleDataLost(DataLostEvent const &event) override {
+        // A gap in the data invalidates the correlation.
+        if (output) {
+            output->HandleError(
+                "Data lost due to device buffer (FIFO) overflow");
+            output.reset();
+        }
+        if (downstream) {
+            downstream->HandleDataLost(event);
+        }
+    }
+
+    void HandleError(std::string const &message) override {
+        if (output) {
+            output->HandleError(message);
+            output.reset();
+        }
+        if (downstream) {
+            downstream->HandleError(message);
+            downstream.reset();
+        }
+    }
+
+    // The incomplete last bins are not included.
+    void HandleFinish() override {
+        if (output) {
+            output->HandleFinish(TakeData());
+            output.reset();
+        }
+        if (downstream) {
+            downstream->HandleFinish();
+            downstream.reset();
+        }
+    }
+};
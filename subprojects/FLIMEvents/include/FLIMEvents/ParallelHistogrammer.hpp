@@ -0,0 +1,319 @@
+#pragma once
+
+#include "ArrayArithmetic.hpp"
+#include "Histogram.hpp"
+#include "HistogramStatistics.hpp"
+#include "MultiChannelHistogrammer.hpp"
+#include "PixelPhotonEvent.hpp"
+
+#include <algorithm>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+// Collect pixel-assigned photon events into a series of (multi-channel)
+// histograms, using multiple worker threads.
+// Photons are routed as in MultiChannelHistogrammer and collected into
+// batches, each of which is filled by whichever worker is free into that
+// worker's private histogram. At the end of each frame the private histograms
+// are summed by a pairwise tree reduction (each round of which runs in
+// parallel), and the result is sent downstream just like Histogrammer does.
+// The calling thread only routes photons; binning and the per-pixel counts
+// for statistics are done by the workers.
+template <typename T>
+class ParallelHistogrammer : public PixelPhotonProcessor {
+    using Batch = std::vector<PixelPhotonEvent>;
+    using Job = std::function<void(std::size_t)>; // Arg = worker index
+
+    std::vector<Histogram<T>> histograms; // Indexed by worker
+    // Binned photons per [channel][pixel], indexed by worker; only if
+    // statistics are requested
+    std::vector<std::vector<uint32_t>> pixelCounts;
+    RouteChannelTable const routeTable;
+    std::size_t const batchSize;
+    bool frameInProgress;
+
+    std::vector<std::thread> workers;
+
+    // Protects jobs, unfinishedJobCount, shuttingDown, and spareBatches
+    std::mutex mutex;
+    std::condition_variable jobAvailableCondition;
+    std::condition_variable allJobsDoneCondition;
+    std::deque<Job> jobs;
+    std::size_t unfinishedJobCount;
+    bool shuttingDown;
+    std::vector<std::shared_ptr<Batch>> spareBatches;
+
+    std::shared_ptr<Batch> currentBatch;
+
+    std::shared_ptr<HistogramProcessor<T>> downstream;
+
+    // Only if statistics are requested; fed from pixelCounts[0] at the end
+    // of each frame
+    std::unique_ptr<HistogramStatisticsTracker<T>> tracker;
+    std::shared_ptr<HistogramStatisticsProcessor> statsDownstream;
+
+    void RunWorker(std::size_t index) {
+        for (;;) {
+            Job job;
+            {
+                std::unique_lock<std::mutex> lock(mutex);
+                while (jobs.empty() && !shuttingDown) {
+                    jobAvailableCondition.wait(lock);
+                }
+                if (jobs.empty()) {
+                    return;
+                }
+                job = std::move(jobs.front());
+                jobs.pop_front();
+            }
+
+            job(index);
+
+            bool allDone;
+            {
+                std::lock_guard<std::mutex> hold(mutex);
+                allDone = --unfinishedJobCount == 0;
+            }
+            if (allDone) {
+                allJobsDoneCondition.notify_all();
+            }
+        }
+    }
+
+    void Post(Job &&job) {
+        {
+            std::lock_guard<std::mutex> hold(mutex);
+            jobs.emplace_back(std::move(job));
+            ++unfinishedJobCount;
+        }
+        jobAvailableCondition.notify_one();
+    }
+
+    void WaitForAllJobs() {
+        std::unique_lock<std::mutex> lock(mutex);
+        while (unfinishedJobCount > 0) {
+            allJobsDoneCondition.wait(lock);
+        }
+    }
+
+    std::shared_ptr<Batch> TakeSpareBatch() {
+        std::shared_ptr<Batch> batch;
+        {
+            std::lock_guard<std::mutex> hold(mutex);
+            if (!spareBatches.empty()) {
+                batch = std::move(spareBatches.back());
+                spareBatches.pop_back();
+            }
+        }
+        if (!batch) {
+            batch = std::make_shared<Batch>();
+            batch->reserve(batchSize);
+        }
+        return batch;
+    }
+
+    void PostCurrentBatch() {
+        if (!currentBatch || currentBatch->empty()) {
+            return;
+        }
+
+        Post([this, batch = std::move(currentBatch)](std::size_t worker) {
+            auto &histogram = histograms[worker];
+            if (pixelCounts.empty()) {
+                for (auto const &event : *batch) {
+                    // Route has already been replaced with channel index
+                    histogram.Increment(event.microtime, event.x, event.y,
+                                        event.route);
+                }
+            } else {
+                uint32_t *counts = pixelCounts[worker].data();
+                std::size_t const width = histogram.GetWidth();
+                std::size_t const numPixels = width * histogram.GetHeight();
+                for (auto const &event : *batch) {
+                    if (histogram.Increment(event.microtime, event.x, event.y,
+                                            event.route)) {
+                        ++counts[event.route * numPixels + event.y * width +
+                                 event.x];
+                    }
+                }
+            }
+            batch->clear();
+            std::lock_guard<std::mutex> hold(mutex);
+            spareBatches.emplace_back(batch);
+        });
+        currentBatch.reset();
+    }
+
+    // Leaves the sum of all private histograms in histograms[0].
+    void MergeHistograms() {
+        PostCurrentBatch();
+        WaitForAllJobs();
+
+        std::size_t n = histograms.size();
+        for (std::size_t stride = 1; stride < n; stride *= 2) {
+            for (std::size_t i = 0; i + stride < n; i += 2 * stride) {
+                Post([this, i, stride](std::size_t) {
+                    histograms[i] += histograms[i + stride];
+                    if (!pixelCounts.empty()) {
+                        auto &dst = pixelCounts[i];
+                        SaturatingAddArray(dst.data(),
+                                           pixelCounts[i + stride].data(),
+                                           dst.size());
+                    }
+                });
+            }
+            WaitForAllJobs();
+        }
+    }
+
+    void StopWorkers() {
+        {
+            std::lock_guard<std::mutex> hold(mutex);
+            shuttingDown = true;
+        }
+        jobAvailableCondition.notify_all();
+        for (auto &w : workers) {
+            if (w.joinable()) {
+                w.join();
+            }
+        }
+    }
+
+  public:
+    static std::size_t const DefaultBatchSize = 4096;
+
+    // One worker thread is started per histogram; all histograms must have
+    // the same dimensions. Statistics are as in MultiChannelHistogrammer.
+    ParallelHistogrammer(
+        std::vector<Histogram<T>> &&histograms,
+        RouteChannelTable const &routeTable,
+        std::shared_ptr<HistogramProcessor<T>> downstream,
+        std::size_t batchSize = DefaultBatchSize,
+        std::shared_ptr<HistogramStatisticsProcessor> statsDownstream = {})
+        : histograms(std::move(histograms)), routeTable(routeTable),
+          batchSize(batchSize),
+          frameInProgress(false), unfinishedJobCount(0), shuttingDown(false),
+          downstream(downstream), statsDownstream(statsDownstream) {
+        if (this->histograms.empty()) {
+            throw std::invalid_argument(
+                "ParallelHistogrammer requires at least one histogram");
+        }
+        if (batchSize < 1) {
+            throw std::invalid_argument("batchSize must be positive");
+        }
+        CheckRouteChannelTable(routeTable,
+                               this->histograms[0].GetNumberOfChannels());
+
+        if (statsDownstream) {
+            auto const &h = this->histograms[0];
+            std::size_t const numPixels = h.GetWidth() * h.GetHeight();
+            tracker = std::make_unique<HistogramStatisticsTracker<T>>(
+                numPixels, h.GetNumberOfChannels());
+            pixelCounts.assign(this->histograms.size(),
+                               std::vector<uint32_t>(
+                                   numPixels * h.GetNumberOfChannels()));
+        }
+
+        workers.reserve(this->histograms.size());
+        for (std::size_t i = 0; i < this->histograms.size(); ++i) {
+            workers.emplace_back([this, i] { RunWorker(i); });
+        }
+    }
+
+    ~ParallelHistogrammer() override { StopWorkers(); }
+
+    ParallelHistogrammer(ParallelHistogrammer const &) = delete;
+    ParallelHistogrammer &operator=(ParallelHistogrammer const &) = delete;
+
+    void HandleBeginFrame() override {
+        for (std::size_t i = 0; i < histograms.size(); ++i) {
+            Post([this, i](std::size_t) {
+                histograms[i].Clear();
+                if (!pixelCounts.empty()) {
+                    std::fill(pixelCounts[i].begin(), pixelCounts[i].end(),
+                              0);
+                }
+            });
+        }
+        // Filling must not start before every private histogram is cleared.
+        WaitForAllJobs();
+        if (tracker) {
+            tracker->BeginFrame();
+        }
+        frameInProgress = true;
+    }
+
+    void HandleEndFrame() override {
+        MergeHistograms();
+        frameInProgress = false;
+        if (tracker) {
+            tracker->AddPixelCounts(pixelCounts[0].data());
+            tracker->EndFrame(histograms[0]);
+            if (statsDownstream) {
+                statsDownstream->HandleFrame(
+                    tracker->GetFrameStatistics(),
+                    tracker->GetCumulativeStatistics());
+            }
+        }
+        if (downstream) {
+            downstream->HandleFrame(histograms[0]);
+        }
+    }
+
+    void HandlePixelPhoton(PixelPhotonEvent const &event) override {
+        if (event.route >= routeTable.size()) {
+            return;
+        }
+        auto channel = routeTable[event.route];
+        if (channel == RouteNotHistogrammed) {
+            return;
+        }
+
+        if (!currentBatch) {
+            currentBatch = TakeSpareBatch();
+        }
+        currentBatch->emplace_back(event);
+        currentBatch->back().route = channel;
+        if (currentBatch->size() >= batchSize) {
+            PostCurrentBatch();
+        }
+    }
+
+    void HandleError(std::string const &message) override {
+        StopWorkers();
+        if (statsDownstream) {
+            statsDownstream->HandleError(message);
+            statsDownstream.reset();
+        }
+        if (downstream) {
+            downstream->HandleError(message);
+            downstream.reset();
+        }
+    }
+
+    void HandleFinish() override {
+        if (frameInProgress) {
+            MergeHistograms();
+        }
+        StopWorkers();
+        if (statsDownstream) {
+            statsDownstream->HandleFinish(tracker->GetCumulativeStatistics());
+            statsDownstream.reset();
+        }
+        if (downstream) {
+            downstream->HandleFinish(std::move(histograms[0]),
+                                     !frameInProgress);
+            downstream.reset();
+        }
+    }
+};
@@ -0,0 +1,300 @@
+#pragma once
+
+#include "AlignedAllocation.hpp"
+#include "ArrayArithmetic.hpp"
+#include "MemoryPool.hpp"
+#include "MultiChannelHistogrammer.hpp"
+#include "PixelPhotonEvent.hpp"
+
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
+
+// cos(n omega t) and sin(n omega t) for every raw microtime t, where n is the
+// harmonic and omega corresponds to a period of periodBins microtime units
+// (normally the laser period; by default the full ADC range, i.e., the TAC
+// range is taken to be the laser period). Phases are taken at bin centers.
+class PhasorLookupTable {
+    std::vector<float> cosTable;
+    std::vector<float> sinTable;
+
+  public:
+    PhasorLookupTable(uint32_t inputBits, uint32_t harmonic, bool reverse,
+                      double periodBins = 0.0) {
+        if (inputBits > 16 || harmonic < 1 || !(periodBins >= 0.0)) {
+            throw std::invalid_argument(
+                "Invalid phasor harmonic, microtime bits, or period");
+        }
+        std::size_t const n = std::size_t(1) << inputBits;
+        if (periodBins == 0.0) {
+            periodBins = double(n);
+        }
+        double const omega =
+            2.0 * 3.14159265358979323846 * harmonic / periodBins;
+        cosTable.resize(n);
+        sinTable.resize(n);
+        for (std::size_t t = 0; t < n; ++t) {
+            double const time = double(reverse ? n - 1 - t : t) + 0.5;
+            cosTable[t] = float(std::cos(omega * time));
+            sinTable[t] = float(std::sin(omega * time));
+        }
+    }
+
+    // No range check
+    float Cos(uint32_t microtime) const noexcept {
+        return cosTable[microtime];
+    }
+
+    float Sin(uint32_t microtime) const noexcept {
+        return sinTable[microtime];
+    }
+
+    std::size_t GetSize() const noexcept { return cosTable.size(); }
+};
+
+// Per-pixel phasor accumulators of a multi-channel image: photon count and
+// sums of cos and sin. 20 bytes per pixel, regardless of time resolution.
+// The sums are double, so that cumulative images do not lose the
+// contributions of later frames. Layout of each array is [channel][y][x].
+class PhasorImage {
+    std::size_t width = 0;
+    std::size_t height = 0;
+    std::size_t numChannels = 0;
+
+    // Cosine sums, then sine sums, then counts, in a single block
+    std::shared_ptr<void> storage;
+
+    static std::shared_ptr<void> AllocateStorage(std::size_t size) {
+        AllocationPolicy const policy;
+        return std::shared_ptr<void>(
+            AllocateAligned(size, policy),
+            [size, policy](void *p) { FreeAligned(p, size, policy); });
+    }
+
+    // Plane 0 and 1 hold the sums, plane 2 the counts
+    char *Plane(std::size_t i) const noexcept {
+        return static_cast<char *>(storage.get()) +
+               i * GetNumberOfPixels() * sizeof(double);
+    }
+
+  public:
+    // Default constructor creates a "moved out" object.
+    PhasorImage() = default;
+
+    // Warning: Newly constructed image is not zeroed (for efficiency)
+    PhasorImage(std::size_t width, std::size_t height,
+                std::size_t numChannels = 1)
+        : width(width), height(height), numChannels(numChannels),
+          storage(
+              AllocateStorage(GetStorageSize(width, height, numChannels))) {}
+
+    // Same as above, but with storage obtained from the given pool.
+    PhasorImage(std::size_t width, std::size_t height,
+                std::size_t numChannels, MemoryPool &pool)
+        : width(width), height(height), numChannels(numChannels),
+          storage(pool.Allocate(GetStorageSize(width, height, numChannels))) {
+    }
+
+    PhasorImage(PhasorImage const &) = delete;
+    PhasorImage &operator=(PhasorImage const &) = delete;
+    PhasorImage(PhasorImage &&) = default;
+    PhasorImage &operator=(PhasorImage &&) = default;
+
+    // Size of the storage needed for an image of the given dimensions
+    static std::size_t GetStorageSize(std::size_t width, std::size_t height,
+                                      std::size_t numChannels = 1) noexcept {
+        return width * height * numChannels *
+               (2 * sizeof(double) + sizeof(uint32_t));
+    }
+
+    bool IsValid() const noexcept { return storage.get(); }
+
+    void Clear() noexcept {
+        std::memset(storage.get(), 0,
+                    GetStorageSize(width, height, numChannels));
+    }
+
+    std::size_t GetWidth() const noexcept { return width; }
+
+    std::size_t GetHeight() const noexcept { return height; }
+
+    std::size_t GetNumberOfChannels() const noexcept { return numChannels; }
+
+    std::size_t GetNumberOfPixels() const noexcept {
+        return width * height * numChannels;
+    }
+
+    uint32_t const *GetCounts() const noexcept {
+        return reinterpret_cast<uint32_t const *>(Plane(2));
+    }
+
+    double const *GetCosineSums() const noexcept {
+        return reinterpret_cast<double const *>(Plane(0));
+    }
+
+    double const *GetSineSums() const noexcept {
+        return reinterpret_cast<double const *>(Plane(1));
+    }
+
+    void Add(std::size_t x, std::size_t y, std::size_t channel, float cosine,
+             float sine) noexcept {
+        auto const pixel = (channel * height + y) * width + x;
+        ++reinterpret_cast<uint32_t *>(Plane(2))[pixel];
+        reinterpret_cast<double *>(Plane(0))[pixel] += cosine;
+        reinterpret_cast<double *>(Plane(1))[pixel] += sine;
+    }
+
+    // Phasor coordinates of a pixel (0 if it has no photons)
+    double GetG(std::size_t pixel) const noexcept {
+        auto const count = GetCounts()[pixel];
+        return count ? GetCosineSums()[pixel] / double(count) : 0.0;
+    }
+
+    double GetS(std::size_t pixel) const noexcept {
+        auto const count = GetCounts()[pixel];
+        return count ? GetSineSums()[pixel] / double(count) : 0.0;
+    }
+
+    PhasorImage &operator+=(PhasorImage const &rhs) {
+        if (rhs.width != width || rhs.height != height ||
+            rhs.numChannels != numChannels) {
+            abort(); // Programming error
+        }
+
+        auto const n = GetNumberOfPixels();
+        auto *counts = reinterpret_cast<uint32_t *>(Plane(2));
+        auto *sums = reinterpret_cast<double *>(Plane(0));
+        uint32_t const *rhsCounts = rhs.GetCounts();
+        double const *rhsSums = rhs.GetCosineSums();
+        for (std::size_t i = 0; i < n; ++i) {
+            counts[i] = SaturatingAdd(counts[i], rhsCounts[i]);
+        }
+        for (std::size_t i = 0; i < 2 * n; ++i) { // Cosine and sine planes
+            sums[i] += rhsSums[i];
+        }
+        return *this;
+    }
+
+    // Copy src into dst, (re)allocating dst if it does not match src.
+    friend void CopyFrame(PhasorImage const &src, PhasorImage &dst) {
+        if (!dst.IsValid() || dst.width != src.width ||
+            dst.height != src.height || dst.numChannels != src.numChannels) {
+            dst = PhasorImage(src.width, src.height, src.numChannels);
+        }
+        std::memcpy(dst.storage.get(), src.storage.get(),
+                    GetStorageSize(src.width, src.height, src.numChannels));
+    }
+};
+
+// Receiver of frame-by-frame phasor images
+class PhasorImageProcessor {
+  public:
+    virtual ~PhasorImageProcessor() = default;
+
+    virtual void HandleError(std::string const &message) = 0;
+    virtual void HandleFrame(PhasorImage const &image) = 0;
+    virtual void HandleFinish(PhasorImage &&image, bool isCompleteFrame) = 0;
+};
+
+// Collect pixel-assigned photon events of all routes into a series of
+// multi-channel phasor images, routing as MultiChannelHistogrammer does.
+class PhasorProcessor : public PixelPhotonProcessor {
+    PhasorImage image;
+    PhasorLookupTable const lut;
+    RouteChannelTable const routeTable;
+    bool frameInProgress;
+
+    std::shared_ptr<PhasorImageProcessor> downstream;
+
+  public:
+    PhasorProcessor(PhasorImage &&image, PhasorLookupTable const &lut,
+                    RouteChannelTable const &routeTable,
+                    std::shared_ptr<PhasorImageProcessor> downstream)
+        : image(std::move(image)), lut(lut), routeTable(routeTable),
+          frameInProgress(false), downstream(downstream) {
+        CheckRouteChannelTable(routeTable,
+                               this->image.GetNumberOfChannels());
+    }
+
+    void HandleBeginFrame() override {
+        image.Clear();
+        frameInProgress = true;
+    }
+
+    void HandleEndFrame() override {
+        frameInProgress = false;
+        if (downstream) {
+            downstream->HandleFrame(image);
+        }
+    }
+
+    void HandlePixelPhoton(PixelPhotonEvent const &event) override {
+        if (event.route >= routeTable.size() ||
+            event.microtime >= lut.GetSize()) {
+            return;
+        }
+        auto channel = routeTable[event.route];
+        if (channel == RouteNotHistogrammed) {
+            return;
+        }
+        image.Add(event.x, event.y, channel, lut.Cos(event.microtime),
+                  lut.Sin(event.microtime));
+    }
+
+    void HandleError(std::string const &message) override {
+        if (downstream) {
+            downstream->HandleError(message);
+            downstream.reset();
+        }
+    }
+
+    void HandleFinish() override {
+        if (downstream) {
+            downstream->HandleFinish(std::move(image), !frameInProgress);
+            downstream.reset();
+        }
+    }
+};
+
+// Accumulate a series of phasor images.
+// Guarantees complete frame upon finish (all zeros if there was no frame).
+class PhasorAccumulator : public PhasorImageProcessor {
+    PhasorImage cumulative;
+
+    std::shared_ptr<PhasorImageProcessor> downstream;
+
+  public:
+    // The image should be zeroed.
+    PhasorAccumulator(PhasorImage &&image,
+                      std::shared_ptr<PhasorImageProcessor> downstream)
+        : cumulative(std::move(image)), downstream(downstream) {}
+
+    void HandleError(std::string const &message) override {
+        if (downstream) {
+            downstream->HandleError(message);
+            downstream.reset();
+        }
+    }
+
+    void HandleFrame(PhasorImage const &image) override {
+        cumulative += image;
+        if (downstream) {
+            downstream->HandleFrame(cumulative);
+        }
+    }
+
+    void HandleFinish(PhasorImage &&image, bool isCompleteFrame) override {
+        // We discard any incomplete frame from upstream
+        if (downstream) {
+            downstream->HandleFinish(std::move(cumulative), true);
+            downstream.reset();
+        }
+    }
+};
@@ -0,0 +1,150 @@
+#pragma once
+
+#include "ArrayArithmetic.hpp"
+#include "Histogram.hpp"
+
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
+
+// Photon count targets for stopping an acquisition early. Unused targets are
+// 0 (a pixelFraction of 0 also disables the pixel target); counts are within
+// the ROI (whole image if roiWidth or roiHeight is 0).
+struct PhotonBudget {
+    uint64_t totalPhotons = 0;
+    // At least pixelFraction of the ROI pixels have pixelPhotons photons
+    uint32_t pixelPhotons = 0;
+    double pixelFraction = 1.0;
+    uint32_t roiX = 0;
+    uint32_t roiY = 0;
+    uint32_t roiWidth = 0;
+    uint32_t roiHeight = 0;
+
+    bool HasPixelTarget() const noexcept {
+        return pixelPhotons > 0 && pixelFraction > 0.0;
+    }
+
+    bool IsEnabled() const noexcept {
+        return totalPhotons > 0 || HasPixelTarget();
+    }
+};
+
+// Pass intensity frames through unchanged, keeping cumulative photon counts
+// of the ROI, and call onReached (once) after the first frame by which all
+// targets of the budget have been met. Each frame costs one pass over the
+// ROI; counting stops once the budget is reached.
+class PhotonBudgetMonitor : public HistogramProcessor<uint32_t> {
+    PhotonBudget const budget;
+    std::size_t const width;
+    std::size_t const roiWidth;
+    std::size_t const roiHeight;
+    std::size_t const pixelsRequired; // Number reaching pixelPhotons
+    std::vector<uint32_t> cumulative; // ROI only
+    uint64_t totalPhotons = 0;
+    std::size_t pixelsReached = 0;
+    std::function<void()> onReached;
+
+    std::shared_ptr<HistogramProcessor<uint32_t>> downstream;
+
+    void Accumulate(Histogram<uint32_t> const &frame) noexcept {
+        uint32_t const *src = frame.Get() + budget.roiY * width + budget.roiX;
+        uint32_t *cum = cumulative.data();
+        uint32_t const threshold =
+            budget.HasPixelTarget() ? budget.pixelPhotons : 0;
+        for (std::size_t y = 0; y < roiHeight; ++y) {
+            totalPhotons += SumArray(src, roiWidth);
+            if (threshold > 0) {
+                for (std::size_t x = 0; x < roiWidth; ++x) {
+                    uint32_t const before = cum[x];
+                    uint32_t const after = SaturatingAdd(before, src[x]);
+                    cum[x] = after;
+                    pixelsReached += before < threshold && after >= threshold;
+                }
+            }
+            src += width;
+            cum += roiWidth;
+        }
+    }
+
+    bool IsReached() const noexcept {
+        return totalPhotons >= budget.totalPhotons &&
+               pixelsReached >= pixelsRequired;
+    }
+
+  public:
+    // Frames must be single-channel images of width x height pixels
+    // containing the ROI.
+    PhotonBudgetMonitor(
+        std::size_t width, std::size_t height, PhotonBudget const &budget,
+        std::function<void()> onReached,
+        std::shared_ptr<HistogramProcessor<uint32_t>> downstream)
+        : budget(budget), width(width),
+          roiWidth(budget.roiWidth > 0 && budget.roiHeight > 0
+                       ? budget.roiWidth
+                       : width),
+          roiHeight(budget.roiWidth > 0 && budget.roiHeight > 0
+                        ? budget.roiHeight
+                        : height),
+          pixelsRequired(budget.HasPixelTarget()
+                             ? std::size_t(std::ceil(
+                                   budget.pixelFraction *
+                                   double(roiWidth * roiHeight)))
+                             : 0),
+          cumulative(budget.HasPixelTarget() ? roiWidth * roiHeight : 0),
+          onReached(std::move(onReached)), downstream(downstream) {
+        if (!budget.IsEnabled()) {
+            throw std::invalid_argument("Photon budget has no target");
+        }
+        if (budget.roiX + roiWidth > width ||
+            budget.roiY + roiHeight > height) {
+            throw std::invalid_argument("Photon budget ROI out of bounds");
+        }
+        if (!(budget.pixelFraction >= 0.0 && budget.pixelFraction <= 1.0)) {
+            throw std::invalid_argument(
+                "Photon budget pixel fraction must be in [0, 1]");
+        }
+    }
+
+    uint64_t GetTotalPhotons() const noexcept { return totalPhotons; }
+
+    std::size_t GetNumberOfPixelsReached() const noexcept {
+        return pixelsReached;
+    }
+
+    void HandleError(std::string const &message) override {
+        onReached = nullptr;
+        if (downstream) {
+            downstream->HandleError(message);
+            downstream.reset();
+        }
+    }
+
+    void HandleFrame(Histogram<uint32_t> const &frame) override {
+        if (onReached) {
+            Accumulate(frame);
+            if (IsReached()) {
+                auto f = std::move(onReached);
+                onReached = nullptr;
+                f();
+            }
+        }
+        if (downstream) {
+            downstream->HandleFrame(frame);
+        }
+    }
+
+    void HandleFinish(Histogram<uint32_t> &&frame,
+                      bool isCompleteFrame) override {
+        onReached = nullptr;
+        if (downstream) {
+            downstream->HandleFinish(std::move(frame), isCompleteFrame);
+            downstream.reset();
+        }
+    }
+};
@@ -0,0 +1,91 @@
+#pragma once
+
+#include "PixelPhotonEvent.hpp"
+
+#include <cstdint>
+#include <memory>
+#include <stdexcept>
+#include <string>
+
+// Crop pixel-assigned photon events to a rectangular region of interest and
+// bin the remaining pixels by an integer factor (in both x and y), so that
+// downstream histograms can be allocated at the reduced size.
+// Partial bins at the right and bottom edges of the region are discarded, so
+// that every output pixel covers the same area.
+class PixelBinner : public PixelPhotonProcessor {
+    uint32_t const roiX;
+    uint32_t const roiY;
+    uint32_t const binFactor;
+    uint32_t const binnedWidth;
+    uint32_t const binnedHeight;
+
+    std::shared_ptr<PixelPhotonProcessor> downstream;
+
+  public:
+    PixelBinner(uint32_t roiX, uint32_t roiY, uint32_t roiWidth,
+                uint32_t roiHeight, uint32_t binFactor,
+                std::shared_ptr<PixelPhotonProcessor> downstream)
+        : roiX(roiX), roiY(roiY), binFactor(binFactor),
+          binnedWidth(binFactor ? roiWidth / binFactor : 0),
+          binnedHeight(binFactor ? roiHeight / binFactor : 0),
+          downstream(downstream) {
+        if (binFactor < 1) {
+            throw std::invalid_argument("Binning factor must be positive");
+        }
+        if (binnedWidth < 1 || binnedHeight < 1) {
+            throw std::invalid_argument(
+                "Region of interest must be at least one bin in size");
+        }
+    }
+
+    uint32_t GetBinnedWidth() const noexcept { return binnedWidth; }
+
+    uint32_t GetBinnedHeight() const noexcept { return binnedHeight; }
+
+    void HandleBeginFrame() override {
+        if (downstream) {
+            downstream->HandleBeginFrame();
+        }
+    }
+
+    void HandleEndFrame() override {
+        if (downstream) {
+            downstream->HandleEndFrame();
+        }
+    }
+
+    void HandlePixelPhoton(PixelPhotonEvent const &event) override {
+        // Coordinates left of or above the ROI wrap around to large values
+        uint32_t x = (event.x - roiX) / binFactor;
+        uint32_t y = (event.y - roiY) / binFactor;
+        if (x >= binnedWidth || y >= binnedHeight) {
+            return;
+        }
+        if (downstream) {
+            PixelPhotonEvent binned = event;
+            binned.x = x;
+            binned.y = y;
+            downstream->HandlePixelPhoton(binned);
+        }
+    }
+
+    void HandleTimeReached(uint64_t macrotime) override {
+        if (downstream) {
+            downstream->HandleTimeReached(macrotime);
+        }
+    }
+
+    void HandleError(std::string const &message) override {
+        if (downstream) {
+            downstream->HandleError(message);
+            downstream.reset();
+        }
+    }
+
+    void HandleFinish() override {
+        if (downstream) {
+            downstream->HandleFinish();
+            downstream.reset();
+        }
+    }
+};
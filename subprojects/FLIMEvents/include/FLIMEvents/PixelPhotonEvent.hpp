@@ -13,6 +13,7 @@ struct PixelPhotonEvent {
     uint32_t x;
     uint32_t y;
     uint32_t frame;
+    uint64_t macrotime; // Of the original photon
 };
 
 // Receiver of pixel-assigned photon events
@@ -25,6 +26,10 @@ class PixelPhotonProcessor {
     virtual void HandlePixelPhoton(PixelPhotonEvent const &event) = 0;
     virtual void HandleError(std::string const &message) = 0;
     virtual void HandleFinish() = 0;
+
+    // All photons before macrotime have been delivered. Processors that do
+    // not depend on the passage of time need not override this.
+    virtual void HandleTimeReached(uint64_t) {}
 };
 
 template <std::size_t N>
@@ -55,6 +60,12 @@ class BroadcastPixelPhotonProcessor : public PixelPhotonProcessor {
         }
     }
 
+    void HandleTimeReached(uint64_t macrotime) override {
+        for (auto &d : downstreams) {
+            d->HandleTimeReached(macrotime);
+        }
+    }
+
     void HandleError(std::string const &message) override {
         for (auto &d : downstreams) {
             d->HandleError(message);
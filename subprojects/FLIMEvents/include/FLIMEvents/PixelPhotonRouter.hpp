@@ -49,6 +49,14 @@ class PixelPhotonRouter : public PixelPhotonProcessor {
         }
     }
 
+    void HandleTimeReached(uint64_t macrotime) override {
+        for (auto &d : downstreams) {
+            if (d) {
+                d->HandleTimeReached(macrotime);
+            }
+        }
+    }
+
     void HandleError(std::string const &message) override {
         for (auto &d : downstreams) {
             if (d) {
@@ -0,0 +1,152 @@
+#pragma once
+
+#include "ArrayArithmetic.hpp"
+#include "Histogram.hpp"
+#include "MeanArrivalTimeCounter.hpp"
+#include "PixelPhotonEvent.hpp"
+
+#include <bitset>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <utility>
+
+// Count photons of the selected routes into a downsampled preview image and
+// pass it downstream every updateInterval (macrotime units), and once more
+// at the finish, so that a display can follow a frame as it is acquired at a
+// fixed rate independent of the frame rate. Unless
+// cumulative, each row of the preview is cleared when the scan reaches it,
+// so rows not yet reached show the previous frame. The image is a 0-bit
+// histogram of binFactor-downsampled size with 1 channel (counts) or 2
+// (counts and microtime sums, as in MeanArrivalTimeCounter).
+class PreviewImager : public PixelPhotonProcessor {
+    Histogram<uint32_t> image;
+    uint32_t const binFactor;
+    std::size_t const width;
+    std::size_t const height;
+    std::size_t const pixels;
+    uint16_t const routeMask; // Bit i set iff route i is counted
+    uint16_t const maxMicrotime;
+    bool const reverseTime;
+    bool const cumulative;
+    uint64_t const updateInterval;
+
+    bool started = false;
+    uint64_t nextUpdateTime = 0;
+    std::size_t nextRow = 0; // Rows before this are current in this frame
+    bool frameInProgress = false;
+
+    std::shared_ptr<HistogramProcessor<uint32_t>> downstream;
+
+    // Mark rows before endRow as reached in this frame
+    void ReachRows(std::size_t endRow) noexcept {
+        if (endRow <= nextRow) {
+            return;
+        }
+        if (!cumulative) {
+            for (std::size_t ch = 0; ch < image.GetNumberOfChannels(); ++ch) {
+                memset(image.Get() + ch * pixels + nextRow * width, 0,
+                       (endRow - nextRow) * width * sizeof(uint32_t));
+            }
+        }
+        nextRow = endRow;
+    }
+
+    void Emit() {
+        if (downstream) {
+            downstream->HandleFrame(image);
+        }
+    }
+
+  public:
+    // The image must have 1 time bin, 1 or 2 channels, and (at most) the
+    // raster size divided by binFactor. Microtimes have inputTimeBits bits;
+    // if reverseTime, they are taken as counting down.
+    PreviewImager(Histogram<uint32_t> &&image, uint32_t binFactor,
+                  std::bitset<16> const &routeMask, uint32_t inputTimeBits,
+                  bool reverseTime, bool cumulative, uint64_t updateInterval,
+                  std::shared_ptr<HistogramProcessor<uint32_t>> downstream)
+        : image(std::move(image)), binFactor(binFactor),
+          width(this->image.GetWidth()), height(this->image.GetHeight()),
+          pixels(this->image.GetNumberOfElementsPerChannel()),
+          routeMask(static_cast<uint16_t>(routeMask.to_ulong())),
+          maxMicrotime(uint16_t((1u << inputTimeBits) - 1)),
+          reverseTime(reverseTime), cumulative(cumulative),
+          updateInterval(updateInterval), downstream(downstream) {
+        if (this->image.GetNumberOfTimeBins() != 1 ||
+            this->image.GetNumberOfChannels() < 1 ||
+            this->image.GetNumberOfChannels() > 2) {
+            throw std::invalid_argument(
+                "Preview image must have 1 time bin and 1 or 2 channels");
+        }
+        if (binFactor < 1) {
+            throw std::invalid_argument("Preview binning must be positive");
+        }
+        if (inputTimeBits < 1 || inputTimeBits > 16) {
+            throw std::invalid_argument("Invalid microtime bits");
+        }
+        if (updateInterval < 1) {
+            throw std::invalid_argument(
+                "Preview update interval must be positive");
+        }
+        this->image.Clear();
+    }
+
+    void HandleBeginFrame() override {
+        nextRow = 0;
+        frameInProgress = true;
+    }
+
+    void HandleEndFrame() override {
+        ReachRows(height);
+        frameInProgress = false;
+    }
+
+    void HandlePixelPhoton(PixelPhotonEvent const &event) override {
+        if (!started) {
+            started = true;
+            nextUpdateTime = event.macrotime + updateInterval;
+        } else if (event.macrotime >= nextUpdateTime) {
+            nextUpdateTime = event.macrotime + updateInterval;
+            Emit();
+        }
+
+        if (event.route >= 16 || !((routeMask >> event.route) & 1)) {
+            return;
+        }
+        std::size_t const x = event.x / binFactor;
+        std::size_t const y = event.y / binFactor;
+        if (x >= width || y >= height) {
+            return; // Partial bins at right and bottom edges
+        }
+        ReachRows(y + 1);
+        std::size_t const pixel = y * width + x;
+        uint32_t *data = image.Get();
+        if (image.GetNumberOfChannels() == 2) {
+            uint16_t t = event.microtime & maxMicrotime;
+            if (reverseTime) {
+                t = uint16_t(maxMicrotime - t);
+            }
+            AddArrivalTime(data[pixel], data[pixels + pixel], t);
+        } else {
+            data[pixel] = SaturatingAdd(data[pixel], 1u);
+        }
+    }
+
+    void HandleError(std::string const &message) override {
+        if (downstream) {
+            downstream->HandleError(message);
+            downstream.reset();
+        }
+    }
+
+    void HandleFinish() override {
+        if (downstream) {
+            downstream->HandleFinish(std::move(image), !frameInProgress);
+            downstream.reset();
+        }
+    }
+};
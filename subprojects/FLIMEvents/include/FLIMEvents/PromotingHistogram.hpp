@@ -0,0 +1,456 @@
+#pragma once
+
+#include "ArrayArithmetic.hpp"
+#include "Histogram.hpp"
+#include "HistogramSnapshot.hpp"
+#include "MemoryPool.hpp"
+#include "MicrotimeBinning.hpp"
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+// A cumulative multi-channel histogram of 16-bit frame histograms that does
+// not saturate: each channel is kept as uint16_t until a sum overflows, at
+// which point that channel (only) is promoted to uint32_t. Overflow is
+// detected during accumulation at no extra memory traffic, and the exact
+// sums are recovered on promotion, so no counts are lost.
+class PromotingHistogram {
+    Histogram<uint16_t> narrow;            // All channels
+    std::vector<Histogram<uint32_t>> wide; // Per channel; valid if promoted
+
+    void Promote(std::size_t channel, uint16_t const *lastAdded) {
+        auto const n = narrow.GetNumberOfElementsPerChannel();
+        Histogram<uint32_t> h(narrow.GetMicrotimeBinning(), narrow.GetWidth(),
+                              narrow.GetHeight());
+        UnwrapCarriedArray(h.Get(), narrow.Get() + channel * n, lastAdded,
+                           n);
+        wide[channel] = std::move(h);
+    }
+
+  public:
+    // Creates a "moved out" object.
+    PromotingHistogram() = default;
+
+    // Takes over the (usually zeroed) 16-bit histogram as initial content.
+    explicit PromotingHistogram(Histogram<uint16_t> &&histogram)
+        : narrow(std::move(histogram)), wide(narrow.GetNumberOfChannels()) {}
+
+    PromotingHistogram(PromotingHistogram &&) = default;
+    PromotingHistogram &operator=(PromotingHistogram &&) = default;
+
+    bool IsValid() const noexcept { return narrow.IsValid(); }
+
+    MicrotimeBinning const &GetMicrotimeBinning() const noexcept {
+        return narrow.GetMicrotimeBinning();
+    }
+
+    uint32_t GetNumberOfTimeBins() const noexcept {
+        return narrow.GetNumberOfTimeBins();
+    }
+
+    std::size_t GetWidth() const noexcept { return narrow.GetWidth(); }
+
+    std::size_t GetHeight() const noexcept { return narrow.GetHeight(); }
+
+    std::size_t GetNumberOfChannels() const noexcept {
+        return narrow.GetNumberOfChannels();
+    }
+
+    std::size_t GetNumberOfElementsPerChannel() const noexcept {
+        return narrow.GetNumberOfElementsPerChannel();
+    }
+
+    std::size_t GetNumberOfElements() const noexcept {
+        return narrow.GetNumberOfElements();
+    }
+
+    bool IsChannelPromoted(std::size_t channel) const noexcept {
+        return wide[channel].IsValid();
+    }
+
+    // True if any channel is promoted
+    bool IsPromoted() const noexcept {
+        for (auto const &w : wide) {
+            if (w.IsValid()) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    // The 16-bit data of all channels; only meaningful if !IsPromoted().
+    Histogram<uint16_t> const &GetNarrow() const noexcept { return narrow; }
+
+    // View of a channel's [y][x][t] data; the channel must not be promoted.
+    uint16_t const *GetNarrowChannel(std::size_t channel) const noexcept {
+        return narrow.GetChannel(channel);
+    }
+
+    // View of a channel's [y][x][t] data; the channel must be promoted.
+    uint32_t const *GetWideChannel(std::size_t channel) const noexcept {
+        return wide[channel].Get();
+    }
+
+    // Copy a channel's data, clipping promoted counts at 65535
+    void CopyChannel(std::size_t channel, uint16_t *dest) const noexcept {
+        auto const n = GetNumberOfElementsPerChannel();
+        if (IsChannelPromoted(channel)) {
+            SaturatingNarrowArray(dest, wide[channel].Get(), n);
+        } else {
+            std::memcpy(dest, narrow.GetChannel(channel),
+                        n * sizeof(uint16_t));
+        }
+    }
+
+    // Copy a channel's data, widening if the channel is not promoted
+    void CopyChannel(std::size_t channel, uint32_t *dest) const noexcept {
+        auto const n = GetNumberOfElementsPerChannel();
+        if (IsChannelPromoted(channel)) {
+            std::memcpy(dest, wide[channel].Get(), n * sizeof(uint32_t));
+        } else {
+            std::memset(dest, 0, n * sizeof(uint32_t));
+            WideningAddArray(dest, narrow.GetChannel(channel), n);
+        }
+    }
+
+    // Make dst a copy of src, reusing dst's storage where possible.
+    friend void CopyFrame(PromotingHistogram const &src,
+                          PromotingHistogram &dst) {
+        CopyFrame(src.narrow, dst.narrow);
+        dst.wide.resize(src.wide.size());
+        for (std::size_t ch = 0; ch < src.wide.size(); ++ch) {
+            if (src.wide[ch].IsValid()) {
+                CopyFrame(src.wide[ch], dst.wide[ch]);
+            } else {
+                dst.wide[ch] = Histogram<uint32_t>();
+            }
+        }
+    }
+
+    // Accumulate a frame histogram of the same dimensions. Memory for
+    // promoted channels is allocated here (not from any pool).
+    PromotingHistogram &operator+=(Histogram<uint16_t> const &rhs) {
+        if (rhs.GetNumberOfTimeBins() != narrow.GetNumberOfTimeBins() ||
+            rhs.GetWidth() != narrow.GetWidth() ||
+            rhs.GetHeight() != narrow.GetHeight() ||
+            rhs.GetNumberOfChannels() != narrow.GetNumberOfChannels()) {
+            abort(); // Programming error
+        }
+
+        auto const n = GetNumberOfElementsPerChannel();
+        for (std::size_t ch = 0; ch < wide.size(); ++ch) {
+            uint16_t const *src = rhs.GetChannel(ch);
+            if (wide[ch].IsValid()) {
+                WideningAddArray(wide[ch].Get(), src, n);
+            } else if (CarryingAddArray(narrow.Get() + ch * n, src, n)) {
+                Promote(ch, src);
+            }
+        }
+        return *this;
+    }
+};
+
+// Receiver of cumulative promoting histograms
+class PromotingHistogramProcessor {
+  public:
+    virtual ~PromotingHistogramProcessor() = default;
+
+    virtual void HandleError(std::string const &message) = 0;
+    virtual void HandleFrame(PromotingHistogram const &histogram) = 0;
+    virtual void HandleFinish(PromotingHistogram &&histogram,
+                              bool isCompleteFrame) = 0;
+};
+
+// Accumulate a series of 16-bit histograms without saturating, as
+// HistogramAccumulator does.
+// Guarantees complete frame upon finish (all zeros if there was no frame).
+class PromotingHistogramAccumulator : public HistogramProcessor<uint16_t> {
+    PromotingHistogram cumulative;
+
+    std::shared_ptr<PromotingHistogramProcessor> downstream;
+
+  public:
+    PromotingHistogramAccumulator(
+        Histogram<uint16_t> &&histogram,
+        std::shared_ptr<PromotingHistogramProcessor> downstream)
+        : cumulative(std::move(histogram)), downstream(downstream) {}
+
+    void HandleError(std::string const &message) override {
+        if (downstream) {
+            downstream->HandleError(message);
+            downstream.reset();
+        }
+    }
+
+    void HandleFrame(Histogram<uint16_t> const &histogram) override {
+        cumulative += histogram;
+        if (downstream) {
+            downstream->HandleFrame(cumulative);
+        }
+    }
+
+    void HandleFinish(Histogram<uint16_t> &&histogram,
+                      bool isCompleteFrame) override {
+        // We discard any incomplete frame from upstream
+        if (downstream) {
+            downstream->HandleFinish(std::move(cumulative), true);
+            downstream.reset();
+        }
+    }
+};
+
+class CowPromotingHistogram;
+
+// Immutable, reference-counted view of a CowPromotingHistogram at one point
+// in time: each channel is a 16-bit snapshot, or a 32-bit one if promoted.
+// Copying is cheap (the tiles are shared). Tiles of both widths hold the same
+// number of elements, a whole number of pixels.
+class PromotingHistogramSnapshot {
+    friend class CowPromotingHistogram;
+
+    MicrotimeBinning binning;
+    std::size_t width = 0;
+    std::size_t height = 0;
+    std::vector<HistogramSnapshot<uint16_t>> narrow; // Valid if not promoted
+    std::vector<HistogramSnapshot<uint32_t>> wide;   // Valid if promoted
+
+  public:
+    // Creates an empty (invalid) snapshot.
+    PromotingHistogramSnapshot() = default;
+
+    bool IsValid() const noexcept { return !narrow.empty(); }
+
+    MicrotimeBinning const &GetMicrotimeBinning() const noexcept {
+        return binning;
+    }
+
+    uint32_t GetNumberOfTimeBins() const noexcept {
+        return binning.GetNumberOfBins();
+    }
+
+    std::size_t GetWidth() const noexcept { return width; }
+
+    std::size_t GetHeight() const noexcept { return height; }
+
+    std::size_t GetNumberOfChannels() const noexcept { return narrow.size(); }
+
+    std::size_t GetNumberOfElementsPerChannel() const noexcept {
+        return GetNumberOfTimeBins() * width * height;
+    }
+
+    std::size_t GetNumberOfElements() const noexcept {
+        return GetNumberOfElementsPerChannel() * GetNumberOfChannels();
+    }
+
+    bool IsChannelPromoted(std::size_t channel) const noexcept {
+        return wide[channel].IsValid();
+    }
+
+    // True if any channel is promoted
+    bool IsPromoted() const noexcept {
+        for (auto const &w : wide) {
+            if (w.IsValid()) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    // The channel must not be promoted.
+    HistogramSnapshot<uint16_t> const &
+    GetNarrowChannel(std::size_t channel) const noexcept {
+        return narrow[channel];
+    }
+
+    // The channel must be promoted.
+    HistogramSnapshot<uint32_t> const &
+    GetWideChannel(std::size_t channel) const noexcept {
+        return wide[channel];
+    }
+
+    // Copy a channel's data, clipping promoted counts at 65535
+    void CopyChannel(std::size_t channel, uint16_t *dest) const noexcept {
+        if (IsChannelPromoted(channel)) {
+            auto const &w = wide[channel];
+            for (std::size_t i = 0; i < w.GetNumberOfTiles(); ++i) {
+                SaturatingNarrowArray(dest + i * w.GetTileElements(),
+                                      w.GetTile(i), w.GetTileSize(i));
+            }
+        } else {
+            narrow[channel].CopyTo(dest);
+        }
+    }
+
+    // Copy a channel's data, widening if the channel is not promoted
+    void CopyChannel(std::size_t channel, uint32_t *dest) const noexcept {
+        if (IsChannelPromoted(channel)) {
+            wide[channel].CopyTo(dest);
+        } else {
+            auto const &n = narrow[channel];
+            std::memset(dest, 0,
+                        GetNumberOfElementsPerChannel() * sizeof(uint32_t));
+            for (std::size_t i = 0; i < n.GetNumberOfTiles(); ++i) {
+                WideningAddArray(dest + i * n.GetTileElements(),
+                                 n.GetTile(i), n.GetTileSize(i));
+            }
+        }
+    }
+};
+
+// Snapshots share their tiles, so a copy only takes new references.
+inline void CopyFrame(PromotingHistogramSnapshot const &src,
+                      PromotingHistogramSnapshot &dst) {
+    dst = src;
+}
+
+// A delivered snapshot must not keep its tiles (see HistogramSnapshot).
+inline void ReleaseFrame(PromotingHistogramSnapshot &snapshot) noexcept {
+    snapshot = PromotingHistogramSnapshot();
+}
+
+// PromotingHistogram stored copy-on-write: each channel is a CowHistogram of
+// 16-bit counts until a sum overflows, when it is replaced by a 32-bit one
+// with the same tiling. Consumers thus keep snapshots without copying them.
+// Not thread safe (but snapshots are).
+class CowPromotingHistogram {
+    MicrotimeBinning binning;
+    std::size_t width;
+    std::size_t height;
+    std::size_t tileElements;
+    std::vector<CowHistogram<uint16_t>> narrow; // Per channel
+    std::vector<CowHistogram<uint32_t>> wide;   // Per channel; once promoted
+    std::vector<bool> promoted;
+
+    // Replace a channel with the true sums of its last addition of src
+    void Promote(std::size_t channel, uint16_t const *src) {
+        CowHistogram<uint32_t> w(binning, width, height, 1, tileElements);
+        auto const sums = narrow[channel].Snapshot();
+        for (std::size_t i = 0; i < sums.GetNumberOfTiles(); ++i) {
+            UnwrapCarriedArray(w.MutableTile(i), sums.GetTile(i),
+                               src + i * tileElements, sums.GetTileSize(i));
+        }
+        wide[channel] = std::move(w);
+        promoted[channel] = true;
+    }
+
+  public:
+    // Tiles of about CowHistogram<uint16_t>::DefaultTileBytes, holding whole
+    // pixels (so that each pixel's decay is contiguous)
+    static std::size_t GetTileElements(uint32_t numTimeBins) noexcept {
+        std::size_t const pixels =
+            CowHistogram<uint16_t>::DefaultTileBytes / sizeof(uint16_t) /
+            numTimeBins;
+        return (std::max)(pixels, std::size_t(1)) * numTimeBins;
+    }
+
+    // Zeroed. Tile memory of unpromoted channels is obtained from pool, if
+    // given; promoted channels are allocated here (not from any pool).
+    CowPromotingHistogram(MicrotimeBinning const &binning, std::size_t width,
+                          std::size_t height, std::size_t numChannels,
+                          MemoryPool *pool = nullptr)
+        : binning(binning), width(width), height(height),
+          tileElements(GetTileElements(binning.GetNumberOfBins())),
+          wide(numChannels), promoted(numChannels) {
+        for (std::size_t ch = 0; ch < numChannels; ++ch) {
+            narrow.emplace_back(binning, width, height, 1, tileElements,
+                                pool);
+        }
+    }
+
+    PromotingHistogramSnapshot Snapshot() const {
+        PromotingHistogramSnapshot snap;
+        snap.binning = binning;
+        snap.width = width;
+        snap.height = height;
+        snap.narrow.resize(narrow.size());
+        snap.wide.resize(narrow.size());
+        for (std::size_t ch = 0; ch < narrow.size(); ++ch) {
+            if (promoted[ch]) {
+                snap.wide[ch] = wide[ch].Snapshot();
+            } else {
+                snap.narrow[ch] = narrow[ch].Snapshot();
+            }
+        }
+        return snap;
+    }
+
+    // Accumulate a frame histogram of the same dimensions
+    CowPromotingHistogram &operator+=(Histogram<uint16_t> const &rhs) {
+        if (rhs.GetNumberOfTimeBins() != binning.GetNumberOfBins() ||
+            rhs.GetWidth() != width || rhs.GetHeight() != height ||
+            rhs.GetNumberOfChannels() != narrow.size()) {
+            abort(); // Programming error
+        }
+
+        for (std::size_t ch = 0; ch < narrow.size(); ++ch) {
+            uint16_t const *src = rhs.GetChannel(ch);
+            if (promoted[ch]) {
+                wide[ch].WideningAdd(src);
+            } else if (narrow[ch].CarryingAdd(src)) {
+                Promote(ch, src);
+                // The 16-bit tiles return to the pool once no snapshot
+                // holds them
+                narrow[ch] = CowHistogram<uint16_t>();
+            }
+        }
+        return *this;
+    }
+};
+
+// Receiver of cumulative promoting histogram snapshots
+class PromotingHistogramSnapshotProcessor {
+  public:
+    virtual ~PromotingHistogramSnapshotProcessor() = default;
+
+    virtual void HandleError(std::string const &message) = 0;
+    virtual void HandleFrame(PromotingHistogramSnapshot const &snapshot) = 0;
+    virtual void HandleFinish(PromotingHistogramSnapshot &&snapshot,
+                              bool isCompleteFrame) = 0;
+};
+
+// Accumulate a series of 16-bit histograms without saturating, as
+// PromotingHistogramAccumulator does, but send downstream a snapshot that it
+// may keep.
+// Guarantees complete frame upon finish (all zeros if there was no frame).
+class SnapshotPromotingHistogramAccumulator
+    : public HistogramProcessor<uint16_t> {
+    CowPromotingHistogram cumulative;
+
+    std::shared_ptr<PromotingHistogramSnapshotProcessor> downstream;
+
+  public:
+    SnapshotPromotingHistogramAccumulator(
+        CowPromotingHistogram &&histogram,
+        std::shared_ptr<PromotingHistogramSnapshotProcessor> downstream)
+        : cumulative(std::move(histogram)), downstream(downstream) {}
+
+    void HandleError(std::string const &message) override {
+        if (downstream) {
+            downstream->HandleError(message);
+            downstream.reset();
+        }
+    }
+
+    void HandleFrame(Histogram<uint16_t> const &histogram) override {
+        cumulative += histogram;
+        if (downstream) {
+            downstream->HandleFrame(cumulative.Snapshot());
+        }
+    }
+
+    void HandleFinish(Histogram<uint16_t> &&histogram,
+                      bool isCompleteFrame) override {
+        // We discard any incomplete frame from upstream
+        if (downstream) {
+            downstream->HandleFinish(cumulative.Snapshot(), true);
+            downstream.reset();
+        }
+    }
+};
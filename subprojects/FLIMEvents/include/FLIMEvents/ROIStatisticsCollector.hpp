@@ -0,0 +1,152 @@
+#pragma once
+
+#include "ArrayArithmetic.hpp"
+#include "MicrotimeBinning.hpp"
+#include "MultiChannelHistogrammer.hpp"
+#include "PixelPhotonEvent.hpp"
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
+
+// Photon counts and decay curves of a set of ROIs, per channel.
+struct ROIStatistics {
+    std::size_t numROIs = 0;
+    std::size_t numChannels = 0;
+    std::size_t numTimeBins = 0;
+    // All photons of each ROI, including those outside the time window.
+    // Layout is [channel][roi].
+    std::vector<uint64_t> photonCounts;
+    // Layout is [channel][roi][t].
+    std::vector<uint32_t> decays;
+};
+
+inline void CopyFrame(ROIStatistics const &src, ROIStatistics &dst) {
+    dst = src;
+}
+
+// Receiver of frame-by-frame ROI statistics
+class ROIStatisticsProcessor {
+  public:
+    virtual ~ROIStatisticsProcessor() = default;
+
+    virtual void HandleError(std::string const &message) = 0;
+    virtual void HandleFrame(ROIStatistics const &stats) = 0;
+    virtual void HandleFinish(ROIStatistics &&stats,
+                              bool isCompleteFrame) = 0;
+};
+
+// Collect per-ROI photon counts and decay curves of pixel-assigned photons,
+// in a single pass, and pass them downstream at the end of each frame. ROIs
+// are given as a label per raster pixel (row-major): 0 for no ROI, or n for
+// ROI n - 1. The cost per photon is one label lookup and, for photons in an
+// ROI, one increment of a small table that stays in cache, so this is much
+// cheaper than a full histogram (and its output is tiny).
+class ROIStatisticsCollector : public PixelPhotonProcessor {
+    std::vector<uint8_t> const labels;
+    uint32_t const width;
+    uint32_t const height;
+    MicrotimeBinning const binning;
+    RouteChannelTable const routeTable;
+    bool const cumulative;
+
+    ROIStatistics stats;
+    bool frameInProgress = false;
+
+    std::shared_ptr<ROIStatisticsProcessor> downstream;
+
+    static std::size_t CountROIs(std::vector<uint8_t> const &labels) {
+        return labels.empty()
+                   ? 0
+                   : *std::max_element(labels.begin(), labels.end());
+    }
+
+  public:
+    // labels must have width * height elements. The number of ROIs is the
+    // largest label. Routes are mapped to channels by routeTable. Unless
+    // cumulative, the statistics are reset at the start of each frame.
+    ROIStatisticsCollector(std::vector<uint8_t> &&labels, uint32_t width,
+                           uint32_t height, MicrotimeBinning const &binning,
+                           RouteChannelTable const &routeTable,
+                           bool cumulative,
+                           std::shared_ptr<ROIStatisticsProcessor> downstream)
+        : labels(std::move(labels)), width(width), height(height),
+          binning(binning), routeTable(routeTable), cumulative(cumulative),
+          downstream(downstream) {
+        if (this->labels.size() != std::size_t(width) * height) {
+            throw std::invalid_argument(
+                "ROI label map does not match raster size");
+        }
+        stats.numROIs = CountROIs(this->labels);
+        if (stats.numROIs < 1) {
+            throw std::invalid_argument("ROI label map contains no ROI");
+        }
+        for (auto channel : routeTable) {
+            if (channel != RouteNotHistogrammed) {
+                stats.numChannels =
+                    (std::max)(stats.numChannels, std::size_t(channel) + 1);
+            }
+        }
+        stats.numTimeBins = binning.GetNumberOfBins();
+        stats.photonCounts.resize(stats.numChannels * stats.numROIs);
+        stats.decays.resize(stats.numChannels * stats.numROIs *
+                            stats.numTimeBins);
+    }
+
+    void HandleBeginFrame() override {
+        if (!cumulative) {
+            std::fill(stats.photonCounts.begin(), stats.photonCounts.end(),
+                      0);
+            std::fill(stats.decays.begin(), stats.decays.end(), 0);
+        }
+        frameInProgress = true;
+    }
+
+    void HandleEndFrame() override {
+        frameInProgress = false;
+        if (downstream) {
+            downstream->HandleFrame(stats);
+        }
+    }
+
+    void HandlePixelPhoton(PixelPhotonEvent const &event) override {
+        if (event.route >= routeTable.size() || event.x >= width ||
+            event.y >= height) {
+            return;
+        }
+        auto const channel = routeTable[event.route];
+        if (channel == RouteNotHistogrammed) {
+            return;
+        }
+        uint8_t const label = labels[std::size_t(event.y) * width + event.x];
+        if (label == 0) {
+            return;
+        }
+        std::size_t const roi = channel * stats.numROIs + label - 1;
+        ++stats.photonCounts[roi];
+        auto const bin = binning.GetBin(event.microtime);
+        if (bin != MicrotimeBinning::NotBinned) {
+            uint32_t &count = stats.decays[roi * stats.numTimeBins + bin];
+            count = SaturatingAdd(count, 1u);
+        }
+    }
+
+    void HandleError(std::string const &message) override {
+        if (downstream) {
+            downstream->HandleError(message);
+            downstream.reset();
+        }
+    }
+
+    void HandleFinish() override {
+        if (downstream) {
+            downstream->HandleFinish(std::move(stats), !frameInProgress);
+            downstream.reset();
+        }
+    }
+};
@@ -0,0 +1,161 @@
+#pragma once
+
+#include "Histogram.hpp"
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdlib>
+#include <limits>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+// Accumulate the most recent N frames of a series of histograms.
+// Each frame is added to the running sum and the frame leaving the window is
+// subtracted, so the cost per frame does not depend on N. The running sum is
+// kept exactly, in an integer type wider than T (saturated values could not
+// be subtracted); the histogram passed downstream holds it saturated to T.
+// Guarantees complete frame upon finish, like HistogramAccumulator.
+template <typename T>
+class SlidingWindowAccumulator : public HistogramProcessor<T> {
+    using SumType = std::conditional_t<(sizeof(T) < sizeof(uint32_t)),
+                                       uint32_t, uint64_t>;
+
+    // A frame in the window, kept until it is subtracted. Frame histograms
+    // are usually sparse, so they are stored as (index, value) pairs unless
+    // that would take more space than the dense histogram.
+    struct StoredFrame {
+        std::vector<T> dense; // Empty if stored sparsely
+        std::vector<uint32_t> indices;
+        std::vector<T> values;
+    };
+
+    std::vector<SumType> wideSum;
+    Histogram<T> sum; // Saturated wideSum
+    std::vector<StoredFrame> window;
+    std::size_t nextSlot;    // Holds the oldest frame when window is full
+    std::size_t storedCount; // Number of frames currently in the window
+
+    std::shared_ptr<HistogramProcessor<T>> downstream;
+
+    void Store(Histogram<T> const &histogram, StoredFrame &frame) {
+        std::size_t const n = histogram.GetNumberOfElements();
+        T const *data = histogram.Get();
+
+        std::size_t nonzero = 0;
+        for (std::size_t i = 0; i < n; ++i) {
+            nonzero += data[i] != 0;
+        }
+
+        frame.indices.clear();
+        frame.values.clear();
+        bool const sparse =
+            n <= std::numeric_limits<uint32_t>::max() &&
+            nonzero * (sizeof(uint32_t) + sizeof(T)) < n * sizeof(T);
+        if (!sparse) {
+            frame.dense.assign(data, data + n);
+            return;
+        }
+
+        std::vector<T>().swap(frame.dense); // Release dense storage
+        frame.indices.reserve(nonzero);
+        frame.values.reserve(nonzero);
+        for (std::size_t i = 0; i < n; ++i) {
+            if (data[i]) {
+                frame.indices.push_back(static_cast<uint32_t>(i));
+                frame.values.push_back(data[i]);
+            }
+        }
+    }
+
+    // Apply op(wideSum[i], value) to each element of frame, updating the
+    // saturated sum of the elements modified
+    template <typename F>
+    void Update(StoredFrame const &frame, F op) noexcept {
+        T *s = sum.Get();
+        SumType const maxValue = std::numeric_limits<T>::max();
+        auto const update = [&](std::size_t i, T value) {
+            op(wideSum[i], value);
+            s[i] = T((std::min)(wideSum[i], maxValue));
+        };
+        if (!frame.dense.empty()) {
+            for (std::size_t i = 0; i < frame.dense.size(); ++i) {
+                update(i, frame.dense[i]);
+            }
+            return;
+        }
+        for (std::size_t k = 0; k < frame.indices.size(); ++k) {
+            update(frame.indices[k], frame.values[k]);
+        }
+    }
+
+  public:
+    // Maximum window size for which the running sum cannot overflow
+    static constexpr std::size_t MaxWindowFrames =
+        std::size_t((std::min)(std::numeric_limits<SumType>::max() /
+                                   std::numeric_limits<T>::max(),
+                               SumType(std::numeric_limits<uint32_t>::max())));
+
+    // The histogram must be zeroed and have the dimensions of the incoming
+    // frames.
+    SlidingWindowAccumulator(Histogram<T> &&histogram,
+                             std::size_t windowFrames,
+                             std::shared_ptr<HistogramProcessor<T>> downstream)
+        : wideSum(histogram.GetNumberOfElements()), sum(std::move(histogram)),
+          nextSlot(0), storedCount(0), downstream(downstream) {
+        if (windowFrames < 1) {
+            throw std::invalid_argument("Window must be at least 1 frame");
+        }
+        if (windowFrames > MaxWindowFrames) {
+            throw std::invalid_argument("Window is too long");
+        }
+        window.resize(windowFrames);
+    }
+
+    // Upper bound on the memory used in addition to the histogram: the
+    // running sum and the stored frames (all dense, at worst)
+    static std::size_t GetStorageSize(std::size_t numElements,
+                                      std::size_t windowFrames) noexcept {
+        return numElements * (sizeof(SumType) + windowFrames * sizeof(T));
+    }
+
+    void HandleError(std::string const &message) override {
+        if (downstream) {
+            downstream->HandleError(message);
+            downstream.reset();
+        }
+    }
+
+    void HandleFrame(Histogram<T> const &histogram) override {
+        if (histogram.GetNumberOfElements() != sum.GetNumberOfElements()) {
+            abort(); // Programming error
+        }
+
+        auto &slot = window[nextSlot];
+        if (storedCount == window.size()) {
+            Update(slot, [](SumType &s, T v) { s -= v; });
+        } else {
+            ++storedCount;
+        }
+        Store(histogram, slot);
+        Update(slot, [](SumType &s, T v) { s += v; });
+        nextSlot = (nextSlot + 1) % window.size();
+
+        if (downstream) {
+            downstream->HandleFrame(sum);
+        }
+    }
+
+    void HandleFinish(Histogram<T> &&histogram,
+                      bool isCompleteFrame) override {
+        // We discard any incomplete frame from upstream
+        window.clear();
+        if (downstream) {
+            downstream->HandleFinish(std::move(sum), true);
+            downstream.reset();
+        }
+    }
+};
@@ -1,22 +1,40 @@
 #pragma once
 
+#include "AlignedAllocation.hpp"
+
+#include <algorithm>
+#include <atomic>
 #include <condition_variable>
-#include <deque>
+#include <cstddef>
 #include <exception>
 #include <memory>
 #include <mutex>
+#include <thread>
+#include <type_traits>
 #include <vector>
 
 // Fixed-capacity reusable memory to hold a bunch of photon events
 // E = event data type (plain struct or integer)
+// The memory is not initialized.
 template <typename E> class EventBuffer {
+    static_assert(std::is_trivial<E>::value, "Event type must be trivial");
+
     std::size_t const capacity;
     std::size_t size;
-    std::unique_ptr<E[]> events;
+    AllocationPolicy const policy;
+    E *const events;
 
   public:
-    explicit EventBuffer(std::size_t capacity)
-        : capacity(capacity), size(0), events(new E[capacity]) {}
+    explicit EventBuffer(std::size_t capacity,
+                         AllocationPolicy const &policy = {})
+        : capacity(capacity), size(0), policy(policy),
+          events(static_cast<E *>(
+              AllocateAligned(capacity * sizeof(E), policy))) {}
+
+    ~EventBuffer() { FreeAligned(events, capacity * sizeof(E), policy); }
+
+    EventBuffer(EventBuffer const &) = delete;
+    EventBuffer &operator=(EventBuffer const &) = delete;
 
     std::size_t GetCapacity() const noexcept { return capacity; }
 
@@ -24,24 +42,28 @@ template <typename E> class EventBuffer {
 
     void SetSize(std::size_t size) noexcept { this->size = size; }
 
-    E *GetData() noexcept { return events.get(); }
+    E *GetData() noexcept { return events; }
 
-    E const *GetData() const noexcept { return events.get(); }
+    E const *GetData() const noexcept { return events; }
 };
 
 template <typename E> class EventBufferPool {
     std::size_t const bufferSize;
+    AllocationPolicy const policy;
 
     std::mutex mutex;
     std::vector<std::unique_ptr<EventBuffer<E>>> buffers;
 
     std::unique_ptr<EventBuffer<E>> MakeBuffer() {
-        return std::make_unique<EventBuffer<E>>(bufferSize);
+        return std::make_unique<EventBuffer<E>>(bufferSize, policy);
     }
 
   public:
-    explicit EventBufferPool(std::size_t size, std::size_t initialCount = 0)
-        : bufferSize(size) {
+    // With policy.prefault, the initial buffers are faulted in here rather
+    // than when first filled.
+    explicit EventBufferPool(std::size_t size, std::size_t initialCount = 0,
+                             AllocationPolicy const &policy = {})
+        : bufferSize(size), policy(policy) {
         buffers.reserve(initialCount);
         for (std::size_t i = 0; i < initialCount; ++i) {
             buffers.emplace_back(MakeBuffer());
@@ -79,42 +101,110 @@ template <typename E> class EventBufferPool {
     }
 };
 
-// A thread-safe queue of EventBuffer<E>, with non-blocking enqueue and
-// blocking dequeue.
+// A bounded single-producer, single-consumer queue of EventBuffer<E>.
+// Buffers are handed over through a lock-free ring of pointers, so that
+// neither side takes a lock (or allocates) while the other keeps up. A
+// side that finds the ring empty (consumer) or full (producer) spins
+// briefly, then blocks until woken by the other side. Send() is only called
+// from one thread at a time, and so is ReceiveBlocking().
 template <typename E> class EventStream {
-    std::mutex mutex;
-    std::condition_variable queueNotEmptyCondition;
-    std::deque<std::shared_ptr<EventBuffer<E>>> queue;
+    using BufferPtr = std::shared_ptr<EventBuffer<E>>;
+
+    // Iterations, each yielding the CPU, before blocking
+    static unsigned const SpinCount = 64;
+
+    std::vector<BufferPtr> slots; // Size is a power of 2
+    std::size_t const indexMask;
+
+    // Free-running indices; kept on separate cache lines, as each is written
+    // by only one side
+    std::atomic<std::size_t> head{0}; // Next to receive
+    char headPadding[CacheLineSize - sizeof(std::atomic<std::size_t>)];
+    std::atomic<std::size_t> tail{0}; // Next to send
+    char tailPadding[CacheLineSize - sizeof(std::atomic<std::size_t>)];
+
+    // Written before the terminating null is published
     std::exception_ptr exception;
 
-  public:
-    // Sending a null will terminate the stream
-    void Send(std::shared_ptr<EventBuffer<E>> buffer) {
-        {
-            std::lock_guard<std::mutex> hold(mutex);
-            queue.emplace_back(buffer);
+    // Blocking, used only after spinning
+    std::mutex mutex;
+    std::condition_variable wakeCondition;
+    std::atomic<bool> consumerWaiting{false};
+    std::atomic<bool> producerWaiting{false};
+
+    static std::size_t RoundUpToPowerOf2(std::size_t n) noexcept {
+        std::size_t p = 1;
+        while (p < n) {
+            p <<= 1;
         }
-        queueNotEmptyCondition.notify_one();
+        return p;
     }
 
-    void SendException(std::exception_ptr e) {
-        {
+    template <typename F> void WaitUntil(F ready, std::atomic<bool> &waiting) {
+        for (unsigned i = 0; i < SpinCount; ++i) {
+            if (ready()) {
+                return;
+            }
+            std::this_thread::yield();
+        }
+
+        std::unique_lock<std::mutex> lock(mutex);
+        waiting.store(true);
+        // Pairs with the fence in Wake(): either we see the other side's
+        // index update, or it sees our flag.
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        while (!ready()) {
+            wakeCondition.wait(lock);
+        }
+        waiting.store(false, std::memory_order_relaxed);
+    }
+
+    void Wake(std::atomic<bool> &waiting) {
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if (waiting.load(std::memory_order_relaxed)) {
             std::lock_guard<std::mutex> hold(mutex);
-            queue.emplace_back(std::shared_ptr<EventBuffer<E>>());
-            exception = e;
+            wakeCondition.notify_all();
         }
     }
 
+  public:
+    // Send() blocks while capacity buffers are queued
+    explicit EventStream(std::size_t capacity = 1024)
+        : slots(RoundUpToPowerOf2((std::max)(capacity, std::size_t(1)))),
+          indexMask(slots.size() - 1) {}
+
+    EventStream(EventStream const &) = delete;
+    EventStream &operator=(EventStream const &) = delete;
+
+    // Sending a null will terminate the stream
+    void Send(BufferPtr buffer) {
+        std::size_t const t = tail.load(std::memory_order_relaxed);
+        WaitUntil(
+            [&] {
+                return t - head.load(std::memory_order_acquire) <
+                       slots.size();
+            },
+            producerWaiting);
+        slots[t & indexMask] = std::move(buffer);
+        tail.store(t + 1, std::memory_order_release);
+        Wake(consumerWaiting);
+    }
+
+    void SendException(std::exception_ptr e) {
+        exception = e;
+        Send({});
+    }
+
     // A null shared pointer return value indicates that the stream has been
     // terminated. Subsequent calls will block forever.
     // Throws if upstream sent an exception.
-    std::shared_ptr<EventBuffer<E>> ReceiveBlocking() {
-        std::unique_lock<std::mutex> lock(mutex);
-        while (queue.empty()) {
-            queueNotEmptyCondition.wait(lock);
-        }
-        auto ret = queue.front();
-        queue.pop_front();
+    BufferPtr ReceiveBlocking() {
+        std::size_t const h = head.load(std::memory_order_relaxed);
+        WaitUntil([&] { return tail.load(std::memory_order_acquire) != h; },
+                  consumerWaiting);
+        BufferPtr ret = std::move(slots[h & indexMask]);
+        head.store(h + 1, std::memory_order_release);
+        Wake(producerWaiting);
         if (!ret && exception) {
             std::rethrow_exception(exception);
         }
@@ -0,0 +1,321 @@
+#pragma once
+
+#include "ArrayArithmetic.hpp"
+#include "MemoryPool.hpp"
+#include "MicrotimeBinning.hpp"
+#include "MultiChannelHistogrammer.hpp"
+#include "PixelPhotonEvent.hpp"
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+// A multi-channel histogram (same layout as Histogram<T>) that may be larger
+// than memory. The histogram is divided into tiles, each holding a band of
+// consecutive lines of one channel, so that line-sequential photons keep
+// hitting the same tile. At most maxCachedTiles tiles are held in memory;
+// the least recently entered tile is spilled to a backing file when another
+// tile is needed. The backing file is only created once a tile is spilled,
+// and is deleted on destruction.
+// Not thread safe.
+template <typename T> class TiledHistogram {
+    static_assert(std::is_unsigned<T>::value, "T must be unsigned");
+
+    static std::size_t const NoSlot = std::size_t(-1);
+
+    struct Slot {
+        std::size_t tile;
+        bool dirty;
+        uint64_t lastUse;
+        std::shared_ptr<void> storage;
+
+        T *Data() const noexcept { return static_cast<T *>(storage.get()); }
+    };
+
+    MicrotimeBinning const binning;
+    std::size_t const numTimeBins;
+    std::size_t const width;
+    std::size_t const height;
+    std::size_t const numChannels;
+    std::size_t const linesPerTile;
+    std::size_t const bandsPerChannel;
+    std::size_t const tileElements;
+    std::size_t const maxCachedTiles;
+
+    MemoryPool ownPool;
+    MemoryPool &pool;
+
+    std::vector<Slot> slots;
+    std::vector<std::size_t> slotOfTile; // Indexed by tile
+    std::vector<bool> spilled;           // Tile has data in backing file
+    uint64_t useCount;
+
+    // The tile that received the previous photon
+    std::size_t currentTile;
+    T *currentData;
+
+    std::string const backingFileName;
+    std::fstream backingFile;
+
+    std::streamoff TileOffset(std::size_t tile) const noexcept {
+        return std::streamoff(tile) * std::streamoff(tileElements) *
+               std::streamoff(sizeof(T));
+    }
+
+    void ReadSpilled(std::size_t tile, std::size_t offset, T *dest,
+                     std::size_t count) {
+        backingFile.seekg(TileOffset(tile) +
+                          std::streamoff(offset * sizeof(T)));
+        backingFile.read(reinterpret_cast<char *>(dest),
+                         std::streamsize(count * sizeof(T)));
+        if (!backingFile) {
+            throw std::runtime_error("Cannot read histogram backing file");
+        }
+    }
+
+    void Spill(Slot const &slot) {
+        if (!backingFile.is_open()) {
+            backingFile.open(backingFileName, std::ios::in | std::ios::out |
+                                                  std::ios::binary |
+                                                  std::ios::trunc);
+            if (!backingFile) {
+                throw std::runtime_error(
+                    "Cannot create histogram backing file");
+            }
+        }
+        backingFile.seekp(TileOffset(slot.tile));
+        backingFile.write(reinterpret_cast<char const *>(slot.Data()),
+                          std::streamsize(tileElements * sizeof(T)));
+        if (!backingFile) {
+            throw std::runtime_error("Cannot write histogram backing file");
+        }
+        spilled[slot.tile] = true;
+    }
+
+    std::size_t AcquireSlot() {
+        if (slots.size() < maxCachedTiles) {
+            slots.push_back(
+                {NoSlot, false, 0, pool.Allocate(tileElements * sizeof(T))});
+            return slots.size() - 1;
+        }
+
+        auto victim = std::min_element(slots.begin(), slots.end(),
+                                       [](Slot const &a, Slot const &b) {
+                                           return a.lastUse < b.lastUse;
+                                       });
+        if (victim->dirty) {
+            Spill(*victim);
+        }
+        slotOfTile[victim->tile] = NoSlot;
+        return std::size_t(victim - slots.begin());
+    }
+
+    T *EnterTile(std::size_t tile) {
+        std::size_t s = slotOfTile[tile];
+        if (s == NoSlot) {
+            s = AcquireSlot();
+            Slot &slot = slots[s];
+            slot.tile = tile;
+            if (spilled[tile]) {
+                ReadSpilled(tile, 0, slot.Data(), tileElements);
+            } else {
+                std::memset(slot.Data(), 0, tileElements * sizeof(T));
+            }
+            slotOfTile[tile] = s;
+        }
+        slots[s].dirty = true;
+        slots[s].lastUse = ++useCount;
+        currentTile = tile;
+        currentData = slots[s].Data();
+        return currentData;
+    }
+
+  public:
+    // The histogram is initially zeroed. maxCachedTiles should be at least
+    // the number of channels, or else interleaved channels will thrash. Tile
+    // memory is obtained from tilePool if given.
+    TiledHistogram(MicrotimeBinning const &binning, std::size_t width,
+                   std::size_t height, std::size_t numChannels,
+                   std::size_t linesPerTile,
+                   std::size_t maxCachedTiles,
+                   std::string const &backingFileName,
+                   MemoryPool *tilePool = nullptr)
+        : binning(binning), numTimeBins(binning.GetNumberOfBins()),
+          width(width), height(height),
+          numChannels(numChannels), linesPerTile(linesPerTile),
+          bandsPerChannel(linesPerTile ? (height + linesPerTile - 1) /
+                                             linesPerTile
+                                       : 0),
+          tileElements(numTimeBins * width * linesPerTile),
+          maxCachedTiles(maxCachedTiles), pool(tilePool ? *tilePool : ownPool),
+          slotOfTile(numChannels * bandsPerChannel, std::size_t(NoSlot)),
+          spilled(numChannels * bandsPerChannel, false), useCount(0),
+          currentTile(NoSlot), currentData(nullptr),
+          backingFileName(backingFileName) {
+        if (linesPerTile < 1 || maxCachedTiles < 1) {
+            throw std::invalid_argument(
+                "Tiles must have at least 1 line, and at least 1 tile must "
+                "be cached");
+        }
+        slots.reserve(maxCachedTiles);
+    }
+
+    ~TiledHistogram() {
+        if (backingFile.is_open()) {
+            backingFile.close();
+            std::remove(backingFileName.c_str());
+        }
+    }
+
+    TiledHistogram(TiledHistogram const &) = delete;
+    TiledHistogram &operator=(TiledHistogram const &) = delete;
+
+    // Size of each tile's storage, for reserving memory
+    static std::size_t
+    GetTileStorageSize(MicrotimeBinning const &binning, std::size_t width,
+                       std::size_t linesPerTile) noexcept {
+        return std::size_t(binning.GetNumberOfBins()) * width * linesPerTile *
+               sizeof(T);
+    }
+
+    MicrotimeBinning const &GetMicrotimeBinning() const noexcept {
+        return binning;
+    }
+
+    uint32_t GetNumberOfTimeBins() const noexcept {
+        return uint32_t(numTimeBins);
+    }
+
+    std::size_t GetWidth() const noexcept { return width; }
+
+    std::size_t GetHeight() const noexcept { return height; }
+
+    std::size_t GetNumberOfChannels() const noexcept { return numChannels; }
+
+    std::size_t GetNumberOfElementsPerChannel() const noexcept {
+        return GetNumberOfTimeBins() * width * height;
+    }
+
+    std::size_t GetLinesPerTile() const noexcept { return linesPerTile; }
+
+    // True if any tile has been written to the backing file
+    bool HasSpilled() const noexcept { return backingFile.is_open(); }
+
+    // Throws std::runtime_error if the backing file cannot be accessed.
+    void Increment(std::size_t t, std::size_t x, std::size_t y,
+                   std::size_t channel = 0) {
+        auto bin = binning.GetBin(uint32_t(t));
+        if (bin == MicrotimeBinning::NotBinned) {
+            return;
+        }
+        std::size_t band = y / linesPerTile;
+        std::size_t tile = channel * bandsPerChannel + band;
+        T *data = tile == currentTile ? currentData : EnterTile(tile);
+        auto pixel = (y - band * linesPerTile) * width + x;
+        auto index = pixel * numTimeBins + bin;
+        data[index] = SaturatingAdd(data[index], T(1));
+    }
+
+    // Copy count elements of a channel's [y][x][t] data, starting at element
+    // offset, without disturbing the tile cache. This allows the histogram
+    // to be written out in chunks.
+    void Read(std::size_t channel, std::size_t offset, T *dest,
+              std::size_t count) {
+        while (count > 0) {
+            std::size_t tile =
+                channel * bandsPerChannel + offset / tileElements;
+            std::size_t within = offset % tileElements;
+            std::size_t n = (std::min)(count, tileElements - within);
+
+            std::size_t s = slotOfTile[tile];
+            if (s != NoSlot) {
+                std::memcpy(dest, slots[s].Data() + within, n * sizeof(T));
+            } else if (spilled[tile]) {
+                ReadSpilled(tile, within, dest, n);
+            } else {
+                std::memset(dest, 0, n * sizeof(T));
+            }
+
+            offset += n;
+            dest += n;
+            count -= n;
+        }
+    }
+};
+
+// Receiver of a tiled histogram at the end of acquisition
+template <typename T> class TiledHistogramProcessor {
+  public:
+    virtual ~TiledHistogramProcessor() = default;
+
+    virtual void HandleError(std::string const &message) = 0;
+
+    // The histogram includes any incomplete last frame (which cannot be
+    // removed without keeping a per-frame histogram).
+    virtual void HandleFinish(std::shared_ptr<TiledHistogram<T>> histogram,
+                              bool isCompleteFrame) = 0;
+};
+
+// Collect pixel-assigned photon events of all frames directly into a
+// cumulative tiled histogram, routing as MultiChannelHistogrammer does.
+template <typename T>
+class TiledHistogrammer : public PixelPhotonProcessor {
+    std::shared_ptr<TiledHistogram<T>> histogram;
+    RouteChannelTable const routeTable;
+    bool frameInProgress;
+
+    std::shared_ptr<TiledHistogramProcessor<T>> downstream;
+
+  public:
+    TiledHistogrammer(std::shared_ptr<TiledHistogram<T>> histogram,
+                      RouteChannelTable const &routeTable,
+                      std::shared_ptr<TiledHistogramProcessor<T>> downstream)
+        : histogram(histogram), routeTable(routeTable),
+          frameInProgress(false), downstream(downstream) {
+        CheckRouteChannelTable(routeTable,
+                               this->histogram->GetNumberOfChannels());
+    }
+
+    void HandleBeginFrame() override { frameInProgress = true; }
+
+    void HandleEndFrame() override { frameInProgress = false; }
+
+    void HandlePixelPhoton(PixelPhotonEvent const &event) override {
+        if (!downstream || event.route >= routeTable.size()) {
+            return;
+        }
+        auto channel = routeTable[event.route];
+        if (channel == RouteNotHistogrammed) {
+            return;
+        }
+        try {
+            histogram->Increment(event.microtime, event.x, event.y, channel);
+        } catch (std::exception const &e) {
+            HandleError(e.what());
+        }
+    }
+
+    void HandleError(std::string const &message) override {
+        histogram.reset();
+        if (downstream) {
+            downstream->HandleError(message);
+            downstream.reset();
+        }
+    }
+
+    void HandleFinish() override {
+        if (downstream) {
+            downstream->HandleFinish(std::move(histogram), !frameInProgress);
+            downstream.reset();
+        }
+    }
+};
@@ -0,0 +1,60 @@
+#include "FLIMEvents/AlignedAllocation.hpp"
+#include "FLIMEvents/MemoryPool.hpp"
+#include "FLIMEvents/StreamBuffer.hpp"
+#include <catch2/catch.hpp>
+
+#include <cstdint>
+#include <cstring>
+
+TEST_CASE("Aligned allocation", "[AlignedAllocation]") {
+    auto hugePages = GENERATE(HugePages::None, HugePages::Transparent,
+                              HugePages::Explicit);
+    auto size = GENERATE(std::size_t(100), HugePageSize + 100);
+    AllocationPolicy policy;
+    policy.alignment = PageSize;
+    policy.hugePages = hugePages;
+    policy.prefault = true;
+
+    void *ptr = AllocateAligned(size, policy);
+    REQUIRE(ptr != nullptr);
+    REQUIRE(reinterpret_cast<std::uintptr_t>(ptr) % PageSize == 0);
+    std::memset(ptr, 0xff, size); // Whole block is usable
+    FreeAligned(ptr, size, policy);
+}
+
+TEST_CASE("Zero-size allocation", "[AlignedAllocation]") {
+    AllocationPolicy policy;
+    REQUIRE(AllocateAligned(0, policy) == nullptr);
+    FreeAligned(nullptr, 0, policy);
+}
+
+TEST_CASE("Event buffers are aligned", "[AlignedAllocation]") {
+    AllocationPolicy policy;
+    policy.prefault = true;
+    EventBufferPool<uint32_t> pool(1000, 2, policy);
+    auto buffer = pool.CheckOut();
+    REQUIRE(buffer->GetCapacity() == 1000);
+    REQUIRE(reinterpret_cast<std::uintptr_t>(buffer->GetData()) %
+                CacheLineSize ==
+            0);
+}
+
+TEST_CASE("Changing pool policy frees blocks", "[AlignedAllocation]") {
+    MemoryPool pool;
+    auto held = pool.Allocate(1000);
+    REQUIRE(pool.Reserve({2000}));
+    REQUIRE(pool.GetFreeBytes() == 2000);
+
+    AllocationPolicy policy;
+    policy.alignment = PageSize;
+    pool.SetPolicy(policy);
+    REQUIRE(pool.GetFreeBytes() == 0);
+
+    // Block allocated under the old policy is not returned to the pool
+    held.reset();
+    REQUIRE(pool.GetFreeBytes() == 0);
+    REQUIRE(pool.GetInUseBytes() == 0);
+
+    auto block = pool.Allocate(1000);
+    REQUIRE(reinterpret_cast<std::uintptr_t>(block.get()) % PageSize == 0);
+}
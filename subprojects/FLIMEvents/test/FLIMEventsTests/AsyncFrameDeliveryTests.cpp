@@ -0,0 +1,107 @@
+#include "FLIMEvents/AsyncFrameDelivery.hpp"
+#include "TestHelpers.hpp"
+#include <catch2/catch.hpp>
+
+#include <future>
+#include <vector>
+
+namespace {
+// Frames block until the gate is opened. (Catch assertions are not thread
+// safe, so none are made here.)
+class GatedHistogramProcessor : public MockHistogramProcessor<uint16_t> {
+    std::shared_future<void> gate;
+
+  public:
+    std::promise<void> firstFrameReceived;
+
+    explicit GatedHistogramProcessor(std::shared_future<void> gate)
+        : gate(gate) {}
+
+    void HandleFrame(Histogram<uint16_t> const &histogram) override {
+        if (frames.empty()) {
+            firstFrameReceived.set_value();
+        }
+        MockHistogramProcessor<uint16_t>::HandleFrame(histogram);
+        gate.wait();
+    }
+};
+
+Histogram<uint16_t> MakeFrame(uint16_t value) {
+    Histogram<uint16_t> h(0, 0, false, 1, 1);
+    h.Get()[0] = value;
+    return h;
+}
+} // namespace
+
+TEST_CASE("Blocking delivery delivers all frames in order",
+          "[AsyncFrameDelivery]") {
+    std::promise<void> gate;
+    auto output = std::make_shared<GatedHistogramProcessor>(
+        gate.get_future().share());
+    {
+        AsyncHistogramProcessor<uint16_t> async(output, 2);
+        // Delivery of frame 0 proceeds once the producer blocks
+        auto opener = std::async(std::launch::async, [&] {
+            output->firstFrameReceived.get_future().wait();
+            gate.set_value();
+        });
+        for (uint16_t i = 0; i < 10; ++i) {
+            async.HandleFrame(MakeFrame(i));
+        }
+        async.HandleFinish(MakeFrame(999), true);
+        opener.wait();
+        REQUIRE(async.GetDroppedFrameCount() == 0);
+    } // Joins the delivery thread
+
+    REQUIRE(output->frames ==
+            std::vector<std::vector<uint16_t>>{
+                {0}, {1}, {2}, {3}, {4}, {5}, {6}, {7}, {8}, {9}});
+    REQUIRE(output->finishes == std::vector<std::vector<uint16_t>>{{999}});
+    REQUIRE(output->finishCompleteness == std::vector<bool>{true});
+    REQUIRE(output->errors.empty());
+}
+
+TEST_CASE("Latest-wins delivery never blocks", "[AsyncFrameDelivery]") {
+    std::promise<void> gate;
+    auto output = std::make_shared<GatedHistogramProcessor>(
+        gate.get_future().share());
+    std::size_t dropped;
+    {
+        AsyncHistogramProcessor<uint16_t> async(
+            output, 2, SlowConsumerPolicy::LatestWins);
+        async.HandleFrame(MakeFrame(0));
+        output->firstFrameReceived.get_future().wait();
+        // Frame 0 is being delivered; the other buffer is recycled
+        for (uint16_t i = 1; i < 10; ++i) {
+            async.HandleFrame(MakeFrame(i));
+        }
+        dropped = async.GetDroppedFrameCount();
+        async.HandleFinish(MakeFrame(999), true);
+        gate.set_value();
+    }
+
+    REQUIRE(output->frames == std::vector<std::vector<uint16_t>>{{0}, {9}});
+    REQUIRE(dropped == 8);
+    REQUIRE(output->finishes == std::vector<std::vector<uint16_t>>{{999}});
+    REQUIRE(output->finishCompleteness == std::vector<bool>{true});
+}
+
+TEST_CASE("Error discards pending frames", "[AsyncFrameDelivery]") {
+    std::promise<void> gate;
+    auto output = std::make_shared<GatedHistogramProcessor>(
+        gate.get_future().share());
+    {
+        AsyncHistogramProcessor<uint16_t> async(output, 3);
+        async.HandleFrame(MakeFrame(0));
+        output->firstFrameReceived.get_future().wait();
+        async.HandleFrame(MakeFrame(1));
+        async.HandleFrame(MakeFrame(2));
+        async.HandleError("test");
+        async.HandleFinish(MakeFrame(999), true); // Ignored
+        gate.set_value();
+    }
+
+    REQUIRE(output->frames == std::vector<std::vector<uint16_t>>{{0}});
+    REQUIRE(output->errors == std::vector<std::string>{"test"});
+    REQUIRE(output->finishes.empty());
+}
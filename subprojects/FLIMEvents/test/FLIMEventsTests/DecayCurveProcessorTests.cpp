@@ -0,0 +1,92 @@
+#include "FLIMEvents/DecayCurveProcessor.hpp"
+#include "TestHelpers.hpp"
+#include <catch2/catch.hpp>
+
+#include <vector>
+
+namespace {
+class MockGlobalDecayProcessor : public GlobalDecayProcessor {
+  public:
+    std::vector<GlobalDecay> frames;
+    std::vector<GlobalDecay> finishes;
+    std::vector<std::string> errors;
+
+    void HandleError(std::string const &message) override {
+        errors.push_back(message);
+    }
+
+    void HandleFrame(GlobalDecay const &decay) override {
+        frames.push_back(decay);
+    }
+
+    void HandleFinish(GlobalDecay &&decay, bool isCompleteFrame) override {
+        finishes.emplace_back(std::move(decay));
+    }
+};
+
+class MockDecodedEventProcessor : public DecodedEventProcessor {
+  public:
+    std::size_t validPhotons = 0;
+    std::size_t dataLost = 0;
+    bool finished = false;
+
+    void HandleTimestamp(DecodedEvent const &event) override {}
+    void HandleValidPhoton(ValidPhotonEvent const &event) override {
+        ++validPhotons;
+    }
+    void HandleInvalidPhoton(InvalidPhotonEvent const &event) override {}
+    void HandleMarker(MarkerEvent const &event) override {}
+    void HandleDataLost(DataLostEvent const &event) override { ++dataLost; }
+    void HandleError(std::string const &message) override {}
+    void HandleFinish() override { finished = true; }
+};
+
+} // namespace
+
+TEST_CASE("Decay curves are accumulated per channel",
+          "[DecayCurveProcessor]") {
+    std::bitset<16> mask;
+    mask.set(1);
+    mask.set(3);
+    auto output = std::make_shared<MockGlobalDecayProcessor>();
+    auto downstream = std::make_shared<MockDecodedEventProcessor>();
+    DecayCurveProcessor proc(mask, 2, false, 1000000, output, downstream);
+
+    proc.HandleValidPhoton(MakeValidPhoton(0, 1, 1));
+    proc.HandleValidPhoton(MakeValidPhoton(1, 1, 1));
+    proc.HandleValidPhoton(MakeValidPhoton(2, 6, 3)); // High bits masked
+    proc.HandleValidPhoton(MakeValidPhoton(3, 0, 2)); // Disabled route
+    proc.HandleDataLost(DataLostEvent{});
+    proc.HandleFinish();
+
+    REQUIRE(output->errors.empty());
+    REQUIRE(output->frames.empty());
+    REQUIRE(output->finishes.size() == 1);
+    auto const &decay = output->finishes[0];
+    REQUIRE(decay.numChannels == 2);
+    REQUIRE(decay.numTimeBins == 4);
+    REQUIRE(decay.counts == std::vector<uint32_t>{0, 2, 0, 0, 0, 0, 1, 0});
+
+    REQUIRE(downstream->validPhotons == 4);
+    REQUIRE(downstream->dataLost == 1);
+    REQUIRE(downstream->finished);
+}
+
+TEST_CASE("Decay curve updates and reversed time", "[DecayCurveProcessor]") {
+    auto output = std::make_shared<MockGlobalDecayProcessor>();
+    DecayCurveProcessor proc(std::bitset<16>(1), 2, true, 100, output,
+                             nullptr);
+
+    proc.HandleValidPhoton(MakeValidPhoton(1000));
+    proc.HandleTimestamp(DecodedEvent{1099});
+    REQUIRE(output->frames.empty());
+    proc.HandleTimestamp(DecodedEvent{1100});
+    REQUIRE(output->frames.size() == 1);
+    REQUIRE(output->frames[0].counts == std::vector<uint32_t>{0, 0, 0, 1});
+    proc.HandleValidPhoton(MakeValidPhoton(1150, 3));
+    MarkerEvent marker{};
+    marker.macrotime = 1200;
+    proc.HandleMarker(marker);
+    REQUIRE(output->frames.size() == 2);
+    REQUIRE(output->frames[1].counts == std::vector<uint32_t>{1, 0, 0, 1});
+}
@@ -0,0 +1,47 @@
+#include "FLIMEvents/GatedIntensityCounter.hpp"
+#include "TestHelpers.hpp"
+#include <catch2/catch.hpp>
+
+#include <vector>
+
+TEST_CASE("Photons are counted per gate", "[GatedIntensityCounter]") {
+    std::bitset<16> mask;
+    mask.set(0);
+    mask.set(2);
+    std::vector<TimeGate> const gates{{8, 16}, {0, 4}};
+
+    auto output = std::make_shared<MockHistogramProcessor<uint32_t>>();
+    GatedIntensityCounter counter(Histogram<uint32_t>(0, 0, false, 2, 1, 2),
+                                  gates, 4, mask, output);
+
+    counter.HandleBeginFrame();
+    counter.HandlePixelPhoton(MakePixelPhoton(0, 0, 15));   // Gate 0
+    counter.HandlePixelPhoton(MakePixelPhoton(1, 0, 8, 2)); // Gate 0
+    counter.HandlePixelPhoton(MakePixelPhoton(1, 0, 3, 2)); // Gate 1
+    counter.HandlePixelPhoton(MakePixelPhoton(1, 0, 4));    // Between gates
+    counter.HandlePixelPhoton(MakePixelPhoton(1, 0, 20));   // Out of range
+    counter.HandlePixelPhoton(MakePixelPhoton(1, 0, 0, 1)); // Disabled route
+    counter.HandleEndFrame();
+
+    counter.HandleBeginFrame();
+    counter.HandlePixelPhoton(MakePixelPhoton(0, 0));
+    counter.HandleEndFrame();
+    counter.HandleFinish();
+
+    REQUIRE(output->frames.size() == 2);
+    REQUIRE(output->frames[0] == std::vector<uint32_t>{1, 1, 0, 1});
+    REQUIRE(output->frames[1] == std::vector<uint32_t>{0, 0, 1, 0});
+    REQUIRE(output->finishCompleteness == std::vector<bool>{true});
+}
+
+TEST_CASE("Invalid gates are rejected", "[GatedIntensityCounter]") {
+    auto makeCounter = [](std::vector<TimeGate> const &gates) {
+        GatedIntensityCounter counter(
+            Histogram<uint32_t>(0, 0, false, 2, 1, gates.size()), gates, 4,
+            std::bitset<16>(1), nullptr);
+    };
+    REQUIRE_NOTHROW(makeCounter({{0, 8}, {8, 16}}));
+    REQUIRE_THROWS_AS(makeCounter({{0, 9}, {8, 16}}), std::invalid_argument);
+    REQUIRE_THROWS_AS(makeCounter({{4, 4}}), std::invalid_argument);
+    REQUIRE_THROWS_AS(makeCounter({{0, 17}}), std::invalid_argument);
+}
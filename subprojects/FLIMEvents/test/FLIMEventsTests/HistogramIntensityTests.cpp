@@ -0,0 +1,128 @@
+#include "FLIMEvents/HistogramIntensity.hpp"
+#include "FLIMEvents/IntensityCounter.hpp"
+#include "FLIMEvents/MultiChannelHistogrammer.hpp"
+#include "TestHelpers.hpp"
+#include <catch2/catch.hpp>
+
+#include <utility>
+#include <vector>
+
+TEST_CASE("Sum over time bins and channels", "[HistogramIntensity]") {
+    // 12-bit histogram so that the vectorized sum has a remainder
+    Histogram<uint16_t> hist(12, 12, false, 2, 1, 3);
+    hist.Clear();
+    for (unsigned t = 0; t < 4096; t += 3) {
+        hist.Increment(t, 0, 0, 0);
+        hist.Increment(t, 1, 0, 2);
+    }
+    hist.Increment(4095, 1, 0, 1);
+
+    Histogram<uint16_t> intensity(0, 12, false, 2, 1);
+    ReduceHistogramToIntensity(hist, intensity);
+    REQUIRE(intensity.Get()[0] == 1366);
+    REQUIRE(intensity.Get()[1] == 1367);
+}
+
+TEST_CASE("Sums exceeding 32 bits", "[ArrayArithmetic]") {
+    // Each partial sum exceeds 2^31; odd length for a scalar remainder
+    std::size_t const n = (std::size_t(1) << 25) + 3;
+    std::vector<uint8_t> bytes(n, 255);
+    REQUIRE(SumArray(bytes.data(), n) == uint64_t(255) * n);
+
+    std::vector<uint16_t> words(n, 65535);
+    REQUIRE(SumArray(words.data(), n) == uint64_t(65535) * n);
+}
+
+TEST_CASE("Intensity saturates", "[HistogramIntensity]") {
+    Histogram<uint16_t> hist(4, 12, false, 1, 1);
+    hist.Clear();
+    for (unsigned i = 0; i < 16; ++i) {
+        hist.Get()[i] = 60000;
+    }
+
+    Histogram<uint16_t> intensity16(0, 12, false, 1, 1);
+    ReduceHistogramToIntensity(hist, intensity16);
+    REQUIRE(intensity16.Get()[0] == 65535);
+
+    Histogram<uint32_t> intensity32(0, 12, false, 1, 1);
+    ReduceHistogramToIntensity(hist, intensity32);
+    REQUIRE(intensity32.Get()[0] == 960000);
+}
+
+TEST_CASE("Reducer forwards histograms and intensity",
+          "[HistogramIntensity]") {
+    auto histOut = std::make_shared<MockHistogramProcessor<uint8_t>>();
+    auto intensityOut = std::make_shared<MockHistogramProcessor<uint16_t>>();
+    HistogramIntensityReducer<uint8_t, uint16_t> reducer(
+        Histogram<uint16_t>(0, 12, false, 2, 1), histOut, intensityOut);
+
+    Histogram<uint8_t> hist(8, 12, false, 2, 1);
+    hist.Clear();
+    for (unsigned i = 0; i < 300; ++i) {
+        hist.Increment(i * 13 % 4096, 1, 0);
+    }
+    reducer.HandleFrame(hist);
+    REQUIRE(histOut->frames.size() == 1);
+    REQUIRE(histOut->frames[0].size() == 512);
+    REQUIRE(intensityOut->frames.size() == 1);
+    REQUIRE(intensityOut->frames[0] == std::vector<uint16_t>{0, 300});
+
+    reducer.HandleFinish(std::move(hist), false);
+    REQUIRE(histOut->finishCompleteness == std::vector<bool>{false});
+    REQUIRE(intensityOut->finishCompleteness == std::vector<bool>{false});
+}
+
+namespace {
+// Intensity of one frame as derived from the histogram (as DataStream does
+// when IntensityFromHistograms is on) and as counted separately
+std::pair<std::vector<uint32_t>, std::vector<uint32_t>>
+DerivedAndCountedIntensity(uint32_t windowStart, uint32_t windowEnd) {
+    std::bitset<16> mask;
+    mask.set(0);
+    mask.set(1);
+
+    auto derived = std::make_shared<MockHistogramProcessor<uint32_t>>();
+    MultiChannelHistogrammer<uint16_t> histogrammer(
+        Histogram<uint16_t>(MicrotimeBinning(12, windowStart, windowEnd, 4,
+                                             false),
+                            2, 1, 2),
+        MakeDenseRouteChannelTable(mask),
+        std::make_shared<HistogramIntensityReducer<uint16_t, uint32_t>>(
+            Histogram<uint32_t>(0, 12, false, 2, 1),
+            std::make_shared<MockHistogramProcessor<uint16_t>>(), derived));
+
+    auto counted = std::make_shared<MockHistogramProcessor<uint32_t>>();
+    IntensityCounter counter(Histogram<uint32_t>(0, 0, false, 2, 1), mask,
+                             counted);
+
+    histogrammer.HandleBeginFrame();
+    counter.HandleBeginFrame();
+    for (uint16_t t = 0; t < 4096; t += 64) {
+        auto const p0 = MakePixelPhoton(0, 0, t);
+        auto const p1 = MakePixelPhoton(1, 0, uint16_t(4095 - t), 1);
+        histogrammer.HandlePixelPhoton(p0);
+        histogrammer.HandlePixelPhoton(p1);
+        counter.HandlePixelPhoton(p0);
+        counter.HandlePixelPhoton(p1);
+    }
+    histogrammer.HandleEndFrame();
+    counter.HandleEndFrame();
+
+    REQUIRE(derived->frames.size() == 1);
+    REQUIRE(counted->frames.size() == 1);
+    return {derived->frames[0], counted->frames[0]};
+}
+} // namespace
+
+TEST_CASE("Derived intensity matches counted intensity only for full window",
+          "[HistogramIntensity]") {
+    auto const full = DerivedAndCountedIntensity(0, 4096);
+    REQUIRE(full.second == std::vector<uint32_t>{64, 64});
+    REQUIRE(full.first == full.second);
+
+    // Photons outside the window are not histogrammed, so the intensity
+    // must then be counted separately
+    auto const partial = DerivedAndCountedIntensity(1024, 2048);
+    REQUIRE(partial.second == std::vector<uint32_t>{64, 64});
+    REQUIRE(partial.first == std::vector<uint32_t>{16, 16});
+}
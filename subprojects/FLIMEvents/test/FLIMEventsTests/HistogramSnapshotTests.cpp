@@ -0,0 +1,200 @@
+#include "FLIMEvents/AsyncFrameDelivery.hpp"
+#include "FLIMEvents/HistogramSnapshot.hpp"
+#include <catch2/catch.hpp>
+
+#include <condition_variable>
+#include <mutex>
+#include <vector>
+
+TEST_CASE("Is zero array", "[ArrayArithmetic]") {
+    // Long enough to exercise both vector and scalar paths
+    std::size_t const n = GENERATE(1, 31, 32, 70);
+    std::size_t const nonzeroAt = GENERATE(0, 15, 31, 69);
+    std::vector<uint16_t> a(n, 0);
+    REQUIRE(IsZeroArray(a.data(), n));
+    if (nonzeroAt < n) {
+        a[nonzeroAt] = 256; // Only the high byte is set
+        REQUIRE_FALSE(IsZeroArray(a.data(), n));
+    }
+}
+
+TEST_CASE("Snapshot is unaffected by later frames", "[CowHistogram]") {
+    MicrotimeBinning const binning(1, 1, false);
+    // 2 x 5 x 2 = 20 elements in tiles of 8: the last tile is short
+    CowHistogram<uint16_t> cumul(binning, 5, 1, 2, 8);
+
+    Histogram<uint16_t> frame(binning, 5, 1, 2);
+    frame.Clear();
+    frame.Get()[3] = 7;
+    frame.Get()[19] = 1;
+
+    cumul += frame;
+    auto snap = cumul.Snapshot();
+    REQUIRE(snap.IsValid());
+    REQUIRE(snap.GetNumberOfTiles() == 3);
+    REQUIRE(snap.GetTileSize(0) == 8);
+    REQUIRE(snap.GetTileSize(2) == 4);
+    REQUIRE(snap.Get(3) == 7);
+    REQUIRE(snap.Get(19) == 1);
+
+    cumul += frame;
+    REQUIRE(snap.Get(3) == 7);
+    REQUIRE(snap.Get(19) == 1);
+    REQUIRE(cumul.Snapshot().Get(3) == 14);
+    REQUIRE(cumul.Snapshot().Get(19) == 2);
+
+    std::vector<uint16_t> copy(20);
+    snap.CopyTo(copy.data());
+    REQUIRE(copy[3] == 7);
+    REQUIRE(copy[19] == 1);
+    REQUIRE(copy[0] == 0);
+}
+
+TEST_CASE("Only modified shared tiles are copied", "[CowHistogram]") {
+    MicrotimeBinning const binning(1, 1, false);
+    CowHistogram<uint16_t> cumul(binning, 8, 4, 1, 8); // 8 tiles
+
+    Histogram<uint16_t> frame(binning, 8, 4);
+    frame.Clear();
+    frame.Get()[9] = 1; // Tile 1
+
+    // No snapshot held: modified in place
+    cumul += frame;
+    REQUIRE(cumul.GetTileCopyCount() == 0);
+
+    {
+        auto snap = cumul.Snapshot();
+        cumul += frame;
+        REQUIRE(cumul.GetTileCopyCount() == 1);
+        cumul += frame; // Now exclusively owned
+        REQUIRE(cumul.GetTileCopyCount() == 1);
+
+        auto later = cumul.Snapshot();
+        REQUIRE(later.GetTile(0) == snap.GetTile(0));
+        REQUIRE(later.GetTile(1) != snap.GetTile(1));
+        REQUIRE(later.GetTile(3) == snap.GetTile(3));
+    }
+
+    // Snapshots released: modified in place again
+    cumul += frame;
+    REQUIRE(cumul.GetTileCopyCount() == 1);
+    REQUIRE(cumul.Snapshot().Get(9) == 4);
+}
+
+TEST_CASE("Tiles may come from pool", "[CowHistogram]") {
+    MemoryPool pool;
+    MicrotimeBinning const binning(1, 1, false);
+    CowHistogram<uint32_t> cumul(binning, 4, 4, 1, 4, &pool);
+
+    Histogram<uint32_t> frame(binning, 4, 4);
+    frame.Clear();
+    frame.Get()[0] = 0xffffffffu;
+
+    cumul += frame;
+    auto snap = cumul.Snapshot();
+    cumul += frame; // Saturates
+    REQUIRE(snap.Get(0) == 0xffffffffu);
+    REQUIRE(cumul.Snapshot().Get(0) == 0xffffffffu);
+    REQUIRE(cumul.GetTileCopyCount() == 1);
+}
+
+namespace {
+
+class MockSnapshotProcessor : public HistogramSnapshotProcessor<uint16_t> {
+  public:
+    std::vector<HistogramSnapshot<uint16_t>> frames;
+    HistogramSnapshot<uint16_t> last;
+    bool finished = false;
+    bool errored = false;
+
+    void HandleError(std::string const &) override { errored = true; }
+
+    void HandleFrame(HistogramSnapshot<uint16_t> const &snapshot) override {
+        frames.push_back(snapshot);
+    }
+
+    void HandleFinish(HistogramSnapshot<uint16_t> &&snapshot,
+                      bool isCompleteFrame) override {
+        last = std::move(snapshot);
+        finished = isCompleteFrame;
+    }
+};
+
+// Counts delivered snapshots without keeping them; each delivery waits to
+// be allowed.
+class GatedSnapshotProcessor : public HistogramSnapshotProcessor<uint16_t> {
+    std::mutex mutex;
+    std::condition_variable changed;
+    std::size_t allowed = 0;
+    std::size_t count = 0;
+
+  public:
+    void HandleError(std::string const &) override {}
+
+    void HandleFrame(HistogramSnapshot<uint16_t> const &) override {
+        std::unique_lock<std::mutex> lock(mutex);
+        changed.wait(lock, [&] { return count < allowed; });
+        ++count;
+        changed.notify_all();
+    }
+
+    void HandleFinish(HistogramSnapshot<uint16_t> &&, bool) override {}
+
+    void AllowAndWait(std::size_t n) {
+        std::unique_lock<std::mutex> lock(mutex);
+        allowed += n;
+        changed.notify_all();
+        changed.wait(lock, [&] { return count == allowed; });
+    }
+};
+
+} // namespace
+
+TEST_CASE("Delivered snapshots do not hold tiles", "[CowHistogram]") {
+    MicrotimeBinning const binning(1, 1, false);
+    CowHistogram<uint16_t> cumul(binning, 8, 4, 1, 8);
+
+    Histogram<uint16_t> frame(binning, 8, 4);
+    frame.Clear();
+    frame.Get()[9] = 1;
+
+    auto consumer = std::make_shared<GatedSnapshotProcessor>();
+    {
+        AsyncFrameDelivery<HistogramSnapshot<uint16_t>,
+                           HistogramSnapshotProcessor<uint16_t>>
+            delivery(consumer, 2);
+        for (int i = 0; i < 10; ++i) {
+            cumul += frame;
+            delivery.HandleFrame(cumul.Snapshot());
+            // Queued in the other buffer, so that the frame's buffer is
+            // recycled (not overwritten) when the consumer is done
+            delivery.HandleFrame(HistogramSnapshot<uint16_t>());
+            consumer->AllowAndWait(2);
+        }
+        delivery.HandleFinish(HistogramSnapshot<uint16_t>(), true);
+    }
+    REQUIRE(cumul.GetTileCopyCount() == 0);
+}
+
+TEST_CASE("Snapshot accumulator", "[SnapshotHistogramAccumulator]") {
+    MicrotimeBinning const binning(1, 1, false);
+    auto mock = std::make_shared<MockSnapshotProcessor>();
+    SnapshotHistogramAccumulator<uint16_t> acc(
+        CowHistogram<uint16_t>(binning, 2, 1), mock);
+
+    Histogram<uint16_t> frame(binning, 2, 1);
+    frame.Clear();
+    frame.Get()[1] = 3;
+
+    acc.HandleFrame(frame);
+    acc.HandleFrame(frame);
+    acc.HandleFinish(std::move(frame), false);
+
+    REQUIRE(mock->frames.size() == 2);
+    // Earlier frames were kept without being overwritten
+    REQUIRE(mock->frames[0].Get(1) == 3);
+    REQUIRE(mock->frames[1].Get(1) == 6);
+    REQUIRE(mock->finished);
+    REQUIRE(mock->last.Get(1) == 6);
+    REQUIRE_FALSE(mock->errored);
+}
@@ -0,0 +1,131 @@
+#include "FLIMEvents/HistogramStatistics.hpp"
+#include "TestHelpers.hpp"
+#include "FLIMEvents/MultiChannelHistogrammer.hpp"
+#include "FLIMEvents/ParallelHistogrammer.hpp"
+#include <catch2/catch.hpp>
+
+#include <vector>
+
+namespace {
+class MockHistogramStatisticsProcessor : public HistogramStatisticsProcessor {
+  public:
+    std::vector<HistogramStatistics> frames;
+    std::vector<HistogramStatistics> cumulatives;
+    std::vector<HistogramStatistics> finishes;
+
+    void HandleError(std::string const &message) override {}
+
+    void HandleFrame(HistogramStatistics const &frame,
+                     HistogramStatistics const &cumulative) override {
+        frames.push_back(frame);
+        cumulatives.push_back(cumulative);
+    }
+
+    void HandleFinish(HistogramStatistics const &cumulative) override {
+        finishes.push_back(cumulative);
+    }
+};
+
+// 4-bit microtimes, window [0, 8) in 2 bins; 2x2 pixels
+Histogram<uint16_t> MakeHistogram(std::size_t channels) {
+    return Histogram<uint16_t>(MicrotimeBinning(4, 0, 8, 2, false), 2, 2,
+                               channels);
+}
+
+void FeedFrames(PixelPhotonProcessor &proc) {
+    // Frame 0
+    proc.HandleBeginFrame();
+    proc.HandlePixelPhoton(MakePixelPhoton(0, 0, 1));
+    proc.HandlePixelPhoton(MakePixelPhoton(0, 0, 5));
+    proc.HandlePixelPhoton(MakePixelPhoton(1, 1, 1));
+    proc.HandlePixelPhoton(MakePixelPhoton(1, 1, 9)); // Outside window
+    proc.HandlePixelPhoton(MakePixelPhoton(1, 0, 1, 1));
+    proc.HandleEndFrame();
+    // Frame 1
+    proc.HandleBeginFrame();
+    proc.HandlePixelPhoton(MakePixelPhoton(0, 1, 1));
+    proc.HandleEndFrame();
+    // Incomplete frame, not in cumulative statistics
+    proc.HandleBeginFrame();
+    proc.HandlePixelPhoton(MakePixelPhoton(1, 0, 1));
+    proc.HandleFinish();
+}
+
+void CheckStatistics(MockHistogramStatisticsProcessor const &stats) {
+    REQUIRE(stats.frames.size() == 2);
+    REQUIRE(stats.finishes.size() == 1);
+
+    auto const &f0 = stats.frames[0];
+    REQUIRE(f0.numPixels == 4);
+    REQUIRE(f0.channels.size() == 2);
+    REQUIRE(f0.channels[0].totalPhotons == 3);
+    REQUIRE(f0.channels[0].maxPixelPhotons == 2);
+    REQUIRE(f0.channels[0].emptyPixels == 2);
+    REQUIRE(f0.GetEmptyPixelFraction(0) == Approx(0.5));
+    REQUIRE(f0.channels[0].saturatedBins == 0);
+    REQUIRE(f0.channels[1].totalPhotons == 1);
+    REQUIRE(f0.channels[1].emptyPixels == 3);
+
+    auto const &f1 = stats.frames[1];
+    REQUIRE(f1.channels[0].totalPhotons == 1);
+    REQUIRE(f1.channels[0].maxPixelPhotons == 1);
+    REQUIRE(f1.channels[0].emptyPixels == 3);
+    REQUIRE(f1.channels[1].totalPhotons == 0);
+    REQUIRE(f1.channels[1].emptyPixels == 4);
+
+    auto const &cum = stats.finishes[0];
+    REQUIRE(cum.channels[0].totalPhotons == 4);
+    REQUIRE(cum.channels[0].maxPixelPhotons == 2);
+    REQUIRE(cum.channels[0].emptyPixels == 1);
+    REQUIRE(cum.channels[1].totalPhotons == 1);
+    REQUIRE(cum.channels[1].emptyPixels == 3);
+}
+} // namespace
+
+TEST_CASE("Histogrammer maintains statistics", "[HistogramStatistics]") {
+    std::bitset<16> mask;
+    mask.set(0);
+    mask.set(1);
+    auto stats = std::make_shared<MockHistogramStatisticsProcessor>();
+    MultiChannelHistogrammer<uint16_t> histogrammer(
+        MakeHistogram(2), MakeDenseRouteChannelTable(mask), nullptr, stats);
+    FeedFrames(histogrammer);
+    CheckStatistics(*stats);
+}
+
+TEST_CASE("Parallel histogrammer maintains statistics",
+          "[HistogramStatistics]") {
+    std::bitset<16> mask;
+    mask.set(0);
+    mask.set(1);
+    std::vector<Histogram<uint16_t>> histograms;
+    for (int i = 0; i < 3; ++i) {
+        histograms.emplace_back(MakeHistogram(2));
+    }
+    auto stats = std::make_shared<MockHistogramStatisticsProcessor>();
+    ParallelHistogrammer<uint16_t> histogrammer(
+        std::move(histograms), MakeDenseRouteChannelTable(mask), nullptr, 1,
+        stats);
+    FeedFrames(histogrammer);
+    CheckStatistics(*stats);
+}
+
+TEST_CASE("Saturated bins are counted", "[HistogramStatistics]") {
+    auto stats = std::make_shared<MockHistogramStatisticsProcessor>();
+    MultiChannelHistogrammer<uint16_t> histogrammer(
+        MakeHistogram(1), MakeDenseRouteChannelTable(1), nullptr, stats);
+
+    for (int f = 0; f < 2; ++f) {
+        histogrammer.HandleBeginFrame();
+        for (int i = 0; i < 70000; ++i) {
+            histogrammer.HandlePixelPhoton(MakePixelPhoton(1, 0, 1));
+        }
+        histogrammer.HandlePixelPhoton(MakePixelPhoton(1, 0, 5));
+        histogrammer.HandleEndFrame();
+    }
+    REQUIRE(stats->frames.size() == 2);
+    REQUIRE(stats->frames[1].channels[0].saturatedBins == 1);
+    REQUIRE(stats->frames[1].channels[0].maxPixelPhotons == 70001);
+    REQUIRE(stats->cumulatives[1].channels[0].saturatedBins == 2);
+    REQUIRE(stats->cumulatives[1].channels[0].maxPixelPhotons == 140002);
+}
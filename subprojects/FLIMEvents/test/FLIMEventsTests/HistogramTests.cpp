@@ -64,3 +64,83 @@ TEST_CASE("SingleTimeBin", "[Histogram]") {
         REQUIRE(data[0] == 2);
     }
 }
+
+TEST_CASE("Accumulate", "[Histogram]") {
+    // 1 x 5 pixels x 4 bins = 20 elements exercises vector and scalar paths
+    Histogram<uint16_t> cumul(2, 12, false, 5, 1);
+    Histogram<uint16_t> frame(2, 12, false, 5, 1);
+    cumul.Clear();
+    frame.Clear();
+
+    frame.Increment(0, 0, 0);
+    frame.Increment(4095, 4, 0);
+    cumul += frame;
+    cumul += frame;
+    REQUIRE(cumul.Get()[0] == 2);
+    REQUIRE(cumul.Get()[19] == 2);
+    REQUIRE(cumul.Get()[1] == 0);
+
+    SECTION("Saturation") {
+        for (int i = 0; i < 65534; ++i) {
+            frame.Increment(4095, 4, 0);
+        }
+        REQUIRE(frame.Get()[19] == 65535);
+        cumul += frame;
+        REQUIRE(cumul.Get()[19] == 65535);
+        REQUIRE(cumul.Get()[0] == 3);
+    }
+}
+
+TEST_CASE("MultipleChannels", "[Histogram]") {
+    Histogram<uint16_t> hist(1, 12, false, 3, 2, 4);
+    REQUIRE(hist.GetNumberOfChannels() == 4);
+    REQUIRE(hist.GetNumberOfElementsPerChannel() == 12);
+    REQUIRE(hist.GetNumberOfElements() == 48);
+    hist.Clear();
+
+    hist.Increment(4095, 2, 1, 0);
+    REQUIRE(hist.Get()[11] == 1);
+    hist.Increment(0, 0, 0, 3);
+    REQUIRE(hist.Get()[36] == 1);
+    REQUIRE(hist.GetChannel(3)[0] == 1);
+    hist.Increment(4095, 1, 0, 2);
+    REQUIRE(hist.GetChannel(2)[3] == 1);
+}
+
+namespace {
+class CountingHistogramProcessor : public HistogramProcessor<uint16_t> {
+  public:
+    unsigned frames = 0;
+    unsigned errors = 0;
+    unsigned validFinishes = 0;
+    unsigned invalidFinishes = 0;
+
+    void HandleError(std::string const &message) override { ++errors; }
+
+    void HandleFrame(Histogram<uint16_t> const &histogram) override {
+        ++frames;
+    }
+
+    void HandleFinish(Histogram<uint16_t> &&histogram,
+                      bool isCompleteFrame) override {
+        ++(histogram.IsValid() ? validFinishes : invalidFinishes);
+    }
+};
+} // namespace
+
+TEST_CASE("Broadcast", "[Histogram]") {
+    auto first = std::make_shared<CountingHistogramProcessor>();
+    auto second = std::make_shared<CountingHistogramProcessor>();
+    BroadcastHistogramProcessor<uint16_t> broadcast(first, second);
+
+    Histogram<uint16_t> hist(0, 12, false, 1, 1);
+    hist.Clear();
+    broadcast.HandleFrame(hist);
+    broadcast.HandleFrame(hist);
+    broadcast.HandleFinish(std::move(hist), true);
+
+    REQUIRE(first->frames == 2);
+    REQUIRE(second->frames == 2);
+    REQUIRE(first->invalidFinishes == 1);
+    REQUIRE(second->validFinishes == 1);
+}
@@ -0,0 +1,49 @@
+#include "FLIMEvents/IntensityCounter.hpp"
+#include "TestHelpers.hpp"
+#include <catch2/catch.hpp>
+
+#include <vector>
+
+TEST_CASE("Photons of enabled routes are counted", "[IntensityCounter]") {
+    std::bitset<16> mask;
+    mask.set(0);
+    mask.set(3);
+
+    auto output = std::make_shared<MockHistogramProcessor<uint32_t>>();
+    IntensityCounter counter(Histogram<uint32_t>(0, 0, false, 3, 2), mask,
+                             output);
+
+    counter.HandleBeginFrame();
+    counter.HandlePixelPhoton(MakePixelPhoton(0, 0, 1234));
+    counter.HandlePixelPhoton(MakePixelPhoton(2, 1, 1234, 3));
+    counter.HandlePixelPhoton(MakePixelPhoton(2, 1, 1234, 3));
+    // Disabled route, then out of range
+    counter.HandlePixelPhoton(MakePixelPhoton(1, 0, 1234, 1));
+    counter.HandlePixelPhoton(MakePixelPhoton(1, 0, 1234, 35));
+    counter.HandleEndFrame();
+
+    // Counting restarts with each frame
+    counter.HandleBeginFrame();
+    counter.HandlePixelPhoton(MakePixelPhoton(1, 1, 1234));
+    counter.HandleEndFrame();
+
+    REQUIRE(output->frames.size() == 2);
+    REQUIRE(output->frames[0] == std::vector<uint32_t>{1, 0, 0, 0, 0, 2});
+    REQUIRE(output->frames[1] == std::vector<uint32_t>{0, 0, 0, 0, 1, 0});
+
+    counter.HandleBeginFrame();
+    counter.HandleFinish();
+    REQUIRE(output->finishCompleteness == std::vector<bool>{false});
+}
+
+TEST_CASE("Saturating narrowing", "[IntensityCounter]") {
+    std::vector<uint32_t> src{0,     1,       32767,      32768,
+                              65534, 65535,   65536,      100000,
+                              12345, 2000000, 0xffffffff, 40000,
+                              7};
+    std::vector<uint16_t> dst(src.size());
+    SaturatingNarrowArray(dst.data(), src.data(), src.size());
+    REQUIRE(dst == std::vector<uint16_t>{0, 1, 32767, 32768, 65534, 65535,
+                                         65535, 65535, 12345, 65535, 65535,
+                                         40000, 7});
+}
@@ -0,0 +1,178 @@
+#include "FLIMEvents/LifetimeEstimator.hpp"
+#include <catch2/catch.hpp>
+
+#include <cmath>
+#include <vector>
+
+namespace {
+class MockLifetimeImageProcessor : public LifetimeImageProcessor {
+  public:
+    std::vector<std::vector<float>> frames;
+    std::vector<bool> finishes; // isCompleteFrame of each finish
+
+    void HandleError(std::string const &message) override {}
+
+    void HandleFrame(LifetimeImage const &image) override {
+        frames.push_back(image.lifetimes);
+    }
+
+    void HandleFinish(LifetimeImage &&image, bool isCompleteFrame) override {
+        finishes.push_back(isCompleteFrame);
+    }
+};
+
+// Fill each decay with counts = amplitude * exp(-t / tau), t at bin centers
+template <typename T>
+void FillDecay(T *decay, std::size_t nBins, double amplitude, double tau) {
+    for (std::size_t t = 0; t < nBins; ++t) {
+        decay[t] = T(std::lround(amplitude * std::exp(-(t + 0.5) / tau)));
+    }
+}
+} // namespace
+
+TEST_CASE("Rapid lifetime determination", "[LifetimeEstimator]") {
+    std::vector<uint16_t> decays(3 * 8);
+    decays[0] = 16; // Bins 0-3: 16; bins 4-7: 4
+    decays[4] = 4;
+    decays[8] = 4; // Rising; no estimate
+    decays[20] = 4;
+    // Pixel 2 empty; no estimate
+
+    std::vector<float> taus(3, -1.0f);
+    EstimateLifetimes(decays.data(), 3, 8,
+                      LifetimeMethod::RapidLifetimeDetermination, 2.0f,
+                      taus.data());
+    REQUIRE(taus[0] == Approx(8.0 / std::log(4.0)));
+    REQUIRE(taus[1] == 0.0f);
+    REQUIRE(taus[2] == 0.0f);
+}
+
+TEST_CASE("First moment lifetime", "[LifetimeEstimator]") {
+    std::vector<uint32_t> decays(2 * 4);
+    decays[1] = 1; // Mean bin center (1.5 + 2 * 3.5) / 3
+    decays[3] = 2;
+
+    std::vector<float> taus(2, -1.0f);
+    EstimateLifetimes(decays.data(), 2, 4, LifetimeMethod::FirstMoment, 2.0f,
+                      taus.data());
+    REQUIRE(taus[0] == Approx(2.0 * 8.5 / 3.0));
+    REQUIRE(taus[1] == 0.0f);
+}
+
+TEST_CASE("Estimates of exponential decays", "[LifetimeEstimator]") {
+    std::size_t const nBins = 256;
+    double const tau = 20.0;
+    std::vector<uint32_t> decay(nBins);
+    FillDecay(decay.data(), nBins, 60000.0, tau);
+
+    float rld = 0.0f;
+    float moment = 0.0f;
+    EstimateLifetimes(decay.data(), 1, nBins,
+                      LifetimeMethod::RapidLifetimeDetermination, 1.0f, &rld);
+    EstimateLifetimes(decay.data(), 1, nBins, LifetimeMethod::FirstMoment,
+                      1.0f, &moment);
+    REQUIRE(rld == Approx(tau).epsilon(0.01));
+    REQUIRE(moment == Approx(tau).epsilon(0.01));
+}
+
+TEST_CASE("Lifetime images of histograms", "[LifetimeEstimator]") {
+    std::size_t const numThreads = GENERATE(1, 3);
+    std::size_t const width = 5;
+    std::size_t const height = 4;
+    std::size_t const nBins = 64;
+
+    auto output = std::make_shared<MockLifetimeImageProcessor>();
+    LifetimeEstimator estimator(LifetimeMethod::RapidLifetimeDetermination,
+                                0.5f, numThreads, output);
+
+    Histogram<uint16_t> hist(6, 12, false, width, height, 2);
+    for (std::size_t ch = 0; ch < 2; ++ch) {
+        for (std::size_t p = 0; p < width * height; ++p) {
+            FillDecay(hist.Get() + (ch * width * height + p) * nBins, nBins,
+                      1000.0, 2.0 + p + ch);
+        }
+    }
+
+    std::vector<float> expected(2 * width * height);
+    EstimateLifetimes(hist.Get(), 2 * width * height, nBins,
+                      LifetimeMethod::RapidLifetimeDetermination, 0.5f,
+                      expected.data());
+
+    SECTION("Frame histograms") {
+        estimator.HandleFrame(hist);
+        estimator.HandleFinish(std::move(hist), true);
+    }
+
+    SECTION("Promoting histograms") {
+        Histogram<uint16_t> zero(hist.GetMicrotimeBinning(), width, height,
+                                 2);
+        zero.Clear();
+        PromotingHistogram cumulative(std::move(zero));
+        cumulative += hist;
+        estimator.HandleFrame(cumulative);
+        estimator.HandleFinish(std::move(cumulative), true);
+    }
+
+    SECTION("Promoting histogram snapshots") {
+        CowPromotingHistogram cumulative(hist.GetMicrotimeBinning(), width,
+                                         height, 2);
+        cumulative += hist;
+        estimator.HandleFrame(cumulative.Snapshot());
+        estimator.HandleFinish(PromotingHistogramSnapshot(), true);
+    }
+
+    REQUIRE(output->frames.size() == 1);
+    REQUIRE(output->frames[0] == expected);
+    REQUIRE(output->finishes == std::vector<bool>{true});
+}
+
+TEST_CASE("Promoted channels are estimated", "[LifetimeEstimator]") {
+    auto output = std::make_shared<MockLifetimeImageProcessor>();
+    LifetimeEstimator estimator(LifetimeMethod::FirstMoment, 1.0f, 2, output);
+
+    Histogram<uint16_t> hist(1, 12, false, 1, 1, 1);
+    hist.Clear();
+    hist.Get()[1] = 60000;
+    Histogram<uint16_t> zero(hist.GetMicrotimeBinning(), 1, 1, 1);
+    zero.Clear();
+    PromotingHistogram cumulative(std::move(zero));
+    cumulative += hist;
+    cumulative += hist;
+    hist.Get()[0] = 60000;
+    hist.Get()[1] = 0;
+    cumulative += hist;
+    REQUIRE(cumulative.IsChannelPromoted(0));
+
+    estimator.HandleFrame(cumulative);
+    REQUIRE(output->frames.size() == 1);
+    REQUIRE(output->frames[0][0] == Approx(0.5 + 2.0 / 3.0));
+}
+
+TEST_CASE("Snapshot channels spanning tiles are estimated",
+          "[LifetimeEstimator]") {
+    std::size_t const nBins = 256;
+    std::size_t const tilePixels =
+        CowPromotingHistogram::GetTileElements(nBins) / nBins;
+    std::size_t const width = 2 * tilePixels + 3; // 3 tiles, last partial
+
+    auto output = std::make_shared<MockLifetimeImageProcessor>();
+    LifetimeEstimator estimator(LifetimeMethod::FirstMoment, 1.0f, 2, output);
+
+    Histogram<uint16_t> hist(8, 12, false, width, 1, 1);
+    for (std::size_t p = 0; p < width; ++p) {
+        FillDecay(hist.Get() + p * nBins, nBins, 1000.0, 2.0 + p % 17);
+    }
+    std::vector<float> expected(width);
+    EstimateLifetimes(hist.Get(), width, nBins, LifetimeMethod::FirstMoment,
+                      1.0f, expected.data());
+
+    CowPromotingHistogram cumulative(hist.GetMicrotimeBinning(), width, 1,
+                                     1);
+    cumulative += hist;
+    auto const snapshot = cumulative.Snapshot();
+    REQUIRE(snapshot.GetNarrowChannel(0).GetNumberOfTiles() == 3);
+    estimator.HandleFrame(snapshot);
+
+    REQUIRE(output->frames.size() == 1);
+    REQUIRE(output->frames[0] == expected);
+}
@@ -129,6 +129,7 @@ TEST_CASE("Frames are produced according to line markers",
         REQUIRE(output->pixelPhotons[1].x == 0);
         REQUIRE(output->pixelPhotons[2].x == 1);
         REQUIRE(output->pixelPhotons[3].x == 1);
+        REQUIRE(output->pixelPhotons[3].macrotime == 124);
     }
 
     // TODO Other things we might test
@@ -139,3 +140,39 @@ TEST_CASE("Frames are produced according to line markers",
     // photons)
     //   - in particular, line spanning negative time
 }
+
+TEST_CASE("Time is reached at the end of each line",
+          "[LineClockPixellator]") {
+    class TimeRecorder : public PixelPhotonProcessor {
+      public:
+        std::vector<uint64_t> times;
+
+        void HandleBeginFrame() override {}
+        void HandleEndFrame() override {}
+        void HandlePixelPhoton(PixelPhotonEvent const &) override {}
+        void HandleError(std::string const &) override {}
+        void HandleFinish() override {}
+        void HandleTimeReached(uint64_t macrotime) override {
+            times.push_back(macrotime);
+        }
+    };
+
+    auto output = std::make_shared<TimeRecorder>();
+    auto lcp =
+        std::make_shared<LineClockPixellator>(2, 2, 10, 0, 20, 1, output);
+
+    MarkerEvent lineMarker;
+    lineMarker.bits = 1 << 1;
+    lineMarker.macrotime = 100;
+    lcp->HandleMarker(lineMarker);
+    lineMarker.macrotime = 200;
+    lcp->HandleMarker(lineMarker);
+    lcp->Flush();
+    REQUIRE(output->times == std::vector<uint64_t>{120});
+
+    DecodedEvent timestamp;
+    timestamp.macrotime = 1000;
+    lcp->HandleTimestamp(timestamp);
+    lcp->Flush();
+    REQUIRE(output->times == std::vector<uint64_t>{120, 220});
+}
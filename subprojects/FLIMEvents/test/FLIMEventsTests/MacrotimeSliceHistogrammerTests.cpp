@@ -0,0 +1,102 @@
+#include "FLIMEvents/MacrotimeSliceHistogrammer.hpp"
+#include "TestHelpers.hpp"
+#include <catch2/catch.hpp>
+
+#include <vector>
+
+namespace {
+std::vector<Histogram<uint16_t>> MakeRing(std::size_t n) {
+    std::vector<Histogram<uint16_t>> ring;
+    for (std::size_t i = 0; i < n; ++i) {
+        ring.emplace_back(0, 12, false, 2, 1, 2);
+    }
+    return ring;
+}
+} // namespace
+
+TEST_CASE("Photons are sliced by macrotime",
+          "[MacrotimeSliceHistogrammer]") {
+    std::bitset<16> mask;
+    mask.set(0);
+    mask.set(2);
+    auto output = std::make_shared<MockHistogramProcessor<uint16_t>>();
+    MacrotimeSliceHistogrammer<uint16_t> slicer(
+        MakeRing(2), MakeDenseRouteChannelTable(mask), 100, output);
+
+    // Slice 0, slice 1, slice 0 (late), disabled route
+    slicer.HandlePixelPhoton(MakePixelPhoton(0, 0, 0, 0, 1000));
+    slicer.HandlePixelPhoton(MakePixelPhoton(1, 0, 0, 2, 1150));
+    slicer.HandlePixelPhoton(MakePixelPhoton(1, 0, 0, 0, 1099));
+    slicer.HandlePixelPhoton(MakePixelPhoton(1, 0, 0, 1, 1120));
+    REQUIRE(output->frames.empty());
+
+    slicer.HandleEndFrame(); // Frames are ignored
+    slicer.HandleBeginFrame();
+
+    // Slice 4 requires emitting slices 0-2 (2 empty)
+    slicer.HandlePixelPhoton(MakePixelPhoton(1, 0, 0, 0, 1400));
+    REQUIRE(output->frames.size() == 3);
+    REQUIRE(output->frames[0] == std::vector<uint16_t>{1, 1, 0, 0});
+    REQUIRE(output->frames[1] == std::vector<uint16_t>{0, 0, 0, 1});
+    REQUIRE(output->frames[2] == std::vector<uint16_t>{0, 0, 0, 0});
+
+    // Slice 2 has been emitted
+    slicer.HandlePixelPhoton(MakePixelPhoton(0, 0, 0, 0, 1250));
+    REQUIRE(slicer.GetNumberOfDroppedPhotons() == 1);
+
+    slicer.HandleFinish();
+    REQUIRE(output->frames.size() == 4); // Slice 3
+    REQUIRE(output->frames[3] == std::vector<uint16_t>{0, 0, 0, 0});
+    REQUIRE(output->finishes.size() == 1);
+    REQUIRE(output->finishes[0] == std::vector<uint16_t>{0, 1, 0, 0});
+    REQUIRE(output->finishCompleteness == std::vector<bool>{false});
+}
+
+TEST_CASE("Slices are emitted as time passes",
+          "[MacrotimeSliceHistogrammer]") {
+    auto output = std::make_shared<MockHistogramProcessor<uint16_t>>();
+    MacrotimeSliceHistogrammer<uint16_t> slicer(
+        MakeRing(2), MakeDenseRouteChannelTable(1), 100, output);
+
+    slicer.HandlePixelPhoton(MakePixelPhoton(0, 0, 0, 0, 1000)); // Slice 0
+    slicer.HandleTimeReached(1099);
+    REQUIRE(output->frames.empty());
+    slicer.HandleTimeReached(1100);
+    REQUIRE(output->frames.size() == 1);
+    REQUIRE(output->frames[0] == std::vector<uint16_t>{1, 0, 0, 0});
+
+    // Slices 1-3 pass without photons
+    slicer.HandleTimeReached(1450);
+    REQUIRE(output->frames.size() == 4);
+    REQUIRE(output->frames[3] == std::vector<uint16_t>(4, 0));
+
+    slicer.HandlePixelPhoton(MakePixelPhoton(1, 0, 0, 0, 1399)); // Dropped
+    slicer.HandlePixelPhoton(MakePixelPhoton(1, 0, 0, 0, 1420)); // Slice 4
+    REQUIRE(slicer.GetNumberOfDroppedPhotons() == 1);
+    slicer.HandleFinish();
+    REQUIRE(output->frames.size() == 4);
+    REQUIRE(output->finishes[0] == std::vector<uint16_t>{0, 1, 0, 0});
+}
+
+TEST_CASE("Time alone starts and ends slices",
+          "[MacrotimeSliceHistogrammer]") {
+    auto output = std::make_shared<MockHistogramProcessor<uint16_t>>();
+    MacrotimeSliceHistogrammer<uint16_t> slicer(
+        MakeRing(1), MakeDenseRouteChannelTable(1), 100, output);
+    slicer.HandleTimeReached(500); // Origin
+    slicer.HandleTimeReached(720);
+    REQUIRE(output->frames.size() == 2);
+    slicer.HandleFinish();
+    REQUIRE(output->finishes.size() == 1);
+    REQUIRE(output->finishes[0] == std::vector<uint16_t>(4, 0));
+}
+
+TEST_CASE("Slicing without photons", "[MacrotimeSliceHistogrammer]") {
+    auto output = std::make_shared<MockHistogramProcessor<uint16_t>>();
+    MacrotimeSliceHistogrammer<uint16_t> slicer(
+        MakeRing(1), MakeDenseRouteChannelTable(3), 100, output);
+    slicer.HandleFinish();
+    REQUIRE(output->frames.empty());
+    REQUIRE(output->finishes.size() == 1);
+    REQUIRE(output->finishes[0] == std::vector<uint16_t>(4, 0));
+}
@@ -0,0 +1,98 @@
+#include "FLIMEvents/MeanArrivalTimeCounter.hpp"
+#include "TestHelpers.hpp"
+#include <catch2/catch.hpp>
+
+#include <vector>
+
+TEST_CASE("Microtimes of enabled routes are summed",
+          "[MeanArrivalTimeCounter]") {
+    std::bitset<16> mask;
+    mask.set(0);
+    mask.set(3);
+    bool const reverse = GENERATE(false, true);
+
+    auto output = std::make_shared<MockHistogramProcessor<uint32_t>>();
+    MeanArrivalTimeCounter counter(Histogram<uint32_t>(0, 0, false, 2, 1, 2),
+                                   mask, 4, reverse, output);
+
+    counter.HandleBeginFrame();
+    counter.HandlePixelPhoton(MakePixelPhoton(1, 0, 2));
+    counter.HandlePixelPhoton(MakePixelPhoton(1, 0, 5, 3));
+    counter.HandlePixelPhoton(MakePixelPhoton(0, 0, 7, 1)); // Disabled route
+    counter.HandleEndFrame();
+    counter.HandleBeginFrame();
+    counter.HandleFinish();
+
+    REQUIRE(output->frames.size() == 1);
+    if (reverse) {
+        REQUIRE(output->frames[0] == std::vector<uint32_t>{0, 2, 0, 23});
+    } else {
+        REQUIRE(output->frames[0] == std::vector<uint32_t>{0, 2, 0, 7});
+    }
+    REQUIRE(output->finishCompleteness == std::vector<bool>{false});
+}
+
+TEST_CASE("Mean arrival times", "[MeanArrivalTimeCounter]") {
+    Histogram<uint32_t> image(0, 0, false, 4, 1, 2);
+    uint32_t *data = image.Get();
+    // Counts
+    data[0] = 0;
+    data[1] = 2;
+    data[2] = 3;
+    data[3] = 1;
+    // Sums
+    data[4] = 0;
+    data[5] = 7;
+    data[6] = 3000;
+    data[7] = 4095;
+
+    std::vector<uint16_t> means(4);
+    ComputeMeanArrivalTimes(image, 16.0f, means.data());
+    REQUIRE(means == std::vector<uint16_t>{0, 56, 16000, 65520});
+
+    ComputeMeanArrivalTimes(image, 32.0f, means.data());
+    REQUIRE(means[3] == 65534);
+
+    data[1] = UINT32_MAX;
+    data[6] = UINT32_MAX;
+    ComputeMeanArrivalTimes(image, 16.0f, means.data());
+    REQUIRE(means[1] == MeanArrivalTimeSaturated);
+    REQUIRE(means[2] == MeanArrivalTimeSaturated);
+}
+
+TEST_CASE("Count and sum saturate together", "[MeanArrivalTimeCounter]") {
+    std::bitset<16> mask;
+    mask.set(0);
+    auto output = std::make_shared<MockHistogramProcessor<uint32_t>>();
+    MeanArrivalTimeCounter counter(Histogram<uint32_t>(0, 0, false, 2, 1, 2),
+                                   mask, 16, false, output);
+
+    // The sum of pixel 0 reaches UINT32_MAX at 65537 photons at 65535
+    counter.HandleBeginFrame();
+    for (int i = 0; i < 65536; ++i) {
+        counter.HandlePixelPhoton(MakePixelPhoton(0, 0, 65535));
+    }
+    counter.HandlePixelPhoton(MakePixelPhoton(1, 0, 3));
+    counter.HandleEndFrame();
+    counter.HandleBeginFrame();
+    for (int i = 0; i < 65540; ++i) {
+        counter.HandlePixelPhoton(MakePixelPhoton(0, 0, 65535));
+    }
+    counter.HandleEndFrame();
+
+    REQUIRE(output->frames.size() == 2);
+    REQUIRE(output->frames[0] ==
+            std::vector<uint32_t>{65536, 1, 65536u * 65535u, 3});
+    REQUIRE(output->frames[1] ==
+            std::vector<uint32_t>{UINT32_MAX, 0, UINT32_MAX, 0});
+
+    // Accumulation keeps the pixel saturated, and its mean is flagged
+    Histogram<uint32_t> cumulative(0, 0, false, 2, 1, 2);
+    cumulative.Clear();
+    for (auto const &frame : output->frames) {
+        SaturatingAddArray(cumulative.Get(), frame.data(), frame.size());
+    }
+    std::vector<uint16_t> means(2);
+    ComputeMeanArrivalTimes(cumulative, 1.0f, means.data());
+    REQUIRE(means == std::vector<uint16_t>{MeanArrivalTimeSaturated, 3});
+}
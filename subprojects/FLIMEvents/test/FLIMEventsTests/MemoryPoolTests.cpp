@@ -0,0 +1,79 @@
+#include "FLIMEvents/Histogram.hpp"
+#include "FLIMEvents/MemoryPool.hpp"
+#include <catch2/catch.hpp>
+
+TEST_CASE("Blocks are reused", "[MemoryPool]") {
+    MemoryPool pool;
+    void *first;
+    {
+        auto block = pool.Allocate(1000);
+        first = block.get();
+        REQUIRE(pool.GetInUseBytes() == 1000);
+        REQUIRE(pool.GetFreeBytes() == 0);
+    }
+    REQUIRE(pool.GetInUseBytes() == 0);
+    REQUIRE(pool.GetFreeBytes() == 1000);
+
+    auto other = pool.Allocate(2000); // Different size is not reused
+    REQUIRE(pool.GetFreeBytes() == 1000);
+    auto again = pool.Allocate(1000);
+    REQUIRE(again.get() == first);
+    REQUIRE(pool.GetFreeBytes() == 0);
+}
+
+TEST_CASE("Reserve", "[MemoryPool]") {
+    MemoryPool pool(5000);
+    auto held = pool.Allocate(1000);
+
+    SECTION("Within budget") {
+        REQUIRE(pool.Reserve({2000, 2000}));
+        REQUIRE(pool.GetFreeBytes() == 4000);
+
+        // Reserving again keeps matching blocks and frees the rest
+        auto block0 = pool.Allocate(2000);
+        auto block1 = pool.Allocate(2000);
+        void *ptrs[] = {block0.get(), block1.get()};
+        block0.reset();
+        block1.reset();
+        REQUIRE(pool.Reserve({2000, 500}));
+        REQUIRE(pool.GetFreeBytes() == 2500);
+        void *kept = pool.Allocate(2000).get();
+        REQUIRE((kept == ptrs[0] || kept == ptrs[1]));
+    }
+
+    SECTION("Over budget") {
+        REQUIRE_FALSE(pool.Reserve({2000, 2001}));
+        REQUIRE(pool.GetFreeBytes() == 0);
+        REQUIRE_FALSE(pool.Reserve({SIZE_MAX / 2, SIZE_MAX / 2}));
+    }
+}
+
+TEST_CASE("Blocks may outlive pool", "[MemoryPool]") {
+    std::shared_ptr<void> block;
+    {
+        MemoryPool pool;
+        block = pool.Allocate(100);
+    }
+    block.reset(); // Must not crash or leak
+}
+
+TEST_CASE("Pooled histogram", "[MemoryPool]") {
+    MemoryPool pool;
+    auto size = Histogram<uint16_t>::GetStorageSize(8, 4, 3, 2);
+    REQUIRE(size == 256 * 4 * 3 * 2 * 2);
+    REQUIRE(pool.Reserve({size}));
+
+    {
+        Histogram<uint16_t> hist(8, 12, false, 4, 3, 2, pool);
+        REQUIRE(pool.GetInUseBytes() == size);
+        REQUIRE(pool.GetFreeBytes() == 0);
+        hist.Clear();
+        hist.Increment(0, 3, 2, 1);
+        REQUIRE(hist.GetChannel(1)[(2 * 4 + 3) * 256] == 1);
+
+        Histogram<uint16_t> moved(std::move(hist));
+        REQUIRE(pool.GetInUseBytes() == size);
+    }
+    REQUIRE(pool.GetInUseBytes() == 0);
+    REQUIRE(pool.GetFreeBytes() == size);
+}
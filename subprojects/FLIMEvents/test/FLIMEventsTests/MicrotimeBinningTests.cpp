@@ -0,0 +1,62 @@
+#include "FLIMEvents/Histogram.hpp"
+#include "FLIMEvents/MicrotimeBinning.hpp"
+#include <catch2/catch.hpp>
+
+// Copy to avoid odr-use of the static member in REQUIRE()
+static uint16_t const NotBinned = MicrotimeBinning::NotBinned;
+
+TEST_CASE("Power-of-2 binning matches bit shift", "[MicrotimeBinning]") {
+    MicrotimeBinning binning(3, 5, false);
+    REQUIRE(binning.GetNumberOfBins() == 8);
+    for (uint32_t t = 0; t < 32; ++t) {
+        REQUIRE(binning.GetBin(t) == t >> 2);
+    }
+    REQUIRE(binning.GetBin(32) == NotBinned);
+
+    MicrotimeBinning reversed(3, 5, true);
+    for (uint32_t t = 0; t < 32; ++t) {
+        REQUIRE(reversed.GetBin(t) == 7 - (t >> 2));
+    }
+}
+
+TEST_CASE("Windowed binning", "[MicrotimeBinning]") {
+    // Window of 10 microtimes in 3 bins (widths 4, 3, 3)
+    MicrotimeBinning binning(4, 5, 15, 3, false);
+    REQUIRE(binning.GetBin(4) == NotBinned);
+    REQUIRE(binning.GetBin(5) == 0);
+    REQUIRE(binning.GetBin(8) == 0);
+    REQUIRE(binning.GetBin(9) == 1);
+    REQUIRE(binning.GetBin(12) == 2);
+    REQUIRE(binning.GetBin(14) == 2);
+    REQUIRE(binning.GetBin(15) == NotBinned);
+
+    MicrotimeBinning reversed(4, 5, 15, 3, true);
+    REQUIRE(reversed.GetBin(5) == 2);
+    REQUIRE(reversed.GetBin(14) == 0);
+}
+
+TEST_CASE("Invalid microtime binning", "[MicrotimeBinning]") {
+    REQUIRE_THROWS_AS(MicrotimeBinning(4, 5, 5, 1, false),
+                      std::invalid_argument);
+    REQUIRE_THROWS_AS(MicrotimeBinning(4, 0, 17, 1, false),
+                      std::invalid_argument);
+    REQUIRE_THROWS_AS(MicrotimeBinning(4, 0, 16, 17, false),
+                      std::invalid_argument);
+    REQUIRE_THROWS_AS(MicrotimeBinning(5, 4, false), std::invalid_argument);
+}
+
+TEST_CASE("Histogram drops photons outside window", "[MicrotimeBinning]") {
+    Histogram<uint16_t> hist(MicrotimeBinning(12, 1000, 2500, 100, false), 2,
+                             1);
+    REQUIRE(hist.GetNumberOfTimeBins() == 100);
+    REQUIRE(hist.GetNumberOfElements() == 200);
+    hist.Clear();
+
+    hist.Increment(999, 1, 0);
+    hist.Increment(2500, 1, 0);
+    hist.Increment(1000, 1, 0);
+    hist.Increment(2499, 1, 0);
+    REQUIRE(hist.Get()[100] == 1);
+    REQUIRE(hist.Get()[199] == 1);
+    REQUIRE(SumArray(hist.Get(), hist.GetNumberOfElements()) == 2);
+}
@@ -0,0 +1,53 @@
+#include "FLIMEvents/MultiChannelHistogrammer.hpp"
+#include "TestHelpers.hpp"
+#include <catch2/catch.hpp>
+
+#include <vector>
+
+TEST_CASE("Route tables", "[MultiChannelHistogrammer]") {
+    std::bitset<16> mask;
+    mask.set(1);
+    mask.set(4);
+
+    auto dense = MakeDenseRouteChannelTable(mask);
+    REQUIRE(dense[0] == RouteNotHistogrammed);
+    REQUIRE(dense[1] == 0);
+    REQUIRE(dense[4] == 1);
+    REQUIRE(dense[15] == RouteNotHistogrammed);
+
+    auto merged = MakeMergedRouteChannelTable(mask);
+    REQUIRE(merged[1] == 0);
+    REQUIRE(merged[4] == 0);
+    REQUIRE(merged[5] == RouteNotHistogrammed);
+
+    REQUIRE_THROWS_AS(CheckRouteChannelTable(dense, 1), std::invalid_argument);
+    REQUIRE_NOTHROW(CheckRouteChannelTable(dense, 2));
+}
+
+TEST_CASE("Photons are histogrammed by channel",
+          "[MultiChannelHistogrammer]") {
+    std::bitset<16> mask;
+    mask.set(1);
+    mask.set(4);
+
+    auto output = std::make_shared<MockHistogramProcessor<uint16_t>>();
+    // 2 channels x 1 line x 2 pixels x 1 time bin
+    MultiChannelHistogrammer<uint16_t> histogrammer(
+        Histogram<uint16_t>(0, 12, false, 2, 1, 2),
+        MakeDenseRouteChannelTable(mask), output);
+
+    histogrammer.HandleBeginFrame();
+    histogrammer.HandlePixelPhoton(MakePixelPhoton(0, 0, 0, 1));
+    histogrammer.HandlePixelPhoton(MakePixelPhoton(1, 0, 0, 4));
+    histogrammer.HandlePixelPhoton(MakePixelPhoton(1, 0, 0, 4));
+    // Disabled route, then out of range
+    histogrammer.HandlePixelPhoton(MakePixelPhoton(0, 0));
+    histogrammer.HandlePixelPhoton(MakePixelPhoton(0, 0, 0, 100));
+    histogrammer.HandleEndFrame();
+
+    REQUIRE(output->frames.size() == 1);
+    REQUIRE(output->frames[0] == std::vector<uint16_t>{1, 0, 0, 2});
+
+    histogrammer.HandleFinish();
+    REQUIRE(output->finishes.size() == 1);
+}
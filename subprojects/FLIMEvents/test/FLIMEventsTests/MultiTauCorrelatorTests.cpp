@@ -0,0 +1,187 @@
+#include "FLIMEvents/MultiTauCorrelator.hpp"
+#include "TestHelpers.hpp"
+#include <catch2/catch.hpp>
+
+#include <vector>
+
+namespace {
+class MockFCSDataProcessor : public FCSDataProcessor {
+  public:
+    std::vector<FCSData> updates;
+    std::vector<FCSData> finishes;
+    std::vector<std::string> errors;
+
+    void HandleError(std::string const &message) override {
+        errors.push_back(message);
+    }
+
+    void HandleUpdate(FCSData const &data) override {
+        updates.push_back(data);
+    }
+
+    void HandleFinish(FCSData &&data) override {
+        finishes.emplace_back(std::move(data));
+    }
+};
+
+} // namespace
+
+TEST_CASE("Multi-tau lags", "[MultiTauCorrelator]") {
+    MultiTauCorrelator corr(3, 4);
+    REQUIRE(corr.GetLags() == std::vector<uint64_t>{1, 2, 3, 4, 6, 8, 12});
+    REQUIRE(corr.GetCorrelation() == std::vector<double>(7, 0.0));
+
+    REQUIRE_THROWS_AS(MultiTauCorrelator(3, 5), std::invalid_argument);
+    REQUIRE_THROWS_AS(MultiTauCorrelator(0, 4), std::invalid_argument);
+}
+
+TEST_CASE("Constant signal is uncorrelated", "[MultiTauCorrelator]") {
+    MultiTauCorrelator corr(4, 8);
+    for (int i = 0; i < 1000; ++i) {
+        corr.Push(3, 3);
+    }
+    for (auto g : corr.GetCorrelation()) {
+        REQUIRE(g == Approx(1.0));
+    }
+}
+
+TEST_CASE("Alternating signal autocorrelation", "[MultiTauCorrelator]") {
+    MultiTauCorrelator corr(3, 4); // Lags 1, 2, 3, 4, 6, 8, 12
+    for (int i = 0; i < 1000; ++i) {
+        uint64_t const v = i % 2 == 0 ? 1 : 0;
+        corr.Push(v, v);
+    }
+    auto const g = corr.GetCorrelation();
+    REQUIRE(g[0] == Approx(0.0));
+    REQUIRE(g[1] == Approx(2.0));
+    REQUIRE(g[2] == Approx(0.0));
+    // Higher levels see the pairwise sums, which are constant
+    for (std::size_t i = 3; i < g.size(); ++i) {
+        REQUIRE(g[i] == Approx(1.0));
+    }
+}
+
+TEST_CASE("Cross-correlation of delayed signal", "[MultiTauCorrelator]") {
+    // b(t) = a(t - 3), with a a sparse pseudo-random signal
+    MultiTauCorrelator corr(1, 8);
+    std::vector<uint64_t> a(2000);
+    uint32_t state = 12345;
+    for (auto &v : a) {
+        state = state * 1103515245u + 12345u;
+        v = (state >> 16) % 8 == 0 ? 1 : 0;
+    }
+    for (std::size_t t = 0; t < a.size(); ++t) {
+        corr.Push(a[t], t >= 3 ? a[t - 3] : 0);
+    }
+    auto const g = corr.GetCorrelation(); // Lags 1-7
+    for (std::size_t i = 0; i < g.size(); ++i) {
+        if (i + 1 == 3) {
+            REQUIRE(g[i] > 5.0);
+        } else {
+            REQUIRE(g[i] < 2.0);
+        }
+    }
+}
+
+TEST_CASE("Pushing zeros in bulk", "[MultiTauCorrelator]") {
+    MultiTauCorrelator bulk(5, 4);
+    MultiTauCorrelator single(5, 4);
+    uint32_t state = 54321;
+    for (int i = 0; i < 200; ++i) {
+        state = state * 1103515245u + 12345u;
+        uint64_t const v = (state >> 16) % 4;
+        uint64_t const zeros = (state >> 20) % 13;
+        bulk.Push(v, v + 1);
+        single.Push(v, v + 1);
+        bulk.PushZeros(zeros);
+        for (uint64_t z = 0; z < zeros; ++z) {
+            single.Push(0, 0);
+        }
+    }
+    REQUIRE(bulk.GetCorrelation() == single.GetCorrelation());
+}
+
+TEST_CASE("FCS correlator bins photons", "[MultiTauCorrelator]") {
+    std::bitset<16> mask;
+    mask.set(1);
+    mask.set(3);
+    auto output = std::make_shared<MockFCSDataProcessor>();
+    FCSCorrelator fcs(mask, 10, 2, 4, 100, 1000, 0, output, nullptr);
+
+    // Route 1 photon every 20, route 3 photon 10 later (one bin delay)
+    for (uint64_t t = 1000; t < 3000; t += 20) {
+        fcs.HandleValidPhoton(MakeValidPhoton(t, 0, 1));
+        fcs.HandleValidPhoton(MakeValidPhoton(t + 10, 0, 3));
+        fcs.HandleValidPhoton(MakeValidPhoton(t + 5, 0, 2)); // Disabled route
+    }
+    fcs.HandleTimestamp(DecodedEvent{3000});
+    fcs.HandleFinish();
+
+    REQUIRE(output->updates.empty());
+    REQUIRE(output->errors.empty());
+    REQUIRE(output->finishes.size() == 1);
+    auto const &data = output->finishes[0];
+    REQUIRE(data.autocorrelations.size() == 2);
+    REQUIRE(data.crossCorrelations.size() == 1);
+
+    auto const &auto0 = data.autocorrelations[0];
+    REQUIRE(auto0.lags == std::vector<uint64_t>{10, 20, 30, 40, 60});
+    REQUIRE(auto0.values[0] == Approx(0.0));
+    REQUIRE(auto0.values[1] == Approx(2.0));
+
+    auto const &cross = data.crossCorrelations[0];
+    REQUIRE(cross.values[0] == Approx(2.0).epsilon(0.02));
+    REQUIRE(cross.values[1] == Approx(0.0));
+
+    REQUIRE(data.traces.size() == 2);
+    REQUIRE(data.traces[0] == std::vector<uint32_t>(20, 5));
+    REQUIRE(data.traces[1] == std::vector<uint32_t>(20, 5));
+}
+
+TEST_CASE("FCS updates and data loss", "[MultiTauCorrelator]") {
+    auto output = std::make_shared<MockFCSDataProcessor>();
+    FCSCorrelator fcs(std::bitset<16>(1), 10, 2, 4, 100, 1000, 1000, output,
+                      nullptr);
+
+    fcs.HandleValidPhoton(MakeValidPhoton(0));
+    fcs.HandleTimestamp(DecodedEvent{999});
+    REQUIRE(output->updates.empty());
+    fcs.HandleTimestamp(DecodedEvent{1000});
+    REQUIRE(output->updates.size() == 1);
+    REQUIRE(output->updates[0].traces[0].size() == 10);
+    REQUIRE(output->updates[0].traces[0][0] == 1);
+
+    // Each update carries only the new trace bins
+    fcs.HandleTimestamp(DecodedEvent{2000});
+    REQUIRE(output->updates.size() == 2);
+    REQUIRE(output->updates[1].firstTraceBin == 10);
+    REQUIRE(output->updates[1].traces[0] == std::vector<uint32_t>(10, 0));
+
+    fcs.HandleDataLost(DataLostEvent{});
+    fcs.HandleFinish();
+    REQUIRE(output->errors.size() == 1);
+    REQUIRE(output->finishes.empty());
+}
+
+TEST_CASE("FCS long gap and trace limit", "[MultiTauCorrelator]") {
+    auto output = std::make_shared<MockFCSDataProcessor>();
+    FCSCorrelator fcs(std::bitset<16>(1), 1, 20, 16, 1000, 8, 0, output,
+                      nullptr);
+
+    // Must not take time proportional to the gap (10^12 base bins)
+    fcs.HandleValidPhoton(MakeValidPhoton(0));
+    fcs.HandleValidPhoton(MakeValidPhoton(1'000'000'000'000));
+    fcs.HandleValidPhoton(MakeValidPhoton(1'000'000'000'001));
+    fcs.HandleTimestamp(DecodedEvent{1'000'000'002'000});
+    fcs.HandleFinish();
+
+    REQUIRE(output->finishes.size() == 1);
+    auto const &data = output->finishes[0];
+    REQUIRE(data.traces[0].size() == 8);
+    REQUIRE(data.firstTraceBin == 1'000'000'002 - 8);
+    REQUIRE(data.traces[0][5] == 0);
+    REQUIRE(data.traces[0][6] == 2);
+    REQUIRE(data.traces[0][7] == 0);
+    // Photons 1 base bin apart, once in 10^12 bins
+    REQUIRE(data.autocorrelations[0].values[0] > 1000.0);
+}
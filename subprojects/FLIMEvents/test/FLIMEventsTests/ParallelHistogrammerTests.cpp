@@ -0,0 +1,71 @@
+#include "FLIMEvents/ParallelHistogrammer.hpp"
+#include "TestHelpers.hpp"
+#include <catch2/catch.hpp>
+
+#include <vector>
+
+TEST_CASE("Parallel result matches serial histogramming",
+          "[ParallelHistogrammer]") {
+    std::size_t const nWorkers = GENERATE(1, 2, 3, 4, 7);
+    uint32_t const width = 4, height = 3;
+
+    std::vector<Histogram<uint16_t>> histograms;
+    for (std::size_t i = 0; i < nWorkers; ++i) {
+        histograms.emplace_back(4, 12, true, width, height);
+    }
+    auto output = std::make_shared<MockHistogramProcessor<uint16_t>>();
+    // Small batches so that every worker receives photons
+    ParallelHistogrammer<uint16_t> parallel(
+        std::move(histograms), MakeDenseRouteChannelTable(1), output, 5);
+
+    Histogram<uint16_t> serial(4, 12, true, width, height);
+
+    for (uint32_t frame = 0; frame < 3; ++frame) {
+        parallel.HandleBeginFrame();
+        serial.Clear();
+        for (uint32_t i = 0; i < 1000; ++i) {
+            PixelPhotonEvent e;
+            e.microtime = static_cast<uint16_t>((i * 37 + frame) % 4096);
+            e.route = 0;
+            e.x = (i * 7) % width;
+            e.y = (i / 3) % height;
+            e.frame = frame;
+            parallel.HandlePixelPhoton(e);
+            serial.Increment(e.microtime, e.x, e.y);
+        }
+        parallel.HandleEndFrame();
+
+        REQUIRE(output->frames.size() == frame + 1);
+        std::vector<uint16_t> expected(
+            serial.Get(), serial.Get() + serial.GetNumberOfElements());
+        REQUIRE(output->frames.back() == expected);
+    }
+
+    parallel.HandleFinish();
+    REQUIRE(output->finishes.size() == 1);
+    REQUIRE(output->finishCompleteness.back());
+    REQUIRE(output->finishes.back() == output->frames.back());
+}
+
+TEST_CASE("Incomplete frame is merged on finish", "[ParallelHistogrammer]") {
+    std::vector<Histogram<uint16_t>> histograms;
+    for (int i = 0; i < 2; ++i) {
+        histograms.emplace_back(0, 12, false, 2, 1);
+    }
+    auto output = std::make_shared<MockHistogramProcessor<uint16_t>>();
+    ParallelHistogrammer<uint16_t> parallel(
+        std::move(histograms), MakeDenseRouteChannelTable(1), output, 1);
+
+    parallel.HandleBeginFrame();
+    PixelPhotonEvent e{};
+    e.x = 1;
+    for (int i = 0; i < 5; ++i) {
+        parallel.HandlePixelPhoton(e);
+    }
+    parallel.HandleFinish();
+
+    REQUIRE(output->frames.empty());
+    REQUIRE(output->finishes.size() == 1);
+    REQUIRE_FALSE(output->finishCompleteness.back());
+    REQUIRE(output->finishes.back() == std::vector<uint16_t>{0, 5});
+}
@@ -0,0 +1,135 @@
+#include "FLIMEvents/PhasorProcessor.hpp"
+#include "TestHelpers.hpp"
+#include <catch2/catch.hpp>
+
+#include <cmath>
+#include <vector>
+
+TEST_CASE("Phasor lookup table", "[PhasorLookupTable]") {
+    // Period of 4 microtime units: phases at bin centers are
+    // (t + 0.5) * pi / 2
+    PhasorLookupTable lut(2, 1, false);
+    REQUIRE(lut.GetSize() == 4);
+    REQUIRE(lut.Cos(0) == Approx(0.70710678));
+    REQUIRE(lut.Sin(0) == Approx(0.70710678));
+    REQUIRE(lut.Cos(1) == Approx(-0.70710678));
+    REQUIRE(lut.Sin(1) == Approx(0.70710678));
+
+    PhasorLookupTable reversed(2, 1, true);
+    REQUIRE(reversed.Cos(3) == Approx(lut.Cos(0)));
+    REQUIRE(reversed.Sin(0) == Approx(lut.Sin(3)));
+
+    PhasorLookupTable second(2, 2, false);
+    REQUIRE(second.Cos(0) == Approx(0.0).margin(1e-6));
+    REQUIRE(second.Sin(0) == Approx(1.0));
+
+    // Laser period shorter than the ADC range, not a whole number of bins
+    PhasorLookupTable laser(4, 1, false, 2.5);
+    REQUIRE(laser.Cos(0) == Approx(std::cos(3.14159265358979 * 0.4)));
+    REQUIRE(laser.Cos(5) == Approx(laser.Cos(0))); // Two periods later
+
+    REQUIRE_THROWS_AS(PhasorLookupTable(2, 1, false, -1.0),
+                      std::invalid_argument);
+}
+
+TEST_CASE("Phasor sums do not lose precision", "[PhasorProcessor]") {
+    // A float sum stops growing at 2^24 when adding 1
+    PhasorImage image(1, 1);
+    image.Clear();
+    std::size_t const n = (std::size_t(1) << 24) + 16;
+    for (std::size_t i = 0; i < n; ++i) {
+        image.Add(0, 0, 0, 1.0f, 0.5f);
+    }
+    REQUIRE(image.GetCosineSums()[0] == double(n));
+    REQUIRE(image.GetSineSums()[0] == double(n) / 2.0);
+    REQUIRE(image.GetG(0) == 1.0);
+}
+
+namespace {
+
+class MockPhasorImageProcessor : public PhasorImageProcessor {
+  public:
+    std::vector<float> g; // Of pixel 1, channel 1, per frame
+    std::vector<uint32_t> counts;
+    PhasorImage last;
+    bool finishedComplete = false;
+    std::string error;
+
+    void HandleError(std::string const &message) override {
+        error = message;
+    }
+
+    void HandleFrame(PhasorImage const &image) override {
+        auto const pixel = image.GetWidth() * image.GetHeight() + 1;
+        g.push_back(image.GetG(pixel));
+        counts.push_back(image.GetCounts()[pixel]);
+    }
+
+    void HandleFinish(PhasorImage &&image, bool isCompleteFrame) override {
+        last = std::move(image);
+        finishedComplete = isCompleteFrame;
+    }
+};
+
+} // namespace
+
+TEST_CASE("Phasor processor", "[PhasorProcessor]") {
+    PhasorLookupTable const lut(2, 1, false);
+    RouteChannelTable table;
+    table.fill(RouteNotHistogrammed);
+    table[3] = 1;
+    table[5] = 0;
+
+    auto mock = std::make_shared<MockPhasorImageProcessor>();
+    PhasorProcessor proc(PhasorImage(2, 1, 2), lut, table, mock);
+
+    proc.HandleBeginFrame();
+    proc.HandlePixelPhoton(MakePixelPhoton(1, 0, 0, 3));
+    proc.HandlePixelPhoton(MakePixelPhoton(1, 0, 1, 3));
+    proc.HandlePixelPhoton(MakePixelPhoton(1, 0, 0, 2)); // Not histogrammed
+    proc.HandlePixelPhoton(MakePixelPhoton(1, 0, 0, 5)); // Channel 0
+    proc.HandleEndFrame();
+    REQUIRE(mock->counts.size() == 1);
+    REQUIRE(mock->counts[0] == 2);
+    REQUIRE(mock->g[0] == Approx(0.0).margin(1e-6));
+
+    proc.HandleBeginFrame();
+    proc.HandlePixelPhoton(MakePixelPhoton(1, 0, 0, 3));
+    proc.HandleFinish();
+    REQUIRE(mock->counts.size() == 1);
+    REQUIRE_FALSE(mock->finishedComplete);
+    REQUIRE(mock->last.GetCounts()[3] == 1);
+    REQUIRE(mock->last.GetG(3) == Approx(0.70710678));
+    REQUIRE(mock->last.GetS(3) == Approx(0.70710678));
+    REQUIRE(mock->last.GetCounts()[1] == 0);
+    REQUIRE(mock->last.GetG(1) == 0.0f);
+    REQUIRE(mock->error.empty());
+}
+
+TEST_CASE("Phasor accumulator", "[PhasorAccumulator]") {
+    auto mock = std::make_shared<MockPhasorImageProcessor>();
+    PhasorImage zero(2, 1, 2);
+    zero.Clear();
+    PhasorAccumulator acc(std::move(zero), mock);
+
+    PhasorImage frame(2, 1, 2);
+    frame.Clear();
+    frame.Add(1, 0, 1, 1.0f, 0.0f);
+    acc.HandleFrame(frame);
+    frame.Clear();
+    frame.Add(1, 0, 1, 0.0f, 1.0f);
+    acc.HandleFrame(frame);
+    acc.HandleFinish(std::move(frame), false);
+
+    REQUIRE(mock->counts.size() == 2);
+    REQUIRE(mock->counts[1] == 2);
+    REQUIRE(mock->g[0] == Approx(1.0));
+    REQUIRE(mock->g[1] == Approx(0.5));
+    REQUIRE(mock->finishedComplete);
+    REQUIRE(mock->last.GetS(3) == Approx(0.5));
+
+    PhasorImage copy;
+    CopyFrame(mock->last, copy);
+    REQUIRE(copy.GetCounts()[3] == 2);
+    REQUIRE(copy.GetG(3) == Approx(0.5));
+}
@@ -0,0 +1,99 @@
+#include "FLIMEvents/PhotonBudgetMonitor.hpp"
+#include "TestHelpers.hpp"
+#include <catch2/catch.hpp>
+
+#include <vector>
+
+namespace {
+Histogram<uint32_t> MakeFrame(std::vector<uint32_t> const &counts) {
+    Histogram<uint32_t> frame(0, 0, false, 3, 2);
+    std::copy(counts.begin(), counts.end(), frame.Get());
+    return frame;
+}
+} // namespace
+
+TEST_CASE("Total photon target", "[PhotonBudgetMonitor]") {
+    PhotonBudget budget;
+    budget.totalPhotons = 10;
+    int reached = 0;
+    auto output = std::make_shared<MockHistogramProcessor<uint32_t>>();
+    PhotonBudgetMonitor monitor(3, 2, budget, [&] { ++reached; }, output);
+
+    monitor.HandleFrame(MakeFrame({1, 2, 3, 0, 0, 3}));
+    REQUIRE(monitor.GetTotalPhotons() == 9);
+    REQUIRE(reached == 0);
+    monitor.HandleFrame(MakeFrame({0, 0, 0, 1, 0, 0}));
+    REQUIRE(reached == 1);
+    monitor.HandleFrame(MakeFrame({5, 5, 5, 5, 5, 5}));
+    REQUIRE(reached == 1);
+    monitor.HandleFinish(MakeFrame({0, 0, 0, 0, 0, 0}), true);
+    REQUIRE(output->frames.size() == 3);
+    REQUIRE(output->finishes.size() == 1);
+}
+
+TEST_CASE("Pixel fraction target in ROI", "[PhotonBudgetMonitor]") {
+    PhotonBudget budget;
+    budget.pixelPhotons = 3;
+    budget.pixelFraction = 0.5;
+    budget.roiX = 1;
+    budget.roiWidth = 2;
+    budget.roiHeight = 2; // Pixels 1, 2, 4, 5
+    int reached = 0;
+    PhotonBudgetMonitor monitor(3, 2, budget, [&] { ++reached; }, nullptr);
+
+    monitor.HandleFrame(MakeFrame({9, 2, 0, 9, 3, 0}));
+    REQUIRE(monitor.GetNumberOfPixelsReached() == 1);
+    REQUIRE(reached == 0);
+    monitor.HandleFrame(MakeFrame({9, 0, 1, 9, 5, 1}));
+    REQUIRE(monitor.GetNumberOfPixelsReached() == 1);
+    REQUIRE(reached == 0);
+    monitor.HandleFrame(MakeFrame({0, 1, 0, 0, 0, 0}));
+    REQUIRE(monitor.GetNumberOfPixelsReached() == 2);
+    REQUIRE(reached == 1);
+}
+
+TEST_CASE("All targets must be met", "[PhotonBudgetMonitor]") {
+    PhotonBudget budget;
+    budget.totalPhotons = 6;
+    budget.pixelPhotons = 1;
+    int reached = 0;
+    PhotonBudgetMonitor monitor(3, 2, budget, [&] { ++reached; }, nullptr);
+
+    monitor.HandleFrame(MakeFrame({9, 0, 0, 0, 0, 0}));
+    REQUIRE(reached == 0);
+    monitor.HandleFrame(MakeFrame({0, 1, 1, 1, 1, 1}));
+    REQUIRE(reached == 1);
+}
+
+TEST_CASE("Zero pixel fraction disables pixel target",
+          "[PhotonBudgetMonitor]") {
+    PhotonBudget budget;
+    budget.pixelPhotons = 3;
+    budget.pixelFraction = 0.0;
+    REQUIRE_FALSE(budget.IsEnabled());
+
+    budget.totalPhotons = 10;
+    int reached = 0;
+    PhotonBudgetMonitor monitor(3, 2, budget, [&] { ++reached; }, nullptr);
+    monitor.HandleFrame(MakeFrame({0, 0, 0, 0, 0, 0}));
+    REQUIRE(reached == 0);
+    monitor.HandleFrame(MakeFrame({5, 5, 0, 0, 0, 0}));
+    REQUIRE(reached == 1);
+}
+
+TEST_CASE("Invalid photon budgets", "[PhotonBudgetMonitor]") {
+    auto make = [](PhotonBudget const &budget) {
+        PhotonBudgetMonitor(3, 2, budget, [] {}, nullptr);
+    };
+    PhotonBudget budget;
+    REQUIRE_THROWS_AS(make(budget), std::invalid_argument);
+    budget.pixelPhotons = 1;
+    budget.pixelFraction = 0.0;
+    REQUIRE_THROWS_AS(make(budget), std::invalid_argument);
+    budget.totalPhotons = 1;
+    REQUIRE_NOTHROW(make(budget));
+    budget.roiX = 2;
+    budget.roiWidth = 2;
+    budget.roiHeight = 1;
+    REQUIRE_THROWS_AS(make(budget), std::invalid_argument);
+}
@@ -0,0 +1,70 @@
+#include "FLIMEvents/PixelBinner.hpp"
+#include "TestHelpers.hpp"
+#include <catch2/catch.hpp>
+
+#include <utility>
+#include <vector>
+
+namespace {
+class MockPixelPhotonProcessor : public PixelPhotonProcessor {
+  public:
+    std::vector<std::pair<uint32_t, uint32_t>> photons; // (x, y)
+    unsigned beginFrames = 0;
+    unsigned endFrames = 0;
+    unsigned finishes = 0;
+
+    void HandleBeginFrame() override { ++beginFrames; }
+    void HandleEndFrame() override { ++endFrames; }
+    void HandlePixelPhoton(PixelPhotonEvent const &event) override {
+        photons.emplace_back(event.x, event.y);
+    }
+    void HandleError(std::string const &message) override {}
+    void HandleFinish() override { ++finishes; }
+};
+
+} // namespace
+
+TEST_CASE("Invalid binning", "[PixelBinner]") {
+    REQUIRE_THROWS_AS(PixelBinner(0, 0, 4, 4, 0, nullptr),
+                      std::invalid_argument);
+    REQUIRE_THROWS_AS(PixelBinner(0, 0, 4, 3, 4, nullptr),
+                      std::invalid_argument);
+}
+
+TEST_CASE("Binning without crop", "[PixelBinner]") {
+    auto output = std::make_shared<MockPixelPhotonProcessor>();
+    PixelBinner binner(0, 0, 5, 4, 2, output);
+    REQUIRE(binner.GetBinnedWidth() == 2);
+    REQUIRE(binner.GetBinnedHeight() == 2);
+
+    binner.HandleBeginFrame();
+    binner.HandlePixelPhoton(MakePixelPhoton(0, 0));
+    binner.HandlePixelPhoton(MakePixelPhoton(1, 1));
+    binner.HandlePixelPhoton(MakePixelPhoton(3, 2));
+    binner.HandlePixelPhoton(MakePixelPhoton(4, 0)); // Partial bin
+    binner.HandleEndFrame();
+    binner.HandleFinish();
+
+    using P = std::pair<uint32_t, uint32_t>;
+    REQUIRE(output->photons == std::vector<P>{{0, 0}, {0, 0}, {1, 1}});
+    REQUIRE(output->beginFrames == 1);
+    REQUIRE(output->endFrames == 1);
+    REQUIRE(output->finishes == 1);
+}
+
+TEST_CASE("Crop and bin", "[PixelBinner]") {
+    auto output = std::make_shared<MockPixelPhotonProcessor>();
+    PixelBinner binner(10, 20, 6, 3, 3, output);
+    REQUIRE(binner.GetBinnedWidth() == 2);
+    REQUIRE(binner.GetBinnedHeight() == 1);
+
+    binner.HandlePixelPhoton(MakePixelPhoton(9, 20));  // Left of ROI
+    binner.HandlePixelPhoton(MakePixelPhoton(10, 19)); // Above ROI
+    binner.HandlePixelPhoton(MakePixelPhoton(10, 20));
+    binner.HandlePixelPhoton(MakePixelPhoton(15, 22));
+    binner.HandlePixelPhoton(MakePixelPhoton(16, 22)); // Right of ROI
+    binner.HandlePixelPhoton(MakePixelPhoton(15, 23)); // Below ROI
+
+    using P = std::pair<uint32_t, uint32_t>;
+    REQUIRE(output->photons == std::vector<P>{{0, 0}, {1, 0}});
+}
@@ -0,0 +1,98 @@
+#include "FLIMEvents/PreviewImager.hpp"
+#include "TestHelpers.hpp"
+#include <catch2/catch.hpp>
+
+#include <vector>
+
+namespace {
+// 2x2 preview of a 4x4 (or 5x5) raster
+Histogram<uint32_t> MakeImage(std::size_t channels) {
+    return Histogram<uint32_t>(0, 12, false, 2, 2, channels);
+}
+} // namespace
+
+TEST_CASE("Preview rows are refreshed as the scan reaches them",
+          "[PreviewImager]") {
+    auto output = std::make_shared<MockHistogramProcessor<uint32_t>>();
+    PreviewImager preview(MakeImage(1), 2, std::bitset<16>(1), 12, false,
+                          false, 10, output);
+
+    preview.HandleBeginFrame();
+    preview.HandlePixelPhoton(MakePixelPhoton(0, 0));
+    preview.HandlePixelPhoton(MakePixelPhoton(1, 1, 0, 0, 1));
+    preview.HandlePixelPhoton(MakePixelPhoton(3, 2, 0, 0, 2));
+    preview.HandlePixelPhoton(MakePixelPhoton(4, 4, 0, 0, 3)); // Partial bin
+    preview.HandlePixelPhoton(MakePixelPhoton(0, 3, 0, 1, 4)); // Bad route
+    preview.HandleEndFrame();
+    REQUIRE(output->frames.empty()); // Not sent at frame end
+
+    // Second frame: only the first row has been reached
+    preview.HandleBeginFrame();
+    preview.HandlePixelPhoton(MakePixelPhoton(2, 0, 0, 0, 10));
+    REQUIRE(output->frames.size() == 1);
+    REQUIRE(output->frames[0] == std::vector<uint32_t>{2, 0, 0, 1});
+    preview.HandleFinish();
+    REQUIRE(output->finishes.size() == 1);
+    REQUIRE(output->finishes[0] == std::vector<uint32_t>{0, 1, 0, 1});
+    REQUIRE(output->finishCompleteness[0] == false);
+}
+
+TEST_CASE("Preview is sent at the update interval", "[PreviewImager]") {
+    auto output = std::make_shared<MockHistogramProcessor<uint32_t>>();
+    PreviewImager preview(MakeImage(1), 2, std::bitset<16>(1), 12, false,
+                          false, 100, output);
+
+    preview.HandleBeginFrame();
+    preview.HandlePixelPhoton(MakePixelPhoton(0, 0, 0, 0, 1000));
+    preview.HandlePixelPhoton(MakePixelPhoton(2, 0, 0, 0, 1099));
+    REQUIRE(output->frames.empty());
+    preview.HandlePixelPhoton(MakePixelPhoton(0, 2, 0, 0, 1100));
+    REQUIRE(output->frames.size() == 1);
+    // The photon that triggered the update is not yet included
+    REQUIRE(output->frames[0] == std::vector<uint32_t>{1, 1, 0, 0});
+    preview.HandlePixelPhoton(MakePixelPhoton(0, 2, 0, 0, 1150));
+    REQUIRE(output->frames.size() == 1);
+    preview.HandlePixelPhoton(MakePixelPhoton(0, 2, 0, 0, 1250));
+    REQUIRE(output->frames.size() == 2);
+    REQUIRE(output->frames[1] == std::vector<uint32_t>{1, 1, 2, 0});
+    preview.HandleEndFrame();
+    REQUIRE(output->frames.size() == 2);
+    preview.HandleFinish();
+    REQUIRE(output->finishCompleteness[0] == true);
+}
+
+TEST_CASE("Cumulative preview", "[PreviewImager]") {
+    auto output = std::make_shared<MockHistogramProcessor<uint32_t>>();
+    PreviewImager preview(MakeImage(1), 2, std::bitset<16>(1), 12, false,
+                          true, 1, output);
+
+    for (int f = 0; f < 3; ++f) {
+        preview.HandleBeginFrame();
+        preview.HandlePixelPhoton(MakePixelPhoton(1, 3, 0, 0, f));
+        preview.HandleEndFrame();
+    }
+    preview.HandleFinish();
+    REQUIRE(output->frames.size() == 2);
+    REQUIRE(output->frames[1] == std::vector<uint32_t>{0, 0, 2, 0});
+    REQUIRE(output->finishes[0] == std::vector<uint32_t>{0, 0, 3, 0});
+}
+
+TEST_CASE("Preview microtime sums", "[PreviewImager]") {
+    auto output = std::make_shared<MockHistogramProcessor<uint32_t>>();
+    PreviewImager preview(MakeImage(2), 2, std::bitset<16>(1), 4, true,
+                          false, 1000000, output);
+
+    preview.HandleBeginFrame();
+    preview.HandlePixelPhoton(MakePixelPhoton(0, 0, 3));
+    // High bits masked
+    preview.HandlePixelPhoton(MakePixelPhoton(1, 0, 0x15, 0, 1));
+    preview.HandleEndFrame();
+    preview.HandleFinish();
+    // Reversed: 15 - 3 + 15 - 5
+    REQUIRE(output->finishes[0] ==
+            std::vector<uint32_t>{2, 0, 0, 0, 22, 0, 0, 0});
+
+    REQUIRE_THROWS_AS(PreviewImager(MakeImage(3), 2, std::bitset<16>(1), 4,
+                                    false, false, 1, output),
+                      std::invalid_argument);
+}
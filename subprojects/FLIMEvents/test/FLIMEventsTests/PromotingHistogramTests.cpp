@@ -0,0 +1,244 @@
+#include "FLIMEvents/PromotingHistogram.hpp"
+#include <catch2/catch.hpp>
+
+#include <vector>
+
+TEST_CASE("Carrying add", "[ArrayArithmetic]") {
+    // Long enough to exercise both vector and scalar paths
+    std::size_t const n = GENERATE(1, 8, 17);
+    std::size_t const carryAt = GENERATE(0, 7, 16);
+    if (carryAt >= n) {
+        return;
+    }
+
+    std::vector<uint16_t> a(n, 60000);
+    std::vector<uint16_t> b(n, 5000);
+    REQUIRE_FALSE(CarryingAddArray(a.data(), b.data(), n));
+    REQUIRE(a[0] == 65000);
+
+    b[carryAt] = 600;
+    REQUIRE(CarryingAddArray(a.data(), b.data(), n));
+    std::vector<uint32_t> unwrapped(n);
+    UnwrapCarriedArray(unwrapped.data(), a.data(), b.data(), n);
+    for (std::size_t i = 0; i < n; ++i) {
+        REQUIRE(unwrapped[i] == (i == carryAt ? 65600u : 70000u));
+    }
+}
+
+TEST_CASE("Widening add", "[ArrayArithmetic]") {
+    std::size_t const n = 19;
+    std::vector<uint32_t> a(n, 100000);
+    std::vector<uint16_t> b(n);
+    for (std::size_t i = 0; i < n; ++i) {
+        b[i] = uint16_t(65535 - i);
+    }
+    WideningAddArray(a.data(), b.data(), n);
+    for (std::size_t i = 0; i < n; ++i) {
+        REQUIRE(a[i] == 165535u - i);
+    }
+}
+
+TEST_CASE("Promotes only overflowing channel", "[PromotingHistogram]") {
+    Histogram<uint16_t> zero(1, 1, false, 4, 1, 2);
+    zero.Clear();
+    PromotingHistogram cumul(std::move(zero));
+
+    Histogram<uint16_t> frame(1, 1, false, 4, 1, 2);
+    frame.Clear();
+    frame.Get()[0] = 40000; // Channel 0
+    frame.Get()[8] = 1;     // Channel 1
+
+    cumul += frame;
+    REQUIRE_FALSE(cumul.IsPromoted());
+    cumul += frame;
+    REQUIRE(cumul.IsPromoted());
+    REQUIRE(cumul.IsChannelPromoted(0));
+    REQUIRE_FALSE(cumul.IsChannelPromoted(1));
+    REQUIRE(cumul.GetWideChannel(0)[0] == 80000);
+    REQUIRE(cumul.GetNarrowChannel(1)[0] == 2);
+
+    cumul += frame;
+    REQUIRE(cumul.GetWideChannel(0)[0] == 120000);
+
+    std::vector<uint16_t> narrowCopy(8);
+    cumul.CopyChannel(0, narrowCopy.data());
+    REQUIRE(narrowCopy[0] == 65535);
+    REQUIRE(narrowCopy[1] == 0);
+
+    std::vector<uint32_t> wideCopy(8);
+    cumul.CopyChannel(1, wideCopy.data());
+    REQUIRE(wideCopy[0] == 3);
+    REQUIRE(wideCopy[7] == 0);
+}
+
+namespace {
+class MockPromotingHistogramProcessor : public PromotingHistogramProcessor {
+  public:
+    std::size_t frameCount = 0;
+    std::vector<uint32_t> finalChannel0;
+
+    void HandleError(std::string const &message) override {}
+
+    void HandleFrame(PromotingHistogram const &histogram) override {
+        ++frameCount;
+    }
+
+    void HandleFinish(PromotingHistogram &&histogram,
+                      bool isCompleteFrame) override {
+        REQUIRE(isCompleteFrame);
+        finalChannel0.resize(histogram.GetNumberOfElementsPerChannel());
+        histogram.CopyChannel(0, finalChannel0.data());
+    }
+};
+} // namespace
+
+TEST_CASE("Promoting accumulator", "[PromotingHistogram]") {
+    auto output = std::make_shared<MockPromotingHistogramProcessor>();
+    Histogram<uint16_t> zero(0, 0, false, 1, 1);
+    zero.Clear();
+    PromotingHistogramAccumulator acc(std::move(zero), output);
+
+    Histogram<uint16_t> frame(0, 0, false, 1, 1);
+    frame.Get()[0] = 30000;
+    for (int i = 0; i < 5; ++i) {
+        acc.HandleFrame(frame);
+    }
+    acc.HandleFinish({}, false);
+
+    REQUIRE(output->frameCount == 5);
+    REQUIRE(output->finalChannel0 == std::vector<uint32_t>{150000});
+}
+
+TEST_CASE("Copy promoting histogram", "[PromotingHistogram]") {
+    Histogram<uint16_t> zero(0, 0, false, 1, 1, 2);
+    zero.Clear();
+    PromotingHistogram cumul(std::move(zero));
+    Histogram<uint16_t> frame(0, 0, false, 1, 1, 2);
+    frame.Get()[0] = 50000;
+    frame.Get()[1] = 7;
+    cumul += frame;
+    cumul += frame;
+
+    PromotingHistogram copy;
+    CopyFrame(cumul, copy);
+    REQUIRE(copy.IsChannelPromoted(0));
+    REQUIRE_FALSE(copy.IsChannelPromoted(1));
+    REQUIRE(copy.GetWideChannel(0)[0] == 100000);
+    REQUIRE(copy.GetNarrowChannel(1)[0] == 14);
+}
+
+TEST_CASE("Copy-on-write promoting histogram", "[PromotingHistogram]") {
+    // 4 time bins x 3 pixels per channel; a tile holds whole pixels
+    MicrotimeBinning const binning(2, 12, false);
+    CowPromotingHistogram cumul(binning, 3, 1, 2);
+    REQUIRE(CowPromotingHistogram::GetTileElements(4) % 4 == 0);
+
+    Histogram<uint16_t> frame(binning, 3, 1, 2);
+    frame.Clear();
+    frame.Get()[0] = 40000;  // Channel 0
+    frame.Get()[12] = 1;     // Channel 1
+    frame.Get()[23] = 60000; // Channel 1
+
+    cumul += frame;
+    auto const first = cumul.Snapshot();
+    REQUIRE_FALSE(first.IsPromoted());
+    REQUIRE(first.GetNumberOfChannels() == 2);
+    REQUIRE(first.GetNumberOfElementsPerChannel() == 12);
+
+    frame.Get()[23] = 0;
+    cumul += frame;
+    auto const second = cumul.Snapshot();
+    REQUIRE(second.IsChannelPromoted(0));
+    REQUIRE_FALSE(second.IsChannelPromoted(1));
+    REQUIRE(second.GetWideChannel(0).Get(0) == 80000);
+    REQUIRE(second.GetNarrowChannel(1).Get(0) == 2);
+    REQUIRE(second.GetNarrowChannel(1).Get(11) == 60000);
+
+    cumul += frame;
+    // Earlier snapshots are unchanged
+    REQUIRE(first.GetNarrowChannel(0).Get(0) == 40000);
+    REQUIRE(second.GetWideChannel(0).Get(0) == 80000);
+    REQUIRE(cumul.Snapshot().GetWideChannel(0).Get(0) == 120000);
+
+    std::vector<uint16_t> narrowCopy(12);
+    second.CopyChannel(0, narrowCopy.data());
+    REQUIRE(narrowCopy[0] == 65535);
+    REQUIRE(narrowCopy[1] == 0);
+
+    std::vector<uint32_t> wideCopy(12);
+    second.CopyChannel(1, wideCopy.data());
+    REQUIRE(wideCopy[0] == 2);
+    REQUIRE(wideCopy[11] == 60000);
+
+    PromotingHistogramSnapshot delivered;
+    CopyFrame(second, delivered);
+    REQUIRE(delivered.GetWideChannel(0).GetTile(0) ==
+            second.GetWideChannel(0).GetTile(0));
+    ReleaseFrame(delivered);
+    REQUIRE_FALSE(delivered.IsValid());
+}
+
+TEST_CASE("Promotion across tiles", "[PromotingHistogram]") {
+    // More than one tile per channel
+    MicrotimeBinning const binning(8, 12, false);
+    std::size_t const width = 2 * CowPromotingHistogram::GetTileElements(256) /
+                              256;
+    CowPromotingHistogram cumul(binning, width, 1, 1);
+
+    Histogram<uint16_t> frame(binning, width, 1, 1);
+    frame.Clear();
+    std::size_t const last = frame.GetNumberOfElements() - 1;
+    frame.Get()[0] = 1000;
+    frame.Get()[last] = 50000;
+    cumul += frame;
+    cumul += frame;
+
+    auto const snap = cumul.Snapshot();
+    REQUIRE(snap.IsChannelPromoted(0));
+    REQUIRE(snap.GetWideChannel(0).GetNumberOfTiles() == 2);
+    REQUIRE(snap.GetWideChannel(0).Get(0) == 2000);
+    REQUIRE(snap.GetWideChannel(0).Get(last) == 100000);
+    REQUIRE(snap.GetWideChannel(0).Get(1) == 0);
+}
+
+namespace {
+class MockPromotingSnapshotProcessor
+    : public PromotingHistogramSnapshotProcessor {
+  public:
+    std::vector<PromotingHistogramSnapshot> frames;
+    std::vector<uint32_t> finalChannel0;
+
+    void HandleError(std::string const &message) override {}
+
+    void HandleFrame(PromotingHistogramSnapshot const &snapshot) override {
+        frames.push_back(snapshot);
+    }
+
+    void HandleFinish(PromotingHistogramSnapshot &&snapshot,
+                      bool isCompleteFrame) override {
+        REQUIRE(isCompleteFrame);
+        finalChannel0.resize(snapshot.GetNumberOfElementsPerChannel());
+        snapshot.CopyChannel(0, finalChannel0.data());
+    }
+};
+} // namespace
+
+TEST_CASE("Snapshot promoting accumulator", "[PromotingHistogram]") {
+    auto output = std::make_shared<MockPromotingSnapshotProcessor>();
+    MicrotimeBinning const binning(0, 0, false);
+    SnapshotPromotingHistogramAccumulator acc(
+        CowPromotingHistogram(binning, 1, 1, 1), output);
+
+    Histogram<uint16_t> frame(binning, 1, 1);
+    frame.Get()[0] = 30000;
+    for (int i = 0; i < 5; ++i) {
+        acc.HandleFrame(frame);
+    }
+    acc.HandleFinish({}, false);
+
+    // Kept snapshots are those of their frame
+    REQUIRE(output->frames.size() == 5);
+    REQUIRE(output->frames[1].GetNarrowChannel(0).Get(0) == 60000);
+    REQUIRE(output->frames[2].GetWideChannel(0).Get(0) == 90000);
+    REQUIRE(output->finalChannel0 == std::vector<uint32_t>{150000});
+}
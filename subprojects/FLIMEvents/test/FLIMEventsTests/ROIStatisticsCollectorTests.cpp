@@ -0,0 +1,97 @@
+#include "FLIMEvents/ROIStatisticsCollector.hpp"
+#include "TestHelpers.hpp"
+#include <catch2/catch.hpp>
+
+#include <vector>
+
+namespace {
+class MockROIStatisticsProcessor : public ROIStatisticsProcessor {
+  public:
+    std::vector<ROIStatistics> frames;
+    std::vector<ROIStatistics> finishes;
+    std::vector<bool> finishCompleteness;
+
+    void HandleError(std::string const &message) override {}
+
+    void HandleFrame(ROIStatistics const &stats) override {
+        frames.push_back(stats);
+    }
+
+    void HandleFinish(ROIStatistics &&stats, bool isCompleteFrame) override {
+        finishes.emplace_back(std::move(stats));
+        finishCompleteness.push_back(isCompleteFrame);
+    }
+};
+
+// 3x2 raster: ROI 0 on the left column, ROI 1 on the right column
+std::vector<uint8_t> MakeLabels() { return {1, 0, 2, 1, 0, 2}; }
+} // namespace
+
+TEST_CASE("Photons are counted per ROI", "[ROIStatisticsCollector]") {
+    std::bitset<16> mask;
+    mask.set(0);
+    mask.set(2);
+    auto output = std::make_shared<MockROIStatisticsProcessor>();
+    // 4-bit microtimes, window [4, 12) in 2 bins
+    ROIStatisticsCollector collector(
+        MakeLabels(), 3, 2, MicrotimeBinning(4, 4, 12, 2, false),
+        MakeDenseRouteChannelTable(mask), false, output);
+
+    collector.HandleBeginFrame();
+    collector.HandlePixelPhoton(MakePixelPhoton(0, 0, 4));    // ROI 0, bin 0
+    collector.HandlePixelPhoton(MakePixelPhoton(0, 1, 11));   // ROI 0, bin 1
+    collector.HandlePixelPhoton(MakePixelPhoton(0, 1, 2));    // ROI 0, no bin
+    collector.HandlePixelPhoton(MakePixelPhoton(1, 0, 4));    // No ROI
+    collector.HandlePixelPhoton(MakePixelPhoton(2, 1, 8, 2)); // Ch 1, ROI 1
+    collector.HandlePixelPhoton(MakePixelPhoton(2, 1, 8, 1)); // Bad route
+    collector.HandlePixelPhoton(MakePixelPhoton(3, 0, 8));    // Off raster
+    collector.HandleEndFrame();
+
+    REQUIRE(output->frames.size() == 1);
+    auto const &stats = output->frames[0];
+    REQUIRE(stats.numROIs == 2);
+    REQUIRE(stats.numChannels == 2);
+    REQUIRE(stats.numTimeBins == 2);
+    REQUIRE(stats.photonCounts == std::vector<uint64_t>{3, 0, 0, 1});
+    REQUIRE(stats.decays == std::vector<uint32_t>{1, 1, 0, 0, 0, 0, 0, 1});
+
+    // Not cumulative: reset at the next frame
+    collector.HandleBeginFrame();
+    collector.HandlePixelPhoton(MakePixelPhoton(2, 0, 5)); // ROI 1, bin 0
+    collector.HandleFinish();
+    REQUIRE(output->finishes.size() == 1);
+    REQUIRE(output->finishCompleteness[0] == false);
+    REQUIRE(output->finishes[0].photonCounts ==
+            std::vector<uint64_t>{0, 1, 0, 0});
+    REQUIRE(output->finishes[0].decays ==
+            std::vector<uint32_t>{0, 0, 1, 0, 0, 0, 0, 0});
+}
+
+TEST_CASE("Cumulative ROI statistics", "[ROIStatisticsCollector]") {
+    auto output = std::make_shared<MockROIStatisticsProcessor>();
+    ROIStatisticsCollector collector(
+        MakeLabels(), 3, 2, MicrotimeBinning(0, 4, false),
+        MakeDenseRouteChannelTable(std::bitset<16>(1)), true, output);
+
+    for (int f = 0; f < 3; ++f) {
+        collector.HandleBeginFrame();
+        collector.HandlePixelPhoton(MakePixelPhoton(2, 0, 7));
+        collector.HandleEndFrame();
+    }
+    collector.HandleFinish();
+    REQUIRE(output->frames.size() == 3);
+    REQUIRE(output->frames[2].photonCounts == std::vector<uint64_t>{0, 3});
+    REQUIRE(output->frames[2].decays == std::vector<uint32_t>{0, 3});
+    REQUIRE(output->finishCompleteness[0] == true);
+}
+
+TEST_CASE("Invalid ROI label maps", "[ROIStatisticsCollector]") {
+    auto const binning = MicrotimeBinning(0, 4, false);
+    auto const table = MakeDenseRouteChannelTable(std::bitset<16>(1));
+    REQUIRE_THROWS_AS(ROIStatisticsCollector(MakeLabels(), 2, 2, binning,
+                                             table, false, nullptr),
+                      std::invalid_argument);
+    REQUIRE_THROWS_AS(ROIStatisticsCollector(std::vector<uint8_t>(4), 2, 2,
+                                             binning, table, false, nullptr),
+                      std::invalid_argument);
+}
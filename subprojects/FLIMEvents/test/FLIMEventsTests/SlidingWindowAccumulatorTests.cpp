@@ -0,0 +1,95 @@
+#include "FLIMEvents/SlidingWindowAccumulator.hpp"
+#include "TestHelpers.hpp"
+#include <catch2/catch.hpp>
+
+#include <vector>
+
+TEST_CASE("Invalid window", "[SlidingWindowAccumulator]") {
+    REQUIRE_THROWS_AS(SlidingWindowAccumulator<uint16_t>(
+                          Histogram<uint16_t>(4, 12, false, 2, 2), 0, nullptr),
+                      std::invalid_argument);
+}
+
+TEST_CASE("Sum of most recent frames", "[SlidingWindowAccumulator]") {
+    std::size_t const windowFrames = GENERATE(1, 2, 3, 5);
+    std::size_t const nFrames = 7;
+
+    auto output = std::make_shared<MockHistogramProcessor<uint16_t>>();
+    Histogram<uint16_t> sum(4, 12, false, 3, 2);
+    sum.Clear();
+    SlidingWindowAccumulator<uint16_t> accumulator(std::move(sum),
+                                                   windowFrames, output);
+
+    std::vector<std::vector<uint16_t>> inputs;
+    for (std::size_t f = 0; f < nFrames; ++f) {
+        Histogram<uint16_t> frame(4, 12, false, 3, 2);
+        frame.Clear();
+        if (f % 2 == 0) { // Sparse
+            frame.Get()[f * 7 % 96] = uint16_t(1000 + f);
+        } else { // Dense
+            for (std::size_t i = 0; i < 96; ++i) {
+                frame.Get()[i] = uint16_t(i * f + 1);
+            }
+        }
+        inputs.emplace_back(frame.Get(), frame.Get() + 96);
+        accumulator.HandleFrame(frame);
+    }
+    accumulator.HandleFinish({}, false);
+
+    REQUIRE(output->frames.size() == nFrames);
+    for (std::size_t f = 0; f < nFrames; ++f) {
+        std::vector<uint16_t> expected(96);
+        std::size_t first = f + 1 >= windowFrames ? f + 1 - windowFrames : 0;
+        for (std::size_t g = first; g <= f; ++g) {
+            for (std::size_t i = 0; i < 96; ++i) {
+                expected[i] += inputs[g][i];
+            }
+        }
+        REQUIRE(output->frames[f] == expected);
+    }
+    REQUIRE(output->finishes.size() == 1);
+    REQUIRE(output->finishes[0] == output->frames.back());
+    REQUIRE(output->finishCompleteness == std::vector<bool>{true});
+}
+
+TEST_CASE("Window sum saturates without losing count",
+          "[SlidingWindowAccumulator]") {
+    bool const dense = GENERATE(false, true);
+
+    auto output = std::make_shared<MockHistogramProcessor<uint16_t>>();
+    Histogram<uint16_t> sum(4, 12, false, 3, 2);
+    sum.Clear();
+    SlidingWindowAccumulator<uint16_t> accumulator(std::move(sum), 2, output);
+
+    for (uint16_t value : {40000, 40000, 1, 0}) {
+        Histogram<uint16_t> frame(4, 12, false, 3, 2);
+        frame.Clear();
+        frame.Get()[5] = value;
+        if (dense) {
+            for (std::size_t i = 6; i < 96; ++i) {
+                frame.Get()[i] = 1;
+            }
+        }
+        accumulator.HandleFrame(frame);
+    }
+    accumulator.HandleFinish({}, false);
+
+    REQUIRE(output->frames.size() == 4);
+    REQUIRE(output->frames[0][5] == 40000);
+    REQUIRE(output->frames[1][5] == 65535);
+    REQUIRE(output->frames[2][5] == 40001);
+    REQUIRE(output->frames[3][5] == 1);
+    REQUIRE(output->finishCompleteness == std::vector<bool>{true});
+    if (dense) {
+        REQUIRE(output->frames[3][95] == 2);
+    }
+}
+
+TEST_CASE("Window too long for sum type", "[SlidingWindowAccumulator]") {
+    std::size_t const maxFrames =
+        SlidingWindowAccumulator<uint32_t>::MaxWindowFrames;
+    REQUIRE_THROWS_AS(SlidingWindowAccumulator<uint32_t>(
+                          Histogram<uint32_t>(4, 12, false, 2, 2),
+                          maxFrames + 1, nullptr),
+                      std::invalid_argument);
+}
@@ -0,0 +1,75 @@
+#include "FLIMEvents/StreamBuffer.hpp"
+#include <catch2/catch.hpp>
+
+#include <chrono>
+#include <future>
+#include <stdexcept>
+#include <vector>
+
+TEST_CASE("EventStream delivers buffers in order", "[EventStream]") {
+    EventBufferPool<uint32_t> pool(4);
+    EventStream<uint32_t> stream(2);
+
+    // More buffers than the capacity, so that the producer must wait
+    auto sent = std::async(std::launch::async, [&] {
+        for (uint32_t i = 0; i < 100; ++i) {
+            auto buf = pool.CheckOut();
+            buf->GetData()[0] = i;
+            buf->SetSize(1);
+            stream.Send(buf);
+        }
+        stream.Send({});
+    });
+
+    std::vector<uint32_t> received;
+    for (;;) {
+        auto buf = stream.ReceiveBlocking();
+        if (!buf) {
+            break;
+        }
+        received.push_back(buf->GetData()[0]);
+    }
+    sent.get();
+
+    REQUIRE(received.size() == 100);
+    for (uint32_t i = 0; i < 100; ++i) {
+        REQUIRE(received[i] == i);
+    }
+}
+
+TEST_CASE("EventStream wakes a blocked receiver", "[EventStream]") {
+    EventBufferPool<uint32_t> pool(4);
+    EventStream<uint32_t> stream;
+
+    auto received = std::async(std::launch::async, [&] {
+        auto buf = stream.ReceiveBlocking();
+        return buf ? buf->GetSize() : 0;
+    });
+    // Let the receiver get past spinning
+    REQUIRE(received.wait_for(std::chrono::milliseconds(50)) ==
+            std::future_status::timeout);
+
+    auto buf = pool.CheckOut();
+    buf->SetSize(3);
+    stream.Send(buf);
+    buf.reset();
+    REQUIRE(received.get() == 3);
+}
+
+TEST_CASE("EventStream propagates exception", "[EventStream]") {
+    EventBufferPool<uint32_t> pool(4);
+    EventStream<uint32_t> stream;
+
+    auto buf = pool.CheckOut();
+    stream.Send(buf);
+    buf.reset();
+
+    auto received = std::async(std::launch::async, [&] {
+        bool const gotBuffer = stream.ReceiveBlocking() != nullptr;
+        stream.ReceiveBlocking();
+        return gotBuffer;
+    });
+    stream.SendException(
+        std::make_exception_ptr(std::runtime_error("test error")));
+    REQUIRE_THROWS_AS(received.get(), std::runtime_error);
+}
@@ -0,0 +1,59 @@
+#pragma once
+
+#include "FLIMEvents/DecodedEvent.hpp"
+#include "FLIMEvents/Histogram.hpp"
+#include "FLIMEvents/PixelPhotonEvent.hpp"
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Records the histograms it receives, as flat copies
+template <typename T>
+class MockHistogramProcessor : public HistogramProcessor<T> {
+  public:
+    std::vector<std::vector<T>> frames;
+    std::vector<std::vector<T>> finishes;
+    std::vector<bool> finishCompleteness; // isCompleteFrame of each finish
+    std::vector<std::string> errors;
+
+    void HandleError(std::string const &message) override {
+        errors.push_back(message);
+    }
+
+    void HandleFrame(Histogram<T> const &histogram) override {
+        frames.emplace_back(histogram.Get(),
+                            histogram.Get() + histogram.GetNumberOfElements());
+    }
+
+    void HandleFinish(Histogram<T> &&histogram,
+                      bool isCompleteFrame) override {
+        finishes.emplace_back(histogram.Get(),
+                              histogram.Get() +
+                                  histogram.GetNumberOfElements());
+        finishCompleteness.push_back(isCompleteFrame);
+    }
+};
+
+inline PixelPhotonEvent MakePixelPhoton(uint32_t x, uint32_t y,
+                                        uint16_t microtime = 0,
+                                        uint16_t route = 0,
+                                        uint64_t macrotime = 0) {
+    PixelPhotonEvent e{};
+    e.macrotime = macrotime;
+    e.microtime = microtime;
+    e.route = route;
+    e.x = x;
+    e.y = y;
+    return e;
+}
+
+inline ValidPhotonEvent MakeValidPhoton(uint64_t macrotime,
+                                        uint16_t microtime = 0,
+                                        uint16_t route = 0) {
+    ValidPhotonEvent e{};
+    e.macrotime = macrotime;
+    e.microtime = microtime;
+    e.route = route;
+    return e;
+}
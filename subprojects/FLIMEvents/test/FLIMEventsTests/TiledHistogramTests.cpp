@@ -0,0 +1,114 @@
+#include "FLIMEvents/Histogram.hpp"
+#include "FLIMEvents/TiledHistogram.hpp"
+#include <catch2/catch.hpp>
+
+#include <cstdio>
+#include <fstream>
+#include <random>
+#include <vector>
+
+namespace {
+std::string const backingFile = "TiledHistogramTests.tmp";
+
+bool FileExists(std::string const &name) {
+    return std::ifstream(name).good();
+}
+
+class TiledSink : public TiledHistogramProcessor<uint16_t> {
+  public:
+    std::shared_ptr<TiledHistogram<uint16_t>> result;
+    bool completeFrame = false;
+    std::string error;
+
+    void HandleError(std::string const &message) override { error = message; }
+
+    void HandleFinish(std::shared_ptr<TiledHistogram<uint16_t>> histogram,
+                      bool isCompleteFrame) override {
+        result = histogram;
+        completeFrame = isCompleteFrame;
+    }
+};
+} // namespace
+
+TEST_CASE("Tiled histogram matches in-memory histogram", "[TiledHistogram]") {
+    auto linesPerTile = GENERATE(1, 3, 8);
+    auto maxCachedTiles = GENERATE(1, 2, 100);
+
+    std::size_t const width = 5, height = 8, channels = 2;
+    Histogram<uint16_t> reference(3, 5, true, width, height, channels);
+    reference.Clear();
+    {
+        TiledHistogram<uint16_t> tiled(MicrotimeBinning(3, 5, true), width,
+                                       height, channels, linesPerTile,
+                                       maxCachedTiles, backingFile);
+
+        std::mt19937 rng(42);
+        for (int i = 0; i < 5000; ++i) {
+            std::size_t t = rng() % 32;
+            std::size_t x = rng() % width;
+            std::size_t y = rng() % height;
+            std::size_t c = rng() % channels;
+            reference.Increment(t, x, y, c);
+            tiled.Increment(t, x, y, c);
+        }
+        std::size_t const tiles =
+            channels * ((height + linesPerTile - 1) / linesPerTile);
+        REQUIRE(tiled.HasSpilled() == (std::size_t(maxCachedTiles) < tiles));
+
+        // Read in odd-sized chunks spanning tile boundaries
+        std::size_t const n = tiled.GetNumberOfElementsPerChannel();
+        std::vector<uint16_t> data(n);
+        for (std::size_t c = 0; c < channels; ++c) {
+            for (std::size_t offset = 0; offset < n; offset += 7) {
+                tiled.Read(c, offset, data.data() + offset,
+                           (std::min)(std::size_t(7), n - offset));
+            }
+            std::vector<uint16_t> expected(reference.GetChannel(c),
+                                           reference.GetChannel(c) + n);
+            REQUIRE(data == expected);
+        }
+    }
+    REQUIRE_FALSE(FileExists(backingFile));
+}
+
+TEST_CASE("Tiled histogram saturates", "[TiledHistogram]") {
+    TiledHistogram<uint8_t> tiled(MicrotimeBinning(0, 0, false), 1, 2, 1, 1,
+                                  1, backingFile);
+    for (int i = 0; i < 300; ++i) {
+        tiled.Increment(0, 0, 0);
+        tiled.Increment(0, 0, 1); // Forces a spill each time
+    }
+    uint8_t data[2];
+    tiled.Read(0, 0, data, 2);
+    REQUIRE(data[0] == 255);
+    REQUIRE(data[1] == 255);
+}
+
+TEST_CASE("Tiled histogrammer", "[TiledHistogram]") {
+    auto histogram = std::make_shared<TiledHistogram<uint16_t>>(
+        MicrotimeBinning(0, 0, false), 2, 2, 2, 1, 4, backingFile);
+    auto sink = std::make_shared<TiledSink>();
+    TiledHistogrammer<uint16_t> histogrammer(
+        histogram, MakeDenseRouteChannelTable(0b1010), sink);
+    histogram.reset();
+
+    // Photons accumulate over frames
+    for (int frame = 0; frame < 2; ++frame) {
+        histogrammer.HandleBeginFrame();
+        histogrammer.HandlePixelPhoton({0, 1, 0, 1, 0});
+        histogrammer.HandlePixelPhoton({0, 3, 0, 1, 0});
+        histogrammer.HandlePixelPhoton({0, 0, 0, 1, 0}); // Route not enabled
+        histogrammer.HandleEndFrame();
+    }
+    histogrammer.HandleFinish();
+
+    REQUIRE(sink->error.empty());
+    REQUIRE(sink->completeFrame);
+    REQUIRE(sink->result);
+    uint16_t data[4];
+    sink->result->Read(0, 0, data, 4);
+    REQUIRE(data[2] == 2);
+    REQUIRE(data[0] + data[1] + data[3] == 0);
+    sink->result->Read(1, 0, data, 4);
+    REQUIRE(data[2] == 2);
+}